@@ -16,7 +16,9 @@
 #include "rts/operator/MergeUnion.hpp"
 #include "rts/operator/NestedLoopFilter.hpp"
 #include "rts/operator/NestedLoopJoin.hpp"
+#include "rts/operator/PropertyPathScan.hpp"
 #include "rts/operator/ResultsPrinter.hpp"
+#include "rts/operator/Scheduler.hpp"
 #include "rts/operator/Selection.hpp"
 #include "rts/operator/SingletonScan.hpp"
 #include "rts/operator/Sort.hpp"
@@ -41,6 +43,9 @@
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
+/// Plans that touch fewer tuples run on a single worker, copying the operator tree would cost more than it saves
+static const Plan::card_t minParallelCardinality = 50000;
+//---------------------------------------------------------------------------
 /// Structure for bindings, we use either single-value binding with Register, or vector-value binding with Vector Register
 struct Binding{
    map<unsigned,Register*> valuebinding;
@@ -147,9 +152,55 @@ static Operator* translateRegularPathScan(Runtime& runtime,const map<unsigned,Re
    if (node.pathmod==QueryGraph::Node::Mul){
    	mod=RegularPathScan::Mul;
    }
+   // Use the caller-provided index, or load the persisted one
+   Index*& index=ferrari[node.predicate];
+   if (!index)
+      index=runtime.getDatabase().getReachabilityIndex(node.predicate);
    // Construct the operator
    return RegularPathScan::create(runtime.getDatabase(),static_cast<Database::DataOrder>(plan->opArg),
-   										subject,constSubject,object,constObject,plan->cardinality,mod,node.predicate,ferrari[node.predicate]);
+   										subject,constSubject,object,constObject,plan->cardinality,mod,node.predicate,index);
+}
+//---------------------------------------------------------------------------
+static Operator* translatePropertyPathScan(Runtime& runtime,const map<unsigned,Register*>& context,const set<unsigned>& projection,Binding& bindings,const MapRegister& registers,Plan* plan,QueryGraph::Filter* /*pathfilter*/,map<unsigned,Index*>& ferrari)
+// Translate a property path into an operator tree
+{
+   const QueryGraph::Node& node=*reinterpret_cast<QueryGraph::Node*>(plan->right);
+   // Initialize the registers
+   bool constSubject,constObject;
+   Register* subject,*object;
+   resolveScanVariable(runtime,context,projection,bindings.valuebinding,registers.valueregister,0,node,subject,constSubject);
+   resolveScanVariable(runtime,context,projection,bindings.valuebinding,registers.valueregister,2,node,object,constObject);
+
+   // Translate the steps, single-step paths end up here if their ends are not joined
+   vector<QueryGraph::Node::PathStep> path=node.path;
+   if (path.empty()) {
+      QueryGraph::Node::PathStep step;
+      step.predicate=node.predicate;
+      step.modifier=node.pathmod;
+      path.push_back(step);
+   }
+   vector<PropertyPathScan::Step> steps;
+   for (vector<QueryGraph::Node::PathStep>::const_iterator iter=path.begin(),limit=path.end();iter!=limit;++iter) {
+      PropertyPathScan::Step step;
+      step.predicate=(*iter).predicate;
+      step.ferrari=0;
+      switch ((*iter).modifier) {
+         case QueryGraph::Node::One: step.modifier=PropertyPathScan::One; break;
+         case QueryGraph::Node::Add: step.modifier=PropertyPathScan::Add; break;
+         case QueryGraph::Node::Mul: step.modifier=PropertyPathScan::Mul; break;
+      }
+      // Starred steps can use the reachability index
+      if (step.modifier!=PropertyPathScan::One) {
+         Index*& index=ferrari[step.predicate];
+         if (!index)
+            index=runtime.getDatabase().getReachabilityIndex(step.predicate);
+         step.ferrari=index;
+      }
+      steps.push_back(step);
+   }
+
+   // Construct the operator
+   return new PropertyPathScan(runtime.getDatabase(),subject,constSubject,object,constObject,steps,plan->cardinality);
 }
 //---------------------------------------------------------------------------
 static Operator* translateIndexScan(Runtime& runtime,const map<unsigned,Register*>& context,const set<unsigned>& projection,Binding& bindings,const MapRegister& registers,Plan* plan,QueryGraph::Filter* /*pathfilter*/)
@@ -227,7 +278,8 @@ static void collectVariables(const map<unsigned,Register*>& context,set<unsigned
       case Plan::AggregatedIndexScan:
       case Plan::FullyAggregatedIndexScan:
       case Plan::DijkstraScan:
-      case Plan::RegularPath:{
+      case Plan::RegularPath:
+      case Plan::PropertyPath:{
          const QueryGraph::Node& node=*reinterpret_cast<QueryGraph::Node*>(plan->right);
          if ((!node.constSubject)&&(!context.count(node.subject)))
             variables.insert(node.subject);
@@ -383,6 +435,41 @@ static void setRegularPathSubtree(Operator* result, Operator* subTree, vector<Re
 	}
 }
 //---------------------------------------------------------------------------
+static Operator* feedRegularPath(Runtime& runtime,Plan*& plan,Plan* pathPlan,Operator* pathTree,Operator* inputTree,const set<unsigned>& joinVariables,Binding& pathBindings,Binding& inputBindings)
+   // Use a join input as input of a reachability check
+{
+   const QueryGraph::Node& node=*reinterpret_cast<QueryGraph::Node*>(pathPlan->right);
+   RegularPathScan* scan=dynamic_cast<RegularPathScan*>(pathTree);
+
+   // Find the end of the path that is fed by the input. A path with a constant end has only one input
+   unsigned joinOn,slot;
+   if (node.constSubject||node.constObject) {
+      joinOn=node.constSubject?node.object:node.subject;
+      slot=0;
+   } else if (joinVariables.count(node.subject)&&(!scan->isFirstInputSet())) {
+      joinOn=node.subject;
+      slot=0;
+   } else {
+      joinOn=node.object;
+      slot=2;
+   }
+   vector<Register*> tail;
+   for (map<unsigned,Register*>::const_iterator iter=inputBindings.valuebinding.begin(),limit=inputBindings.valuebinding.end();iter!=limit;++iter)
+      if ((*iter).first!=joinOn)
+         tail.push_back((*iter).second);
+   setRegularPathSubtree(pathTree,inputTree,tail,inputBindings.valuebinding[joinOn],slot);
+
+   // Joins further up feed the remaining input
+   if (!scan->isComplete()) {
+      plan->op=Plan::RegularPath;
+      plan->right=pathPlan->right;
+      return pathTree;
+   }
+
+   // Check the other join conditions
+   return addAdditionalSelections(runtime,pathTree,joinVariables,pathBindings,inputBindings,joinOn);
+}
+//---------------------------------------------------------------------------
 static Operator* translateMergeJoin(Runtime& runtime,const map<unsigned,Register*>& context,const set<unsigned>& projection,Binding& bindings,const MapRegister& registers,Plan*& plan,QueryGraph::Filter* pathfilter,map<unsigned,Index*>& ferrari)
    // Translate a merge join into an operator tree
 {
@@ -414,22 +501,9 @@ static Operator* translateMergeJoin(Runtime& runtime,const map<unsigned,Register
 			rightTail.push_back((*iter).second);
 
    if (plan->left->op==Plan::RegularPath){
-      const QueryGraph::Node& node=*reinterpret_cast<QueryGraph::Node*>(plan->left->right);
-
-   	result=leftTree;
-   	plan->op=Plan::RegularPath;
-   	plan->right=plan->left->right;
-   	unsigned slot=(node.subject==joinOn)?0:2;
-   	setRegularPathSubtree(leftTree,rightTree,rightTail,rightBindings.valuebinding[joinOn],slot);
+      result=feedRegularPath(runtime,plan,plan->left,leftTree,rightTree,joinVariables,leftBindings,rightBindings);
    } else if (plan->right->op==Plan::RegularPath){
-      const QueryGraph::Node& node=*reinterpret_cast<QueryGraph::Node*>(plan->right->right);
-
-   	result=rightTree;
-   	plan->op=Plan::RegularPath;
-   	plan->right=plan->right->right;
-   	unsigned slot=(node.subject==joinOn)?0:2;
-
-   	setRegularPathSubtree(rightTree,leftTree,leftTail,leftBindings.valuebinding[joinOn],slot);
+      result=feedRegularPath(runtime,plan,plan->right,rightTree,leftTree,joinVariables,rightBindings,leftBindings);
    } else {
    	// Build the operator
    	result=new MergeJoin(leftTree,leftBindings.valuebinding[joinOn],leftTail,rightTree,rightBindings.valuebinding[joinOn],rightTail,plan->cardinality);
@@ -472,24 +546,11 @@ static Operator* translateHashJoin(Runtime& runtime,const map<unsigned,Register*
    Operator* result=0;
 
    if (plan->left->op==Plan::RegularPath){
-   	result=leftTree;
-      const QueryGraph::Node& node=*reinterpret_cast<QueryGraph::Node*>(plan->left->right);
-   	plan->op=Plan::RegularPath;
-   	plan->right=plan->left->right;
-   	unsigned slot=(node.subject==joinOn)?0:2;
-
-   	setRegularPathSubtree(result,rightTree,rightTail,rightBindings.valuebinding[joinOn],slot);
-   }
-   else if (plan->right->op==Plan::RegularPath){
-   	result=rightTree;
-      const QueryGraph::Node& node=*reinterpret_cast<QueryGraph::Node*>(plan->right->right);
-   	plan->right=plan->right->right;
-   	plan->op=Plan::RegularPath;
-   	unsigned slot=(node.subject==joinOn)?0:2;
-
-   	setRegularPathSubtree(result,leftTree,leftTail,leftBindings.valuebinding[joinOn],slot);
+      result=feedRegularPath(runtime,plan,plan->left,leftTree,rightTree,joinVariables,leftBindings,rightBindings);
+   } else if (plan->right->op==Plan::RegularPath){
+      result=feedRegularPath(runtime,plan,plan->right,rightTree,leftTree,joinVariables,rightBindings,leftBindings);
    } else {
-   	result=new HashJoin(leftTree,leftBindings.valuebinding[joinOn],leftTail,rightTree,rightBindings.valuebinding[joinOn],rightTail,-plan->left->costs,plan->right->costs,plan->cardinality);
+   	result=new HashJoin(leftTree,leftBindings.valuebinding[joinOn],leftTail,rightTree,rightBindings.valuebinding[joinOn],rightTail,plan->cardinality);
 
    	// And apply additional selections if necessary
    	result=addAdditionalSelections(runtime,result,joinVariables,leftBindings,rightBindings,joinOn);
@@ -798,6 +859,7 @@ static Operator* translatePlan(Runtime& runtime,const map<unsigned,Register*>& c
       case Plan::FullyAggregatedIndexScan: result=translateFullyAggregatedIndexScan(runtime,context,projection,bindings,registers,plan,pathfilter); break;
       case Plan::DijkstraScan: result = translateDijkstraScan(runtime,context,projection,bindings,registers,plan,pathfilter); break;
       case Plan::RegularPath: result=translateRegularPathScan(runtime,context,projection,bindings,registers,plan,pathfilter,ferrari); break;
+      case Plan::PropertyPath: result=translatePropertyPathScan(runtime,context,projection,bindings,registers,plan,pathfilter,ferrari); break;
       case Plan::NestedLoopJoin: result=translateNestedLoopJoin(runtime,context,projection,bindings,registers,plan,pathfilter,ferrari); break;
       case Plan::MergeJoin: result=translateMergeJoin(runtime,context,projection,bindings,registers,plan,pathfilter,ferrari); break;
       case Plan::HashJoin: result=translateHashJoin(runtime,context,projection,bindings,registers,plan,pathfilter,ferrari); break;
@@ -954,6 +1016,34 @@ Operator* CodeGen::translateIntern(Runtime& runtime,const QueryGraph& query,Plan
    return tree;
 }
 //---------------------------------------------------------------------------
+static Plan::card_t maxCardinality(const Plan* plan)
+   // The largest estimated cardinality of any operator in a plan
+{
+   // Scans and table functions keep their query graph entry in right
+   switch (plan->op) {
+      case Plan::NestedLoopJoin:
+      case Plan::MergeJoin:
+      case Plan::HashJoin:
+      case Plan::Union:
+      case Plan::MergeUnion:
+         return max(plan->cardinality,max(maxCardinality(plan->left),maxCardinality(plan->right)));
+      case Plan::HashGroupify:
+      case Plan::Filter:
+      case Plan::PathFilter:
+      case Plan::TableFunction:
+         return max(plan->cardinality,maxCardinality(plan->left));
+      case Plan::IndexScan:
+      case Plan::AggregatedIndexScan:
+      case Plan::FullyAggregatedIndexScan:
+      case Plan::DijkstraScan:
+      case Plan::RegularPath:
+      case Plan::PropertyPath:
+      case Plan::Singleton:
+         break;
+   }
+   return plan->cardinality;
+}
+//---------------------------------------------------------------------------
 Operator* CodeGen::translate(Runtime& runtime,const QueryGraph& query,Plan* plan, map<unsigned,Index*>& ferrari,bool silent)
    // Perform a naive translation of a query into an operator tree
 {
@@ -982,8 +1072,24 @@ Operator* CodeGen::translate(Runtime& runtime,const QueryGraph& query,Plan* plan
 	   }
 	   tree=new DescribeScan(runtime.getDatabase(),tree,output,output.valueoutput[regSize-3],output.valueoutput[regSize-2],output.valueoutput[regSize-1],0);
 	   tree=new ResultsPrinter(runtime,tree,descrOutput,duplicateHandling,query.getLimit(),silent);
-   } else
-	   tree=new ResultsPrinter(runtime,tree,output,duplicateHandling,query.getLimit(),silent);
+   } else {
+      ResultsPrinter* printer=new ResultsPrinter(runtime,tree,output,duplicateHandling,query.getLimit(),silent);
+      // Exchange batches if the whole pipeline produces them natively
+      bool batchMode=output.pathoutput.empty()&&tree->supportsBatches();
+      printer->setBatchMode(batchMode);
+      tree=printer;
+
+      // Large batch pipelines without limit are executed by all workers, each on its own copy of the tree
+      if (batchMode&&(!~query.getLimit())&&(!runtime.hasDifferentialIndex())&&(maxCardinality(plan)>=minParallelCardinality)) {
+         TemporaryDictionary* temporaryDictionary=runtime.hasTemporaryDictionary()?(&runtime.getTemporaryDictionary()):0;
+         for (unsigned worker=1,workers=Scheduler::getWorkerCount();worker<workers;worker++) {
+            Runtime* workerRuntime=new Runtime(runtime.getDatabase(),0,temporaryDictionary);
+            Output workerOutput;
+            Operator* workerTree=translateIntern(*workerRuntime,query,plan,workerOutput,ferrari);
+            printer->addWorker(workerRuntime,workerTree,workerOutput);
+         }
+      }
+   }
    return tree;
 }
 //---------------------------------------------------------------------------
@@ -65,6 +65,7 @@ void Plan::print(unsigned indent) const
       case DijkstraScan: cout<<"DijkstraScan"; break;
       case PathFilter: cout<<"PathFilter"; break;
       case RegularPath: cout<<"RegularPath"; break;
+      case PropertyPath: cout<<"PropertyPath"; break;
    }
    cout << " cardinality=" << cardinality << " costs=" << costs << endl;
    switch (op) {
@@ -83,6 +84,7 @@ void Plan::print(unsigned indent) const
       case Singleton: break;
       case PathFilter: break;
       case RegularPath: break;
+      case PropertyPath: break;
    }
 }
 //---------------------------------------------------------------------------
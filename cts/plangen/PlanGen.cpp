@@ -5,6 +5,7 @@
 #include "rts/segment/FullyAggregatedFactsSegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
 #include "rts/segment/ExactStatisticsSegment.hpp"
+#include "rts/segment/FerrariSegment.hpp"
 #include "rts/segment/PathSelectivitySegment.hpp"
 #include "rts/runtime/TemporaryDictionary.hpp"
 #include "rts/runtime/Runtime.hpp"
@@ -187,6 +188,51 @@ static unsigned getCardinality(Database& db,Database::DataOrder order,unsigned c
    return db.getExactStatistics().getCardinality(c1,c2,c3);
 }
 //---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Estimates for one step of a property path
+struct ClosureEstimate {
+   /// The number of nodes
+   double nodes;
+   /// The average number of nodes reached from a node
+   double reachable;
+   /// The average number of intervals per node in the reachability index
+   double intervals;
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+static ClosureEstimate estimateClosure(Database& db,unsigned predicate,QueryGraph::Node::PathModifier modifier)
+   // Estimate the nodes reached by one step of a property path
+{
+   ClosureEstimate result;
+   double edges=getCardinality(db,Database::Order_Predicate_Subject_Object,predicate,~0u,~0u);
+   if (edges<1) edges=1;
+
+   // Use the statistics of the reachability index if available
+   FerrariSegment::Statistics stats;
+   FerrariSegment* ferrari=db.getFerrari();
+   if (ferrari&&ferrari->getStatistics(predicate,stats)&&stats.nodes) {
+      result.nodes=stats.nodes;
+      result.reachable=static_cast<double>(stats.reachable)/stats.nodes;
+      result.intervals=stats.components?(static_cast<double>(stats.intervals)/stats.components):0;
+   } else {
+      // Assume a sparse forest
+      result.nodes=2*edges;
+      result.reachable=min(result.nodes,10.0);
+      result.intervals=1;
+   }
+
+   // Roughly half of the nodes have outgoing edges
+   double fanout=max(1.0,2*edges/result.nodes);
+   switch (modifier) {
+      case QueryGraph::Node::One: result.reachable=fanout; break;
+      case QueryGraph::Node::Add: result.reachable=max(fanout,result.reachable-1); break;
+      case QueryGraph::Node::Mul: break;
+   }
+   return result;
+}
+//---------------------------------------------------------------------------
 void PlanGen::buildDijkstraScan(const QueryGraph::SubQuery& query,Database::DataOrder order,Problem* result,unsigned predicate,unsigned subj,unsigned obj){
 	// Initialize a new plan
 	Plan* plan=plans.alloc();
@@ -310,7 +356,7 @@ void PlanGen::buildUnfixedDijkstraScan(const QueryGraph::SubQuery& query,Problem
    addPlan(result,plan);
 }
 //---------------------------------------------------------------------------
-void PlanGen::buildRegularPath(const QueryGraph::SubQuery& query,Problem* result,unsigned value1,unsigned value3)
+void PlanGen::buildRegularPath(const QueryGraph::SubQuery& /*query*/,const QueryGraph::Node& node,Problem* result,unsigned value1,unsigned value3)
 // Build a regular path scan
 {
 	// New plan
@@ -318,8 +364,7 @@ void PlanGen::buildRegularPath(const QueryGraph::SubQuery& query,Problem* result
 	plan->op=Plan::RegularPath;
 	plan->right=0;
 	plan->next=0;
-	plan->cardinality=~0u;
-	plan->costs=~0u;
+	plan->ordering=~0u;
 
 	if (!~value3){
 		plan->opArg=Database::Order_Object_Predicate_Subject;
@@ -327,12 +372,184 @@ void PlanGen::buildRegularPath(const QueryGraph::SubQuery& query,Problem* result
 	else /*if (!~value1)*/{
 		plan->opArg=Database::Order_Subject_Predicate_Object;
 	}
+
+	// The check does nothing until its inputs are joined in, see buildRegularPathJoin
+	ClosureEstimate estimate=estimateClosure(*db,node.predicate,node.pathmod);
+	plan->cardinality=((~value1)&&(~value3))?(estimate.nodes*estimate.reachable):estimate.reachable;
+	plan->costs=0;
+
+   // Filters are applied after the joins, the join inputs must be the scan itself
+   addPlan(result,plan);
+}
+//---------------------------------------------------------------------------
+void PlanGen::buildPropertyPath(const QueryGraph::SubQuery& query,const QueryGraph::Node& node,Problem* result,unsigned value1,unsigned value3)
+// Build a property path scan
+{
+	// New plan
+	Plan* plan=plans.alloc();
+	plan->op=Plan::PropertyPath;
+	plan->right=0;
+	plan->next=0;
+	plan->opArg=0;
+	// Paths from unbound subjects are produced in subject order
+	plan->ordering=((~value1)&&(~value3))?value1:~0u;
+
+	// Estimate the nodes reached from each start node, and the lookups to find them
+	vector<QueryGraph::Node::PathStep> path=node.path;
+	if (path.empty()) {
+		QueryGraph::Node::PathStep step;
+		step.predicate=node.predicate;
+		step.modifier=node.pathmod;
+		path.push_back(step);
+	}
+	double reached=1,lookups=1,sources=1;
+	for (vector<QueryGraph::Node::PathStep>::const_iterator iter=path.begin(),limit=path.end();iter!=limit;++iter) {
+		ClosureEstimate estimate=estimateClosure(*db,(*iter).predicate,(*iter).modifier);
+		if ((iter==path.begin())&&(~value1)&&(~value3))
+			sources=estimate.nodes/2;
+		reached*=estimate.reachable;
+		lookups+=reached;
+	}
+	if ((~value1)&&(~value3))
+		plan->cardinality=sources*reached;
+	else if ((~value1)||(~value3))
+		plan->cardinality=reached;
+	else
+		plan->cardinality=1;
+	if (plan->cardinality<1) plan->cardinality=1;
+	plan->costs=Costs::pathExpansion(sources*lookups);
+
    plan=buildFilters(plans,query,plan,value1,~0u,value3);
 
    // Store it
    addPlan(result,plan);
 }
 //---------------------------------------------------------------------------
+static void collectVariables(const Plan* plan,set<unsigned>& vars)
+   // Collect all variables bound by a plan
+{
+   switch (plan->op) {
+      case Plan::IndexScan:
+      case Plan::AggregatedIndexScan:
+      case Plan::FullyAggregatedIndexScan:
+      case Plan::DijkstraScan:
+      case Plan::RegularPath:
+      case Plan::PropertyPath: {
+         const QueryGraph::Node& node=*reinterpret_cast<const QueryGraph::Node*>(plan->right);
+         if (!node.constSubject) vars.insert(node.subject);
+         if (!node.constPredicate) vars.insert(node.predicate);
+         if (!node.constObject) vars.insert(node.object);
+         break;
+      }
+      case Plan::NestedLoopJoin:
+      case Plan::MergeJoin:
+      case Plan::HashJoin:
+      case Plan::Union:
+      case Plan::MergeUnion:
+         collectVariables(plan->left,vars);
+         collectVariables(plan->right,vars);
+         break;
+      case Plan::HashGroupify:
+      case Plan::Filter:
+      case Plan::PathFilter:
+         collectVariables(plan->left,vars);
+         break;
+      case Plan::TableFunction: {
+         const QueryGraph::TableFunction& func=*reinterpret_cast<const QueryGraph::TableFunction*>(plan->right);
+         vars.insert(func.output.begin(),func.output.end());
+         collectVariables(plan->left,vars);
+         break;
+      }
+      case Plan::Singleton:
+         break;
+   }
+}
+//---------------------------------------------------------------------------
+static const QueryGraph::Node* openPath(const Plan* plan,vector<unsigned>& pending)
+   // Find a reachability check that still waits for join inputs, and the ends it waits for
+{
+   pending.clear();
+   if (plan->op==Plan::RegularPath) {
+      const QueryGraph::Node& node=*reinterpret_cast<const QueryGraph::Node*>(plan->right);
+      if (!node.constSubject) pending.push_back(node.subject);
+      if (!node.constObject) pending.push_back(node.object);
+      return &node;
+   }
+   if (plan->op!=Plan::HashJoin)
+      return 0;
+
+   // Joins that feed a check have it as direct input, see CodeGen
+   for (unsigned side=0;side<2;side++) {
+      const Plan* input=side?plan->right:plan->left,*other=side?plan->left:plan->right;
+      if ((input->op!=Plan::RegularPath)&&(input->op!=Plan::HashJoin))
+         continue;
+      const QueryGraph::Node* node=openPath(input,pending);
+      if (!node)
+         continue;
+      set<unsigned> vars;
+      collectVariables(other,vars);
+      vector<unsigned> remaining;
+      for (vector<unsigned>::const_iterator iter=pending.begin(),limit=pending.end();iter!=limit;++iter)
+         if (!vars.count(*iter))
+            remaining.push_back(*iter);
+      pending.swap(remaining);
+      return pending.empty()?0:node;
+   }
+   return 0;
+}
+//---------------------------------------------------------------------------
+bool PlanGen::buildRegularPathJoin(Problem* problem,Plan* leftPlan,Plan* rightPlan)
+   // Feed a reachability check with a join input. Returns false if no check is waiting for input
+{
+   vector<unsigned> leftPending,rightPending;
+   const QueryGraph::Node* leftPath=openPath(leftPlan,leftPending),*rightPath=openPath(rightPlan,rightPending);
+   if ((!leftPath)&&(!rightPath))
+      return false;
+   if (leftPath&&rightPath)
+      return true;
+   Plan* pathPlan=leftPath?leftPlan:rightPlan,*input=leftPath?rightPlan:leftPlan;
+   const QueryGraph::Node& node=leftPath?(*leftPath):(*rightPath);
+   const vector<unsigned>& pending=leftPath?leftPending:rightPending;
+
+   // The input must bind exactly one of the missing ends
+   set<unsigned> vars;
+   collectVariables(input,vars);
+   unsigned fed=0;
+   for (vector<unsigned>::const_iterator iter=pending.begin(),limit=pending.end();iter!=limit;++iter)
+      if (vars.count(*iter))
+         fed++;
+   if (fed!=1)
+      return true;
+
+   Plan* p=plans.alloc();
+   p->op=Plan::HashJoin;
+   p->opArg=0;
+   p->left=pathPlan;
+   p->right=input;
+   p->next=0;
+   p->ordering=~0u;
+
+   ClosureEstimate estimate=estimateClosure(*db,node.predicate,node.pathmod);
+   if (pending.size()>1) {
+      // The work happens once the other end is joined in
+      p->cardinality=input->cardinality*estimate.reachable;
+      p->costs=pathPlan->costs+input->costs;
+   } else if (pathPlan->op==Plan::RegularPath) {
+      // A constant end, check each input tuple
+      p->cardinality=input->cardinality*estimate.reachable/estimate.nodes;
+      p->costs=pathPlan->costs+input->costs+Costs::reachabilityProbe(input->cardinality,estimate.intervals);
+   } else {
+      // The smaller input is stored, the other one probes the index
+      const Plan* first=(pathPlan->left->op==Plan::RegularPath)?pathPlan->right:pathPlan->left;
+      double stored=min(first->cardinality,input->cardinality),probe=max(first->cardinality,input->cardinality);
+      p->cardinality=first->cardinality*input->cardinality*estimate.reachable/estimate.nodes;
+      p->costs=pathPlan->costs+input->costs+Costs::reachabilityJoin(stored,probe,estimate.intervals,p->cardinality);
+   }
+   if (p->cardinality<1) p->cardinality=1;
+   addPlan(problem,p);
+   return true;
+}
+//---------------------------------------------------------------------------
 void PlanGen::buildIndexScan(const QueryGraph::SubQuery& query,Database::DataOrder order,Problem* result,unsigned value1,unsigned value1C,unsigned value2,unsigned value2C,unsigned value3,unsigned value3C)
    // Build an index scan
 {
@@ -477,6 +694,25 @@ static bool isUnused(const QueryGraph::SubQuery& query,const QueryGraph::Node& n
    return true;
 }
 //---------------------------------------------------------------------------
+static bool usesVariable(const QueryGraph::Node& node,unsigned val)
+   // Does a pattern use a variable?
+{
+   return ((!node.constSubject)&&(val==node.subject))||((!node.constPredicate)&&(val==node.predicate))||((!node.constObject)&&(val==node.object));
+}
+//---------------------------------------------------------------------------
+static bool canFeed(const QueryGraph::SubQuery& query,const QueryGraph::Node& node,unsigned end,unsigned other)
+   // Is there another pattern of the subquery that binds one end of a path without the other end?
+{
+   for (vector<QueryGraph::Node>::const_iterator iter=query.nodes.begin(),limit=query.nodes.end();iter!=limit;++iter) {
+      const QueryGraph::Node& n=*iter;
+      if ((&n)==(&node))
+         continue;
+      if (usesVariable(n,end)&&((!~other)||(!usesVariable(n,other))))
+         return true;
+   }
+   return false;
+}
+//---------------------------------------------------------------------------
 static bool isUnused(const QueryGraph& query,const QueryGraph::Node& node,unsigned val)
    // Check if a variable is unused outside its primary pattern
 {
@@ -517,7 +753,13 @@ PlanGen::Problem* PlanGen::buildScan(const QueryGraph::SubQuery& query,const Que
 	   }
    }
    else if (node.propertyPath){
-   	buildRegularPath(query,result,s,o);
+      // The reachability check needs each unbound end fed by a separate join input
+      bool subjectFed=node.constSubject||canFeed(query,node,node.subject,node.constObject?~0u:node.object);
+      bool objectFed=node.constObject||canFeed(query,node,node.object,node.constSubject?~0u:node.subject);
+      if (node.path.empty()&&subjectFed&&objectFed&&!(node.constSubject&&node.constObject))
+         buildRegularPath(query,node,result,s,o);
+      else
+         buildPropertyPath(query,node,result,s,o);
    } else {
 	   // Build all relevant scans
 	   if ((unusedSubject+unusedPredicate+unusedObject)>=2) {
@@ -806,6 +1048,7 @@ static void findFilters(Plan* plan,set<const QueryGraph::Filter*>& filters)
       case Plan::FullyAggregatedIndexScan:
       case Plan::DijkstraScan:
       case Plan::RegularPath:
+      case Plan::PropertyPath:
       case Plan::Singleton:
          // We reached a leaf.
          break;
@@ -936,6 +1179,12 @@ Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
       joins.push_back(join);
    }
 
+   // Reachability checks need special join handling
+   bool regularPaths=false;
+   for (Problem* iter=dpTable[0];iter;iter=iter->next)
+      for (Plan* iter2=iter->plans;iter2;iter2=iter2->next)
+         if (iter2->op==Plan::RegularPath)
+            regularPaths=true;
    // Build larger join trees
    vector<unsigned> joinOrderings;
    for (unsigned index=1;index<dpTable.size();index++) {
@@ -999,6 +1248,9 @@ Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
                // Combine physical plans
                for (Plan* leftPlan=iter->plans;leftPlan;leftPlan=leftPlan->next) {
                   for (Plan* rightPlan=iter2->plans;rightPlan;rightPlan=rightPlan->next) {
+                     // Reachability checks take their inputs from joins
+                     if (regularPaths&&buildRegularPathJoin(problem,leftPlan,rightPlan))
+                        continue;
                      // Try a merge joins
                      if (leftPlan->ordering==rightPlan->ordering && leftPlan->op != Plan::DijkstraScan && rightPlan->op != Plan::DijkstraScan && leftPlan->op != Plan::PathFilter && rightPlan->op != Plan::PathFilter) {
                         for (vector<unsigned>::const_iterator iter=joinOrderings.begin(),limit=joinOrderings.end();iter!=limit;++iter) {
@@ -1010,10 +1262,7 @@ Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
                               p->right=rightPlan;
 			      p->next=0;
                               if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
-                              if (leftPlan->op==Plan::RegularPath||rightPlan->op==Plan::RegularPath)
-                              	p->costs=~0u-1;
-                              else
-                              	p->costs=leftPlan->costs+rightPlan->costs+Costs::mergeJoin(leftPlan->cardinality,rightPlan->cardinality);
+                              p->costs=leftPlan->costs+rightPlan->costs+Costs::mergeJoin(leftPlan->cardinality,rightPlan->cardinality);
                               p->ordering=leftPlan->ordering;
                               addPlan(problem,p);
                               break;
@@ -1029,10 +1278,7 @@ Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
                         p->right=rightPlan;
 			p->next=0;
                         if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
-                        if (leftPlan->op==Plan::RegularPath||rightPlan->op==Plan::RegularPath)
-                        	p->costs=~0u-1;
-                        else
-                        	p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(leftPlan->cardinality,rightPlan->cardinality);
+                        p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(leftPlan->cardinality,rightPlan->cardinality);
                         p->ordering=~0u;
                         addPlan(problem,p);
                         // Second order
@@ -1043,10 +1289,7 @@ Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
                         p->right=leftPlan;
 			p->next=0;
                         if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
-                        if (leftPlan->op==Plan::RegularPath||rightPlan->op==Plan::RegularPath)
-                        	p->costs=~0u-1;
-                        else
-                        	p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(rightPlan->cardinality,leftPlan->cardinality);
+                        p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(rightPlan->cardinality,leftPlan->cardinality);
                         p->ordering=~0u;
                         addPlan(problem,p);
                      } else {
@@ -386,7 +386,6 @@ static bool transformSubquery(DictionarySegment& dict,DifferentialIndex* diffInd
 
    vector<QueryGraph::Node> unboundedPath;
    // Encode all patterns
-   unsigned additionalVariables=group.patterns.size()*3;
    for (std::vector<SPARQLParser::Pattern>::const_iterator iter=group.patterns.begin(),limit=group.patterns.end();iter!=limit;++iter) {
       // Encode the entries
       QueryGraph::Node node;
@@ -408,38 +407,26 @@ static bool transformSubquery(DictionarySegment& dict,DifferentialIndex* diffInd
 
       if (iter->predicate.type==SPARQLParser::Element::PropertyPath){
       	node.propertyPath=true;
-      	unsigned lastObject=node.object;
-      	bool lastObjectConst=node.constObject;
-         if (!lookup(dict,diffIndex,iter->predicate.path[0].label,Type::URI,0,node.predicate)) return false;
-         node.constPredicate=true;
-         // get the modifier
-         switch (iter->predicate.path[0].modifier){
-         	case SPARQLParser::Step::Add: node.pathmod=QueryGraph::Node::Add; break;
-         	case SPARQLParser::Step::Mul: node.pathmod=QueryGraph::Node::Mul; break;
-         	default: node.propertyPath=false; break;
-         }
-
-         for (unsigned i=1; i < iter->predicate.path.size(); i++){
-         	//finish this node
-         	node.object=additionalVariables++;
-         	node.constObject=false;
-         	output.nodes.push_back(node);
-         	//start new node
-         	node.subject=node.object;
-         	node.constSubject=false;
-         	if (!lookup(dict,diffIndex,iter->predicate.path[i].label,Type::URI,0,node.predicate)) return false;
-         	node.constPredicate=true;
-         	node.pathTriple=false;
-         	node.usedInDijkstraInit=false;
-         	node.propertyPath=true;
+         // Encode the steps
+         for (unsigned i=0; i < iter->predicate.path.size(); i++){
+            QueryGraph::Node::PathStep step;
+            if (!lookup(dict,diffIndex,iter->predicate.path[i].label,Type::URI,0,step.predicate)) return false;
             switch (iter->predicate.path[i].modifier){
-            	case SPARQLParser::Step::Add: node.pathmod=QueryGraph::Node::Add; break;
-            	case SPARQLParser::Step::Mul: node.pathmod=QueryGraph::Node::Mul; break;
-            	default: node.propertyPath=false; break;
+               case SPARQLParser::Step::Add: step.modifier=QueryGraph::Node::Add; break;
+               case SPARQLParser::Step::Mul: step.modifier=QueryGraph::Node::Mul; break;
+               default: step.modifier=QueryGraph::Node::One; break;
             }
+            node.path.push_back(step);
+         }
+         node.predicate=node.path[0].predicate;
+         node.constPredicate=true;
+         node.pathmod=node.path[0].modifier;
+         if (node.path.size()==1){
+            // A single step is a reachability check, or a plain triple without modifier
+            node.path.clear();
+            if (node.pathmod==QueryGraph::Node::One)
+               node.propertyPath=false;
          }
-         node.object=lastObject;
-         node.constObject=lastObjectConst;
       }
       output.nodes.push_back(node);
    }
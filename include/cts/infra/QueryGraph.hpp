@@ -38,8 +38,17 @@ class QueryGraph
       /// Does the triple contain the property path expression?
       bool propertyPath;
       /// Modifier of the property path expression
-      enum PathModifier{Mul, Add };
+      enum PathModifier{Mul, Add, One };
       PathModifier pathmod;
+      /// A step of a property path expression
+      struct PathStep {
+         /// The predicate
+         unsigned predicate;
+         /// The modifier
+         PathModifier modifier;
+      };
+      /// The steps of a multi-step property path. Empty for single-step paths
+      std::vector<PathStep> path;
 
       /// Do we use this triple to initialize the Dijkstra scan?
       bool usedInDijkstraInit;
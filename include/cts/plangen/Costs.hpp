@@ -39,6 +39,12 @@ class Costs
    static cost_t filter(double card) { return card/(cpuSpeed/3); }
    /// Costs for a table function
    static cost_t tableFunction(double leftCard) { return leftCard*10000.0; }
+   /// Costs for probing the reachability index, intervals is the average interval count per node
+   static cost_t reachabilityProbe(double probeCard,double intervals) { return probeCard*(1+intervals)/100; }
+   /// Costs for a reachability join storing one input and probing the index with the other
+   static cost_t reachabilityJoin(double storedCard,double probeCard,double intervals,double outputCard) { return 300000+(storedCard/10)+reachabilityProbe(probeCard,intervals)+(outputCard/100); }
+   /// Costs for expanding a path closure by index lookups
+   static cost_t pathExpansion(double lookups) { return seekBtree()+(lookups/10); }
 };
 //---------------------------------------------------------------------------
 #endif
@@ -16,7 +16,7 @@
 struct Plan
 {
    /// Possible operators
-   enum Op { IndexScan, AggregatedIndexScan, FullyAggregatedIndexScan, DijkstraScan, RegularPath, NestedLoopJoin, MergeJoin, HashJoin, HashGroupify, Filter, PathFilter, Union, MergeUnion, TableFunction, Singleton };
+   enum Op { IndexScan, AggregatedIndexScan, FullyAggregatedIndexScan, DijkstraScan, RegularPath, PropertyPath, NestedLoopJoin, MergeJoin, HashJoin, HashGroupify, Filter, PathFilter, Union, MergeUnion, TableFunction, Singleton };
    /// The cardinalits type
    typedef double card_t;
    /// The cost type
@@ -57,7 +57,11 @@ class PlanGen
    /// Generate a Dijkstra scan with unknown start and end
    void buildUnfixedDijkstraScan(const QueryGraph::SubQuery& query,Problem* result,unsigned predicate,unsigned subj,unsigned obj);
    /// Generate a Regular Path query
-   void buildRegularPath(const QueryGraph::SubQuery& query,Problem* result,unsigned value1,unsigned value3);
+   void buildRegularPath(const QueryGraph::SubQuery& query,const QueryGraph::Node& node,Problem* result,unsigned value1,unsigned value3);
+   /// Generate a property path scan
+   void buildPropertyPath(const QueryGraph::SubQuery& query,const QueryGraph::Node& node,Problem* result,unsigned value1,unsigned value3);
+   /// Feed a reachability check with a join input. Returns false if no check is waiting for input
+   bool buildRegularPathJoin(Problem* problem,Plan* leftPlan,Plan* rightPlan);
    /// Generate base table accesses
    Problem* buildScan(const QueryGraph::SubQuery& query,const QueryGraph::Node& node,unsigned id);
    /// Build the informaion about a join
@@ -0,0 +1,52 @@
+#ifndef H_infra_osdep_MemoryArena
+#define H_infra_osdep_MemoryArena
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "infra/Config.hpp"
+#include <cstddef>
+//---------------------------------------------------------------------------
+/// Allocation of memory blocks for pools and buffers. Blocks of at least a
+/// huge page are mapped directly, backed by 2MB huge pages, and placed on
+/// NUMA nodes. Smaller blocks come from the heap. Configured by environment:
+///    HUGEPAGES=0   no huge pages
+///    HUGEPAGES=1   transparent huge pages (default)
+///    HUGEPAGES=2   explicit huge pages, transparent ones if none are reserved
+///    NUMA=0        leave the placement to the operating system
+///    NUMA=1        place blocks as requested (default if there are multiple nodes)
+class MemoryArena
+{
+   public:
+   /// The size of a huge page
+   static const size_t hugePageSize = 2*1024*1024;
+   /// The placement of a block
+   enum Placement {
+      /// On the node of the allocating thread, for operator memory
+      Placement_Local,
+      /// Spread over all nodes, for memory shared by all threads
+      Placement_Interleaved
+   };
+
+   /// Get the usable size of a block. Mapped blocks are rounded up to whole huge pages
+   static size_t getBlockSize(size_t size);
+   /// Allocate a block of getBlockSize(size) bytes. Mapped blocks are page aligned. Throws bad_alloc
+   static void* alloc(size_t size,Placement placement=Placement_Local);
+   /// Release a block. The size must be the requested size
+   static void free(void* block,size_t size);
+   /// Ask for huge pages for an existing mapping, if enabled
+   static void adviseHugePages(void* begin,size_t size);
+
+   /// Get the NUMA node of the calling thread
+   static unsigned getCurrentNode();
+   /// Get the number of NUMA nodes
+   static unsigned getNodeCount();
+};
+//---------------------------------------------------------------------------
+#endif
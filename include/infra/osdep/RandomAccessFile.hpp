@@ -0,0 +1,64 @@
+#ifndef H_infra_osdep_RandomAccessFile
+#define H_infra_osdep_RandomAccessFile
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//----------------------------------------------------------------------------
+/// A file accessed by positioned reads and writes instead of a mapping.
+/// Direct access bypasses the operating system cache, then offsets, sizes,
+/// and buffers must be aligned to the block size
+class RandomAccessFile
+{
+   public:
+   /// Typedef for offsets and sizes
+   typedef unsigned long ofs_t;
+   /// Alignment required for direct access
+   static const unsigned blockSize = 4096;
+
+   private:
+   /// os dependent data
+   struct Data;
+
+   /// os dependen tdata
+   Data* data;
+
+   public:
+   /// Constructor
+   RandomAccessFile();
+   /// Destructor
+   ~RandomAccessFile();
+
+   /// Open. Falls back to cached access if direct access is not supported
+   bool open(const char* name,bool readOnly,bool direct);
+   /// Create a new file
+   bool create(const char* name,bool direct);
+   /// Close
+   void close();
+   /// Flush the file
+   bool flush();
+   /// Is the operating system cache bypassed?
+   bool isDirect() const;
+
+   /// The file size
+   ofs_t getSize() const;
+   /// Grow the file
+   bool grow(ofs_t increment);
+
+   /// Read
+   bool read(ofs_t ofs,void* data,unsigned len);
+   /// Write
+   bool write(ofs_t ofs,const void* data,unsigned len);
+
+   /// Allocate a buffer suitable for direct access
+   static void* allocBuffer(unsigned len);
+   /// Release a buffer
+   static void freeBuffer(void* buffer);
+};
+//----------------------------------------------------------------------------
+#endif
@@ -12,6 +12,8 @@ class Thread
 
    /// Available physical memory
    static uint64_t guessPhysicalAvailable();
+   /// Number of available processors
+   static unsigned guessProcessorCount();
    /// Wait x ms
    static void sleep(unsigned time);
    /// Get the thread id
@@ -0,0 +1,79 @@
+#ifndef H_infra_util_AlignedAllocator
+#define H_infra_util_AlignedAllocator
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "infra/Config.hpp"
+#include "infra/osdep/MemoryArena.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#ifdef CONFIG_WINDOWS
+#include <malloc.h>
+#endif
+//---------------------------------------------------------------------------
+/// An STL allocator that aligns all allocations, e.g. for vector loads. Large
+/// arrays come from the memory arena and use huge pages
+template <class T,unsigned alignment=32> class AlignedAllocator
+{
+   public:
+   typedef T value_type;
+   typedef T* pointer;
+   typedef const T* const_pointer;
+   typedef T& reference;
+   typedef const T& const_reference;
+   typedef std::size_t size_type;
+   typedef std::ptrdiff_t difference_type;
+
+   /// Rebind to a different type
+   template <class U> struct rebind { typedef AlignedAllocator<U,alignment> other; };
+
+   /// Constructor
+   AlignedAllocator() {}
+   /// Copy constructor
+   template <class U> AlignedAllocator(const AlignedAllocator<U,alignment>&) {}
+
+   /// Allocate space for n objects
+   T* allocate(std::size_t n) {
+      std::size_t size=n?n*sizeof(T):alignment;
+      if (size>=MemoryArena::hugePageSize)
+         return static_cast<T*>(MemoryArena::alloc(size));
+#ifdef CONFIG_WINDOWS
+      void* result=_aligned_malloc(size,alignment);
+      if (!result)
+         throw std::bad_alloc();
+#else
+      void* result=0;
+      if (posix_memalign(&result,alignment,size))
+         throw std::bad_alloc();
+#endif
+      return static_cast<T*>(result);
+   }
+   /// Release space
+   void deallocate(T* p,std::size_t n) {
+      std::size_t size=n?n*sizeof(T):alignment;
+      if (size>=MemoryArena::hugePageSize) {
+         MemoryArena::free(p,size);
+         return;
+      }
+#ifdef CONFIG_WINDOWS
+      _aligned_free(p);
+#else
+      free(p);
+#endif
+   }
+
+   /// Comparison. All instances are interchangeable
+   template <class U> bool operator==(const AlignedAllocator<U,alignment>&) const { return true; }
+   /// Comparison
+   template <class U> bool operator!=(const AlignedAllocator<U,alignment>&) const { return false; }
+};
+//---------------------------------------------------------------------------
+#endif
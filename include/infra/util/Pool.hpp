@@ -10,6 +10,7 @@
 // or send a letter to Creative Commons, 171 Second Street, Suite 300,
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
+#include "infra/osdep/MemoryArena.hpp"
 #include <new>
 #include <cstring>
 //---------------------------------------------------------------------------
@@ -84,8 +85,11 @@ template <class Impl,class T> class PoolBase
 template <class Impl,class T> void PoolBase<Impl,T>::allocChunk()
    // Allocate a new chunk
 {
-   // Allocate the chunk
-   char* newData=new char[chunkSize*size+sizeof(ChunkHeader)];
+   // Allocate the chunk. Large chunks are rounded up to whole huge pages, use all of it
+   size_t blockSize=MemoryArena::getBlockSize(static_cast<size_t>(chunkSize)*size+sizeof(ChunkHeader));
+   if (((blockSize-sizeof(ChunkHeader))/size)>chunkSize)
+      chunkSize=(blockSize-sizeof(ChunkHeader))/size;
+   char* newData=static_cast<char*>(MemoryArena::alloc(blockSize));
    ChunkHeader* const newChunk=reinterpret_cast<ChunkHeader*>(newData+chunkSize*size);
    newChunk->next=chunks; newChunk->chunkSize=chunkSize; chunks=newChunk;
 
@@ -148,7 +152,7 @@ template <class Impl,class T> void PoolBase<Impl,T>::freeAll()
    // Delete all chunks
    while (chunks) {
       ChunkHeader* next=chunks->next;
-      delete[] reinterpret_cast<char*>(chunks->getData());
+      MemoryArena::free(chunks->getData(),static_cast<size_t>(chunks->chunkSize)*size+sizeof(ChunkHeader));
       chunks=next;
    }
 
@@ -11,6 +11,7 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 #include "infra/util/Pool.hpp"
+#include "infra/osdep/MemoryArena.hpp"
 //---------------------------------------------------------------------------
 /** A pool of entries with variable sizes. This use useful for
   * allocating data types of the form
@@ -94,8 +95,11 @@ template <class T> VarPool<T>::VarPool(unsigned extraSize,unsigned cs)
 template <class T> void VarPool<T>::allocChunk()
    // Allocate a new chunk
 {
-   // Allocate the chunk
-   char* newData=new char[chunkSize*size+sizeof(ChunkHeader)];
+   // Allocate the chunk. Large chunks are rounded up to whole huge pages, use all of it
+   size_t blockSize=MemoryArena::getBlockSize(static_cast<size_t>(chunkSize)*size+sizeof(ChunkHeader));
+   if (((blockSize-sizeof(ChunkHeader))/size)>chunkSize)
+      chunkSize=(blockSize-sizeof(ChunkHeader))/size;
+   char* newData=static_cast<char*>(MemoryArena::alloc(blockSize));
    ChunkHeader* const newChunk=reinterpret_cast<ChunkHeader*>(newData);
    newChunk->next=chunks; newChunk->chunkSize=chunkSize; chunks=newChunk;
    newData+=sizeof(ChunkHeader);
@@ -156,7 +160,7 @@ template <class T> void VarPool<T>::freeAll()
    // Delete all chunks
    while (chunks) {
       ChunkHeader* next=chunks->next;
-      delete[] reinterpret_cast<char*>(chunks);
+      MemoryArena::free(chunks,static_cast<size_t>(chunks->chunkSize)*size+sizeof(ChunkHeader));
       chunks=next;
    }
 
@@ -14,7 +14,9 @@
 #include "infra/osdep/Mutex.hpp"
 #include "infra/osdep/Event.hpp"
 #include "infra/osdep/Latch.hpp"
-#include <map>
+#include <atomic>
+#include <deque>
+#include <vector>
 //---------------------------------------------------------------------------
 class BufferManager;
 class Partition;
@@ -26,6 +28,8 @@ class BufferFrame
    private:
    /// Possible states
    enum State { Empty, Read, Write, WriteDirty };
+   /// Replacement queues
+   enum Queue { Unqueued, Recent, Frequent, Ghost };
 
    /// The buffer manager
    BufferManager* buffer;
@@ -45,8 +49,14 @@ class BufferFrame
    uint64_t lsn;
    /// The state
    State state;
-   /// The next released frame
+   /// The replacement queue
+   Queue queue;
+   /// Was the page marked as frequently accessed?
+   bool hot;
+   /// The next frame in the replacement queue or in the released frames
    BufferFrame* next;
+   /// The previous frame in the replacement queue
+   BufferFrame* prev;
 
    /// Grant the buffer manager access
    friend class BufferManager;
@@ -80,6 +90,18 @@ class BufferFrame
 /// A database buffer backed by a file
 class BufferManager
 {
+   public:
+   /// Buffer statistics
+   struct Statistics {
+      /// Number of requests served from the buffer
+      uint64_t hits;
+      /// Number of requests that had to read the page
+      uint64_t misses;
+      /// Number of pages evicted
+      uint64_t evictions;
+      /// Number of pages currently in the buffer
+      unsigned resident;
+   };
 
    private:
    /// A page ID
@@ -89,28 +111,105 @@ class BufferManager
       /// The page
       unsigned pageNo;
 
+      /// Constructor
+      PageID() : partition(0),pageNo(0) {}
       /// Constructor
       PageID(Partition* partition,unsigned pageNo) : partition(partition),pageNo(pageNo) {}
 
       /// Compare
       bool operator==(const PageID& i) const { return (partition==i.partition)&&(pageNo==i.pageNo); }
-      /// Compare
-      bool operator<(const PageID& i) const { return (partition<i.partition)||((partition==i.partition)&&(pageNo<i.pageNo)); }
+      /// Hash value
+      uint64_t hash() const;
+   };
+   /// An entry of the frame directory
+   struct DirectoryEntry {
+      /// The page
+      PageID page;
+      /// The frame, 0 for unused entries
+      BufferFrame* frame;
+
+      /// Constructor
+      DirectoryEntry() : frame(0) {}
+   };
+   /// A doubly linked list of buffer frames
+   struct FrameList {
+      /// The first and the last frame
+      BufferFrame* head,*tail;
+      /// Number of frames
+      unsigned size;
+
+      /// Constructor
+      FrameList() : head(0),tail(0),size(0) {}
+
+      /// Add a frame at the front
+      void pushFront(BufferFrame* frame);
+      /// Remove a frame
+      void remove(BufferFrame* frame);
    };
+   /// A part of the frame directory. Pages are spread over the parts by
+   /// hash, each part has its own lock, hash table, released frames, and
+   /// replacement queues. The parts share one budget: a part may grow beyond
+   /// its fair share while the buffer as a whole has room, and gives pages
+   /// back once the buffer is full. Replacement follows 2Q: new pages enter the recent
+   /// FIFO, pages evicted from there are remembered as ghosts, and only a
+   /// page requested again while it is a ghost enters the frequent LRU list.
+   /// A single scan therefore never displaces the frequently used pages.
+   /// Hot pages skip the recent queue and get a second chance on eviction
+   struct DirectoryPartition {
+      /// Lock. Should be held as shortly as possible
+      Mutex mutex;
+      /// Open addressing hash table with linear probing. The size is a power of two
+      std::vector<DirectoryEntry> entries;
+      /// Number of used entries
+      unsigned count;
+      /// All released buffer frames
+      BufferFrame* releasedFrames;
+      /// The replacement queues
+      FrameList recent,frequent,ghosts;
+      /// Fair share of the budget. Sizes the ghost queue, and parts above it are evicted first
+      unsigned capacity;
+      /// Statistics
+      uint64_t hits,misses,evictions;
 
-   /// Maximum number of pages in buffer (hint)
+      /// Constructor
+      DirectoryPartition();
+
+      /// Find a frame
+      BufferFrame* lookup(const PageID& page,uint64_t hash) const;
+      /// Insert a frame
+      void insert(const PageID& page,uint64_t hash,BufferFrame* frame);
+      /// Remove a frame
+      void erase(const PageID& page,uint64_t hash);
+   };
+   /// A readahead request
+   struct PrefetchRequest {
+      /// The partition
+      Partition* partition;
+      /// The page
+      unsigned pageNo;
+      /// The requester
+      const void* owner;
+   };
+   /// Number of bits selecting a directory part
+   static const unsigned directoryBits = 6;
+   /// Number of directory parts
+   static const unsigned directoryPartitions = 1<<directoryBits;
+
+   /// Maximum number of pages in buffer. Only exceeded by fixed or dirty pages
    const unsigned bufferSize;
+   /// Number of pages in the recent and frequent queues of all directory parts
+   std::atomic<unsigned> residentPages;
+   /// The next directory part to take pages from
+   std::atomic<unsigned> stealCursor;
    /// Limit when starting to write back (hint)
    const unsigned dirtLimit;
 
-   /// Lock. Should be held as shortly as possible
+   /// Lock for the dirty page bookkeeping and the writer. Should be held as shortly as possible. Acquired before directory locks
    Mutex mutex;
    /// The frame directory
-   std::map<PageID,BufferFrame*> directory;
-   /// All released buffer frames
-   BufferFrame* releasedFrames;
-   /// Number of dirty pages (estimate)
-   unsigned dirtCounter;
+   DirectoryPartition directory[directoryPartitions];
+   /// Number of dirty pages (estimate). Modified under the mutex, but read without it
+   std::atomic<unsigned> dirtCounter;
    /// Notification for the writer thread
    Event flusherNotify;
    /// Notification when writing is done
@@ -127,14 +226,40 @@ class BufferManager
    unsigned pagesSinceLastCheckpoint;
    /// Simulate a crash? Only for testing purposes!
    bool doCrash;
+   /// Lock for the readahead queue
+   Mutex prefetchMutex;
+   /// Waiting readahead requests
+   std::deque<PrefetchRequest> prefetchQueue;
+   /// Notification for the readahead threads
+   Event prefetchNotify;
+   /// Notification when a readahead thread stopped
+   Event prefetchDeadNotify;
+   /// Flag to stop the readahead threads
+   bool prefetchDie;
+   /// Number of running readahead threads
+   unsigned prefetchAlive;
 
-   /// Find or create a buffer frame
-   BufferFrame* findBufferFrame(Partition* partition,unsigned pageNo,bool exclusive);
+   /// The directory part of a page
+   DirectoryPartition& getDirectory(uint64_t hash) { return directory[hash>>(64-directoryBits)]; }
+   /// Find or create a buffer frame. The directory part must be locked
+   BufferFrame* findBufferFrame(DirectoryPartition& part,Partition* partition,unsigned pageNo,uint64_t hash,bool exclusive);
+   /// Release a frame after its latch was released. The old page identifies the frame
+   void releaseFrame(BufferFrame* frame,Partition* oldPartition,unsigned oldPageNo);
+   /// Remove an unused frame from the directory. The directory part must be locked
+   void dropFrame(DirectoryPartition& part,BufferFrame* frame);
+   /// Evict an unfixed clean page. The directory part must be locked
+   bool evictFrame(DirectoryPartition& part);
+   /// Evict a page of another directory part that exceeds its share. The own directory part must be locked
+   bool stealFrame(DirectoryPartition& part);
 
    /// Write dirty pages
    bool doFlush();
    /// Start the writer
    static void startFlusher(void* ptr);
+   /// Read a page into the buffer unless it is there already
+   void prefetchPage(Partition& partition,unsigned pageNo);
+   /// Start a readahead thread
+   static void startPrefetcher(void* ptr);
 
    friend class BufferFrame;
 
@@ -143,22 +268,32 @@ class BufferManager
 
    public:
    /// Constructor
-   BufferManager(unsigned bufferSizeHintInBytes);
+   BufferManager(unsigned bufferSizeInBytes);
    /// BufferManager
    ~BufferManager();
 
-   /// Prepare a page for writing without reading it. Page is exclusive but not modifed
+   /// Prepare a page for writing without reading it. Page is exclusive but not modifed. Returns 0 on I/O errors
    BufferFrame* buildPage(Partition& partition,unsigned pageNo);
-   /// Read a page. Page is shared and not modified
+   /// Read a page. Page is shared and not modified. Returns 0 on I/O errors
    const BufferFrame* readPageShared(Partition& partition,unsigned pageNo);
-   /// Read a page. Page is exclusive and not modifed
+   /// Read a page. Page is exclusive and not modifed. Returns 0 on I/O errors
    const BufferFrame* readPageExclusive(Partition& partition,unsigned pageNo);
    // Release an (unmodified) page
    void unfixPage(const BufferFrame* cframe);
+   /// Hint that a fixed page is accessed frequently, like an inner B-tree page
+   void markHot(const BufferFrame* cframe);
    /// Release a dirty page without recovery information. Recovery is handled by Transaction::unfixDirtyPage
    void unfixDirtyPageWithoutRecovery(BufferFrame* frame);
    /// Mark a dirty page without recovery information. Recovery is handled by Transaction::unfixDirtyPage
    void markDirtyWithoutRecovery(BufferFrame* frame);
+
+   /// Read pages in the background. Returns the number of requests of the owner that are still waiting
+   unsigned prefetchPages(Partition& partition,unsigned start,unsigned count,const void* owner);
+   /// Drop the waiting readahead requests of an owner
+   void cancelPrefetch(const void* owner);
+
+   /// Get the buffer statistics
+   void getStatistics(Statistics& statistics);
 };
 //---------------------------------------------------------------------------
 #endif
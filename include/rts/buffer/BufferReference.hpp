@@ -91,6 +91,8 @@ class BufferReference
    void swap(BufferReference& other);
    /// Reset the reference
    void reset();
+   /// Hint that the page is accessed frequently and should stay in the buffer
+   void markHot() const;
 
    /// Access the page
    const void* getPage() const;
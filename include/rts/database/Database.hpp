@@ -16,11 +16,15 @@ class BufferManager;
 class FactsSegment;
 class AggregatedFactsSegment;
 class FullyAggregatedFactsSegment;
-class FilePartition;
+class Partition;
 class DatabasePartition;
 class DictionarySegment;
 class ExactStatisticsSegment;
 class PathSelectivitySegment;
+class FerrariSegment;
+class Index;
+class LeafCache;
+class DictionaryCache;
 //---------------------------------------------------------------------------
 /// Access to the RDF database
 class Database
@@ -31,18 +35,41 @@ class Database
       Order_Subject_Predicate_Object=0,Order_Subject_Object_Predicate,Order_Object_Predicate_Subject,
       Order_Object_Subject_Predicate,Order_Predicate_Subject_Object,Order_Predicate_Object_Subject
    };
+   /// Supported ways to access the database file
+   enum IOMode {
+      /// Map the file into memory, the operating system reads and caches the pages
+      IO_Mapped,
+      /// Read pages explicitly into the buffer
+      IO_Read,
+      /// Read pages explicitly into the buffer, bypassing the operating system cache
+      IO_Direct,
+      /// Use the mode named by the IOMODE environment variable (mapped, read or direct), mapped if unset
+      IO_Default
+   };
 
    private:
    /// The underlying file
-   FilePartition* file;
+   Partition* file;
    /// The database buffer
    BufferManager* bufferManager;
    /// The partition
    DatabasePartition* partition;
+   /// The cache for decompressed facts pages
+   LeafCache* leafCache;
+   /// The cache for dictionary strings
+   DictionaryCache* dictionaryCache;
    /// SN of the root page
    uint64_t rootSN;
    /// LSN offset of the current log
    uint64_t startLSN;
+   /// The buffer size in bytes
+   unsigned bufferSize;
+   /// The size of the decompressed facts cache in bytes
+   unsigned leafCacheSize;
+   /// The size of the dictionary string cache in bytes
+   unsigned dictionaryCacheSize;
+   /// The memory a sort may use for buffered tuples in bytes
+   uint64_t sortMemoryLimit;
 
    Database(const Database&);
    void operator=(const Database&);
@@ -56,9 +83,19 @@ class Database
    /// Create a new database
    bool create(const char* fileName);
    /// Open a database
-   bool open(const char* fileName,bool readOnly=false);
+   bool open(const char* fileName,bool readOnly=false,IOMode ioMode=IO_Default);
    /// Close the current database
    void close();
+   /// Set the buffer size in bytes. Takes effect when opening or creating a database
+   void setBufferSize(unsigned bufferSize) { this->bufferSize=bufferSize; }
+   /// Set the size of the decompressed facts cache in bytes, 0 disables it. Takes effect when opening a database
+   void setLeafCacheSize(unsigned leafCacheSize) { this->leafCacheSize=leafCacheSize; }
+   /// Set the size of the dictionary string cache in bytes, 0 disables it. Takes effect when opening a database
+   void setDictionaryCacheSize(unsigned dictionaryCacheSize) { this->dictionaryCacheSize=dictionaryCacheSize; }
+   /// Set the memory a sort may use for buffered tuples in bytes, larger inputs are spilled to a temporary file
+   void setSortMemoryLimit(uint64_t sortMemoryLimit) { this->sortMemoryLimit=sortMemoryLimit; }
+   /// Get the memory a sort may use for buffered tuples in bytes
+   uint64_t getSortMemoryLimit() const { return sortMemoryLimit; }
 
    /// Get a facts table
    FactsSegment& getFacts(DataOrder order);
@@ -72,9 +109,19 @@ class Database
    DictionarySegment& getDictionary();
    /// Get the path statistics
    PathSelectivitySegment& getPathSelectivity();
+   /// Get the reachability indexes. Might be 0 for databases without them
+   FerrariSegment* getFerrari();
+   /// Get the reachability index for a predicate, loaded on demand. Returns 0 if not available
+   Index* getReachabilityIndex(unsigned predicate);
 
    /// Get the first partition
    DatabasePartition& getFirstPartition() { return *partition; }
+   /// Get the buffer manager
+   BufferManager& getBufferManager() { return *bufferManager; }
+   /// Get the decompressed facts cache. Might be 0
+   LeafCache* getLeafCache() { return leafCache; }
+   /// Get the dictionary string cache. Might be 0
+   DictionaryCache* getDictionaryCache() { return dictionaryCache; }
 };
 //---------------------------------------------------------------------------
 #endif
@@ -13,6 +13,7 @@
 #include "rts/database/Database.hpp"
 #include "rts/buffer/BufferReference.hpp"
 #include "infra/util/Type.hpp"
+#include "rts/segment/FactsSegment.hpp"
 #include "rts/segment/PathSelectivitySegment.hpp"
 #include <vector>
 //---------------------------------------------------------------------------
@@ -135,6 +136,8 @@ class DatabaseBuilder
    Database out;
    /// The file name
    const char* dbFile;
+   /// The leaf encoding of the facts
+   FactsSegment::LeafFormat factsLeafFormat;
 
    /// Load the triples aggregated into the database
    void loadAggregatedFacts(unsigned order,FactsReader& reader);
@@ -153,6 +156,8 @@ class DatabaseBuilder
    /// Close
    void close() { out.close(); }
 
+   /// Set the leaf encoding of the facts. Must be called before loading them
+   void setFactsLeafFormat(FactsSegment::LeafFormat leafFormat) { factsLeafFormat=leafFormat; }
    /// Loads the facts in a given order
    void loadFacts(unsigned order,FactsReader& reader);
    /// Load the raw strings (must be in id order, ids 0,1,2,...)
@@ -161,6 +166,8 @@ class DatabaseBuilder
    void loadStringMappings(StringInfoReader& reader);
    /// Load the hash->page mappings (must be in hash order)
    void loadStringHashes(StringInfoReader& reader);
+   /// Build the in-memory fingerprint index of the strings (after loading them)
+   void computeStringFingerprints();
 
    /// Compute the exact statistics (after loading)
    void computeExactStatistics(const char* tempFile);
@@ -169,8 +176,9 @@ class DatabaseBuilder
    /// Compute the path selectivities
    void computePathSelectivity(std::vector<unsigned>& back_selectivity, std::vector<unsigned>& forw_selectivity);
 
-   /// Compute FERRARI reachability index (after loading)
-   void computeFerrari();
+   /// Compute FERRARI reachability index (after loading). The indexes of different predicates are built by up to threads
+   /// threads, keeping at most memoryBudget bytes of edges and indexes in flight. 0 guesses from the machine
+   void computeFerrari(unsigned threads=0,uint64_t memoryBudget=0);
 
 };
 //---------------------------------------------------------------------------
@@ -16,6 +16,8 @@ class BufferManager;
 class BufferRequest;
 class BufferRequestExclusive;
 class BufferRequestModified;
+class DictionaryCache;
+class LeafCache;
 class Partition;
 class Segment;
 class SegmentInventorySegment;
@@ -33,7 +35,7 @@ class DatabasePartition
       Tag_SP,Tag_SO,Tag_OP,Tag_OS,Tag_PS,Tag_PO,
       Tag_S,Tag_O,Tag_P,
       Tag_Dictionary,Tag_ExactStatistics,Tag_PathSelectivity,
-      Tag_Ferrari
+      Tag_Ferrari,Tag_DictionaryFingerprint
    };
 
    private:
@@ -41,6 +43,10 @@ class DatabasePartition
    BufferManager& bufferManager;
    /// The partition
    Partition& partition;
+   /// The cache for decompressed facts pages, if any
+   LeafCache* leafCache;
+   /// The cache for dictionary strings, if any
+   DictionaryCache* dictionaryCache;
    /// All segments
    std::vector<std::pair<Segment*,unsigned> > segments;
 
@@ -64,11 +70,23 @@ class DatabasePartition
    BufferRequestExclusive readExclusive(unsigned page);
    /// Read a specific page
    BufferRequestModified modifyExclusive(unsigned page);
+   /// Read pages in the background. Returns the number of requests of the owner that are still waiting
+   unsigned prefetch(unsigned start,unsigned count,const void* owner) const;
+   /// Drop the waiting background reads of an owner
+   void cancelPrefetch(const void* owner) const;
 
    /// Get the space inventory
    SpaceInventorySegment* getSpaceInventory();
    /// Get the segment inventory
    SegmentInventorySegment* getSegmentInventory();
+   /// Set the cache for decompressed facts pages. 0 disables caching
+   void setLeafCache(LeafCache* leafCache) { this->leafCache=leafCache; }
+   /// Get the cache for decompressed facts pages. Might be 0
+   LeafCache* getLeafCache() const { return leafCache; }
+   /// Set the cache for dictionary strings. 0 disables caching
+   void setDictionaryCache(DictionaryCache* dictionaryCache) { this->dictionaryCache=dictionaryCache; }
+   /// Get the cache for dictionary strings. Might be 0
+   DictionaryCache* getDictionaryCache() const { return dictionaryCache; }
 
    /// Add a segment
    void addSegment(Segment* seg,unsigned tag=0);
@@ -12,6 +12,7 @@
 //---------------------------------------------------------------------------
 #include "rts/segment/Segment.hpp"
 #include "rts/database/Database.hpp"
+#include "rts/dijkstra/PathTraversal.hpp"
 #include <vector>
 #include <string>
 #include <sstream>
@@ -28,16 +29,6 @@
 #include <algorithm>
 //---------------------------------------------------------------------------
 class DijkstraEngine {
-public:
-	/// comparing nodes by distance to source
-	template <typename T> struct CompareByDistance {
-	    bool operator()(const std::pair<T, T> &lhs, const std::pair<T, T> &rhs) {
-	        if (lhs.first == rhs.first)
-	            return lhs.second < rhs.second;
-	        return lhs.first < rhs.first;
-	    }
-	};
-
 protected:
 	/// database to be scanned
 	Database& db;
@@ -47,25 +38,24 @@ protected:
 	std::vector<unsigned> selectivity;
 	/// approximate backward selectivity of path scans
 	std::vector<unsigned> backward_selectivity;
-	/// Dijkstra's shortest distances
-	std::map<unsigned,unsigned> shortestDistances;
-	/// Dijkstra's settled nodes
-	std::set<unsigned> settledNodes;
-	/// Dijkstra's working set
-	std::set<std::pair<unsigned, unsigned>,CompareByDistance<unsigned> > workingSet;
+	/// Dijkstra's distances, settled nodes and working set
+	PathTraversal traversal;
 
 	/// is the node handled already?
-	bool isHandled(unsigned node) {return (settledNodes.find(node)!=settledNodes.end());}
+	bool isHandled(unsigned node) {return traversal.isSettled(node);}
 	/// get the shortest distance from the start to the node
-	unsigned getShortestDist(unsigned node) {return shortestDistances.count(node)?shortestDistances[node]:~0u;}
+	unsigned getShortestDist(unsigned node) {return traversal.getDistance(node);}
 
 public:
 	/// Constructor
 	DijkstraEngine(Database& db,Database::DataOrder order): db(db), order(order){}
+	/// Destructor
+	virtual ~DijkstraEngine(){}
 
 	virtual void computeSP(unsigned source) = 0;
 
-	std::map<unsigned,unsigned>& getSPMap(){return shortestDistances;}
+	/// nodes reached by the last search
+	const std::vector<unsigned>& getReached(){return traversal.getReached();}
 
 	virtual void countSelectivity(unsigned root)=0;
 
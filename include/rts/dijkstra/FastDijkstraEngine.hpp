@@ -30,9 +30,10 @@
 //---------------------------------------------------------------------------
 class FastDijkstraEngine: public DijkstraEngine {
 public:
-	/// Dijkstra's shortest path tree
-	std::map<unsigned,std::set<unsigned> > tree;
-	std::map<unsigned,std::set<unsigned> > parentsURI;
+	/// Dijkstra's shortest path tree, as sorted (parent,child) edges
+	std::vector<std::pair<unsigned,unsigned> > tree;
+	/// URI predecessors, as sorted (child,parent) edges
+	std::vector<std::pair<unsigned,unsigned> > parentsURI;
 
 	/// Dijkstra's init
 	void init(unsigned source);
@@ -41,15 +42,8 @@ public:
 
 	void updateNeighbors(unsigned node,unsigned nodeIndex);
 
-	struct Neighbors{
-		std::vector<std::vector<std::pair<unsigned,unsigned> > > connections;
-		std::vector<unsigned> ids;
-	};
-
-	Neighbors n;
-	std::set<unsigned> curNodes;
-	std::set<unsigned>::iterator curnodes_iter;
-	unsigned curIndex;
+	PathTraversal::Neighbors n;
+	std::vector<unsigned> curNodes;
 
 	std::set<unsigned> URI;
 
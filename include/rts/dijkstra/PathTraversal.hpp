@@ -0,0 +1,158 @@
+#ifndef H_rts_dijkstra_PathTraversal
+#define H_rts_dijkstra_PathTraversal
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "rts/database/Database.hpp"
+#include <boost/dynamic_bitset.hpp>
+#include <vector>
+#include <utility>
+//---------------------------------------------------------------------------
+/// The state of a shortest path search over unit weight edges. All per node
+/// state lives in one array indexed by node id. Entries carry the epoch they
+/// were written in, a new search just starts a new epoch instead of clearing.
+/// Nodes wait in a bucket queue indexed by distance. Whole levels can be
+/// expanded either top-down from the frontier or bottom-up by scanning the
+/// reverse order for unreached nodes, like direction-optimizing BFS
+class PathTraversal
+{
+   public:
+   /// The predecessor of a node on its shortest path
+   struct Parent {
+      /// The node, ~0u for start nodes
+      unsigned node;
+      /// The edge label
+      unsigned edge;
+   };
+   /// The outgoing edges of a frontier, stored contiguously
+   struct Neighbors {
+      /// The (edge,node) pairs
+      std::vector<std::pair<unsigned,unsigned> > edges;
+      /// The first edge of each frontier node, plus an end marker
+      std::vector<unsigned> offsets;
+
+      /// The first edge of a frontier node
+      std::vector<std::pair<unsigned,unsigned> >::const_iterator begin(unsigned index) const { return edges.begin()+offsets[index]; }
+      /// Behind the last edge of a frontier node
+      std::vector<std::pair<unsigned,unsigned> >::const_iterator end(unsigned index) const { return edges.begin()+offsets[index+1]; }
+   };
+   /// A node reached by expanding a frontier
+   struct Discovery {
+      /// The node
+      unsigned node;
+      /// The frontier node it was reached from
+      unsigned parent;
+      /// The edge label
+      unsigned edge;
+   };
+   /// The direction of level expansions
+   enum Direction { Automatic, TopDown, BottomUp };
+
+   private:
+   /// The state of a node
+   struct NodeState {
+      /// The epochs the node was reached, settled, and marked in
+      unsigned reached,settled,marked;
+      /// The distance from the start
+      unsigned distance;
+      /// The predecessor
+      Parent parent;
+   };
+
+   /// The states
+   std::vector<NodeState> nodes;
+   /// The current search epoch
+   unsigned epoch;
+   /// The current mark epoch
+   unsigned markEpoch;
+   /// The queue buckets, indexed by distance
+   std::vector<std::vector<unsigned> > buckets;
+   /// The smallest bucket that may be non-empty
+   unsigned currentBucket;
+   /// The number of queued entries
+   unsigned queued;
+   /// All nodes reached in this search
+   std::vector<unsigned> reachedNodes;
+   /// The requested expansion direction
+   Direction direction;
+   /// Was the last level expanded bottom-up?
+   bool bottomUp;
+   /// The maximum number of threads per expansion
+   unsigned threads;
+   /// The frontier as bitmap, for bottom-up expansion
+   boost::dynamic_bitset<> frontierBits;
+   class WorkerPool;
+   /// The threads expanding levels in parallel, started on first use
+   WorkerPool* pool;
+
+   /// Make room for a node
+   void grow(unsigned node);
+   /// Settle a node
+   void settle(unsigned node) { nodes[node].settled=epoch; }
+   /// Expand a part of the frontier top-down
+   static void discoverTopDown(void* task);
+   /// Expand a range of nodes bottom-up
+   static void discoverBottomUp(void* task);
+
+   PathTraversal(const PathTraversal&);
+   void operator=(const PathTraversal&);
+
+   public:
+   /// Constructor
+   PathTraversal();
+   /// Destructor
+   ~PathTraversal();
+
+   /// Start a new search
+   void reset();
+   /// Add a start node
+   void start(unsigned node);
+   /// Record a path to a node. Returns true if it is shorter than the known one
+   bool reach(unsigned node,unsigned distance,unsigned parentNode,unsigned edge);
+   /// Queue a node with its current distance
+   void push(unsigned node);
+   /// Record a path and queue the node if it was shorter. Returns true if it was
+   bool relax(unsigned node,unsigned distance,unsigned parentNode,unsigned edge) { if (!reach(node,distance,parentNode,edge)) return false; push(node); return true; }
+
+   /// Take the closest unsettled node and settle it
+   bool pop(unsigned& node);
+   /// Take all unsettled nodes with the smallest distance, sorted by id, and settle them
+   bool nextBucket(std::vector<unsigned>& frontier);
+
+   /// Was the node reached?
+   bool isReached(unsigned node) const { return (node<nodes.size())&&(nodes[node].reached==epoch); }
+   /// Was the node settled?
+   bool isSettled(unsigned node) const { return (node<nodes.size())&&(nodes[node].settled==epoch); }
+   /// The distance of a node, ~0u if not reached
+   unsigned getDistance(unsigned node) const { return isReached(node)?nodes[node].distance:~0u; }
+   /// The predecessor of a reached node
+   const Parent& getParent(unsigned node) const { return nodes[node].parent; }
+   /// All reached nodes
+   const std::vector<unsigned>& getReached() const { return reachedNodes; }
+
+   /// Forget all marks
+   void clearMarks();
+   /// Mark a node. Returns false if it was marked already
+   bool mark(unsigned node);
+   /// Is the node marked?
+   bool isMarked(unsigned node) const { return (node<nodes.size())&&(nodes[node].marked==markEpoch); }
+
+   /// Set the expansion direction
+   void setDirection(Direction direction) { this->direction=direction; }
+   /// Set the maximum number of threads per expansion
+   void setThreads(unsigned threads) { this->threads=threads?threads:1; }
+   /// Find all unreached neighbors of a sorted frontier, each with one parent. The caller reaches them
+   void discover(Database& db,Database::DataOrder order,const std::vector<unsigned>& frontier,std::vector<Discovery>& found);
+
+   /// Find the outgoing edges of sorted frontier nodes in a single index pass
+   static void findNeighbors(Database& db,Database::DataOrder order,const std::vector<unsigned>& frontier,Neighbors& neighbors);
+};
+//---------------------------------------------------------------------------
+#endif
@@ -30,14 +30,10 @@
 //---------------------------------------------------------------------------
 class SlowDijkstraEngine: public DijkstraEngine {
 private:
-	/// map of predecessors
-	std::map<unsigned,unsigned> predecessors;
 	/// Dijkstra's init
 	void init(unsigned source);
 	unsigned getPredecessor(unsigned node);
-	void setPredecessor(unsigned a, unsigned b);
 
-	void setShortestDistance(unsigned node, unsigned oldDistance, unsigned distance);
 	void updateNeighbors(unsigned node);
 public:
 	/// Constructor
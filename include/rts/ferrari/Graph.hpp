@@ -34,6 +34,9 @@ private:
   std::map<unsigned,unsigned> name2id;
   std::vector<unsigned> id2name;
 
+  /// Empty graph, filled when deserializing a persisted index
+  Graph();
+
   friend class FerrariSegment;
 public:
   Graph(const std::string& filename);
@@ -64,11 +67,17 @@ public:
     return n;
   }
 
-  inline unsigned getNodeId(unsigned n) {
-	  return name2id[n];
+  inline unsigned num_edges() const {
+    return m;
+  }
+
+  /// Map a node to its SCC, ~0u if the node is not part of the graph
+  inline unsigned getNodeId(unsigned n) const {
+	  std::map<unsigned,unsigned>::const_iterator pos=name2id.find(n);
+	  return (pos==name2id.end())?~0u:(*pos).second;
   }
 
-  inline unsigned getNodeById(unsigned id){
+  inline unsigned getNodeById(unsigned id) const {
 	  return id2name[id];
   }
 };
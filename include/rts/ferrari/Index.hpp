@@ -51,6 +51,46 @@ struct topological_order_less {
 };
 //--------------------------------------------------------------------------------------------------
 class Index {
+public:
+  /// Per-query state of the reachability checks. The index itself is
+  /// immutable after build(), concurrent queries use separate contexts
+  class QueryContext {
+  private:
+    std::vector<unsigned> visited;
+    unsigned queryId;
+    unsigned expanded;
+
+    friend class Index;
+
+    /// Start a new query on an index with n nodes
+    void begin(unsigned n);
+  public:
+    QueryContext() : queryId(0), expanded(0) {}
+
+    /// Reset the context, returns the number of expanded nodes
+    unsigned reset();
+  };
+
+  /// A set of nodes resolved to the graph and sorted by their position in
+  /// the interval order. Prepared once and probed for many sources or targets
+  class Batch {
+  private:
+    struct Entry {
+      unsigned order; // position in the interval order, ~0u if unknown
+      unsigned node;  // node id in the graph, ~0u if unknown
+      unsigned name;  // original node
+      unsigned pos;   // position in the input
+
+      bool operator<(const Entry& o) const { return order < o.order; }
+    };
+    std::vector<Entry> entries;
+
+    friend class Index;
+  public:
+    /// The number of nodes
+    unsigned size() const { return entries.size(); }
+  };
+
 private:
   Graph *g;
 
@@ -83,10 +123,7 @@ private:
   // parent of node in resulting tree
   std::vector<unsigned> parent_;
 
-  // query processing
-  std::vector<unsigned> visited;
-  unsigned queryId;
-  unsigned expanded;
+  friend class FerrariSegment;
 
 public:
   /// constructor
@@ -102,14 +139,18 @@ public:
   }
 
   // query processing
-  bool reachable(unsigned x, unsigned y);
-  bool reachable_dfs(unsigned x, unsigned y);
-  bool reachable_bfs(unsigned x, unsigned y);
-  unsigned reset();
-  void get_reachable(unsigned x, std::vector<unsigned>& nodes);
+  bool reachable(unsigned x, unsigned y, QueryContext& ctx) const;
+  bool reachable_dfs(unsigned x, unsigned y, QueryContext& ctx) const;
+  bool reachable_bfs(unsigned x, unsigned y, QueryContext& ctx) const;
+  void get_reachable(unsigned x, std::vector<unsigned>& nodes) const;
+
+  // batched query processing, results are the ascending input positions
+  void prepare_batch(const std::vector<unsigned>& nodes, Batch& batch) const;
+  void reachable(unsigned x, const Batch& targets, std::vector<unsigned>& result, QueryContext& ctx) const;
+  void reaching(const Batch& sources, unsigned y, std::vector<unsigned>& result, QueryContext& ctx) const;
 
   // helpers
-  bool path(unsigned x, unsigned y, std::vector<unsigned>* p);
+  bool path(unsigned x, unsigned y, std::vector<unsigned>* p, QueryContext& ctx) const;
 
   // accessors
   inline const unsigned& get_id(const unsigned& x) const {
@@ -133,8 +174,10 @@ private:
   void assign_sketches_global();
 
   // query processing
-  bool __reachable_dfs(unsigned x, unsigned y);
-  bool __reachable(const unsigned& x, const unsigned& y);
+  bool reachable_node(unsigned x, unsigned y, QueryContext& ctx) const;
+  bool __expand(unsigned x, unsigned y, QueryContext& ctx) const;
+  bool __reachable_dfs(unsigned x, unsigned y, QueryContext& ctx) const;
+  bool __reachable(const unsigned& x, const unsigned& y, QueryContext& ctx) const;
 };
 //--------------------------------------------------------------------------------------------------
 #endif /* INDEX_H_ */
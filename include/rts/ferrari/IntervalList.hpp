@@ -11,6 +11,8 @@
 #ifndef FERRARI_INTERVALLIST_H_
 #define FERRARI_INTERVALLIST_H_
 //-------------------------------------------------------------------------------------------------
+#include "infra/util/AlignedAllocator.hpp"
+//-------------------------------------------------------------------------------------------------
 #include <functional>
 #include <iostream>
 #include <vector>
@@ -25,17 +27,39 @@ struct second_smaller {
 };
 //-------------------------------------------------------------------------------------------------
 class IntervalList {
-private:
-  // interval endpoints
-  std::vector<unsigned> lower_;
-  std::vector<unsigned> upper_;
-  std::vector<char> exact_;
-
 public:
+  /// Interval endpoints, aligned for vector loads
+  typedef std::vector<unsigned, AlignedAllocator<unsigned, 32> > bounds;
+
   enum containment {
     NOT = -1, MAYBE = 0, YES = 1
   };
 
+  /// Search kernels for find/contains
+  enum kernel {
+    BINARY_SEARCH, SCALAR, SSE4, AVX2
+  };
+
+private:
+  // interval endpoints
+  bounds lower_;
+  bounds upper_;
+  // exactness of the intervals, one bit per interval
+  std::vector<uint64_t> exact_;
+
+  void push_exact(bool ex);
+  void insert_exact(unsigned pos, bool ex);
+  void erase_exact(unsigned from, unsigned to);
+
+  inline void set_exact(unsigned index, bool ex) {
+    uint64_t bit = uint64_t(1) << (index & 63);
+    if (ex)
+      exact_[index >> 6] |= bit;
+    else
+      exact_[index >> 6] &= ~bit;
+  }
+
+public:
   IntervalList();
 
   IntervalList(unsigned a, unsigned b, char ex = 1);
@@ -54,7 +78,7 @@ public:
     } else {
       lower_.push_back(x);
       upper_.push_back(x);
-      exact_.push_back(1);
+      push_exact(true);
     }
   }
 
@@ -62,6 +86,10 @@ public:
   int find(const unsigned& x, int min=0) const;
   containment contains(const unsigned& x) const;
 
+  // search kernel selection, chosen by CPUID at startup
+  static kernel get_kernel();
+  static bool set_kernel(kernel k);
+
   // accessors
   inline unsigned min() const {
     return lower_.front();
@@ -82,7 +110,7 @@ public:
   inline unsigned count_approximate() const {
     unsigned count = 0;
     for (unsigned i = 0; i < lower_.size(); ++i) {
-      if (exact_[i] == 0) {
+      if (!is_exact(i)) {
         count += interval_length(i);
       }
     }
@@ -92,23 +120,23 @@ public:
   inline unsigned count_exact() const {
     unsigned count = 0;
     for (unsigned i = 0; i < lower_.size(); ++i) {
-      if (exact_[i]) {
+      if (is_exact(i)) {
         count += interval_length(i);
       }
     }
     return count;
   }
 
-  inline const std::vector<unsigned>& get_lower() const {
+  inline const bounds& get_lower() const {
     return lower_;
   }
 
-  inline const std::vector<unsigned>& get_upper() const {
+  inline const bounds& get_upper() const {
     return upper_;
   }
 
-  inline const std::vector<char>& get_exact() const {
-    return exact_;
+  inline bool is_exact(unsigned index) const {
+    return (exact_[index >> 6] >> (index & 63)) & 1;
   }
 
   inline unsigned interval_length(const unsigned& index) const {
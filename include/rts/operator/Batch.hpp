@@ -0,0 +1,81 @@
+#ifndef H_rts_operator_Batch
+#define H_rts_operator_Batch
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include <vector>
+//---------------------------------------------------------------------------
+class Register;
+//---------------------------------------------------------------------------
+/// A batch of tuples exchanged between operators in batch mode. The consumer
+/// chooses the registers, the producer fills one column of values per
+/// register plus the tuple counts. Registers that the producer does not
+/// compute are constants, their columns repeat the register value
+class Batch
+{
+   public:
+   /// The maximum number of tuples in a batch
+   static const unsigned capacity = 1024;
+
+   private:
+   /// The registers, one per column
+   std::vector<Register*> registers;
+   /// The values, column by column
+   std::vector<unsigned> values;
+   /// The tuple counts
+   std::vector<unsigned> counts;
+   /// The number of tuples
+   unsigned size;
+
+   Batch(const Batch&);
+   void operator=(const Batch&);
+
+   public:
+   /// Constructor
+   Batch();
+   /// Destructor
+   ~Batch();
+
+   /// Set the registers. Duplicates are ignored
+   void setRegisters(const std::vector<Register*>& registers);
+   /// Get the registers
+   const std::vector<Register*>& getRegisters() const { return registers; }
+   /// The number of columns
+   unsigned getColumnCount() const { return registers.size(); }
+   /// Find the column of a register. Returns ~0u if not contained
+   unsigned findColumn(const Register* reg) const;
+
+   /// Access a column
+   unsigned* getColumn(unsigned column) { return &values[column*capacity]; }
+   /// Access a column
+   const unsigned* getColumn(unsigned column) const { return &values[column*capacity]; }
+   /// Access the tuple counts
+   unsigned* getCounts() { return &counts[0]; }
+   /// Access the tuple counts
+   const unsigned* getCounts() const { return &counts[0]; }
+
+   /// The number of tuples
+   unsigned getSize() const { return size; }
+   /// Set the number of tuples after filling the columns directly
+   void setSize(unsigned s) { size=s; }
+   /// Full?
+   bool isFull() const { return size==capacity; }
+   /// Remove all tuples
+   void clear() { size=0; }
+
+   /// Fill a column with the current value of its register
+   void fillConstant(unsigned column);
+   /// Append a tuple from the current register values
+   void append(unsigned count);
+   /// Copy a tuple into the registers
+   void loadRegisters(unsigned row) const;
+};
+//---------------------------------------------------------------------------
+#endif
@@ -38,7 +38,7 @@ class FastDijkstraScan : public Operator
    /// Filter for paths
    QueryGraph::Filter* pathfilter;
    /// DB dictionary
-   DictionarySegment dict;
+   DictionarySegment& dict;
    /// Plan that defines start/stop of the scan
    Operator* subplan;
    /// Register for start/stop of unbounded Dijkstra scan
@@ -11,13 +11,21 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 #include "rts/operator/Operator.hpp"
+#include "rts/operator/Batch.hpp"
 #include "rts/operator/Scheduler.hpp"
+#include "rts/runtime/DomainDescription.hpp"
+#include "infra/util/AlignedAllocator.hpp"
 #include "infra/util/VarPool.hpp"
 #include <vector>
+#include <stdint.h>
 //---------------------------------------------------------------------------
 class Register;
 //---------------------------------------------------------------------------
-/// A memory based hash join
+/// A memory based hash join. The build side is partitioned by the hash of
+/// the join key, the partitions are built in parallel. Every partition is
+/// a directory of bucket chains, the buckets fill a cache line each and hold
+/// the keys inline. Unused pointer bits of the directory entries carry tags
+/// of the contained keys to reject most misses without touching a bucket
 class HashJoin : public Operator
 {
    private:
@@ -32,40 +40,54 @@ class HashJoin : public Operator
       /// Further values
       unsigned values[];
    };
-   /// Hash table task
-   class BuildHashTable : public Scheduler::AsyncPoint {
-      private:
-      /// The operator
-      HashJoin& join;
-      /// Already done?
-      bool done;
+   /// The number of keys in a bucket
+   static const unsigned bucketSlots = 4;
+   /// A bucket, fills one cache line
+   struct Bucket {
+      /// The next bucket of the slot
+      Bucket* next;
+      /// The keys
+      unsigned keys[bucketSlots];
+      /// The number of used keys
+      unsigned used;
+      /// Padding to a full cache line
+      unsigned padding;
+      /// The entries of the keys
+      Entry* entries[bucketSlots];
+   };
+   /// A partition of the hash table
+   struct Partition {
+      /// The first bucket of every slot, tagged with the keys of the slot
+      std::vector<uint64_t> directory;
+      /// The buckets
+      std::vector<Bucket,AlignedAllocator<Bucket,64> > buckets;
+      /// The entries read from the build side, until the partition is built
+      Entry* entries;
+      /// The number of entries read
+      unsigned entryCount;
 
-      public:
       /// Constructor
-      BuildHashTable(HashJoin& join) : join(join),done(false) {}
-      /// Perform the task
-      void run();
+      Partition() : entries(0),entryCount(0) {}
    };
-   friend class BuildHashTable;
-   /// Probe peek task
-   class ProbePeek : public Scheduler::AsyncPoint {
+   /// Hash table task. The build side is a pipeline of its own
+   class BuildHashTable : public Scheduler::PipelineSink {
       private:
       /// The operator
       HashJoin& join;
-      /// The count
-      unsigned count;
-      /// Already done?
-      bool done;
-
-      friend class HashJoin;
 
       public:
       /// Constructor
-      ProbePeek(HashJoin& join) : join(join),count(0),done(false) {}
-      /// Perform the task
-      void run();
+      BuildHashTable(HashJoin& join) : join(join) {}
+      /// Consume a morsel of the build side
+      void consumeMorsel(unsigned morsel);
+      /// Prepare building the partitions
+      unsigned preparePartitions(const std::vector<Scheduler::PipelineSink*>& workers);
+      /// Build a partition from the entries of all workers
+      void finishPartition(unsigned partition);
+      /// Share the hash table with all workers
+      void finishPipeline(const std::vector<Scheduler::PipelineSink*>& workers);
    };
-   friend class ProbePeek;
+   friend class BuildHashTable;
 
    /// The input
    Operator* left,*right;
@@ -75,27 +97,45 @@ class HashJoin : public Operator
    std::vector<Register*> leftTail,rightTail;
    /// The pool of hash entry
    VarPool<Entry> entryPool;
-   /// The hash table
-   std::vector<Entry*> hashTable;
+   /// The partitions of the hash table
+   std::vector<Partition> partitions;
+   /// The number of bits selecting the partition
+   unsigned partitionBits;
+   /// The partitions used for lookups. Workers share the partitions of the first worker
+   std::vector<Partition>* table;
+   /// The workers whose entries are combined in our partitions
+   std::vector<HashJoin*> buildWorkers;
+   /// Has the hash table been built?
+   bool built;
+   /// The build attributes with domain information
+   std::vector<Register*> domainRegs;
+   /// The observed domains of the build attributes. The filters are sized by the expected build cardinality
+   std::vector<ObservedDomainDescription> observedDomains;
    /// The current iter
    Entry* hashTableIter;
-   /// The tuple count from the right side
-   unsigned rightCount;
+   /// The probe side, always read in batches
+   Batch probeBatch;
+   /// The current position within the probe batch
+   unsigned probePos;
    /// Task
    BuildHashTable buildHashTableTask;
-   /// Task
-   ProbePeek probePeekTask;
-   /// Task priorities
-   double hashPriority,probePriority;
 
-   /// Insert into the hash table
-   void insert(Entry* e);
+   /// Build a partition from the entries of the workers
+   void buildPartition(unsigned partition,const std::vector<HashJoin*>& workers);
    /// Lookup an entry
    inline Entry* lookup(unsigned key);
+   /// Read the build side into the partitions
+   void readBuildInput();
+   /// Restrict the domains of the build attributes to the observed values
+   void restrictDomains(const std::vector<ObservedDomainDescription>& domains);
+   /// Read the first probe batch
+   bool startProbe();
+   /// Move to the next probe tuple with matches
+   bool nextProbe();
 
    public:
    /// Constructor
-   HashJoin(Operator* left,Register* leftValue,const std::vector<Register*>& leftTail,Operator* right,Register* rightValue,const std::vector<Register*>& rightTail,double hashPriority,double probePriority,double expectedOutputCardinality);
+   HashJoin(Operator* left,Register* leftValue,const std::vector<Register*>& leftTail,Operator* right,Register* rightValue,const std::vector<Register*>& rightTail,double expectedOutputCardinality);
    /// Destructor
    ~HashJoin();
 
@@ -103,6 +143,12 @@ class HashJoin : public Operator
    unsigned first();
    /// Produce the next tuple
    unsigned next();
+   /// Produce the first batch of tuples
+   unsigned firstBatch(Batch& batch);
+   /// Produce the next batch of tuples
+   unsigned nextBatch(Batch& batch);
+   /// Are batches produced natively?
+   bool supportsBatches() const;
 
    /// Print the operator tree. Debugging only.
    void print(PlanPrinter& out);
@@ -11,6 +11,7 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 #include "rts/operator/Operator.hpp"
+#include "rts/operator/Scheduler.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/segment/FactsSegment.hpp"
 #include <vector>
@@ -36,6 +37,21 @@ class IndexScan : public Operator
       void next(unsigned& value1,unsigned& value2,unsigned& value3);
    };
    friend class Hint;
+   /// Splits the scan into morsels
+   class Splitter : public Scheduler::MorselSource {
+      private:
+      /// The scan
+      IndexScan& scan;
+
+      public:
+      /// Constructor
+      Splitter(IndexScan& scan) : scan(scan) {}
+      /// Split the scan into morsels
+      unsigned prepareMorsels(unsigned maxMorsels);
+      /// Restrict the next scans to a morsel
+      void selectMorsel(unsigned morsel);
+   };
+   friend class Splitter;
 
    /// The registers for the different parts of the triple
    Register* value1,*value2,*value3;
@@ -51,6 +67,25 @@ class IndexScan : public Operator
    Hint hint;
    /// Merge hints
    std::vector<Register*> merge1,merge2,merge3;
+   /// The bound values in batch mode
+   unsigned batchValue1,batchValue2,batchValue3;
+   /// The number of bound leading values in batch mode
+   unsigned batchPrefix;
+   /// Filter the second or third value in batch mode?
+   bool batchFilter2,batchFilter3;
+   /// The morsel splitting
+   Splitter splitter;
+   /// The upper bounds of the morsels except the last one
+   std::vector<FactsSegment::Triple> morselBounds;
+   /// The selected morsel, ~0u for the whole scan
+   unsigned morsel;
+   /// Does the selected morsel end before the scan in batch mode?
+   bool batchLimited;
+   /// The last entry of the selected morsel
+   FactsSegment::Triple batchLimit;
+
+   /// Produce a batch. The scan is positioned on an unread entry if hasCurrent is set
+   unsigned fillBatch(Batch& batch,bool hasCurrent);
 
    /// Constructor
    IndexScan(Database& db,Database::DataOrder order,Register* value1,bool bound1,Register* value2,bool bound2,Register* value3,bool bound3,double expectedOutputCardinality);
@@ -73,6 +108,12 @@ class IndexScan : public Operator
    virtual unsigned first() = 0;
    /// Produce the next tuple
    virtual unsigned next() = 0;
+   /// Produce the first batch of tuples
+   unsigned firstBatch(Batch& batch);
+   /// Produce the next batch of tuples
+   unsigned nextBatch(Batch& batch);
+   /// Are batches produced natively?
+   bool supportsBatches() const;
 
    /// Print the operator tree. Debugging only.
    void print(PlanPrinter& out);
@@ -11,6 +11,7 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 #include "rts/operator/Operator.hpp"
+#include "rts/operator/Batch.hpp"
 #include <vector>
 //---------------------------------------------------------------------------
 class Register;
@@ -48,6 +49,20 @@ class MergeJoin : public Operator
    ScanState scanState;
    /// Is a copy of the left hand side available? Only used for loopSpooled*
    bool leftInCopy;
+   /// The inputs in batch mode, the join attribute is the first column
+   Batch leftBatch,rightBatch;
+   /// The positions within the input batches
+   unsigned leftPos,rightPos;
+   /// Inputs exhausted in batch mode?
+   bool leftDone,rightDone;
+   /// The join values of the last consumed input tuples
+   unsigned lastLeft,lastRight;
+   /// The join value of the right hand side tuples spooled into the buffer in batch mode
+   unsigned groupValue;
+   /// The position within the spooled tuples
+   unsigned groupPos;
+   /// Combining the current left tuple with the spooled tuples?
+   bool inGroup;
 
    /// Copy the left tuple into its shadow
    void copyLeft();
@@ -61,6 +76,13 @@ class MergeJoin : public Operator
    /// Handle the n:m case
    void handleNM();
 
+   /// Publish the smallest join values that are still needed as merge hints
+   void publishHints();
+   /// Make a left tuple available in batch mode
+   bool hasLeft();
+   /// Make a right tuple available in batch mode
+   bool hasRight();
+
    public:
    /// Constructor
    MergeJoin(Operator* left,Register* leftValue,const std::vector<Register*>& leftTail,Operator* right,Register* rightValue,const std::vector<Register*>& rightTail,double expectedOutputCardinality);
@@ -71,6 +93,12 @@ class MergeJoin : public Operator
    unsigned first();
    /// Produce the next tuple
    unsigned next();
+   /// Produce the first batch of tuples
+   unsigned firstBatch(Batch& batch);
+   /// Produce the next batch of tuples
+   unsigned nextBatch(Batch& batch);
+   /// Are batches produced natively?
+   bool supportsBatches() const;
 
    /// Print the operator tree. Debugging only.
    void print(PlanPrinter& out);
@@ -10,6 +10,7 @@
 // or send a letter to Creative Commons, 171 Second Street, Suite 300,
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
+class Batch;
 class Register;
 class DictionarySegment;
 class Scheduler;
@@ -23,6 +24,11 @@ class Operator
    double expectedOutputCardinality;
    /// Tuple counter
    unsigned observedOutputCardinality;
+   /// Input exhausted while producing batches?
+   bool batchesDone;
+
+   /// Append tuples produced by next() until the batch is full
+   unsigned appendTuples(Batch& batch);
 
    public:
    /// Constructor
@@ -34,6 +40,12 @@ class Operator
    virtual unsigned first() = 0;
    /// Produce the next tuple
    virtual unsigned next() = 0;
+   /// Produce the first batch of tuples. Returns the number of tuples, 0 at the end. Uses first() and next() unless overwritten
+   virtual unsigned firstBatch(Batch& batch);
+   /// Produce the next batch of tuples
+   virtual unsigned nextBatch(Batch& batch);
+   /// Are batches produced natively by this operator and all its inputs?
+   virtual bool supportsBatches() const;
 
    /// Tuple counter
    double getExpectedOutputCardinality() const { return expectedOutputCardinality; }
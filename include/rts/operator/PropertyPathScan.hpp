@@ -0,0 +1,125 @@
+#ifndef H_rts_operator_PropertyPathScan
+#define H_rts_operator_PropertyPathScan
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2013 Andrey Gubichev, Thomas Neumann.
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "rts/operator/Operator.hpp"
+#include "rts/database/Database.hpp"
+#include "rts/ferrari/Index.hpp"
+#include <boost/dynamic_bitset.hpp>
+#include <vector>
+//---------------------------------------------------------------------------
+class FactsSegment;
+class Register;
+//---------------------------------------------------------------------------
+/// Evaluates a property path like p1*/p2/p3+ as one operator. The path is
+/// compiled into an automaton, the scan walks the product of the data graph
+/// and the automaton using index lookups, with one visited set per state
+class PropertyPathScan : public Operator
+{
+   public:
+   /// Modifier of a path step
+   enum Modifier { One, Add, Mul };
+   /// A step of the path expression
+   struct Step {
+      /// The predicate
+      unsigned predicate;
+      /// The modifier
+      Modifier modifier;
+      /// The reachability index of the predicate, if any. Used for starred steps
+      Index* ferrari;
+   };
+
+   private:
+   /// The edges with one predicate leaving an automaton state
+   struct Transition {
+      /// The predicate
+      unsigned predicate;
+      /// The target states, closed under steps that may be skipped
+      std::vector<unsigned> targets;
+   };
+   /// An entry of the search queue
+   struct Entry {
+      /// The node
+      unsigned node;
+      /// The automaton state
+      unsigned state;
+   };
+
+   /// The registers for the ends of the path
+   Register* subject,*object;
+   /// Are the ends bound?
+   bool subjectBound,objectBound;
+   /// The facts tables for neighbor lookups and start enumeration
+   FactsSegment& edges,&starts;
+   /// Walk the path backwards from the object?
+   bool inverse;
+   /// The steps, in walking direction
+   std::vector<Step> steps;
+   /// The transitions per state
+   std::vector<std::vector<Transition> > transitions;
+   /// The states entered together with a state
+   std::vector<std::vector<unsigned> > closure;
+   /// The accepting state
+   unsigned accept;
+   /// Check the last step with the reachability index instead of walking it
+   bool useFerrari;
+   /// The state of our reachability checks
+   Index::QueryContext ferrariContext;
+   /// The visited nodes per state
+   std::vector<boost::dynamic_bitset<> > visited;
+   /// The search queue, also remembers all visited entries
+   std::vector<Entry> queue;
+   /// Buffer for neighbor lookups
+   std::vector<unsigned> neighbors;
+   /// The start nodes if both ends are unbound
+   std::vector<unsigned> sources;
+   /// The next start node
+   unsigned nextSource;
+   /// The current start node
+   unsigned source;
+   /// The nodes reached from the current start node
+   std::vector<unsigned> results;
+   /// The next result
+   unsigned nextResult;
+
+   /// Build the automaton
+   void buildAutomaton();
+   /// Collect all nodes that can start a path
+   void collectSources();
+   /// Find all neighbors of a node along a predicate
+   void findNeighbors(unsigned node,unsigned predicate);
+   /// Enter a node in a set of states
+   bool enter(unsigned node,const std::vector<unsigned>& states,unsigned target);
+   /// Is the target reachable from a node along the last step?
+   bool checkLastStep(unsigned node,unsigned target);
+   /// Find all nodes reachable from a start node. Stops early if target is reached
+   void search(unsigned start,unsigned target);
+
+   public:
+   /// Constructor
+   PropertyPathScan(Database& db,Register* subject,bool subjectBound,Register* object,bool objectBound,const std::vector<Step>& steps,double expectedOutputCardinality);
+   /// Destructor
+   ~PropertyPathScan();
+
+   /// Produce the first tuple
+   unsigned first();
+   /// Produce the next tuple
+   unsigned next();
+
+   /// Print the operator tree. Debugging only.
+   void print(PlanPrinter& out);
+   /// Add a merge join hint
+   void addMergeHint(Register* reg1,Register* reg2);
+   /// Register parts of the tree that can be executed asynchronous
+   void getAsyncInputCandidates(Scheduler& scheduler);
+};
+//---------------------------------------------------------------------------
+#endif
@@ -41,8 +41,11 @@ class RegularPathScan : public Operator
    /// The data order
    Database::DataOrder order;
    /// DB dictionary
-   DictionarySegment dict;
+   DictionarySegment& dict;
+   /// The reachability index, shared between operators
    Index* ferrari;
+   /// The state of our reachability checks
+   Index::QueryContext ferrariContext;
    /// Operator-input
    Operator* op1, *op2;
    Register* firstSource,*secondSource;
@@ -64,11 +67,19 @@ class RegularPathScan : public Operator
    VarPool<Entry>* entryPool;
    // store the results of one of the subtrees
    std::vector<Entry*> storage;
-   decltype(storage.begin()) storageIterator;
+   /// The stored keys, prepared for batched reachability checks
+   Index::Batch storageBatch;
+   /// The stored entries connected to the current probe tuple
+   std::vector<unsigned> matches;
+   decltype(matches.begin()) matchIterator;
    // number of elements returned by the right subtree (probe)
    unsigned rightCount;
    //
    void buildStorage();
+   /// Does the stored subtree bind the subject of the path?
+   bool storesSubject() const;
+   /// Find all stored entries connected to the current probe tuple
+   void probe();
 
    //implementations
    class RPConstant;
@@ -107,6 +118,8 @@ class RegularPathScan : public Operator
 
    bool isFirstInputSet();
    bool isSecondInputSet();
+   /// Are all required inputs set? A path with a constant end has only one input
+   bool isComplete();
 
    // swap two subtrees so that the "cheapest" one is on the left
    void checkAndSwap();
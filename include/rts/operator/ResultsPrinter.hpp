@@ -45,6 +45,17 @@ class ResultsPrinter : public Operator
    unsigned limit;
    /// Skip the printing, resolve only?
    bool silent;
+   /// Consume the input in batches?
+   bool batchMode;
+   /// The runtimes of further workers
+   std::vector<Runtime*> workerRuntimes;
+   /// The copies of the input for further workers
+   std::vector<Operator*> workerInputs;
+   /// The output of the copies
+   std::vector<CodeGen::Output> workerOutputs;
+
+   /// Consume the input with all workers. Produces the same entries as consuming it in batches
+   void collectParallel(unsigned minCount,std::vector<unsigned>& results);
 
    public:
    /// Constructor
@@ -56,6 +67,10 @@ class ResultsPrinter : public Operator
    void setOutputMode(OutputMode o) { outputMode=o; }
    /// Get the input
    Operator* getInput() const { return input; }
+   /// Consume the input in batches. Only sensible if the input supports batches natively
+   void setBatchMode(bool b) { batchMode=b; }
+   /// Add a worker with its own copy of the input. The input must support batches, the printer takes ownership
+   void addWorker(Runtime* runtime,Operator* input,const CodeGen::Output& output);
 
    /// Produce the first tuple
    unsigned first();
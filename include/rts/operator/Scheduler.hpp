@@ -4,73 +4,125 @@
 #include "infra/osdep/Event.hpp"
 #include "infra/osdep/Mutex.hpp"
 #include <vector>
-#include <set>
 //---------------------------------------------------------------------------
 class Operator;
 //---------------------------------------------------------------------------
-/// Executes an execution plan, potentially multi-threaded
+/// Executes an execution plan, potentially multi-threaded. Parallel execution
+/// is morsel-driven: every worker owns a copy of the operator tree, the tree
+/// is cut into pipelines at the pipeline breakers, and the workers steal
+/// key-range morsels of the scan driving a pipeline and push them through
+/// their copy of the pipeline
 class Scheduler
 {
    public:
-   /// An synchronous execution point
-   class AsyncPoint {
+   /// A scan that can be split into morsels
+   class MorselSource {
       public:
       /// Destructor
-      virtual ~AsyncPoint();
-      /// Run it
-      virtual void run() = 0;
+      virtual ~MorselSource();
+      /// Split the scan into at most maxMorsels morsels. Returns the number of morsels
+      virtual unsigned prepareMorsels(unsigned maxMorsels) = 0;
+      /// Restrict the next scans to a morsel
+      virtual void selectMorsel(unsigned morsel) = 0;
    };
+   /// The end of a pipeline
+   class PipelineSink {
+      public:
+      /// Destructor
+      virtual ~PipelineSink();
+      /// Consume a morsel of the pipeline input. Called by the worker owning the copy
+      virtual void consumeMorsel(unsigned morsel) = 0;
+      /// Prepare combining the results of all workers after all morsels were consumed. Returns the number of partitions the workers combine in parallel
+      virtual unsigned preparePartitions(const std::vector<PipelineSink*>& workers);
+      /// Combine a partition of the results. Called for the first copy, concurrently for different partitions
+      virtual void finishPartition(unsigned partition);
+      /// Combine the results of all workers after all partitions were combined. Called for the first copy
+      virtual void finishPipeline(const std::vector<PipelineSink*>& workers) = 0;
+   };
+   /// The number of morsels per worker a scan is split into
+   static const unsigned morselsPerWorker = 8;
+   /// The minimum number of leaf pages in a morsel
+   static const unsigned minMorselPages = 4;
 
    private:
-   /// A registered execution point
-   struct RegisteredPoint {
-      /// The async point
-      AsyncPoint& point;
-      /// The point class
-      unsigned schedulingClass;
-      /// The priority
-      double priority;
-      /// Unfinished executions points this one depends on
-      std::set<RegisteredPoint*> dependencies;
-
-      /// Constructor
-      RegisteredPoint(AsyncPoint& point,unsigned schedulingClass,double priority);
+   /// A registered pipeline
+   struct Pipeline {
+      /// The sink
+      PipelineSink* sink;
+      /// The driving scan, if any
+      MorselSource* source;
    };
-   /// The registered execution points
-   std::vector<RegisteredPoint*> registeredPoints;
+   /// A pipeline under construction
+   struct OpenPipeline {
+      /// The driving scan, if any
+      MorselSource* source;
+      /// Are further scans excluded from driving?
+      bool blocked;
+   };
+
+   /// The pipelines of all workers, inner pipelines first
+   std::vector<std::vector<Pipeline> > pipelines;
+   /// The pipelines under construction
+   std::vector<OpenPipeline> openPipelines;
+   /// The worker whose tree is registered
+   unsigned registeringWorker;
    /// A synchronization lock
    Mutex workerLock;
    /// Notification
    Event workerSignal;
-   /// The queue of tasks
-   std::vector<RegisteredPoint*> workQueue;
-   /// The number of threads to use
-   unsigned threads;
-   /// The number of active threads
-   volatile unsigned activeWorkers,workerThreads;
+   /// The pipeline executed by the workers
+   unsigned currentPipeline;
+   /// The sink whose partitions the workers combine, if any
+   PipelineSink* partitionSink;
+   /// The morsels (or partitions) of the current round
+   unsigned nextMorsel,morselCount;
+   /// Incremented for every round, wakes up the workers
+   unsigned round;
+   /// The number of workers that finished the current pipeline
+   unsigned finishedWorkers;
+   /// The number of worker threads
+   unsigned workerThreads;
    /// Should the workers die?
-   volatile bool workersDie;
+   bool workersDie;
 
+   /// Consume morsels of the current pipeline until none is left
+   void consumeMorsels(unsigned worker);
+   /// Let all workers consume the morsels (or partitions) of a round
+   void runRound(unsigned workers,unsigned count);
+   /// Execute a pipeline on all workers
+   void runPipeline(unsigned pipeline);
    /// Perform the work of a worker thread
-   void performWork();
+   void performWork(unsigned worker);
    /// Entry point for worker threads
    static void asyncWorker(void*);
 
+   Scheduler(const Scheduler&);
+   void operator=(const Scheduler&);
+
    public:
    /// Constructor
    Scheduler();
    /// Destructor
    ~Scheduler();
 
-   /// The current position within the execution points
-   unsigned getRegisteredPoints() const { return registeredPoints.size(); }
-   /// Register an async execution point
-   void registerAsyncPoint(AsyncPoint& point,unsigned schedulingClass,double priority,unsigned dependencies);
+   /// The number of workers a query should use. MAXTHREADS overrides the number of processors
+   static unsigned getWorkerCount();
+
+   /// Start a new pipeline, for example the build side of a hash join
+   void beginPipeline();
+   /// Finish the current pipeline
+   void endPipeline(PipelineSink& sink);
+   /// Register a scan. The first scan of a pipeline that is not blocked drives it
+   void registerMorselSource(MorselSource& source);
+   /// Exclude further scans of the current pipeline from driving it, e.g. the inner side of a merge join. Returns the previous state
+   bool blockMorselSources(bool block);
 
    /// Execute a plan single threaded
    void executeSingleThreaded(Operator* root);
-   /// Execute a plan using, using potentially multiple threads
+   /// Execute a plan
    void execute(Operator* root);
+   /// Execute copies of a plan using one worker per copy. The sinks consume the output of the roots
+   void execute(const std::vector<Operator*>& roots,const std::vector<PipelineSink*>& sinks);
 };
 //---------------------------------------------------------------------------
 #endif
@@ -11,6 +11,7 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 #include "rts/operator/Operator.hpp"
+#include "rts/operator/Batch.hpp"
 #include "infra/util/Type.hpp"
 #include <vector>
 #include <string>
@@ -84,6 +85,8 @@ class Selection : public Operator
 
       /// Register the selection
       virtual void setSelection(Selection* selection);
+      /// Collect the registers read by the predicate
+      virtual void collectRegisters(std::vector<Register*>& registers);
       /// Evaluate the predicate
       virtual void eval(Result& result) = 0;
       /// Print the predicate (debugging only)
@@ -106,6 +109,8 @@ class Selection : public Operator
 
       /// Register the selection
       void setSelection(Selection* selection);
+      /// Collect the registers read by the predicate
+      void collectRegisters(std::vector<Register*>& registers);
    };
    /// Unary operator
    class UnaryPredicate : public Predicate {
@@ -121,6 +126,8 @@ class Selection : public Operator
 
       /// Register the selection
       void setSelection(Selection* selection);
+      /// Collect the registers read by the predicate
+      void collectRegisters(std::vector<Register*>& registers);
    };
    /// Logical or
    class Or : public BinaryPredicate {
@@ -280,6 +287,8 @@ class Selection : public Operator
       /// Constructor
       Variable(Register* reg) : reg(reg) {}
 
+      /// Collect the registers read by the predicate
+      void collectRegisters(std::vector<Register*>& registers);
       /// Evaluate the predicate
       void eval(Result& result);
       /// Print the predicate (debugging only)
@@ -359,6 +368,8 @@ class Selection : public Operator
 
       /// Register the selection
       void setSelection(Selection* selection);
+      /// Collect the registers read by the predicate
+      void collectRegisters(std::vector<Register*>& registers);
 
       /// Evaluate the predicate
       void eval(Result& result);
@@ -419,6 +430,8 @@ class Selection : public Operator
       /// Constructor
       BuiltinBound(Register* reg) : reg(reg) {}
 
+      /// Collect the registers read by the predicate
+      void collectRegisters(std::vector<Register*>& registers);
       /// Evaluate the predicate
       void eval(Result& result);
       /// Print the predicate (debugging only)
@@ -482,6 +495,8 @@ class Selection : public Operator
 
       /// Register the selection
       void setSelection(Selection* selection);
+      /// Collect the registers read by the predicate
+      void collectRegisters(std::vector<Register*>& registers);
 
       /// Evaluate the predicate
       void eval(Result& result);
@@ -502,6 +517,8 @@ class Selection : public Operator
 
       /// Register the selection
       void setSelection(Selection* selection);
+      /// Collect the registers read by the predicate
+      void collectRegisters(std::vector<Register*>& registers);
 
       /// Evaluate the predicate
       void eval(Result& result);
@@ -516,7 +533,13 @@ class Selection : public Operator
    Runtime& runtime;
    /// The predicate
    Predicate* predicate;
+   /// The input in batch mode
+   Batch inputBatch;
+   /// The input columns read by the predicate in batch mode
+   std::vector<unsigned> predicateColumns;
 
+   /// Filter input batches until a tuple qualifies
+   unsigned filterBatch(Batch& batch);
 
    public:
    /// Constructor
@@ -528,6 +551,12 @@ class Selection : public Operator
    unsigned first();
    /// Produce the next tuple
    unsigned next();
+   /// Produce the first batch of tuples
+   unsigned firstBatch(Batch& batch);
+   /// Produce the next batch of tuples
+   unsigned nextBatch(Batch& batch);
+   /// Are batches produced natively?
+   bool supportsBatches() const;
 
    /// Print the operator tree. Debugging only.
    void print(PlanPrinter& out);
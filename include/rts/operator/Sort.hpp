@@ -11,22 +11,24 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 #include "rts/operator/Operator.hpp"
-#include "infra/util/VarPool.hpp"
 #include <vector>
+#include <cstdio>
+#include <stdint.h>
 //---------------------------------------------------------------------------
 class Database;
 //---------------------------------------------------------------------------
-/// A sort operator
+/// A sort operator. The dictionary strings of the sort keys are resolved
+/// once per distinct id and ranked, the tuples are sorted by their ranks.
+/// Inputs exceeding the memory limit of the database are sorted in runs, the
+/// runs are spilled to a temporary file with order preserving binary keys and
+/// merged. If spilling fails the input is sorted in memory
 class Sort : public Operator
 {
+   public:
+   /// Helper to allow test access to private members
+   class TestInterface;
+
    private:
-   /// A tuple
-   struct Tuple {
-      /// The count
-      unsigned count;
-      /// The values
-      unsigned values[];
-   };
    /// Order specification
    struct Order {
       /// The slot
@@ -34,22 +36,56 @@ class Sort : public Operator
       /// Descending?
       bool descending;
    };
-   class Sorter;
+   /// A sort entry
+   struct Entry {
+      /// The ranks of the first two sort keys
+      uint64_t prefix;
+      /// The tuple
+      unsigned tuple;
+   };
+   class EntrySorter;
+   class Run;
+   class RunSorter;
 
    /// The input registers
    std::vector<Register*> values;
    /// The input
    Operator* input;
-   /// The sorted tuples
-   std::vector<Tuple*> tuples;
-   /// The tuples pool
-   VarPool<Tuple> tuplesPool;
    /// The sort order
    std::vector<Order> order;
    /// The dictionary
    DictionarySegment& dict;
-   /// Tuples iterator
-   std::vector<Tuple*>::const_iterator tuplesIter;
+   /// Maximum amount of memory used for buffered tuples
+   uint64_t memoryLimit;
+   /// The buffered tuples, the count followed by the values
+   std::vector<unsigned> tuples;
+   /// The ranks of the sort keys of the buffered tuples
+   std::vector<unsigned> ranks;
+   /// The sort entries of the buffered tuples
+   std::vector<Entry> entries;
+   /// The distinct ids of the sort keys
+   std::vector<unsigned> keyIds;
+   /// The binary keys of the distinct ids
+   std::vector<unsigned char> idKeys;
+   /// The offsets of the binary keys
+   std::vector<unsigned> idKeyOfs;
+   /// The ids ordered by their binary keys
+   std::vector<unsigned> rankedIds;
+   /// The temporary file of spilled runs
+   FILE* spillFile;
+   /// The spilled runs, a heap ordered by the current tuple while merging
+   std::vector<Run*> runs;
+   /// Entries iterator
+   unsigned entriesPos;
+
+   /// Rank and sort the buffered tuples
+   void sortTuples();
+   /// Sort the buffered tuples and spill them as a run. Keeps them buffered if writing fails
+   bool spillTuples();
+   /// Read the spilled runs back into the buffer
+   void loadRuns();
+   /// Release spilled runs
+   void discardRuns();
 
    public:
    /// Constructor
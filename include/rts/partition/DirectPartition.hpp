@@ -0,0 +1,91 @@
+#ifndef H_rts_partition_DirectPartition
+#define H_rts_partition_DirectPartition
+//---------------------------------------------------------------------------
+#include "rts/partition/Partition.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include "infra/osdep/RandomAccessFile.hpp"
+#include <vector>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+/// A partition stored in a file that is read page by page into private
+/// buffers instead of being mapped. Optionally bypasses the operating system
+/// cache. Every read gets its own buffer that is recycled when the buffer
+/// manager releases the frame, so page memory follows the buffer budget.
+/// Modifications stay in that buffer until they are flushed
+class DirectPartition : public Partition
+{
+   private:
+   /// Number of lists of released buffers
+   static const unsigned poolCount = 16;
+   /// Released buffers
+   struct BufferPool {
+      /// Lock
+      Mutex mutex;
+      /// The buffers
+      std::vector<void*> buffers;
+   };
+
+   /// Protects the blocks and growing the file
+   Mutex mutex;
+   /// The backing file
+   RandomAccessFile file;
+   /// The total size in pages
+   unsigned size;
+   /// Blocks holding the page buffers
+   std::vector<void*> blocks;
+   /// The unused part of the last block
+   char* blockPos,*blockLimit;
+   /// Released buffers, spread by page number to avoid contention
+   BufferPool pools[poolCount];
+   /// Bypass the operating system cache?
+   bool direct;
+
+   /// Allocate a new buffer
+   void* allocBuffer(unsigned pageNo);
+   /// Release a buffer
+   void freeBuffer(unsigned pageNo,void* buffer);
+
+   public:
+   /// Constructor
+   explicit DirectPartition(bool direct);
+   /// Destructor
+   ~DirectPartition();
+
+   /// Open an existing partition
+   bool open(const char* name,bool readOnly);
+   /// Create a new partition
+   bool create(const char* name);
+   /// Close the partition
+   void close();
+
+   /// Acess a page for reading
+   const void* readPage(unsigned pageNo,PageInfo& info);
+   /// Finish reading a page
+   void finishReadPage(PageInfo& info);
+   /// Access a page for writing
+   void* writePage(unsigned pageNo,PageInfo& info);
+   /// Acess a page for writing without reading it first
+   void* buildPage(unsigned pageNo,PageInfo& info);
+   /// Access an already read page for writing
+   void* writeReadPage(PageInfo& info);
+   /// Write the changes back
+   bool flushWrittenPage(PageInfo& info);
+   /// Finish writing a page. Does _not_ write unflushed changes back!
+   void finishWrittenPage(PageInfo& info);
+   /// Flush the parition
+   bool flush();
+   /// Grow the partition.
+   bool grow(unsigned minIncrease,unsigned& start,unsigned& len);
+   /// The the partition size in pages
+   unsigned getSize() const;
+};
+//---------------------------------------------------------------------------
+#endif
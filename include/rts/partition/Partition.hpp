@@ -32,11 +32,12 @@ class Partition
    /// Destructor
    virtual ~Partition();
 
-   /// Acess a page for reading
+   /// Acess a page for reading. Returns 0 if the page cannot be read. The page
+   /// is only guaranteed to be accessible until finishReadPage is called
    virtual const void* readPage(unsigned pageNo,PageInfo& info) = 0;
    /// Finish reading a page
    virtual void finishReadPage(PageInfo& info) = 0;
-   /// Access a page for writing
+   /// Access a page for writing. Returns 0 if the page cannot be read
    virtual void* writePage(unsigned pageNo,PageInfo& info) = 0;
    /// Acess a page for writing without reading it first
    virtual void* buildPage(unsigned pageNo,PageInfo& info) = 0;
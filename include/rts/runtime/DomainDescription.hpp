@@ -10,6 +10,8 @@
 // or send a letter to Creative Commons, 171 Second Street, Suite 300,
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
+#include <vector>
+//---------------------------------------------------------------------------
 class ObservedDomainDescription;
 //---------------------------------------------------------------------------
 /** Domain description.
@@ -18,8 +20,12 @@ class ObservedDomainDescription;
 class DomainDescription
 {
    protected:
-   /// The desired bloom filter size
+   /// The minimum bloom filter size
    static const unsigned filterSize = 256;
+   /// The maximum bloom filter size
+   static const unsigned maxFilterSize = 1<<18;
+   /// The desired number of filter bits per observed value
+   static const unsigned filterBitsPerValue = 8;
    /// An filter entry
    typedef unsigned long FilterEntry;
    /// Bits in a filter entry
@@ -29,8 +35,11 @@ class DomainDescription
 
    /// Value bounds
    unsigned min,max;
-   /// Bloom filter of values
-   FilterEntry filter[filterSize];
+   /// Bloom filter of values. The size is a power of two, a value sets the bit value mod the number of bits.
+   /// This keeps the bits ordered by value for nextCandidate
+   std::vector<FilterEntry> filter;
+   /// One bit per filter entry, set if the entry is non-zero. Lets nextCandidate skip empty parts of large filters
+   std::vector<FilterEntry> summary;
 
    /// Constructor
    DomainDescription() {}
@@ -40,6 +49,13 @@ class DomainDescription
    /// Assignment
    DomainDescription& operator=(const DomainDescription& other);
 
+   /// Grow the filter, the new entries repeat the existing ones
+   void growFilter(unsigned size);
+   /// Recompute the summary after changing the filter
+   void rebuildSummary();
+   /// Find the first non-zero filter entry at or after index (or the filter size)
+   unsigned nextEntry(unsigned index) const;
+
    public:
    /// Could this value qualify?
    bool couldQualify(unsigned value) const;
@@ -66,11 +82,13 @@ class ObservedDomainDescription : public DomainDescription
    friend class PotentialDomainDescription;
 
    public:
-   /// Constructor
-   ObservedDomainDescription();
+   /// Constructor. The filter grows with the expected number of values
+   explicit ObservedDomainDescription(double expectedValues=0);
 
    /// Add an observed value
    void add(unsigned value);
+   /// Add the values observed by another description
+   void merge(const ObservedDomainDescription& other);
 };
 //---------------------------------------------------------------------------
 #endif
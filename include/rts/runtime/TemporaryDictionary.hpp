@@ -15,6 +15,7 @@
 #include <string>
 #include <map>
 //---------------------------------------------------------------------------
+class BufferReference;
 class DictionarySegment;
 class DifferentialIndex;
 //---------------------------------------------------------------------------
@@ -60,8 +61,8 @@ class TemporaryDictionary
 
    /// Lookup an id for a given string
    bool lookup(const std::string& text,Type::ID type,unsigned subType,unsigned& id);
-   /// Lookup a string for a given id
-   bool lookupById(unsigned id,const char*& start,const char*& stop,Type::ID& type,unsigned& subType);
+   /// Lookup a string for a given id. Strings of the database stay valid while the page reference is held
+   bool lookupById(unsigned id,BufferReference& page,const char*& start,const char*& stop,Type::ID& type,unsigned& subType);
 };
 //---------------------------------------------------------------------------
 #endif
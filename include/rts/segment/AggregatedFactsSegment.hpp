@@ -12,6 +12,7 @@
 //---------------------------------------------------------------------------
 #include "rts/segment/Segment.hpp"
 #include "rts/buffer/BufferReference.hpp"
+#include <vector>
 //---------------------------------------------------------------------------
 class DatabaseBuilder;
 //---------------------------------------------------------------------------
@@ -30,6 +31,10 @@ class AggregatedFactsSegment : public Segment
       /// Mark the last triple as duplicate
       virtual void markAsDuplicate() = 0;
    };
+   /// A key
+   struct Pair {
+      unsigned value1,value2;
+   };
 
    private:
    /// The index implementation layer
@@ -72,6 +77,8 @@ class AggregatedFactsSegment : public Segment
 
    /// Update the segment
    void update(Source& source);
+   /// Split the key range [from,to] into at most parts ranges of about equal numbers of leaf pages, each spanning at least minPages pages. Stores the inclusive upper bound of every range but the last
+   void splitRange(const Pair& from,const Pair& to,unsigned parts,unsigned minPages,std::vector<Pair>& bounds);
 
    /// A scan over the facts segment
    class Scan {
@@ -100,6 +107,8 @@ class AggregatedFactsSegment : public Segment
       BufferReference current;
       /// The segment
       AggregatedFactsSegment* seg;
+      /// The readahead
+      Readahead readahead;
       /// The position on the current page
       const Triple* pos,*posLimit;
       /// The decompressed triples
@@ -103,6 +103,8 @@ template <class T> class BTree : public T
 
    /// Navigate to a leaf node
    template <class V> bool findLeaf(BufferReference& leaf,const V& key);
+   /// Collect the upper bounds of all leaf pages in key order. Empty if the root is a leaf
+   template <class V> void collectLeafBounds(std::vector<std::pair<V,unsigned> >& bounds);
    /// Perform an initial bulkload
    template <class S> void performBulkload(S& source);
    /// Perform an update
@@ -118,6 +120,8 @@ template <class T> template <class V> bool BTree<T>::findLeaf(BufferReference& r
       const unsigned char* page=static_cast<const unsigned char*>(ref.getPage());
       // Inner node?
       if (isInnerPage(page)) {
+         // Inner nodes are shared by all lookups, keep them in the buffer
+         ref.markHot();
          // Perform a binary search. The test is more complex as we only have the upper bound for ranges
          unsigned left=0,right=getInnerCount(page);
          while (left!=right) {
@@ -151,6 +155,40 @@ template <class T> template <class V> bool BTree<T>::findLeaf(BufferReference& r
    }
 }
 //---------------------------------------------------------------------------
+template <class T> template <class V> void BTree<T>::collectLeafBounds(std::vector<std::pair<V,unsigned> >& bounds)
+   // Collect the upper bounds of all leaf pages in key order
+{
+   bounds.clear();
+   BufferReference ref(this->readShared(T::getRootPage()));
+   if (!isInnerPage(static_cast<const unsigned char*>(ref.getPage())))
+      return;
+
+   // Descend level by level, the lowest inner level holds the leaf bounds
+   std::vector<unsigned> level(1,T::getRootPage()),nextLevel;
+   while (true) {
+      nextLevel.clear();
+      bounds.clear();
+      for (std::vector<unsigned>::const_iterator iter=level.begin(),limit=level.end();iter!=limit;++iter) {
+         ref=this->readShared(*iter);
+         const unsigned char* page=static_cast<const unsigned char*>(ref.getPage());
+         for (unsigned slot=0,count=getInnerCount(page);slot<count;slot++) {
+            V key;
+            T::readInnerKey(key,getInnerPtr(page,slot));
+            bounds.push_back(std::pair<V,unsigned>(key,getInnerChildPage(page,slot)));
+            nextLevel.push_back(getInnerChildPage(page,slot));
+         }
+      }
+
+      // The tree is balanced, so one child tells the level
+      if (nextLevel.empty())
+         return;
+      ref=this->readShared(nextLevel.front());
+      if (!isInnerPage(static_cast<const unsigned char*>(ref.getPage())))
+         return;
+      level.swap(nextLevel);
+   }
+}
+//---------------------------------------------------------------------------
 template <class T> template <class S,class V> void BTree<T>::packLeaves(S& reader,std::vector<std::pair<V,unsigned> >& boundaries)
    // Pack the leaf pages
 {
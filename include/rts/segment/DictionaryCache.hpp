@@ -0,0 +1,105 @@
+#ifndef H_rts_segment_DictionaryCache
+#define H_rts_segment_DictionaryCache
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "infra/osdep/Mutex.hpp"
+#include "infra/util/Type.hpp"
+#include <map>
+#include <string>
+#include <stdint.h>
+//---------------------------------------------------------------------------
+/// A bounded cache of hot id->string mappings, shared by all queries. Ids
+/// are spread over independently locked shards, each shard evicts its least
+/// recently used entries. Dictionary entries never change, so the cache is
+/// never invalidated
+class DictionaryCache
+{
+   public:
+   /// Statistics
+   struct Statistics {
+      /// Number of lookups that found the id
+      uint64_t hits;
+      /// Number of lookups that did not find the id
+      uint64_t misses;
+      /// Number of evicted entries
+      uint64_t evictions;
+      /// Number of cached entries
+      unsigned entries;
+      /// The used memory in bytes
+      uint64_t size;
+   };
+
+   private:
+   /// The number of shards
+   static const unsigned shardCount = 16;
+
+   /// A cached string
+   struct Entry {
+      /// The id
+      unsigned id;
+      /// The type
+      ::Type::ID type;
+      /// The sub-type
+      unsigned subType;
+      /// The string
+      std::string value;
+      /// The neighbors in the LRU list
+      Entry* prev,*next;
+   };
+   /// A shard
+   struct Shard {
+      /// The mutex
+      Mutex mutex;
+      /// The cached entries
+      std::map<unsigned,Entry*> entries;
+      /// The LRU list, most recently used first
+      Entry* head,*tail;
+      /// The used memory
+      uint64_t size;
+      /// Statistics
+      uint64_t hits,misses,evictions;
+
+      /// Constructor
+      Shard() : head(0),tail(0),size(0),hits(0),misses(0),evictions(0) {}
+
+      /// Unlink an entry from the LRU list
+      void unlink(Entry* entry);
+      /// Add an entry at the front of the LRU list
+      void pushFront(Entry* entry);
+   };
+
+   /// The shards
+   Shard shards[shardCount];
+   /// The maximum memory per shard
+   uint64_t shardCapacity;
+
+   /// Get the shard of an id
+   Shard& getShard(unsigned id) { return shards[id%shardCount]; }
+
+   DictionaryCache(const DictionaryCache&);
+   void operator=(const DictionaryCache&);
+
+   public:
+   /// Constructor
+   explicit DictionaryCache(uint64_t capacityInBytes);
+   /// Destructor
+   ~DictionaryCache();
+
+   /// Find a string and copy it. Returns false if the id is not cached
+   bool lookup(unsigned id,std::string& value,::Type::ID& type,unsigned& subType);
+   /// Add a string
+   void insert(unsigned id,const char* start,const char* stop,::Type::ID type,unsigned subType);
+
+   /// Get statistics
+   void getStatistics(Statistics& statistics);
+};
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,107 @@
+#ifndef H_rts_segment_DictionaryFingerprintSegment
+#define H_rts_segment_DictionaryFingerprintSegment
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "rts/segment/Segment.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include <atomic>
+#include "infra/util/Type.hpp"
+#include <string>
+#include <stdint.h>
+//---------------------------------------------------------------------------
+class DatabaseBuilder;
+class DictionarySegment;
+//---------------------------------------------------------------------------
+/// An index from 64bit string fingerprints to ids, kept in memory as an open
+/// addressing table of 16 slot groups. Complements the hash b-tree of the
+/// dictionary: a lookup probes the table, and only falls back to the b-tree
+/// for fingerprints shared by multiple strings, for very long strings, and
+/// for strings added after the table was built
+class DictionaryFingerprintSegment : public Segment
+{
+   public:
+   /// The segment id
+   static const Segment::Type ID = Segment::Type_DictionaryFingerprint;
+   /// The result of a lookup
+   enum Result {
+      /// The string is not among the covered ids
+      Result_Absent,
+      /// The id of a string with the same fingerprint was found
+      Result_Found,
+      /// The table cannot decide, the b-tree must be used
+      Result_Unknown
+   };
+   /// The number of slots in a group
+   static const unsigned groupSize = 16;
+
+   /// Helper to allow test access to private members
+   class TestInterface;
+
+   private:
+   /// A group of slots
+   struct Group {
+      /// The control bytes. 7 bits of the fingerprint, or empty
+      unsigned char control[groupSize];
+      /// The fingerprints
+      uint64_t fingerprints[groupSize];
+      /// The ids
+      unsigned ids[groupSize];
+   };
+
+   /// The first page of the table
+   unsigned tableStart;
+   /// The number of groups, a power of two
+   unsigned groupCount;
+   /// The number of ids covered by the table
+   unsigned coveredIds;
+   /// The table in memory, if loaded
+   Group* table;
+   /// Was the table loaded, or found to be unusable?
+   std::atomic<bool> loaded;
+   /// Protects loading the table
+   Mutex loadLock;
+
+   /// Insert a fingerprint into the table
+   static void insert(Group* table,unsigned groupCount,uint64_t fingerprint,unsigned id);
+   /// Build the table from the dictionary
+   void computeFingerprints(DictionarySegment& dictionary);
+   /// Write the table
+   void writeTable();
+   /// Load the table
+   void loadTable();
+   /// Release the table
+   void freeTable();
+
+   friend class DatabaseBuilder;
+
+   DictionaryFingerprintSegment(const DictionaryFingerprintSegment&);
+   void operator=(const DictionaryFingerprintSegment&);
+   /// Refresh segment info stored in the partition
+   void refreshInfo();
+
+   public:
+   /// Constructor
+   DictionaryFingerprintSegment(DatabasePartition& partition);
+   /// Destructor
+   ~DictionaryFingerprintSegment();
+
+   /// Get the type
+   Segment::Type getType() const;
+
+   /// Compute the fingerprint of a string
+   static uint64_t fingerprint(const char* start,unsigned len,::Type::ID type,unsigned subType);
+   /// The number of ids covered by the table. Newer ids are only found by the b-tree
+   unsigned getCoveredIds() const { return coveredIds; }
+   /// Lookup the id of a string. A found id must be verified, the string might be absent with a colliding fingerprint
+   Result lookup(const std::string& text,::Type::ID type,unsigned subType,unsigned& id);
+};
+//---------------------------------------------------------------------------
+#endif
@@ -10,12 +10,16 @@
 // or send a letter to Creative Commons, 171 Second Street, Suite 300,
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
+#include "infra/osdep/Mutex.hpp"
 #include "infra/util/Type.hpp"
 #include "rts/segment/Segment.hpp"
+#include <atomic>
 #include <string>
 #include <vector>
 //---------------------------------------------------------------------------
+class BufferReference;
 class DatabaseBuilder;
+class DictionaryFingerprintSegment;
 //---------------------------------------------------------------------------
 /// A dictionary mapping strings to ids and backwards
 class DictionarySegment : public Segment
@@ -41,6 +45,18 @@ class DictionarySegment : public Segment
       bool operator<(const Literal& l) const { return (type<l.type)||((type==l.type)&&((subType<l.subType)||((subType==l.subType)&&(str<l.str)))); }
    };
 
+   /// A string found by id
+   struct IdString {
+      /// The string bounds. Point into the text buffer passed to lookupByIds
+      const char* start,*stop;
+      /// The type
+      ::Type::ID type;
+      /// The sub-type (if any, otherwise 0)
+      unsigned subType;
+      /// Was the id found?
+      bool found;
+   };
+
    /// A source for strings
    class StringSource
    {
@@ -82,13 +98,21 @@ class DictionarySegment : public Segment
    unsigned nextId;
    /// The mapping table(s) (id->page)
    std::vector<std::pair<unsigned,unsigned> > mappings;
+   /// Was the mapping chain read?
+   std::atomic<bool> mappingLoaded;
+   /// Protects reading the mapping chain
+   Mutex mappingLock;
    /// The root of the index b-tree
    unsigned indexRoot;
+   /// The fingerprint index, if any
+   DictionaryFingerprintSegment* fingerprints;
 
    /// Refresh segment info stored in the partition
    void refreshInfo();
    /// Refresh the mapping table if needed
    void refreshMapping();
+   /// Find the mapping entry of an id
+   bool findDirectoryEntry(unsigned id,unsigned& dirPage,unsigned& dirSlot) const;
    /// Lookup an id for a given string on a certain page in the raw string table
    bool lookupOnPage(unsigned pageNo,const std::string& text,::Type::ID type,unsigned subType,unsigned hash,unsigned& id);
 
@@ -110,11 +134,18 @@ class DictionarySegment : public Segment
 
    /// Lookup an id for a given string
    bool lookup(const std::string& text,::Type::ID type,unsigned subType,unsigned& id);
-   /// Lookup a string for a given id
-   bool lookupById(unsigned id,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType);
+   /// Lookup a string for a given id. The string points into the page, which stays fixed while the reference is held
+   bool lookupById(unsigned id,BufferReference& page,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType);
+   /// Lookup a string for a given id and copy it. Uses the string cache of the database
+   bool lookupById(unsigned id,std::string& value,::Type::ID& type,unsigned& subType);
+   /// Lookup strings for many ids. Sorted ids are grouped by page, each page is fixed once. The strings
+   /// are copied into text and stay valid until text is modified
+   void lookupByIds(const std::vector<unsigned>& ids,std::vector<IdString>& strings,std::vector<char>& text);
 
    /// Get the next id
    unsigned getNextId() const { return nextId; }
+   /// Does the dictionary have a fingerprint index?
+   bool hasFingerprints() const { return fingerprints; }
 
    /// Load new literals into the dictionary
    void appendLiterals(const std::vector<Literal>& strings);
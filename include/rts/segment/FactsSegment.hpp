@@ -12,8 +12,12 @@
 //---------------------------------------------------------------------------
 #include "rts/segment/Segment.hpp"
 #include "rts/buffer/BufferReference.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include <vector>
 //---------------------------------------------------------------------------
 class DatabaseBuilder;
+class DecodedLeaf;
+class LeafCache;
 //---------------------------------------------------------------------------
 /// A compressed facts table stored in a clustered B-Tree
 class FactsSegment : public Segment
@@ -25,6 +29,13 @@ class FactsSegment : public Segment
    enum Action {
       Action_UpdateInnerPage, Action_UpdateInner,Action_InsertInner,Action_UpdateLeaf
    };
+   /// Encodings for newly written leaves. Readers handle both
+   enum LeafFormat {
+      /// Byte-oriented delta encoding, supports versioned triples
+      LeafFormat_Delta=0,
+      /// Columnar blocks of bit-packed values, see PackedLeaf. Versioned triples still use the delta encoding
+      LeafFormat_Packed=1
+   };
    /// A source for updates
    class Source {
       public:
@@ -45,6 +56,8 @@ class FactsSegment : public Segment
    class IndexImplementation;
    /// The index
    class Index;
+   /// The key ranges of the leaf pages
+   class LeafSummary;
 
    private:
    /// The start of the raw facts table
@@ -53,6 +66,14 @@ class FactsSegment : public Segment
    unsigned indexRoot;
    /// Statistics
    unsigned pages,groups1,groups2,cardinality;
+   /// Incremented by updates, cached decompressed pages of older generations are stale
+   unsigned generation;
+   /// The encoding for new leaves
+   LeafFormat leafFormat;
+   /// The leaf summary, built on demand. Reference counted, scans may still use older generations
+   LeafSummary* summary;
+   /// Protects the leaf summary and its reference counts
+   Mutex summaryMutex;
 
    /// Refresh segment info stored in the partition
    void refreshInfo();
@@ -61,6 +82,12 @@ class FactsSegment : public Segment
    void loadFullFacts(Source& reader);
    /// Load count statistics
    void loadCounts(unsigned groups1,unsigned groups2,unsigned cardinality);
+   /// Set the encoding for new leaves
+   void setLeafFormat(LeafFormat leafFormat);
+   /// Get a reference to the leaf summary of the current generation. Returns 0 if the index has no inner pages
+   LeafSummary* acquireLeafSummary();
+   /// Release a reference to a leaf summary
+   void releaseLeafSummary(LeafSummary* summary);
 
    FactsSegment(const FactsSegment&);
    void operator=(const FactsSegment&);
@@ -70,6 +97,8 @@ class FactsSegment : public Segment
    public:
    /// Constructor
    explicit FactsSegment(DatabasePartition& partition);
+   /// Destructor
+   ~FactsSegment();
 
    /// Get the type
    Type getType() const;
@@ -82,9 +111,13 @@ class FactsSegment : public Segment
    unsigned getLevel2Groups() const { return groups2; }
    /// Get the total cardinality
    unsigned getCardinality() const { return cardinality; }
+   /// Get the encoding for new leaves
+   LeafFormat getLeafFormat() const { return leafFormat; }
 
    /// Update the segment
    void update(Source& source);
+   /// Split the key range [from,to] into at most parts ranges of about equal numbers of leaf pages, each spanning at least minPages pages. Stores the inclusive upper bound of every range but the last
+   void splitRange(const Triple& from,const Triple& to,unsigned parts,unsigned minPages,std::vector<Triple>& bounds);
 
    /// A scan over the facts segment
    class Scan {
@@ -109,10 +142,18 @@ class FactsSegment : public Segment
       BufferReference current;
       /// The segment
       FactsSegment* seg;
+      /// The readahead
+      Readahead readahead;
+      /// The cache for decompressed pages, if any
+      LeafCache* cache;
+      /// The cached current page, if any
+      const DecodedLeaf* leaf;
+      /// The leaf summary for hinted scans, if any. Holds a reference
+      LeafSummary* summary;
       /// The position on the current page
       const Triple* pos,*posLimit;
-      /// The decompressed triples
-      Triple triples[maxCount];
+      /// The decompressed triples if there is no cache. Allocated on demand
+      Triple* triples;
       /// The scan hint
       Hint* hint;
       /// The point in (version-)time where the scan should take place
@@ -120,6 +161,14 @@ class FactsSegment : public Segment
 
       /// Perform a binary search
       bool find(unsigned value1,unsigned value2,unsigned value3);
+      /// Decompress the current page or use the cached copy
+      void decodePage();
+      /// Unpin the cached page
+      void releaseLeaf();
+      /// Release the leaf summary
+      void releaseSummary();
+      /// Move to the first page that may contain an entry using the leaf summary. Returns false if there is none
+      bool skipPages(unsigned value1,unsigned value2,unsigned value3);
       /// Read the next page
       bool readNextPage();
 
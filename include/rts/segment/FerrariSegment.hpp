@@ -11,36 +11,99 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 #include "rts/segment/Segment.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include <deque>
+#include <map>
+#include <vector>
 //---------------------------------------------------------------------------
 class AggregatedFactsSegment;
 class Database;
 class DatabaseBuilder;
 class Graph;
+class Index;
 //---------------------------------------------------------------------------
-/// FERRARI reachability index segment
+/// FERRARI reachability index segment. Stores one serialized index per
+/// predicate, the indexes are materialized lazily on first access
 class FerrariSegment : public Segment
 {
+   public:
+   /// The segment id
+   static const Segment::Type ID = Segment::Type_Ferrari;
+   /// Statistics about the reachability index of a predicate
+   struct Statistics {
+      /// The number of nodes
+      unsigned nodes;
+      /// The number of strongly connected components
+      unsigned components;
+      /// The number of edges between components
+      unsigned edges;
+      /// The number of intervals over all components
+      unsigned long long intervals;
+      /// The sum of the reachable set sizes over all nodes, derived from the intervals. An upper bound, approximate intervals overestimate it
+      unsigned long long reachable;
+   };
 
-private:
+   private:
    friend class DatabaseBuilder;
    /// Position of the directory
    unsigned directoryPage;
+   /// The directory. Maps predicates to the first page of the index
+   std::vector<std::pair<unsigned,unsigned> > directory;
+   /// The statistics of the indexes, in directory order
+   std::vector<Statistics> statistics;
+   /// The indexes loaded so far
+   std::map<unsigned,Index*> loaded;
+   /// Protects the loaded indexes
+   Mutex loadLock;
+
+   /// A predicate whose index is being built
+   struct BuildJob;
+   /// State shared between the scan and the build workers
+   struct BuildPipeline;
 
-   // compute the index
-   void computeFerrari(Database& db);
-   // serialize the graph
-   unsigned packGraph(Graph* g);
+   /// Compute the indexes using up to threads workers, keeping the edges and indexes in flight within the memory budget
+   void computeFerrari(Database& db,unsigned threads,uint64_t memoryBudget);
+   /// Build and serialize the index of a predicate
+   static void buildIndex(BuildJob& job,unsigned nodeCount);
+   /// A build worker
+   static void buildWorker(void* data);
+   /// Write the finished jobs at the front of the pending list
+   void writeFinished(Database& db,std::deque<BuildJob*>& pending,BuildPipeline& pipeline);
+   /// Write a built index
+   void writeJob(Database& db,BuildJob& job);
+   /// Compute the statistics of an index
+   static void computeStatistics(Index& index,Statistics& stats);
+   /// Serialize an index
+   static void packIndex(Index& index,std::vector<unsigned char>& out);
+   /// Write a serialized index, returns the first page
+   unsigned writeIndex(const std::vector<unsigned char>& data);
+   /// Deserialize an index
+   Index* unpackIndex(unsigned firstPage);
+   /// Write the directory
+   void writeDirectory();
 
    FerrariSegment(const FerrariSegment&);
    void operator=(const FerrariSegment&);
    /// Refresh segment info stored in the partition
    void refreshInfo();
+
    public:
+   /// Constructor
    FerrariSegment(DatabasePartition& partition);
+   /// Destructor
+   ~FerrariSegment();
+
    /// Get type
    Type getType() const;
-   class Dumper;
 
+   /// Is there an index for the predicate?
+   bool hasIndex(unsigned predicate) const;
+   /// Get the index for a predicate, loading it if required. Returns 0 if the predicate is not indexed
+   Index* lookupIndex(unsigned predicate);
+   /// Get all indexed predicates
+   void getPredicates(std::vector<unsigned>& predicates) const;
+   /// Get the statistics of the index for a predicate. Returns false if not available
+   bool getStatistics(unsigned predicate,Statistics& stats) const;
 };
-
+//---------------------------------------------------------------------------
 #endif
@@ -0,0 +1,147 @@
+#ifndef H_rts_segment_LeafCache
+#define H_rts_segment_LeafCache
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "rts/segment/FactsSegment.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include <map>
+#include <vector>
+//---------------------------------------------------------------------------
+class LeafCache;
+//---------------------------------------------------------------------------
+/// A decompressed leaf page of a facts segment. Read-only once cached
+class DecodedLeaf
+{
+   private:
+   /// The segment
+   const FactsSegment* segment;
+   /// The segment generation the page was decoded in
+   unsigned generation;
+   /// The page
+   unsigned pageNo;
+   /// The version time
+   unsigned time;
+   /// The triples. Holds one unused entry at the end, the data is never empty
+   std::vector<FactsSegment::Triple> triples;
+   /// The number of scans using the page
+   unsigned pins;
+   /// The neighbors in the LRU list
+   DecodedLeaf* prev,*next;
+
+   /// Constructor
+   DecodedLeaf(const FactsSegment* segment,unsigned generation,unsigned pageNo,unsigned time,const FactsSegment::Triple* begin,const FactsSegment::Triple* end);
+
+   friend class LeafCache;
+
+   public:
+   /// The first triple
+   const FactsSegment::Triple* begin() const { return &triples[0]; }
+   /// Behind the last triple
+   const FactsSegment::Triple* end() const { return &triples[0]+(triples.size()-1); }
+};
+//---------------------------------------------------------------------------
+/// A bounded cache of decompressed facts leaves, shared by all scans. Pages
+/// are keyed by segment, segment generation, page, and version time, so
+/// updating a segment makes its cached pages unreachable. Pages are spread
+/// over independently locked shards. Pages in use are pinned, each shard
+/// evicts its least recently used unpinned pages
+class LeafCache
+{
+   public:
+   /// Statistics
+   struct Statistics {
+      /// Number of lookups that found the page
+      uint64_t hits;
+      /// Number of lookups that did not find the page
+      uint64_t misses;
+      /// Number of evicted pages
+      uint64_t evictions;
+      /// Number of cached pages
+      unsigned pages;
+      /// The used memory in bytes
+      uint64_t size;
+   };
+   /// The number of shards
+   static const unsigned shardCount = 16;
+
+   private:
+   /// The key of a page
+   struct Key {
+      /// The segment
+      const FactsSegment* segment;
+      /// The generation, page, and time
+      unsigned generation,pageNo,time;
+
+      /// Comparison
+      bool operator<(const Key& k) const;
+   };
+   /// A shard
+   struct Shard {
+      /// The mutex
+      Mutex mutex;
+      /// The cached pages
+      std::map<Key,DecodedLeaf*> pages;
+      /// The LRU list, most recently used first
+      DecodedLeaf* head,*tail;
+      /// The used memory
+      uint64_t size;
+      /// Statistics
+      uint64_t hits,misses,evictions;
+
+      /// Constructor
+      Shard() : head(0),tail(0),size(0),hits(0),misses(0),evictions(0) {}
+
+      /// Unlink a page from the LRU list
+      void unlink(DecodedLeaf* leaf);
+      /// Add a page at the front of the LRU list
+      void pushFront(DecodedLeaf* leaf);
+      /// Evict pages until the shard fits into its budget
+      void shrink(uint64_t capacity);
+   };
+
+   /// The shards
+   Shard shards[shardCount];
+   /// The maximum memory per shard
+   uint64_t shardCapacity;
+   /// The mutex protecting the buffers
+   Mutex bufferMutex;
+   /// Released decompression buffers
+   std::vector<FactsSegment::Triple*> buffers;
+
+   /// Get the shard of a page. Neighboring pages go to different shards
+   Shard& getShard(unsigned pageNo) { return shards[pageNo%shardCount]; }
+
+   LeafCache(const LeafCache&);
+   void operator=(const LeafCache&);
+
+   public:
+   /// The maximum number of triples on a page
+   static const unsigned maxTriples = BufferReference::pageSize;
+
+   /// Constructor
+   explicit LeafCache(uint64_t capacityInBytes);
+   /// Destructor
+   ~LeafCache();
+
+   /// Find a page and pin it. Returns 0 if the page is not cached
+   const DecodedLeaf* lookup(const FactsSegment* segment,unsigned generation,unsigned pageNo,unsigned time);
+   /// Get a buffer for maxTriples triples to decompress into. Must be passed to insert
+   FactsSegment::Triple* allocateBuffer();
+   /// Copy a decompressed page into the cache and pin it. Returns the cached page, which may stem from a concurrent insert
+   const DecodedLeaf* insert(const FactsSegment* segment,unsigned generation,unsigned pageNo,unsigned time,FactsSegment::Triple* buffer,const FactsSegment::Triple* bufferEnd);
+   /// Unpin a page
+   void release(const DecodedLeaf* leaf);
+
+   /// Get statistics
+   void getStatistics(Statistics& statistics);
+};
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,46 @@
+#ifndef H_rts_segment_PackedLeaf
+#define H_rts_segment_PackedLeaf
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "rts/segment/FactsSegment.hpp"
+//---------------------------------------------------------------------------
+/// The block-packed encoding of facts leaves. The triples are stored
+/// columnar in blocks of up to 128 entries. Each column of a block stores
+/// the differences to the block minimum with a fixed bit width, spread over
+/// four interleaved 32bit lanes so that four values are decoded at once.
+/// Holds unversioned triples only, the delta encoding covers the rest.
+///
+/// Layout behind the leaf header: marker[4] count[4] first triple[12]
+/// blocks[?]. A block is base1[4] base2[4] base3[4] count[1] bits[3]
+/// followed by the packed columns, all little-endian. Blocks are not aligned,
+/// the decoder uses unaligned loads
+class PackedLeaf
+{
+   public:
+   /// The maximum number of triples per block
+   static const unsigned blockSize = 128;
+   /// The size of the page header
+   static const unsigned headerSize = 20;
+
+   /// Is the leaf data block-packed? The marker is no valid id
+   static bool isPacked(const unsigned char* data) { return Segment::readUint32Aligned(data)==0xFFFFFFFF; }
+   /// Get the number of triples
+   static unsigned getCount(const unsigned char* data) { return Segment::readUint32Aligned(data+4); }
+   /// Get the first triple
+   static const unsigned char* getFirstTriple(const unsigned char* data) { return data+8; }
+
+   /// Pack sorted, distinct triples. Returns the number of packed triples, 0 if not even one fits
+   static unsigned pack(unsigned char* writer,unsigned char* limit,const FactsSegment::Triple* triples,unsigned count);
+   /// Unpack all triples. Returns the end of the output
+   static FactsSegment::Triple* unpack(const unsigned char* reader,FactsSegment::Triple* writer);
+};
+//---------------------------------------------------------------------------
+#endif
@@ -26,7 +26,7 @@ class Segment
 {
    public:
    /// Known segment types
-   enum Type { Unused, Type_SpaceInventory, Type_SegmentInventory, Type_Facts, Type_AggregatedFacts, Type_FullyAggregatedFacts, Type_Dictionary, Type_ExactStatistics, Type_BTree, Type_PredicateSet, Type_PathSelectivity, Type_Ferrari };
+   enum Type { Unused, Type_SpaceInventory, Type_SegmentInventory, Type_Facts, Type_AggregatedFacts, Type_FullyAggregatedFacts, Type_Dictionary, Type_ExactStatistics, Type_BTree, Type_PredicateSet, Type_PathSelectivity, Type_Ferrari, Type_DictionaryFingerprint };
 
    private:
    /// The containing database partition
@@ -46,6 +46,31 @@ class Segment
    friend class DatabaseBuilder;
 
    protected:
+   /// Background reads ahead of a scan over chained pages. Only physically
+   /// consecutive pages are read ahead, the window grows as long as the
+   /// background reads keep up with the scan
+   class Readahead {
+      private:
+      /// The last page of the scan
+      unsigned last;
+      /// The first page that was not requested yet
+      unsigned next;
+      /// The window size, 0 if inactive
+      unsigned window;
+
+      Readahead(const Readahead&);
+      void operator=(const Readahead&);
+
+      public:
+      /// Constructor
+      Readahead() : last(0),next(0),window(0) {}
+
+      /// The scan moves to a page
+      void advance(const Segment& segment,unsigned page);
+      /// Stop reading ahead, e.g. when the scan skips
+      void reset(const Segment& segment);
+   };
+
    /// Constructor
    explicit Segment(DatabasePartition& partition);
 
@@ -64,6 +89,10 @@ class Segment
    BufferRequestExclusive readExclusive(unsigned page);
    /// Read a specific page
    BufferRequestModified modifyExclusive(unsigned page);
+   /// Read pages in the background
+   unsigned prefetch(unsigned start,unsigned count,const void* owner) const;
+   /// Drop the waiting background reads of an owner
+   void cancelPrefetch(const void* owner) const;
 
    public:
    /// Allocate a new page
@@ -1,4 +1,5 @@
 #include "infra/osdep/GrowableMappedFile.hpp"
+#include "infra/osdep/MemoryArena.hpp"
 #include <vector>
 #if defined(WIN32)||defined(__WIN32__)||defined(_WIN32)
 #define CONFIG_WINDOWS
@@ -99,6 +100,7 @@ bool GrowableMappedFile::open(const char* name,char*& begin,char*& end,bool read
          if (!mapping) { ::close(file); return false; }
          begin=static_cast<char*>(mapping);
          end=begin+size;
+         MemoryArena::adviseHugePages(mapping,size);
 
          data=new Data();
          data->mappings.push_back(pair<char*,char*>(begin,end));
@@ -278,6 +280,7 @@ bool GrowableMappedFile::growMapping(ofs_t increment,char*& begin,char*& end)
    if (!mapping) return false;
    begin=static_cast<char*>(mapping);
    end=begin+increment;
+   MemoryArena::adviseHugePages(mapping,increment);
 
    data->mappings.push_back(pair<char*,char*>(begin,end));
 #endif
@@ -0,0 +1,235 @@
+#include "infra/osdep/MemoryArena.hpp"
+#ifdef CONFIG_WINDOWS
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+#include <cstdlib>
+#include <new>
+#include <vector>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+// NUMA policies, as in numaif.h
+static const int mpolPreferred = 1;
+static const int mpolInterleave = 3;
+#ifdef CONFIG_WINDOWS
+/// Alignment of unmapped large blocks, sufficient for direct I/O
+static const size_t largeAlignment = 4096;
+#endif
+//---------------------------------------------------------------------------
+static unsigned countNodes()
+   // Count the NUMA nodes
+{
+#ifdef CONFIG_WINDOWS
+   return 1;
+#else
+   // The file lists ranges like "0-3,5", we need the highest node
+   FILE* in=fopen("/sys/devices/system/node/online","r");
+   if (!in)
+      return 1;
+   unsigned nodes=1,value=0;
+   int c;
+   while ((c=fgetc(in))!=EOF) {
+      if ((c>='0')&&(c<='9')) {
+         value=10*value+(c-'0');
+      } else {
+         if (value+1>nodes) nodes=value+1;
+         value=0;
+      }
+   }
+   if (value+1>nodes) nodes=value+1;
+   fclose(in);
+   return nodes;
+#endif
+}
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The configuration, read once from the environment
+struct Configuration {
+   /// The huge page mode
+   unsigned hugePages;
+   /// Place blocks on NUMA nodes?
+   bool numa;
+   /// The number of NUMA nodes
+   unsigned nodes;
+
+   /// Constructor
+   Configuration();
+};
+//---------------------------------------------------------------------------
+Configuration::Configuration()
+   : hugePages(1),nodes(countNodes())
+   // Constructor
+{
+   if (getenv("HUGEPAGES"))
+      hugePages=atoi(getenv("HUGEPAGES"));
+   if (hugePages>2)
+      hugePages=1;
+   numa=(nodes>1);
+   if (getenv("NUMA"))
+      numa=atoi(getenv("NUMA"))!=0;
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+static const Configuration& getConfiguration()
+   // Get the configuration
+{
+   static Configuration configuration;
+   return configuration;
+}
+//---------------------------------------------------------------------------
+static bool isMapped(size_t size)
+   // Is a block large enough to be mapped directly?
+{
+   return size>=MemoryArena::hugePageSize;
+}
+//---------------------------------------------------------------------------
+static void place(void* block,size_t size,MemoryArena::Placement placement)
+   // Bind a block to NUMA nodes before it is touched
+{
+#if defined(__linux__)&&defined(SYS_mbind)
+   const Configuration& configuration=getConfiguration();
+   if ((!configuration.numa)||(configuration.nodes<2))
+      return;
+
+   const unsigned bitsPerWord=8*sizeof(unsigned long);
+   vector<unsigned long> mask((configuration.nodes+bitsPerWord-1)/bitsPerWord);
+   int mode;
+   if (placement==MemoryArena::Placement_Local) {
+      unsigned node=MemoryArena::getCurrentNode();
+      if (node>=configuration.nodes)
+         return;
+      mask[node/bitsPerWord]|=1ul<<(node%bitsPerWord);
+      mode=mpolPreferred;
+   } else {
+      for (unsigned node=0;node<configuration.nodes;node++)
+         mask[node/bitsPerWord]|=1ul<<(node%bitsPerWord);
+      mode=mpolInterleave;
+   }
+   // Placement is only a hint, failures are ignored
+   syscall(SYS_mbind,block,size,mode,&mask[0],mask.size()*bitsPerWord+1,0);
+#else
+   (void)block; (void)size; (void)placement;
+#endif
+}
+//---------------------------------------------------------------------------
+size_t MemoryArena::getBlockSize(size_t size)
+   // Get the usable size of a block
+{
+   if (!isMapped(size))
+      return size;
+   return ((size+hugePageSize-1)/hugePageSize)*hugePageSize;
+}
+//---------------------------------------------------------------------------
+void* MemoryArena::alloc(size_t size,Placement placement)
+   // Allocate a block
+{
+   // Small blocks come from the heap
+   if (!isMapped(size)) {
+      void* result=malloc(size?size:1);
+      if (!result)
+         throw std::bad_alloc();
+      return result;
+   }
+   size=getBlockSize(size);
+
+#ifdef CONFIG_WINDOWS
+   (void)placement;
+   void* result=_aligned_malloc(size,largeAlignment);
+   if (!result)
+      throw std::bad_alloc();
+   return result;
+#else
+   const Configuration& configuration=getConfiguration();
+   void* result=0;
+
+   // Explicit huge pages, if any are reserved
+#ifdef MAP_HUGETLB
+   if (configuration.hugePages==2) {
+      result=mmap(0,size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+      if (result==MAP_FAILED)
+         result=0;
+   }
+#endif
+
+   // Otherwise map regular pages aligned to a huge page, so that they can be merged
+   if (!result) {
+      void* mapping=mmap(0,size+hugePageSize,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+      if (mapping==MAP_FAILED)
+         throw std::bad_alloc();
+      char* raw=static_cast<char*>(mapping),*rawEnd=raw+size+hugePageSize;
+      char* begin=raw+((hugePageSize-(reinterpret_cast<size_t>(raw)%hugePageSize))%hugePageSize),*end=begin+size;
+      if (begin!=raw)
+         munmap(raw,begin-raw);
+      if (end!=rawEnd)
+         munmap(end,rawEnd-end);
+      result=begin;
+      if (configuration.hugePages)
+         adviseHugePages(result,size);
+   }
+
+   place(result,size,placement);
+   return result;
+#endif
+}
+//---------------------------------------------------------------------------
+void MemoryArena::free(void* block,size_t size)
+   // Release a block
+{
+   if (!block)
+      return;
+   if (!isMapped(size)) {
+      ::free(block);
+      return;
+   }
+
+#ifdef CONFIG_WINDOWS
+   _aligned_free(block);
+#else
+   munmap(block,getBlockSize(size));
+#endif
+}
+//---------------------------------------------------------------------------
+void MemoryArena::adviseHugePages(void* begin,size_t size)
+   // Ask for huge pages for an existing mapping
+{
+#if defined(MADV_HUGEPAGE)
+   if (getConfiguration().hugePages&&(size>=hugePageSize))
+      madvise(begin,size,MADV_HUGEPAGE);
+#else
+   (void)begin; (void)size;
+#endif
+}
+//---------------------------------------------------------------------------
+unsigned MemoryArena::getCurrentNode()
+   // Get the NUMA node of the calling thread
+{
+#if defined(__linux__)&&defined(SYS_getcpu)
+   unsigned cpu=0,node=0;
+   if (syscall(SYS_getcpu,&cpu,&node,0)==0)
+      return node;
+#endif
+   return 0;
+}
+//---------------------------------------------------------------------------
+unsigned MemoryArena::getNodeCount()
+   // Get the number of NUMA nodes
+{
+   return getConfiguration().nodes;
+}
+//---------------------------------------------------------------------------
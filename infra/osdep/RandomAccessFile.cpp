@@ -0,0 +1,247 @@
+#include "infra/osdep/RandomAccessFile.hpp"
+#if defined(WIN32)||defined(__WIN32__)||defined(_WIN32)
+#define CONFIG_WINDOWS
+#endif
+#ifdef CONFIG_WINDOWS
+#include <windows.h>
+#include <malloc.h>
+#include <cstring>
+#else
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#endif
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//----------------------------------------------------------------------------
+// OS dependent data
+struct RandomAccessFile::Data
+{
+#ifdef CONFIG_WINDOWS
+   /// The file
+   HANDLE file;
+#else
+   /// The file
+   int file;
+#endif
+   /// The size
+   ofs_t size;
+   /// Is the cache bypassed?
+   bool direct;
+};
+//----------------------------------------------------------------------------
+#ifndef CONFIG_WINDOWS
+static int openFile(const char* name,int flags,bool& direct)
+   // Open a file, preferably bypassing the cache
+{
+#if defined(O_DIRECT)
+   if (direct) {
+      int file=::open(name,flags|O_DIRECT,00640);
+      // Some file systems do not support direct access
+      if ((file>=0)||(errno!=EINVAL))
+         return file;
+      direct=false;
+   }
+   return ::open(name,flags,00640);
+#elif defined(F_NOCACHE)
+   int file=::open(name,flags,00640);
+   if ((file>=0)&&direct)
+      direct=(fcntl(file,F_NOCACHE,1)!=-1);
+   return file;
+#else
+   direct=false;
+   return ::open(name,flags,00640);
+#endif
+}
+#endif
+//----------------------------------------------------------------------------
+RandomAccessFile::RandomAccessFile()
+   : data(0)
+   // Constructor
+{
+}
+//----------------------------------------------------------------------------
+RandomAccessFile::~RandomAccessFile()
+   // Destructor
+{
+   close();
+}
+//----------------------------------------------------------------------------
+bool RandomAccessFile::open(const char* name,bool readOnly,bool direct)
+   // Open
+{
+   if (!name) return false;
+   close();
+
+   #ifdef CONFIG_WINDOWS
+      HANDLE file;
+      DWORD flags=direct?FILE_FLAG_NO_BUFFERING:0;
+      if (readOnly)
+         file=CreateFile(name,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,flags,0); else
+         file=CreateFile(name,GENERIC_READ|GENERIC_WRITE,0,0,OPEN_EXISTING,flags,0);
+      if (file==INVALID_HANDLE_VALUE) return false;
+      LARGE_INTEGER size;
+      if (!GetFileSizeEx(file,&size)) { CloseHandle(file); return false; }
+      data=new Data();
+      data->size=size.QuadPart;
+   #else
+      int file=openFile(name,readOnly?O_RDONLY:O_RDWR,direct);
+      if (file<0) return false;
+      off_t size=lseek(file,0,SEEK_END);
+      if (size<0) { ::close(file); return false; }
+      data=new Data();
+      data->size=size;
+   #endif
+
+   data->file=file;
+   data->direct=direct;
+
+   return true;
+}
+//----------------------------------------------------------------------------
+bool RandomAccessFile::create(const char* name,bool direct)
+   // Create a new file
+{
+   if (!name) return false;
+   close();
+
+   #ifdef CONFIG_WINDOWS
+      HANDLE file=CreateFile(name,GENERIC_READ|GENERIC_WRITE,0,0,CREATE_ALWAYS,direct?FILE_FLAG_NO_BUFFERING:0,0);
+      if (file==INVALID_HANDLE_VALUE) return false;
+   #else
+      int file=openFile(name,O_RDWR|O_CREAT|O_TRUNC,direct);
+      if (file<0) return false;
+   #endif
+
+   data=new Data();
+   data->file=file;
+   data->size=0;
+   data->direct=direct;
+
+   return true;
+}
+//----------------------------------------------------------------------------
+void RandomAccessFile::close()
+   // Close
+{
+   if (data) {
+#ifdef CONFIG_WINDOWS
+      CloseHandle(data->file);
+#else
+      ::close(data->file);
+#endif
+      delete data;
+      data=0;
+   }
+}
+//----------------------------------------------------------------------------
+bool RandomAccessFile::flush()
+   // Flush the file
+{
+   if (!data) return false;
+
+#ifdef CONFIG_WINDOWS
+   return FlushFileBuffers(data->file);
+#elif defined(CONFIG_DARWIN)
+   return fsync(data->file)==0;
+#else
+   return fdatasync(data->file)==0;
+#endif
+}
+//----------------------------------------------------------------------------
+bool RandomAccessFile::isDirect() const
+   // Is the operating system cache bypassed?
+{
+   return data&&data->direct;
+}
+//----------------------------------------------------------------------------
+RandomAccessFile::ofs_t RandomAccessFile::getSize() const
+   // The file size
+{
+   return data?data->size:0;
+}
+//----------------------------------------------------------------------------
+bool RandomAccessFile::grow(ofs_t increment)
+   // Grow the file
+{
+#ifdef CONFIG_WINDOWS
+   LARGE_INTEGER s; s.QuadPart=data->size+increment;
+   if ((!SetFilePointerEx(data->file,s,0,FILE_BEGIN))||(!SetEndOfFile(data->file)))
+      return false;
+#else
+   if (ftruncate(data->file,data->size+increment)!=0)
+      return false;
+#endif
+
+   data->size+=increment;
+   return true;
+}
+//----------------------------------------------------------------------------
+bool RandomAccessFile::read(ofs_t ofs,void* data,unsigned len)
+   // Read
+{
+#ifdef CONFIG_WINDOWS
+   OVERLAPPED info;
+   memset(&info,0,sizeof(info));
+   LARGE_INTEGER o; o.QuadPart=ofs;
+   info.Offset=o.LowPart;
+   info.OffsetHigh=o.HighPart;
+   DWORD result;
+   if (!ReadFile(this->data->file,data,len,&result,&info))
+      return false;
+   return result==len;
+#else
+   return static_cast<unsigned>(pread(this->data->file,data,len,ofs))==len;
+#endif
+}
+//----------------------------------------------------------------------------
+bool RandomAccessFile::write(ofs_t ofs,const void* data,unsigned len)
+   // Write
+{
+#ifdef CONFIG_WINDOWS
+   OVERLAPPED info;
+   memset(&info,0,sizeof(info));
+   LARGE_INTEGER o; o.QuadPart=ofs;
+   info.Offset=o.LowPart;
+   info.OffsetHigh=o.HighPart;
+   DWORD result;
+   if (!WriteFile(this->data->file,data,len,&result,&info))
+      return false;
+   return result==len;
+#else
+   return static_cast<unsigned>(pwrite(this->data->file,data,len,ofs))==len;
+#endif
+}
+//----------------------------------------------------------------------------
+void* RandomAccessFile::allocBuffer(unsigned len)
+   // Allocate a buffer suitable for direct access
+{
+#ifdef CONFIG_WINDOWS
+   return _aligned_malloc(len,blockSize);
+#else
+   void* result;
+   if (posix_memalign(&result,blockSize,len)!=0)
+      return 0;
+   return result;
+#endif
+}
+//----------------------------------------------------------------------------
+void RandomAccessFile::freeBuffer(void* buffer)
+   // Release a buffer
+{
+#ifdef CONFIG_WINDOWS
+   _aligned_free(buffer);
+#else
+   free(buffer);
+#endif
+}
+//----------------------------------------------------------------------------
@@ -70,6 +70,19 @@ uint64_t Thread::guessPhysicalAvailable()
 #endif
 }
 //---------------------------------------------------------------------------
+unsigned Thread::guessProcessorCount()
+   // Guess the number of available processors
+{
+#ifdef CONFIG_WINDOWS
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   return info.dwNumberOfProcessors;
+#else
+   long count=sysconf(_SC_NPROCESSORS_ONLN);
+   return (count>0)?static_cast<unsigned>(count):1;
+#endif
+}
+//---------------------------------------------------------------------------
 void Thread::sleep(unsigned time)
    // Wait x ms
 {
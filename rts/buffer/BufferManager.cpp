@@ -16,9 +16,17 @@
 //---------------------------------------------------------------------------
 /// Checkpoint after how many pages?
 static const unsigned checkpointLimit = 1024;
+/// Initial size of a directory hash table
+static const unsigned initialDirectorySize = 64;
+/// Number of readahead threads
+static const unsigned prefetchThreads = 4;
+/// Maximum number of waiting readahead requests
+static const unsigned maxPrefetchQueue = 1024;
+/// Granularity of the operating system when faulting in mapped pages
+static const unsigned osPageSize = 4096;
 //---------------------------------------------------------------------------
 BufferFrame::BufferFrame()
-   : buffer(0),intentionLock(0),data(0),partition(0),pageNo(0),lsn(0),state(Empty),next(0)
+   : buffer(0),intentionLock(0),data(0),partition(0),pageNo(0),lsn(0),state(Empty),queue(Unqueued),hot(false),next(0),prev(0)
    // Constructor
 {
 }
@@ -44,21 +52,143 @@ BufferFrame* BufferFrame::update() const
    return result;
 }
 //---------------------------------------------------------------------------
-BufferManager::BufferManager(unsigned bufferSizeHintInBytes)
-   : bufferSize(bufferSizeHintInBytes/BufferReference::pageSize),dirtLimit(3*bufferSize/4),releasedFrames(0),
-     dirtCounter(0),logManager(0),checkpointsEnabled(false),pagesSinceLastCheckpoint(0),doCrash(false)
+uint64_t BufferManager::PageID::hash() const
+   // Hash value
+{
+   // Mix all bits, the high bits select the directory part
+   uint64_t result=(reinterpret_cast<uintptr_t>(partition)*0x9E3779B97F4A7C15ull)+pageNo;
+   result^=result>>33;
+   result*=0xFF51AFD7ED558CCDull;
+   result^=result>>33;
+   result*=0xC4CEB9FE1A85EC53ull;
+   return result^(result>>33);
+}
+//---------------------------------------------------------------------------
+void BufferManager::FrameList::pushFront(BufferFrame* frame)
+   // Add a frame at the front
+{
+   frame->prev=0;
+   frame->next=head;
+   if (head)
+      head->prev=frame; else
+      tail=frame;
+   head=frame;
+   size++;
+}
+//---------------------------------------------------------------------------
+void BufferManager::FrameList::remove(BufferFrame* frame)
+   // Remove a frame
+{
+   if (frame->prev)
+      frame->prev->next=frame->next; else
+      head=frame->next;
+   if (frame->next)
+      frame->next->prev=frame->prev; else
+      tail=frame->prev;
+   frame->next=frame->prev=0;
+   size--;
+}
+//---------------------------------------------------------------------------
+BufferManager::DirectoryPartition::DirectoryPartition()
+   : entries(initialDirectorySize),count(0),releasedFrames(0),capacity(1),hits(0),misses(0),evictions(0)
    // Constructor
 {
+}
+//---------------------------------------------------------------------------
+BufferFrame* BufferManager::DirectoryPartition::lookup(const PageID& page,uint64_t hash) const
+   // Find a frame
+{
+   unsigned mask=entries.size()-1;
+   for (unsigned slot=hash&mask;;slot=(slot+1)&mask) {
+      const DirectoryEntry& entry=entries[slot];
+      if (!entry.frame)
+         return 0;
+      if (entry.page==page)
+         return entry.frame;
+   }
+}
+//---------------------------------------------------------------------------
+void BufferManager::DirectoryPartition::insert(const PageID& page,uint64_t hash,BufferFrame* frame)
+   // Insert a frame
+{
+   // Keep the table at most half full
+   if (2*(count+1)>entries.size()) {
+      std::vector<DirectoryEntry> old(2*entries.size());
+      old.swap(entries);
+      count=0;
+      for (std::vector<DirectoryEntry>::const_iterator iter=old.begin(),limit=old.end();iter!=limit;++iter)
+         if ((*iter).frame)
+            insert((*iter).page,(*iter).page.hash(),(*iter).frame);
+   }
+
+   unsigned mask=entries.size()-1,slot=hash&mask;
+   while (entries[slot].frame)
+      slot=(slot+1)&mask;
+   entries[slot].page=page;
+   entries[slot].frame=frame;
+   count++;
+}
+//---------------------------------------------------------------------------
+void BufferManager::DirectoryPartition::erase(const PageID& page,uint64_t hash)
+   // Remove a frame
+{
+   unsigned mask=entries.size()-1,slot=hash&mask;
+   while (!(entries[slot].page==page)) {
+      assert(entries[slot].frame);
+      slot=(slot+1)&mask;
+   }
+
+   // Shift the following entries back instead of leaving a tombstone
+   for (unsigned next=(slot+1)&mask;entries[next].frame;next=(next+1)&mask) {
+      unsigned home=entries[next].page.hash()&mask;
+      // Can the entry move into the hole?
+      if (((next-home)&mask)>=((next-slot)&mask)) {
+         entries[slot]=entries[next];
+         slot=next;
+      }
+   }
+   entries[slot].frame=0;
+   entries[slot].page=PageID();
+   count--;
+}
+//---------------------------------------------------------------------------
+BufferManager::BufferManager(unsigned bufferSizeInBytes)
+   : bufferSize(bufferSizeInBytes/BufferReference::pageSize),residentPages(0),stealCursor(0),dirtLimit(3*bufferSize/4),
+     dirtCounter(0),logManager(0),checkpointsEnabled(false),pagesSinceLastCheckpoint(0),doCrash(false),
+     prefetchDie(false),prefetchAlive(0)
+   // Constructor
+{
+   // Compute the fair share of the directory parts
+   unsigned capacity=bufferSize/directoryPartitions;
+   for (unsigned index=0;index<directoryPartitions;index++)
+      directory[index].capacity=capacity?capacity:1;
+
    // Start the writer thread
    dirtCounter=0;
    flusherDie=flusherDead=false;
    Thread::start(startFlusher,this,true);
+
+   // Start the readahead threads
+   prefetchMutex.lock();
+   for (unsigned index=0;index<prefetchThreads;index++)
+      if (Thread::start(startPrefetcher,this))
+         prefetchAlive++;
+   prefetchMutex.unlock();
 }
 //---------------------------------------------------------------------------
 BufferManager::~BufferManager()
    // BufferManager
 {
+   // Stop the readahead threads
+   prefetchMutex.lock();
+   prefetchDie=true;
+   prefetchNotify.notifyAll(prefetchMutex);
+   while (prefetchAlive)
+      prefetchDeadNotify.wait(prefetchMutex);
+   prefetchMutex.unlock();
+
    // Lock the mutex to synchronize with the writer
+   mutex.lock();
 
    // Stop the writer
    flusherDie=true;
@@ -74,12 +204,14 @@ BufferManager::~BufferManager()
       }
    } while (dirtCounter>0);
 
-   // Release all remaining pages. All pages must be empty unless we simulate a crash!
-   for (std::map<PageID,BufferFrame*>::iterator iter=directory.begin(),limit=directory.end();iter!=limit;++iter) {
-      BufferFrame& frame=*((*iter).second);
-      if (frame.state!=BufferFrame::Empty) {
+   // Release all remaining pages. All pages must be clean unless we simulate a crash!
+   for (unsigned index=0;index<directoryPartitions;index++) {
+      DirectoryPartition& part=directory[index];
+      for (std::vector<DirectoryEntry>::iterator iter=part.entries.begin(),limit=part.entries.end();iter!=limit;++iter) {
+         if (!(*iter).frame) continue;
+         BufferFrame& frame=*((*iter).frame);
          if (!doCrash) {
-            assert(frame.state==BufferFrame::Empty);
+            assert((frame.state==BufferFrame::Empty)||(frame.state==BufferFrame::Read));
          }
          switch (frame.state) {
             case BufferFrame::Empty: break;
@@ -87,90 +219,237 @@ BufferManager::~BufferManager()
             case BufferFrame::Write: frame.partition->finishWrittenPage(frame.pageInfo); break;
             case BufferFrame::WriteDirty: frame.partition->finishWrittenPage(frame.pageInfo); break;
          }
+         delete &frame;
+         (*iter).frame=0;
       }
-      delete &frame;
-   }
-   directory.clear();
+      part.count=0;
 
-   // Release all released frames
-   while (releasedFrames) {
-      BufferFrame* frame=releasedFrames;
-      releasedFrames=frame->next;
-      delete frame;
+      // Release all released frames
+      while (part.releasedFrames) {
+         BufferFrame* frame=part.releasedFrames;
+         part.releasedFrames=frame->next;
+         delete frame;
+      }
    }
 
    // Release the lock again
    mutex.unlock();
 }
 //---------------------------------------------------------------------------
-BufferFrame* BufferManager::findBufferFrame(Partition* partition,unsigned pageNo,bool exclusive)
-   // Find or create a buffer frame
+BufferFrame* BufferManager::findBufferFrame(DirectoryPartition& part,Partition* partition,unsigned pageNo,uint64_t hash,bool exclusive)
+   // Find or create a buffer frame. The directory part must be locked
 {
    // Check the diectory
    PageID pageID(partition,pageNo);
 
-   std::map<PageID,BufferFrame*>::iterator iter=directory.find(pageID);
-   if (iter!=directory.end()) {
+   BufferFrame* frame=part.lookup(pageID,hash);
+   if (frame) {
       // Fond, try to lock it...
-      bool success;
-      BufferFrame& frame=*((*iter).second);
-      if (frame.state==BufferFrame::Empty)
+      bool shared=!exclusive;
+      if (frame->state==BufferFrame::Empty)
          exclusive=true;
+      bool success;
       if (exclusive)
-         success=frame.latch.tryLockExclusive(); else
-         success=frame.latch.tryLockShared();
-      if (success)
-         return &frame;
-      // Unsuccessful, try again in blocking mode
-      frame.intentionLock++;
-      mutex.unlock();
-      if (exclusive)
-         frame.latch.lockExclusive(); else
-         frame.latch.lockShared();
+         success=frame->latch.tryLockExclusive(); else
+         success=frame->latch.tryLockShared();
+      if (!success) {
+         // Unsuccessful, try again in blocking mode. Shared requests wait for a concurrent reader with a shared latch,
+         // otherwise they would also wait for all other threads that fix the page once it is read
+         frame->intentionLock++;
+         part.mutex.unlock();
+         if (shared)
+            frame->latch.lockShared(); else
+            frame->latch.lockExclusive();
+         part.mutex.lock();
+         frame->intentionLock--;
+         // The page was not read after all? Then start over
+         if (shared&&(frame->state==BufferFrame::Empty)) {
+            frame->latch.unlock();
+            return findBufferFrame(part,partition,pageNo,hash,false);
+         }
+      }
+      // Update the replacement queues
+      switch (frame->queue) {
+         case BufferFrame::Unqueued: case BufferFrame::Recent: part.hits++; return frame;
+         case BufferFrame::Frequent: part.frequent.remove(frame); part.frequent.pushFront(frame); part.hits++; return frame;
+         case BufferFrame::Ghost: part.ghosts.remove(frame); part.frequent.pushFront(frame); frame->queue=BufferFrame::Frequent; residentPages++; break;
+      }
+   } else {
+      // Not found, allocate a new frame
+      if (part.releasedFrames) {
+         frame=part.releasedFrames;
+         part.releasedFrames=frame->next;
+         frame->next=0;
+      } else {
+         frame=new BufferFrame();
+      }
+      part.insert(pageID,hash,frame);
+
+      // And initialize it
+      BufferFrame& result=*frame;
+      result.buffer=this;
+      result.latch.lockExclusive();
+      result.intentionLock=0;
+      result.data=0;
+      result.partition=partition;
+      result.pageNo=pageNo;
+      result.lsn=0;
+      result.state=BufferFrame::Empty;
+      result.hot=false;
+      result.queue=BufferFrame::Recent;
+      part.recent.pushFront(frame);
+      residentPages++;
+   }
+   part.misses++;
+
+   // Stay within the budget. Parts above their share give back pages first, the others take them from parts that borrowed
+   while (residentPages>bufferSize) {
+      if (((part.recent.size+part.frequent.size)>part.capacity)&&evictFrame(part))
+         continue;
+      if ((!stealFrame(part))&&(!evictFrame(part)))
+         break;
+   }
+
+   // Trigger the flusher if dirty pages keep us above the budget, otherwise write operations can flood the main memory
+   if ((residentPages>bufferSize)&&(dirtCounter>dirtLimit)) {
+      part.mutex.unlock();
       mutex.lock();
-      frame.intentionLock--;
-      // Success...
-      return &frame;
+      if (dirtCounter>dirtLimit) {
+         flusherNotify.notify(mutex);
+         flusherDone.wait(mutex);
+      }
+      mutex.unlock();
+      part.mutex.lock();
    }
-   // Not found, allocate a new frame
-   BufferFrame* frame;
-   if (releasedFrames) {
-      frame=releasedFrames;
-      releasedFrames=frame->next;
-      frame->next=0;
-   } else {
-      frame=new BufferFrame();
+
+   return frame;
+}
+//---------------------------------------------------------------------------
+void BufferManager::dropFrame(DirectoryPartition& part,BufferFrame* frame)
+   // Remove an unused frame from the directory. The directory part must be locked
+{
+   switch (frame->queue) {
+      case BufferFrame::Unqueued: break;
+      case BufferFrame::Recent: part.recent.remove(frame); residentPages--; break;
+      case BufferFrame::Frequent: part.frequent.remove(frame); residentPages--; break;
+      case BufferFrame::Ghost: part.ghosts.remove(frame); break;
+   }
+   PageID pageID(frame->partition,frame->pageNo);
+   part.erase(pageID,pageID.hash());
+
+   frame->queue=BufferFrame::Unqueued;
+   frame->data=0;
+   frame->partition=0;
+   frame->pageNo=0;
+   frame->next=part.releasedFrames;
+   part.releasedFrames=frame;
+}
+//---------------------------------------------------------------------------
+bool BufferManager::evictFrame(DirectoryPartition& part)
+   // Evict an unfixed clean page. The directory part must be locked
+{
+   // Take from the recent queue while it exceeds its share
+   bool recentFirst=(4*part.recent.size>part.capacity)||(!part.frequent.size);
+   for (unsigned round=0;round<2;round++) {
+      FrameList& list=(recentFirst==(!round))?part.recent:part.frequent;
+      for (BufferFrame* frame=list.tail,*prev;frame;frame=prev) {
+         prev=frame->prev;
+         // Hot pages get a second chance
+         if (frame->hot) {
+            frame->hot=false;
+            list.remove(frame);
+            list.pushFront(frame);
+            continue;
+         }
+         // Only unfixed clean pages can be evicted
+         if ((frame->state!=BufferFrame::Read)||frame->intentionLock||(!frame->latch.tryLockExclusive()))
+            continue;
+         frame->partition->finishReadPage(frame->pageInfo);
+         frame->state=BufferFrame::Empty;
+         frame->data=0;
+         frame->latch.unlock();
+         part.evictions++;
+
+         // Remember pages evicted from the recent queue
+         if (&list==&part.recent) {
+            part.recent.remove(frame);
+            part.ghosts.pushFront(frame);
+            frame->queue=BufferFrame::Ghost;
+            residentPages--;
+            while (part.ghosts.size>((part.capacity>1)?(part.capacity/2):1))
+               dropFrame(part,part.ghosts.tail);
+         } else {
+            dropFrame(part,frame);
+         }
+         return true;
+      }
    }
-   directory[pageID]=frame;
-
-   // And initialize it
-   BufferFrame& result=*frame;
-   result.buffer=this;
-   result.latch.lockExclusive();
-   result.intentionLock=0;
-   result.data=0;
-   result.partition=partition;
-   result.pageNo=pageNo;
-   result.lsn=0;
-   result.state=BufferFrame::Empty;
-
-   // Trigger the flusher if needed, otherwise write operations can flood the main memory
-   if ((dirtCounter>dirtLimit)&&(directory.size()>bufferSize+dirtLimit)) {
-      flusherNotify.notify(mutex);
-      flusherDone.wait(mutex);
+   return false;
+}
+//---------------------------------------------------------------------------
+bool BufferManager::stealFrame(DirectoryPartition& part)
+   // Evict a page of another directory part that exceeds its share. The own directory part must be locked
+{
+   for (unsigned index=0;index<directoryPartitions;index++) {
+      DirectoryPartition& victim=directory[(stealCursor++)%directoryPartitions];
+      if (&victim==&part)
+         continue;
+      // Never wait while holding the own lock, busy parts are skipped
+      if (!victim.mutex.tryLock())
+         continue;
+      bool evicted=((victim.recent.size+victim.frequent.size)>victim.capacity)&&evictFrame(victim);
+      victim.mutex.unlock();
+      if (evicted)
+         return true;
    }
+   return false;
+}
+//---------------------------------------------------------------------------
+void BufferManager::releaseFrame(BufferFrame* frame,Partition* oldPartition,unsigned oldPageNo)
+   // Release a frame after its latch was released. The old page identifies the frame
+{
+   PageID pageID(oldPartition,oldPageNo);
+   DirectoryPartition& part=getDirectory(pageID.hash());
 
-   return &result;
+   part.mutex.lock();
+   // Is this really the last reference?
+   if (frame->latch.tryLockExclusive()) {
+      // Still the same?
+      if ((frame->partition==oldPartition)&&(frame->pageNo==oldPageNo)) {
+         // Written pages are released, read pages stay in the buffer
+         switch (frame->state) {
+            case BufferFrame::Empty: break;
+            case BufferFrame::Read: break;
+            case BufferFrame::Write: frame->partition->finishWrittenPage(frame->pageInfo); frame->state=BufferFrame::Empty; break;
+            case BufferFrame::WriteDirty: break;
+         }
+         // And release the buffer frame itself if there is no contention
+         if ((frame->state==BufferFrame::Empty)&&(!frame->intentionLock))
+            dropFrame(part,frame);
+      }
+      frame->latch.unlock();
+   }
+   part.mutex.unlock();
 }
 //---------------------------------------------------------------------------
 BufferFrame* BufferManager::buildPage(Partition& partition,unsigned pageNo)
    // Prepare a page for writing without reading it. Page is exclusive but not modifed
 {
-   mutex.lock();
-   BufferFrame* frame=findBufferFrame(&partition,pageNo,true);
-   mutex.unlock();
+   uint64_t hash=PageID(&partition,pageNo).hash();
+   DirectoryPartition& part=getDirectory(hash);
+   part.mutex.lock();
+   BufferFrame* frame=findBufferFrame(part,&partition,pageNo,hash,true);
+   part.mutex.unlock();
    switch (frame->state) {
-      case BufferFrame::Empty: frame->data=partition.writePage(pageNo,frame->pageInfo); frame->state=BufferFrame::Write; break;
+      case BufferFrame::Empty:
+         frame->data=partition.writePage(pageNo,frame->pageInfo);
+         if (!frame->data) {
+            // The page could not be read, release the still empty frame
+            unfixPage(frame);
+            return 0;
+         }
+         frame->state=BufferFrame::Write;
+         break;
       case BufferFrame::Read: frame->data=partition.writeReadPage(frame->pageInfo); frame->state=BufferFrame::Write; break;
       case BufferFrame::Write: break;
       case BufferFrame::WriteDirty: break;
@@ -181,24 +460,34 @@ BufferFrame* BufferManager::buildPage(Partition& partition,unsigned pageNo)
 const BufferFrame* BufferManager::readPageShared(Partition& partition,unsigned pageNo)
    // Read a page. Page is shared and not modified
 {
-   mutex.lock();
-   BufferFrame* frame=findBufferFrame(&partition,pageNo,false);
+   uint64_t hash=PageID(&partition,pageNo).hash();
+   DirectoryPartition& part=getDirectory(hash);
+   part.mutex.lock();
+   BufferFrame* frame=findBufferFrame(part,&partition,pageNo,hash,false);
    // Empty frames are always locked exclusive. Mark intention to prepare for reads
    if (frame->state==BufferFrame::Empty)
       frame->intentionLock++;
-   mutex.unlock();
+   part.mutex.unlock();
 
    switch (frame->state) {
       case BufferFrame::Empty:
          frame->data=const_cast<void*>(partition.readPage(pageNo,frame->pageInfo));
+         if (!frame->data) {
+            // The page could not be read, release the still empty frame
+            part.mutex.lock();
+            frame->intentionLock--;
+            part.mutex.unlock();
+            unfixPage(frame);
+            return 0;
+         }
          frame->state=BufferFrame::Read;
          // Change X latch to S latch
          frame->latch.unlock();
          frame->latch.lockShared();
          // And release the intention lock
-         mutex.lock();
+         part.mutex.lock();
          frame->intentionLock--;
-         mutex.unlock();
+         part.mutex.unlock();
          break;
       case BufferFrame::Read: break;
       case BufferFrame::Write: break;
@@ -210,11 +499,21 @@ const BufferFrame* BufferManager::readPageShared(Partition& partition,unsigned p
 const BufferFrame* BufferManager::readPageExclusive(Partition& partition,unsigned pageNo)
    // Read a page. Page is exclusive and not modifed
 {
-   mutex.lock();
-   BufferFrame* frame=findBufferFrame(&partition,pageNo,true);
-   mutex.unlock();
+   uint64_t hash=PageID(&partition,pageNo).hash();
+   DirectoryPartition& part=getDirectory(hash);
+   part.mutex.lock();
+   BufferFrame* frame=findBufferFrame(part,&partition,pageNo,hash,true);
+   part.mutex.unlock();
    switch (frame->state) {
-      case BufferFrame::Empty: frame->data=const_cast<void*>(partition.readPage(pageNo,frame->pageInfo)); frame->state=BufferFrame::Read; break;
+      case BufferFrame::Empty:
+         frame->data=const_cast<void*>(partition.readPage(pageNo,frame->pageInfo));
+         if (!frame->data) {
+            // The page could not be read, release the still empty frame
+            unfixPage(frame);
+            return 0;
+         }
+         frame->state=BufferFrame::Read;
+         break;
       case BufferFrame::Read: break;
       case BufferFrame::Write: break;
       case BufferFrame::WriteDirty: break;
@@ -230,35 +529,31 @@ void BufferManager::unfixPage(const BufferFrame* cframe)
    Partition* oldPartition=frame->partition;
    unsigned oldPageNo=frame->pageNo;
    if (frame->latch.unlock()) {
-      // Dirty pages are released by the background writer
-      if (frame->state==BufferFrame::WriteDirty)
+      // Dirty pages are released by the background writer, read pages stay in the buffer
+      if ((frame->state==BufferFrame::WriteDirty)||(frame->state==BufferFrame::Read))
          return;
 
-      mutex.lock();
-      // Is this really the last reference?
-      if (frame->latch.tryLockExclusive()) {
-         // Still the same?
-         if ((frame->partition==oldPartition)&&(frame->pageNo==oldPageNo)) {
-            // Then release it
-            switch (frame->state) {
-               case BufferFrame::Empty: break;
-               case BufferFrame::Read: frame->partition->finishReadPage(frame->pageInfo); frame->state=BufferFrame::Empty; break;
-               case BufferFrame::Write: frame->partition->finishWrittenPage(frame->pageInfo); frame->state=BufferFrame::Empty; break;
-               case BufferFrame::WriteDirty: break;
-            }
-            // And release the buffer frame itself
-            if ((frame->state==BufferFrame::Empty)&&(!frame->intentionLock)) {
-               directory.erase(PageID(frame->partition,frame->pageNo));
-               frame->next=releasedFrames;
-               releasedFrames=frame;
-               frame->partition=0;
-               frame->pageNo=0;
-            }
-         }
-         frame->latch.unlock();
-      }
-      mutex.unlock();
+      releaseFrame(frame,oldPartition,oldPageNo);
+   }
+}
+//---------------------------------------------------------------------------
+void BufferManager::markHot(const BufferFrame* cframe)
+   // Hint that a fixed page is accessed frequently
+{
+   BufferFrame* frame=const_cast<BufferFrame*>(cframe);
+   if (frame->hot)
+      return;
+
+   DirectoryPartition& part=getDirectory(PageID(frame->partition,frame->pageNo).hash());
+   part.mutex.lock();
+   // No need to prove reuse first
+   if (frame->queue==BufferFrame::Recent) {
+      part.recent.remove(frame);
+      part.frequent.pushFront(frame);
+      frame->queue=BufferFrame::Frequent;
    }
+   frame->hot=true;
+   part.mutex.unlock();
 }
 //---------------------------------------------------------------------------
 void BufferManager::unfixDirtyPageWithoutRecovery(BufferFrame* frame)
@@ -308,21 +603,26 @@ bool BufferManager::doFlush()
    uint64_t     forceLSN=0;
    unsigned     totalCount=0,partitionCount=0;
    dirtCounter=0;
-   for (std::map<PageID,BufferFrame*>::iterator iter=directory.begin(),limit=directory.end();iter!=limit;++iter) {
-      if ((*iter).second->state==BufferFrame::WriteDirty) {
-         BufferFrame& frame=*((*iter).second);
-         if (totalCount<collectCount) {
-            if (frame.latch.tryLockShared()) {
-               list[totalCount++]=&frame;
-               if (frame.lsn>forceLSN) forceLSN=frame.lsn;
-               if ((!partitionCount)||(frame.partition!=partitionList[partitionCount-1]))
-                  partitionList[partitionCount++]=frame.partition;
-            } else {
-               fixedDirty=true;
-               dirtCounter++;
-            }
-         } else dirtCounter++;
+   for (unsigned index=0;index<directoryPartitions;index++) {
+      DirectoryPartition& part=directory[index];
+      part.mutex.lock();
+      for (std::vector<DirectoryEntry>::const_iterator iter=part.entries.begin(),limit=part.entries.end();iter!=limit;++iter) {
+         if ((*iter).frame&&((*iter).frame->state==BufferFrame::WriteDirty)) {
+            BufferFrame& frame=*((*iter).frame);
+            if (totalCount<collectCount) {
+               if (frame.latch.tryLockShared()) {
+                  list[totalCount++]=&frame;
+                  if (frame.lsn>forceLSN) forceLSN=frame.lsn;
+                  if ((!partitionCount)||(frame.partition!=partitionList[partitionCount-1]))
+                     partitionList[partitionCount++]=frame.partition;
+               } else {
+                  fixedDirty=true;
+                  dirtCounter++;
+               }
+            } else dirtCounter++;
+         }
       }
+      part.mutex.unlock();
    }
    // No dirty pages found? Then stop immediately
    if (!totalCount) {
@@ -344,29 +644,9 @@ bool BufferManager::doFlush()
       frame->state=BufferFrame::Write;
       Partition* oldPartition=frame->partition;
       unsigned oldPageNo=frame->pageNo;
-      if (frame->latch.unlock()) {
-         // Last reference?
-         if (frame->latch.tryLockExclusive()) {
-            if ((frame->partition==oldPartition)&&(frame->pageNo==oldPageNo)) {
-               // Then release it
-               switch (frame->state) {
-                  case BufferFrame::Empty: break;
-                  case BufferFrame::Read: frame->partition->finishReadPage(frame->pageInfo); frame->state=BufferFrame::Empty; break;
-                  case BufferFrame::Write: frame->partition->finishWrittenPage(frame->pageInfo); frame->state=BufferFrame::Empty; break;
-                  case BufferFrame::WriteDirty: break;
-               }
-               // Release the buffer frame if there is no contention
-               if ((frame->state==BufferFrame::Empty)&&(!frame->intentionLock)) {
-                  directory.erase(PageID(frame->partition,frame->pageNo));
-                  frame->next=releasedFrames;
-                  releasedFrames=frame;
-                  frame->partition=0;
-                  frame->pageNo=0;
-               }
-            }
-            frame->latch.unlock();
-         }
-      }
+      // Last reference?
+      if (frame->latch.unlock())
+         releaseFrame(frame,oldPartition,oldPageNo);
    }
 
    // Set a checkpoint if nevessary
@@ -404,3 +684,105 @@ void BufferManager::startFlusher(void* ptr)
    buf->mutex.unlock();
 }
 //---------------------------------------------------------------------------
+void BufferManager::getStatistics(Statistics& statistics)
+   // Get the buffer statistics
+{
+   statistics.hits=statistics.misses=statistics.evictions=0;
+   statistics.resident=0;
+   for (unsigned index=0;index<directoryPartitions;index++) {
+      DirectoryPartition& part=directory[index];
+      part.mutex.lock();
+      statistics.hits+=part.hits;
+      statistics.misses+=part.misses;
+      statistics.evictions+=part.evictions;
+      statistics.resident+=part.recent.size+part.frequent.size;
+      part.mutex.unlock();
+   }
+}
+//---------------------------------------------------------------------------
+void BufferManager::prefetchPage(Partition& partition,unsigned pageNo)
+   // Read a page into the buffer unless it is there already
+{
+   PageID pageID(&partition,pageNo);
+   uint64_t hash=pageID.hash();
+   DirectoryPartition& part=getDirectory(hash);
+   part.mutex.lock();
+   bool present=part.lookup(pageID,hash);
+   part.mutex.unlock();
+   if (present)
+      return;
+
+   // Touch the data, mapped pages are only read when accessed
+   const BufferFrame* frame=readPageShared(partition,pageNo);
+   if (!frame)
+      return;
+   const volatile char* data=static_cast<const char*>(frame->pageData());
+   for (unsigned ofs=0;ofs<BufferReference::pageSize;ofs+=osPageSize)
+      static_cast<void>(data[ofs]);
+   unfixPage(frame);
+}
+//---------------------------------------------------------------------------
+void BufferManager::startPrefetcher(void* ptr)
+   // Start a readahead thread
+{
+   BufferManager* buf=static_cast<BufferManager*>(ptr);
+
+   buf->prefetchMutex.lock();
+   while (!buf->prefetchDie) {
+      if (buf->prefetchQueue.empty()) {
+         buf->prefetchNotify.wait(buf->prefetchMutex);
+         continue;
+      }
+      PrefetchRequest request=buf->prefetchQueue.front();
+      buf->prefetchQueue.pop_front();
+      buf->prefetchMutex.unlock();
+      buf->prefetchPage(*request.partition,request.pageNo);
+      buf->prefetchMutex.lock();
+   }
+   buf->prefetchAlive--;
+   buf->prefetchDeadNotify.notify(buf->prefetchMutex);
+   buf->prefetchMutex.unlock();
+}
+//---------------------------------------------------------------------------
+unsigned BufferManager::prefetchPages(Partition& partition,unsigned start,unsigned count,const void* owner)
+   // Read pages in the background
+{
+   // Stay within the partition and leave most of the buffer to the readers
+   unsigned size=partition.getSize();
+   if (start>=size)
+      return 0;
+   if (count>size-start)
+      count=size-start;
+   if (count>bufferSize/4)
+      count=bufferSize/4;
+
+   prefetchMutex.lock();
+   unsigned waiting=0;
+   for (std::deque<PrefetchRequest>::const_iterator iter=prefetchQueue.begin(),limit=prefetchQueue.end();iter!=limit;++iter)
+      if ((*iter).owner==owner)
+         waiting++;
+   for (unsigned index=0;(index<count)&&(prefetchQueue.size()<maxPrefetchQueue);index++) {
+      PrefetchRequest request;
+      request.partition=&partition;
+      request.pageNo=start+index;
+      request.owner=owner;
+      prefetchQueue.push_back(request);
+   }
+   prefetchNotify.notifyAll(prefetchMutex);
+   prefetchMutex.unlock();
+
+   return waiting;
+}
+//---------------------------------------------------------------------------
+void BufferManager::cancelPrefetch(const void* owner)
+   // Drop the waiting readahead requests of an owner
+{
+   prefetchMutex.lock();
+   std::deque<PrefetchRequest>::iterator writer=prefetchQueue.begin();
+   for (std::deque<PrefetchRequest>::const_iterator iter=prefetchQueue.begin(),limit=prefetchQueue.end();iter!=limit;++iter)
+      if ((*iter).owner!=owner)
+         *(writer++)=*iter;
+   prefetchQueue.erase(writer,prefetchQueue.end());
+   prefetchMutex.unlock();
+}
+//---------------------------------------------------------------------------
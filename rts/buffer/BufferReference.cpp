@@ -56,6 +56,12 @@ void BufferReference::reset()
    }
 }
 //---------------------------------------------------------------------------
+void BufferReference::markHot() const
+   // Hint that the page is accessed frequently
+{
+   frame->getBufferManager()->markHot(frame);
+}
+//---------------------------------------------------------------------------
 const void* BufferReference::getPage() const
    // Access the page
 {
@@ -151,7 +157,8 @@ BufferReferenceModified& BufferReferenceModified::operator=(const BufferRequestM
    // The page _must_ be unfixed before assigned a new page!
    assert(!frame);
 
-   frame=request.bufferManager.readPageExclusive(request.partition,request.page)->update();
+   const BufferFrame* page=request.bufferManager.readPageExclusive(request.partition,request.page);
+   frame=page?page->update():0;
    return *this;
 }
 //---------------------------------------------------------------------------
@@ -1,15 +1,21 @@
 #include "rts/database/Database.hpp"
 #include "rts/buffer/BufferManager.hpp"
 #include "rts/database/DatabasePartition.hpp"
+#include "rts/partition/DirectPartition.hpp"
 #include "rts/partition/FilePartition.hpp"
 #include "rts/segment/AggregatedFactsSegment.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/ExactStatisticsSegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
+#include "rts/segment/FerrariSegment.hpp"
 #include "rts/segment/FullyAggregatedFactsSegment.hpp"
+#include "rts/segment/LeafCache.hpp"
+#include "rts/segment/DictionaryCache.hpp"
 #include "rts/segment/PathSelectivitySegment.hpp"
 #include <iostream>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -20,11 +26,26 @@
 // or send a letter to Creative Commons, 171 Second Street, Suite 300,
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
-/// Active buffer size. This is only a hint!
-static const unsigned bufferSize = 16*1024*1024;
+/// Default buffer size
+static const unsigned defaultBufferSize = 16*1024*1024;
+/// Default size of the decompressed facts cache. Off, Database::setLeafCacheSize enables it
+static const unsigned defaultLeafCacheSize = 0;
+/// Default size of the dictionary string cache
+static const unsigned defaultDictionaryCacheSize = 16*1024*1024;
+/// Default memory limit of a sort, the SORTMEMORY environment variable overrides it
+static const uint64_t defaultSortMemoryLimit = sizeof(void*)*(1<<24);
+//---------------------------------------------------------------------------
+static uint64_t requestedSortMemoryLimit()
+   // The sort memory limit requested by the environment
+{
+   const char* limit=getenv("SORTMEMORY");
+   if (limit&&(atoll(limit)>0))
+      return atoll(limit);
+   return defaultSortMemoryLimit;
+}
 //---------------------------------------------------------------------------
 Database::Database()
-   : file(0),bufferManager(0),partition(0)
+   : file(0),bufferManager(0),partition(0),leafCache(0),dictionaryCache(0),bufferSize(defaultBufferSize),leafCacheSize(defaultLeafCacheSize),dictionaryCacheSize(defaultDictionaryCacheSize),sortMemoryLimit(requestedSortMemoryLimit())
    // Constructor
 {
 }
@@ -54,8 +75,9 @@ bool Database::create(const char* fileName)
    close();
 
    // Try to create the partition
-   file=new FilePartition();
-   if (!file->create(fileName))
+   FilePartition* filePartition=new FilePartition();
+   file=filePartition;
+   if (!filePartition->create(fileName))
       return false;
    unsigned start,len;
    if (!file->grow(4,start,len))
@@ -96,20 +118,49 @@ bool Database::create(const char* fileName)
 static unsigned readUint32(const unsigned char* data) { return (data[0]<<24)|(data[1]<<16)|(data[2]<<8)|data[3]; }
 static uint64_t readUint64(const unsigned char* data) { return (static_cast<uint64_t>(readUint32(data))<<32)|static_cast<uint64_t>(readUint32(data+4)); }
 //---------------------------------------------------------------------------
-bool Database::open(const char* fileName,bool readOnly)
+static Database::IOMode requestedIOMode()
+   // The I/O mode requested by the environment
+{
+   const char* mode=getenv("IOMODE");
+   if ((!mode)||(strcmp(mode,"mapped")==0))
+      return Database::IO_Mapped;
+   if (strcmp(mode,"read")==0)
+      return Database::IO_Read;
+   if (strcmp(mode,"direct")==0)
+      return Database::IO_Direct;
+   std::cerr << "unknown IOMODE " << mode << ", using mapped" << std::endl;
+   return Database::IO_Mapped;
+}
+//---------------------------------------------------------------------------
+bool Database::open(const char* fileName,bool readOnly,IOMode ioMode)
    // Open a database
 {
    close();
 
+   if (ioMode==IO_Default)
+      ioMode=requestedIOMode();
+
    // Try to open the file
-   file=new FilePartition();
-   if (!file->open(fileName,readOnly))
-      return false;
+   if (ioMode==IO_Mapped) {
+      FilePartition* filePartition=new FilePartition();
+      file=filePartition;
+      if (!filePartition->open(fileName,readOnly))
+         return false;
+   } else {
+      DirectPartition* directPartition=new DirectPartition(ioMode==IO_Direct);
+      file=directPartition;
+      if (!directPartition->open(fileName,readOnly))
+         return false;
+   }
    bufferManager=new BufferManager(bufferSize);
 
    // Check the root page
    {
       BufferReference root(BufferRequest(*bufferManager,*file,0));
+      if (!root) {
+         std::cerr << "unable to read the root page" << std::endl;
+         return false;
+      }
       const unsigned char* page=static_cast<const unsigned char*>(root.getPage());
 
       // Check the magic
@@ -128,6 +179,14 @@ bool Database::open(const char* fileName,bool readOnly)
 
    // Open the partition
    partition=new DatabasePartition(*bufferManager,*file);
+   if (leafCacheSize) {
+      leafCache=new LeafCache(leafCacheSize);
+      partition->setLeafCache(leafCache);
+   }
+   if (dictionaryCacheSize) {
+      dictionaryCache=new DictionaryCache(dictionaryCacheSize);
+      partition->setDictionaryCache(dictionaryCache);
+   }
    partition->open();
 
    return true;
@@ -138,6 +197,10 @@ void Database::close()
 {
    delete partition;
    partition=0;
+   delete leafCache;
+   leafCache=0;
+   delete dictionaryCache;
+   dictionaryCache=0;
    delete bufferManager;
    bufferManager=0;
    delete file;
@@ -180,3 +243,16 @@ PathSelectivitySegment& Database::getPathSelectivity()
    return *(partition->lookupSegment<PathSelectivitySegment>(DatabasePartition::Tag_PathSelectivity));
 }
 //---------------------------------------------------------------------------
+FerrariSegment* Database::getFerrari()
+   // Get the reachability indexes
+{
+   return partition->lookupSegment<FerrariSegment>(DatabasePartition::Tag_Ferrari);
+}
+//---------------------------------------------------------------------------
+Index* Database::getReachabilityIndex(unsigned predicate)
+   // Get the reachability index for a predicate
+{
+   FerrariSegment* ferrari=getFerrari();
+   return ferrari?ferrari->lookupIndex(predicate):0;
+}
+//---------------------------------------------------------------------------
@@ -1,9 +1,11 @@
 #include "rts/database/DatabaseBuilder.hpp"
 #include "infra/osdep/MemoryMappedFile.hpp"
+#include "infra/osdep/Thread.hpp"
 #include "infra/util/Hash.hpp"
 #include "rts/buffer/BufferReference.hpp"
 #include "rts/database/DatabasePartition.hpp"
 #include "rts/segment/AggregatedFactsSegment.hpp"
+#include "rts/segment/DictionaryFingerprintSegment.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/ExactStatisticsSegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
@@ -130,7 +132,7 @@ void DatabaseBuilder::PageChainer::finish()
 }
 //---------------------------------------------------------------------------
 DatabaseBuilder::DatabaseBuilder(const char* fileName)
-   : dbFile(fileName)
+   : dbFile(fileName),factsLeafFormat(FactsSegment::LeafFormat_Delta)
    // Constructor
 {
    // Create the database
@@ -286,6 +288,7 @@ void DatabaseBuilder::loadFacts(unsigned order,FactsReader& reader)
    // Load the full facts first
    FactsSegment* fullFacts=new FactsSegment(out.getFirstPartition());
    out.getFirstPartition().addSegment(fullFacts,DatabasePartition::Tag_SPO+order);
+   fullFacts->setLeafFormat(factsLeafFormat);
    reader.reset();
    {
       FactsSegmentSource source(reader);
@@ -454,6 +457,16 @@ void DatabaseBuilder::loadStringHashes(StringInfoReader& reader)
    seg->loadStringHashes(source);
 }
 //---------------------------------------------------------------------------
+void DatabaseBuilder::computeStringFingerprints()
+   // Build the fingerprint index of the strings
+{
+   DictionarySegment* dictionary=out.getFirstPartition().lookupSegment<DictionarySegment>(DatabasePartition::Tag_Dictionary);
+   DictionaryFingerprintSegment* seg=new DictionaryFingerprintSegment(out.getFirstPartition());
+   out.getFirstPartition().addSegment(seg,DatabasePartition::Tag_DictionaryFingerprint);
+   seg->computeFingerprints(*dictionary);
+   dictionary->fingerprints=seg;
+}
+//---------------------------------------------------------------------------
 static void buildCountMap(Database& db,const char* fileName)
    // Build a map with aggregated counts
 {
@@ -556,11 +569,15 @@ void DatabaseBuilder::computePathSelectivity(vector<unsigned>& back_selectivity,
 	PathSelectivity().computeSelectivity(out,back_selectivity,forw_selectivity);
 }
 //---------------------------------------------------------------------------
-void DatabaseBuilder::computeFerrari()
+void DatabaseBuilder::computeFerrari(unsigned threads,uint64_t memoryBudget)
 	// compute FERRARI reachability
 {
+	if (!threads)
+		threads=Thread::guessProcessorCount();
+	if (!memoryBudget)
+		memoryBudget=Thread::guessPhysicalAvailable();
 	FerrariSegment* seg=new FerrariSegment(out.getFirstPartition());
 	out.getFirstPartition().addSegment(seg,DatabasePartition::Tag_Ferrari);
-	seg->computeFerrari(out);
+	seg->computeFerrari(out,threads,memoryBudget);
 }
 //---------------------------------------------------------------------------
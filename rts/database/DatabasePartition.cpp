@@ -1,7 +1,9 @@
 #include "rts/database/DatabasePartition.hpp"
+#include "rts/buffer/BufferManager.hpp"
 #include "rts/buffer/BufferReference.hpp"
 #include "rts/partition/Partition.hpp"
 #include "rts/segment/AggregatedFactsSegment.hpp"
+#include "rts/segment/DictionaryFingerprintSegment.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/ExactStatisticsSegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
@@ -25,7 +27,7 @@
 using namespace std;
 //---------------------------------------------------------------------------
 DatabasePartition::DatabasePartition(BufferManager& bufferManager,Partition& partition)
-   : bufferManager(bufferManager),partition(partition)
+   : bufferManager(bufferManager),partition(partition),leafCache(0),dictionaryCache(0)
    // Constructor
 {
 }
@@ -91,6 +93,7 @@ void DatabasePartition::open()
          case Segment::Type_PredicateSet: seg=new PredicateSetSegment(*this); break;
          case Segment::Type_PathSelectivity: seg=new PathSelectivitySegment(*this); break;
          case Segment::Type_Ferrari: seg=new FerrariSegment(*this); break;
+         case Segment::Type_DictionaryFingerprint: seg=new DictionaryFingerprintSegment(*this); break;
       }
       assert(seg);
       seg->id=id++;
@@ -120,6 +123,18 @@ BufferRequestModified DatabasePartition::modifyExclusive(unsigned page)
    return BufferRequestModified(bufferManager,partition,page);
 }
 //---------------------------------------------------------------------------
+unsigned DatabasePartition::prefetch(unsigned start,unsigned count,const void* owner) const
+   // Read pages in the background
+{
+   return bufferManager.prefetchPages(partition,start,count,owner);
+}
+//---------------------------------------------------------------------------
+void DatabasePartition::cancelPrefetch(const void* owner) const
+   // Drop the waiting background reads of an owner
+{
+   bufferManager.cancelPrefetch(owner);
+}
+//---------------------------------------------------------------------------
 SpaceInventorySegment* DatabasePartition::getSpaceInventory()
    // Get the space inventory
 {
@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/dijkstra/FastDijkstraEngine.hpp"
 #include "rts/segment/DictionarySegment.hpp"
@@ -26,6 +27,15 @@
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Compare edges by their source only
+struct CompareFirst {
+	bool operator()(const pair<unsigned,unsigned>& a,const pair<unsigned,unsigned>& b) const { return a.first<b.first; }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
 static void clusterPredicates(set<unsigned>& toURI, set<unsigned>& toLiterals, Database& db){
 	FactsSegment::Scan scan;
 	unsigned predicate=0;
@@ -34,8 +44,9 @@ static void clusterPredicates(set<unsigned>& toURI, set<unsigned>& toLiterals, D
 		if (!decided){
 			assert(predicate==scan.getValue1());
 			unsigned o=scan.getValue3();
+			BufferReference page;
 			const char* start=0,*stop=0; Type::ID type; unsigned subType;
-			db.getDictionary().lookupById(o,start,stop,type,subType);
+			db.getDictionary().lookupById(o,page,start,stop,type,subType);
 			if (type==Type::Literal)
 				toLiterals.insert(scan.getValue1());
 			else
@@ -50,52 +61,6 @@ static void clusterPredicates(set<unsigned>& toURI, set<unsigned>& toLiterals, D
 	} while (scan.next());
 }
 //---------------------------------------------------------------------------
-namespace {
-//---------------------------------------------------------------------------
-class ConstantOperator: public Operator{
-	private:
-	/// The  register
-	Register* reg;
-	/// The filter
-	const set<unsigned>& neighbors;
-	set<unsigned>::const_iterator cur;
-
-	public:
-	/// Constructor
-	ConstantOperator(Register* reg,const set<unsigned>& neighbors) : Operator(0),reg(reg),neighbors(neighbors),cur(neighbors.begin()){}
-	/// Destructor
-	~ConstantOperator() { }
-	/// Find the first tuple
-	unsigned first();
-	/// Find the next tuple
-	unsigned next();
-	/// Print the operator
-	void print(PlanPrinter& out);
-	/// Handle a merge hint
-	void addMergeHint(Register* /*l*/,Register* /*r*/) {};
-	/// Register parts of the tree that can be executed asynchronous
-	void getAsyncInputCandidates(Scheduler& /*scheduler*/) {};
-};
-//---------------------------------------------------------------------------
-void ConstantOperator::print(PlanPrinter& out){
-	out.beginOperator("ConstantOperator",expectedOutputCardinality,observedOutputCardinality);
-}
-//---------------------------------------------------------------------------
-unsigned ConstantOperator::first(){
-	return next();
-}
-//---------------------------------------------------------------------------
-unsigned ConstantOperator::next(){
-	if (cur!=neighbors.end()){
-		reg->value=*cur;
-		cur++;
-		return 1;
-	}
-	return 0;
-}
-//---------------------------------------------------------------------------
-}
-//---------------------------------------------------------------------------
 void FastDijkstraEngine::precomputeSelectivity(){
 	/// assume the order was OPS
 	set<unsigned> literal;
@@ -127,181 +92,106 @@ void FastDijkstraEngine::precomputeSelectivity(){
 	} while (scan.next());
 }
 //---------------------------------------------------------------------------
+static pair<vector<pair<unsigned,unsigned> >::const_iterator,vector<pair<unsigned,unsigned> >::const_iterator> edgesOf(const vector<pair<unsigned,unsigned> >& edges,unsigned node){
+	// the edges of a node in a sorted edge list
+	return equal_range(edges.begin(),edges.end(),pair<unsigned,unsigned>(node,0),CompareFirst());
+}
+//---------------------------------------------------------------------------
 void FastDijkstraEngine::countSelectivity(unsigned root){
 	/// assume order was OPS
 	stack<unsigned> s, internal;
 	s.push(root);
 	unsigned nodes=0;
-	map<unsigned, bool> visited;
+	traversal.clearMarks();
 
 	while (!s.empty()){
 		unsigned node = s.top();
 		s.pop();
-		visited[node]=true;
-		set<unsigned>& kids=tree[node];
-		for (set<unsigned>::iterator it=kids.begin(); it!=kids.end(); it++){
+		traversal.mark(node);
+		pair<vector<pair<unsigned,unsigned> >::const_iterator,vector<pair<unsigned,unsigned> >::const_iterator> kids=edgesOf(tree,node);
+		for (vector<pair<unsigned,unsigned> >::const_iterator it=kids.first; it!=kids.second; it++){
 			nodes++;
-			if (!visited[*it])
-				s.push(*it);
+			if (!traversal.isMarked(it->second))
+				s.push(it->second);
 		}
 
-		set<unsigned>& parURI = parentsURI[node];
-		for (set<unsigned>::iterator it=parURI.begin(); it!=parURI.end(); it++){
-				backward_selectivity[node]+=backward_selectivity[*it];
+		pair<vector<pair<unsigned,unsigned> >::const_iterator,vector<pair<unsigned,unsigned> >::const_iterator> parURI=edgesOf(parentsURI,node);
+		for (vector<pair<unsigned,unsigned> >::const_iterator it=parURI.first; it!=parURI.second; it++){
+				backward_selectivity[node]+=backward_selectivity[it->second];
 		}
 
 		backward_selectivity[node]+=1;
 
 		internal.push(node);
 	}
-	visited.clear();
+	traversal.clearMarks();
 
 	while (!internal.empty()){
 		unsigned node=internal.top();
 		internal.pop();
 
-		if (visited[node])
+		if (!traversal.mark(node))
 			continue;
 
-		visited[node]=true;
-
-		set<unsigned>& kids=tree[node];
+		pair<vector<pair<unsigned,unsigned> >::const_iterator,vector<pair<unsigned,unsigned> >::const_iterator> kids=edgesOf(tree,node);
 
-		for (set<unsigned>::iterator it=kids.begin(); it!=kids.end(); it++){
-			selectivity[node]+=selectivity[*it];
+		for (vector<pair<unsigned,unsigned> >::const_iterator it=kids.first; it!=kids.second; it++){
+			selectivity[node]+=selectivity[it->second];
 		}
 
-		selectivity[node]+=kids.size()+1;
+		selectivity[node]+=(kids.second-kids.first)+1;
 	}
 }
 //---------------------------------------------------------------------------
 void FastDijkstraEngine::getNeighbors(){
-	Register reg;
-	Register rs,rp,ro;
-	Register *s=0, *o=0;
-	rs.reset(); rp.reset(); ro.reset();
-	IndexScan* scan1=IndexScan::create(db,order,&rs,false,&rp,false,&ro,false,0);
-
-	ConstantOperator* scan2=new ConstantOperator(&reg,curNodes);
-	vector<Register*> lt,rt;
-
-	// forward or backward search?
-	if (order==Database::Order_Subject_Predicate_Object){
-		s=&rs;
-		o=&ro;
-	}
-	else {
-		s=&ro;
-		o=&rs;
-	}
-
-	rt.push_back(&rp);rt.push_back(o);
-	MergeJoin join(scan2,&reg,lt,scan1,s,rt,0);
-	n.connections.clear();
-	n.connections.resize(curNodes.size());
-	unsigned old=s->value;
-	unsigned i=0;
-	bool firstiter=true;
-
-	for (set<unsigned>::iterator it = curNodes.begin(); it != curNodes.end(); it++)
-		n.ids.push_back(*it);
-//	cerr<<"n.connections size: "<<n.connections.size()<<endl;
-	if (join.first()) do {
-		if (old==s->value||firstiter){
-		   old=s->value;
-		   while (n.ids[i]!=s->value) i++;
-		   n.connections[i].push_back(pair<unsigned,unsigned>(rp.value,o->value));
-		   firstiter=false;
-		}
-		else {
-		   old=s->value;
-		   i++;
-		   while (n.ids[i]!=s->value) i++;
-		   n.connections[i].push_back(pair<unsigned,unsigned>(rp.value,o->value));
-		}
-    } while (join.next());
-
+	PathTraversal::findNeighbors(db,order,curNodes,n);
 }
 //---------------------------------------------------------------------------
 void FastDijkstraEngine::init(unsigned source) {
 	// init the computation
 	tree.clear();
 	parentsURI.clear();
-	workingSet.clear();
-	settledNodes.clear();
-	shortestDistances.clear();
+	traversal.reset();
+	traversal.start(source);
 	curNodes.clear();
-	workingSet.insert(pair<unsigned, unsigned>(0,source));
-	shortestDistances[source]=0;
-	curNodes.insert(source);
-	curnodes_iter=curNodes.begin();
-	curIndex=0;
-	n.connections.clear();
-	n.ids.clear();
 }
 //---------------------------------------------------------------------------
 void FastDijkstraEngine::updateNeighbors(unsigned node,unsigned nodeindex){
-	vector<pair<unsigned,unsigned> >& succ=n.connections[nodeindex];
-	for (vector<pair<unsigned,unsigned> >::iterator iter=succ.begin(),limit=succ.end(); iter!=limit; iter++){
+	for (vector<pair<unsigned,unsigned> >::const_iterator iter=n.begin(nodeindex),limit=n.end(nodeindex); iter!=limit; iter++){
 		// if we need to estimate selectivity, save URI predecessors
 		if (needSelectivity) {
-			tree[node].insert(iter->second);
+			tree.push_back(pair<unsigned,unsigned>(node,iter->second));
 			if (URI.count(iter->first))
-				parentsURI[iter->second].insert(node);
+				parentsURI.push_back(pair<unsigned,unsigned>(iter->second,node));
 		}
 		if (DijkstraEngine::isHandled(iter->second))
 			continue;
-		unsigned shortDist=DijkstraEngine::getShortestDist(node)+1;
-		unsigned oldShortDist=DijkstraEngine::getShortestDist(iter->second);
-		if (shortDist<oldShortDist) {
-			workingSet.erase(pair<unsigned,unsigned>(oldShortDist,iter->second));
-			shortestDistances[iter->second]=shortDist;
-			workingSet.insert(pair<unsigned,unsigned>(shortDist,iter->second));
-		}
+		traversal.relax(iter->second,DijkstraEngine::getShortestDist(node)+1,node,iter->first);
 	}
 }
 //---------------------------------------------------------------------------
 void FastDijkstraEngine::computeSP(unsigned source){
 	init(source);
-	if (curnodes_iter==curNodes.begin()){
-		getNeighbors();
-	}
-
-	while (!workingSet.empty()) {
-		if (curnodes_iter==curNodes.end() && !workingSet.empty()){
-			curNodes.clear();
-			// copying the neighbors.
-			// can we just use workingSet???
-			for (unsigned i=0; i<n.connections.size(); i++){
-				for (unsigned j=0; j<n.connections[i].size(); j++){
-					if (!DijkstraEngine::isHandled((n.connections[i])[j].second))
-						curNodes.insert((n.connections[i])[j].second);
-				}
-			}
-			n.connections.clear();
-			n.ids.clear();
-			curIndex=0;
 
+	// unit weights, so the working set is processed level by level
+	vector<PathTraversal::Discovery> found;
+	while (traversal.nextBucket(curNodes)) {
+		if (needSelectivity) {
+			// the selectivity tree needs every edge, not just one parent per node
 			getNeighbors();
-			curnodes_iter=curNodes.begin();
+			for (unsigned i=0; i<curNodes.size(); i++)
+				updateNeighbors(curNodes[i],i);
+		} else {
+			traversal.discover(db,order,curNodes,found);
+			for (vector<PathTraversal::Discovery>::const_iterator iter=found.begin(),limit=found.end(); iter!=limit; iter++)
+				traversal.relax(iter->node,DijkstraEngine::getShortestDist(iter->parent)+1,iter->parent,iter->edge);
 		}
+	}
 
-		while (curnodes_iter!=curNodes.end()){
-			unsigned curNode=*curnodes_iter;
-			unsigned curDist=DijkstraEngine::getShortestDist(curNode); // we need to store it in curNodes!!!
-
-			workingSet.erase(pair<unsigned,unsigned>(curDist,curNode));
-			curnodes_iter++;
-
-			if (DijkstraEngine::isHandled(curNode)){
-				curIndex++;
-				continue;
-			}
-
-			updateNeighbors(curNode,curIndex);
-			curIndex++;
-
-			settledNodes.insert(curNode);
-		}
+	if (needSelectivity) {
+		sort(tree.begin(),tree.end());
+		tree.erase(unique(tree.begin(),tree.end()),tree.end());
+		sort(parentsURI.begin(),parentsURI.end());
+		parentsURI.erase(unique(parentsURI.begin(),parentsURI.end()),parentsURI.end());
 	}
 }
@@ -0,0 +1,492 @@
+#include "rts/dijkstra/PathTraversal.hpp"
+#include "rts/operator/IndexScan.hpp"
+#include "rts/operator/MergeJoin.hpp"
+#include "rts/operator/PlanPrinter.hpp"
+#include "rts/runtime/Runtime.hpp"
+#include "rts/segment/DictionarySegment.hpp"
+#include "rts/segment/FactsSegment.hpp"
+#include "infra/osdep/Event.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include "infra/osdep/Thread.hpp"
+#include <algorithm>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Produces a sorted list of nodes
+class ConstantOperator : public Operator
+{
+   private:
+   /// The register
+   Register* reg;
+   /// The nodes
+   const vector<unsigned>& values;
+   /// The next node
+   vector<unsigned>::const_iterator cur;
+
+   public:
+   /// Constructor
+   ConstantOperator(Register* reg,const vector<unsigned>& values) : Operator(0),reg(reg),values(values),cur(values.begin()) {}
+
+   /// Find the first tuple
+   unsigned first() { cur=values.begin(); return next(); }
+   /// Find the next tuple
+   unsigned next() { if (cur==values.end()) return 0; reg->value=*cur; ++cur; return 1; }
+   /// Print the operator
+   void print(PlanPrinter& out) { out.beginOperator("ConstantOperator",expectedOutputCardinality,observedOutputCardinality); out.endOperator(); }
+   /// Handle a merge hint
+   void addMergeHint(Register* /*l*/,Register* /*r*/) {}
+   /// Register parts of the tree that can be executed asynchronous
+   void getAsyncInputCandidates(Scheduler& /*scheduler*/) {}
+};
+//---------------------------------------------------------------------------
+/// Minimum frontier size per thread for top-down expansion
+static const unsigned minTopDownChunk = 1024;
+/// Minimum number of triples per thread for bottom-up expansion
+static const unsigned minBottomUpChunk = 1<<16;
+/// Go bottom-up once the frontier exceeds 1/alpha of the unreached nodes
+static const unsigned alpha = 14;
+/// Go top-down again once the frontier drops below 1/beta of all nodes
+static const unsigned beta = 24;
+//---------------------------------------------------------------------------
+/// A part of a level expansion
+struct ExpandTask {
+   /// The traversal
+   const PathTraversal* traversal;
+   /// The database
+   Database* db;
+   /// The order of the search, or the reverse order for bottom-up
+   Database::DataOrder order;
+   /// The whole frontier
+   const vector<unsigned>* frontier;
+   /// The frontier as bitmap
+   const boost::dynamic_bitset<>* frontierBits;
+   /// The range of frontier entries (top-down) or node ids (bottom-up)
+   unsigned from,to;
+   /// The result
+   vector<PathTraversal::Discovery> found;
+};
+//---------------------------------------------------------------------------
+static bool reverseOrder(Database::DataOrder order,Database::DataOrder& reverse)
+   // The order that enumerates the incoming edges of a node
+{
+   switch (order) {
+      case Database::Order_Subject_Predicate_Object: reverse=Database::Order_Object_Predicate_Subject; return true;
+      case Database::Order_Object_Predicate_Subject: reverse=Database::Order_Subject_Predicate_Object; return true;
+      default: return false;
+   }
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+/// Worker threads expanding the parts of a level. The threads are started
+/// on first use and live as long as the traversal
+class PathTraversal::WorkerPool
+{
+   private:
+   /// A synchronization lock
+   Mutex mutex;
+   /// Notification
+   Event signal;
+   /// The work of the current level
+   void (*run)(void*);
+   /// The tasks of the current level, if any
+   vector<ExpandTask>* tasks;
+   /// The next task to take
+   unsigned nextTask;
+   /// The number of tasks not finished yet
+   unsigned unfinished;
+   /// The number of worker threads
+   unsigned workerThreads;
+   /// Should the workers die?
+   bool workersDie;
+
+   /// Take and run tasks until none is left. Called with the mutex held
+   void runTasks();
+   /// Perform the work of a worker thread
+   void performWork();
+   /// Entry point for worker threads
+   static void asyncWorker(void* pool);
+
+   public:
+   /// Constructor
+   WorkerPool() : run(0),tasks(0),nextTask(0),unfinished(0),workerThreads(0),workersDie(false) {}
+   /// Destructor
+   ~WorkerPool();
+
+   /// Run all tasks on up to the given number of threads, including the calling one
+   void execute(void (*run)(void*),vector<ExpandTask>& tasks,unsigned threads);
+};
+//---------------------------------------------------------------------------
+PathTraversal::WorkerPool::~WorkerPool()
+   // Destructor
+{
+   mutex.lock();
+   workersDie=true;
+   signal.notifyAll(mutex);
+   while (workerThreads)
+      signal.wait(mutex);
+   mutex.unlock();
+}
+//---------------------------------------------------------------------------
+void PathTraversal::WorkerPool::runTasks()
+   // Take and run tasks until none is left
+{
+   while (tasks&&(nextTask<tasks->size())) {
+      ExpandTask* task=&(*tasks)[nextTask++];
+      void (*work)(void*)=run;
+      mutex.unlock();
+      work(task);
+      mutex.lock();
+      if (!(--unfinished))
+         signal.notifyAll(mutex);
+   }
+}
+//---------------------------------------------------------------------------
+void PathTraversal::WorkerPool::performWork()
+   // Perform the work of a worker thread
+{
+   mutex.lock();
+   while (!workersDie) {
+      if ((!tasks)||(nextTask>=tasks->size())) {
+         signal.wait(mutex);
+         continue;
+      }
+      runTasks();
+   }
+
+   // Deregister
+   workerThreads--;
+   signal.notifyAll(mutex);
+   mutex.unlock();
+}
+//---------------------------------------------------------------------------
+void PathTraversal::WorkerPool::asyncWorker(void* pool)
+   // Thread entry point
+{
+   static_cast<WorkerPool*>(pool)->performWork();
+}
+//---------------------------------------------------------------------------
+void PathTraversal::WorkerPool::execute(void (*run)(void*),vector<ExpandTask>& tasks,unsigned threads)
+   // Run all tasks
+{
+   mutex.lock();
+
+   // Start missing workers, the calling thread is one of them
+   unsigned wanted=min<unsigned>(threads,tasks.size())-1;
+   while (workerThreads<wanted) {
+      if (!Thread::start(asyncWorker,this))
+         break;
+      workerThreads++;
+   }
+
+   // Publish the tasks and help running them
+   this->run=run;
+   this->tasks=&tasks;
+   nextTask=0;
+   unfinished=tasks.size();
+   signal.notifyAll(mutex);
+   runTasks();
+   while (unfinished)
+      signal.wait(mutex);
+   this->tasks=0;
+
+   mutex.unlock();
+}
+//---------------------------------------------------------------------------
+PathTraversal::PathTraversal()
+   : epoch(1),markEpoch(1),currentBucket(0),queued(0),direction(Automatic),bottomUp(false),threads(Thread::guessProcessorCount()),pool(0)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+PathTraversal::~PathTraversal()
+   // Destructor
+{
+   delete pool;
+}
+//---------------------------------------------------------------------------
+void PathTraversal::grow(unsigned node)
+   // Make room for a node
+{
+   NodeState empty;
+   empty.reached=0; empty.settled=0; empty.marked=0;
+   empty.distance=~0u;
+   empty.parent.node=~0u; empty.parent.edge=~0u;
+   nodes.resize(max<size_t>(node+1,2*nodes.size()),empty);
+}
+//---------------------------------------------------------------------------
+void PathTraversal::reset()
+   // Start a new search
+{
+   // Stamps are only cleared when the epoch wraps around
+   if ((++epoch)==~0u) {
+      for (vector<NodeState>::iterator iter=nodes.begin(),limit=nodes.end();iter!=limit;++iter)
+         (*iter).reached=(*iter).settled=0;
+      epoch=1;
+   }
+   for (vector<vector<unsigned> >::iterator iter=buckets.begin(),limit=buckets.end();iter!=limit;++iter)
+      (*iter).clear();
+   currentBucket=0;
+   queued=0;
+   reachedNodes.clear();
+   bottomUp=false;
+}
+//---------------------------------------------------------------------------
+void PathTraversal::start(unsigned node)
+   // Add a start node
+{
+   relax(node,0,~0u,~0u);
+}
+//---------------------------------------------------------------------------
+bool PathTraversal::reach(unsigned node,unsigned distance,unsigned parentNode,unsigned edge)
+   // Record a path to a node. Returns true if it is shorter than the known one
+{
+   if (node>=nodes.size())
+      grow(node);
+   NodeState& state=nodes[node];
+   if (state.reached==epoch) {
+      if (state.distance<=distance)
+         return false;
+   } else {
+      state.reached=epoch;
+      reachedNodes.push_back(node);
+   }
+   state.distance=distance;
+   state.parent.node=parentNode;
+   state.parent.edge=edge;
+   return true;
+}
+//---------------------------------------------------------------------------
+void PathTraversal::push(unsigned node)
+   // Queue a node with its current distance
+{
+   unsigned distance=nodes[node].distance;
+   if (distance>=buckets.size())
+      buckets.resize(distance+1);
+   buckets[distance].push_back(node);
+   queued++;
+}
+//---------------------------------------------------------------------------
+bool PathTraversal::pop(unsigned& node)
+   // Take the closest unsettled node and settle it
+{
+   while (queued) {
+      while (buckets[currentBucket].empty())
+         currentBucket++;
+      unsigned candidate=buckets[currentBucket].back();
+      buckets[currentBucket].pop_back();
+      queued--;
+
+      // Skip entries that were settled or improved meanwhile
+      if ((nodes[candidate].settled==epoch)||(nodes[candidate].distance!=currentBucket))
+         continue;
+      settle(candidate);
+      node=candidate;
+      return true;
+   }
+   return false;
+}
+//---------------------------------------------------------------------------
+bool PathTraversal::nextBucket(vector<unsigned>& frontier)
+   // Take all unsettled nodes with the smallest distance, sorted by id, and settle them
+{
+   frontier.clear();
+   while (queued) {
+      vector<unsigned>& bucket=buckets[currentBucket];
+      queued-=bucket.size();
+      for (vector<unsigned>::const_iterator iter=bucket.begin(),limit=bucket.end();iter!=limit;++iter)
+         if ((nodes[*iter].settled!=epoch)&&(nodes[*iter].distance==currentBucket))
+            frontier.push_back(*iter);
+      bucket.clear();
+      currentBucket++;
+
+      if (!frontier.empty()) {
+         sort(frontier.begin(),frontier.end());
+         frontier.erase(unique(frontier.begin(),frontier.end()),frontier.end());
+         for (vector<unsigned>::const_iterator iter=frontier.begin(),limit=frontier.end();iter!=limit;++iter)
+            settle(*iter);
+         return true;
+      }
+   }
+   return false;
+}
+//---------------------------------------------------------------------------
+void PathTraversal::clearMarks()
+   // Forget all marks
+{
+   if ((++markEpoch)==~0u) {
+      for (vector<NodeState>::iterator iter=nodes.begin(),limit=nodes.end();iter!=limit;++iter)
+         (*iter).marked=0;
+      markEpoch=1;
+   }
+}
+//---------------------------------------------------------------------------
+bool PathTraversal::mark(unsigned node)
+   // Mark a node. Returns false if it was marked already
+{
+   if (node>=nodes.size())
+      grow(node);
+   if (nodes[node].marked==markEpoch)
+      return false;
+   nodes[node].marked=markEpoch;
+   return true;
+}
+//---------------------------------------------------------------------------
+void PathTraversal::findNeighbors(Database& db,Database::DataOrder order,const vector<unsigned>& frontier,Neighbors& neighbors)
+   // Find the outgoing edges of sorted frontier nodes in a single index pass
+{
+   neighbors.edges.clear();
+   neighbors.offsets.assign(1,0);
+   if (frontier.empty())
+      return;
+
+   // Forward or backward search?
+   Register reg,rs,rp,ro;
+   reg.reset(); rs.reset(); rp.reset(); ro.reset();
+   Register* s,*o;
+   if (order==Database::Order_Subject_Predicate_Object) {
+      s=&rs; o=&ro;
+   } else {
+      s=&ro; o=&rs;
+   }
+
+   // Merge the frontier with the facts
+   vector<Register*> leftTail,rightTail;
+   rightTail.push_back(&rp); rightTail.push_back(o);
+   MergeJoin join(new ConstantOperator(&reg,frontier),&reg,leftTail,IndexScan::create(db,order,&rs,false,&rp,false,&ro,false,0),s,rightTail,0);
+
+   unsigned index=0;
+   if (join.first()) do {
+      while (frontier[index]!=s->value) {
+         neighbors.offsets.push_back(neighbors.edges.size());
+         index++;
+      }
+      neighbors.edges.push_back(pair<unsigned,unsigned>(rp.value,o->value));
+   } while (join.next());
+   while (neighbors.offsets.size()<=frontier.size())
+      neighbors.offsets.push_back(neighbors.edges.size());
+}
+//---------------------------------------------------------------------------
+void PathTraversal::discoverTopDown(void* data)
+   // Expand a part of the frontier top-down
+{
+   ExpandTask& task=*static_cast<ExpandTask*>(data);
+   vector<unsigned> part(task.frontier->begin()+task.from,task.frontier->begin()+task.to);
+   Neighbors neighbors;
+   findNeighbors(*task.db,task.order,part,neighbors);
+
+   for (unsigned index=0;index<part.size();index++)
+      for (vector<pair<unsigned,unsigned> >::const_iterator iter=neighbors.begin(index),limit=neighbors.end(index);iter!=limit;++iter)
+         if (!task.traversal->isReached((*iter).second)) {
+            Discovery d; d.node=(*iter).second; d.parent=part[index]; d.edge=(*iter).first;
+            task.found.push_back(d);
+         }
+}
+//---------------------------------------------------------------------------
+void PathTraversal::discoverBottomUp(void* data)
+   // Expand a range of nodes bottom-up
+{
+   ExpandTask& task=*static_cast<ExpandTask*>(data);
+   const boost::dynamic_bitset<>& bits=*task.frontierBits;
+
+   // Look for a frontier node among the incoming edges of every unreached node
+   FactsSegment::Scan scan;
+   unsigned done=~0u;
+   if (scan.first(task.db->getFacts(task.order),task.from,0,0)) do {
+      unsigned node=scan.getValue1();
+      if (node>=task.to) break;
+      if (node==done) continue;
+      if (task.traversal->isReached(node)) {
+         done=node;
+         continue;
+      }
+      unsigned source=scan.getValue3();
+      if ((source<bits.size())&&bits[source]) {
+         Discovery d; d.node=node; d.parent=source; d.edge=scan.getValue2();
+         task.found.push_back(d);
+         done=node;
+      }
+   } while (scan.next());
+}
+//---------------------------------------------------------------------------
+static bool compareNode(const PathTraversal::Discovery& a,const PathTraversal::Discovery& b) { return a.node<b.node; }
+static bool sameNode(const PathTraversal::Discovery& a,const PathTraversal::Discovery& b) { return a.node==b.node; }
+//---------------------------------------------------------------------------
+void PathTraversal::discover(Database& db,Database::DataOrder order,const vector<unsigned>& frontier,vector<Discovery>& found)
+   // Find all unreached neighbors of a sorted frontier, each with one parent
+{
+   found.clear();
+   if (frontier.empty())
+      return;
+
+   // Choose the direction. Bottom-up pays off once the frontier covers a large part of the unreached graph
+   unsigned nodeCount=max<unsigned>(db.getDictionary().getNextId(),reachedNodes.size());
+   unsigned triples=db.getFacts(order).getCardinality();
+   Database::DataOrder reverse=order;
+   if (!reverseOrder(order,reverse)) {
+      bottomUp=false;
+   } else if (direction!=Automatic) {
+      bottomUp=(direction==BottomUp);
+   } else if (!bottomUp) {
+      bottomUp=(static_cast<uint64_t>(frontier.size())*alpha>nodeCount-reachedNodes.size());
+   } else {
+      bottomUp=(static_cast<uint64_t>(frontier.size())*beta>=nodeCount);
+   }
+
+   // Split the work
+   vector<ExpandTask> tasks;
+   unsigned parts,range;
+   if (bottomUp) {
+      parts=max<unsigned>(1,min<unsigned>(threads,triples/minBottomUpChunk));
+      range=frontier.back()+1;
+      if (frontierBits.size()<range)
+         frontierBits.resize(range);
+      for (vector<unsigned>::const_iterator iter=frontier.begin(),limit=frontier.end();iter!=limit;++iter)
+         frontierBits.set(*iter);
+      range=nodeCount;
+   } else {
+      parts=max<unsigned>(1,min<unsigned>(threads,frontier.size()/minTopDownChunk));
+      range=frontier.size();
+   }
+   tasks.resize(parts);
+   for (unsigned index=0;index<parts;index++) {
+      ExpandTask& task=tasks[index];
+      task.traversal=this;
+      task.db=&db;
+      task.order=bottomUp?reverse:order;
+      task.frontier=&frontier;
+      task.frontierBits=&frontierBits;
+      task.from=static_cast<uint64_t>(range)*index/parts;
+      task.to=(index+1==parts)?(bottomUp?~0u:range):static_cast<unsigned>(static_cast<uint64_t>(range)*(index+1)/parts);
+   }
+   if (parts>1) {
+      if (!pool)
+         pool=new WorkerPool();
+      pool->execute(bottomUp?discoverBottomUp:discoverTopDown,tasks,threads);
+   } else {
+      (bottomUp?discoverBottomUp:discoverTopDown)(&tasks[0]);
+   }
+
+   // Combine the results. Top-down keeps the first parent in frontier order
+   for (vector<ExpandTask>::const_iterator iter=tasks.begin(),limit=tasks.end();iter!=limit;++iter)
+      found.insert(found.end(),(*iter).found.begin(),(*iter).found.end());
+   if (bottomUp) {
+      for (vector<unsigned>::const_iterator iter=frontier.begin(),limit=frontier.end();iter!=limit;++iter)
+         frontierBits.reset(*iter);
+   } else {
+      stable_sort(found.begin(),found.end(),compareNode);
+      found.erase(unique(found.begin(),found.end(),sameNode),found.end());
+   }
+}
+//---------------------------------------------------------------------------
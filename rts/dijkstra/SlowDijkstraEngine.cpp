@@ -53,30 +53,12 @@ static vector<pair<unsigned, unsigned> > findPredecessors(unsigned node, Databas
 }
 //---------------------------------------------------------------------------
 unsigned SlowDijkstraEngine::getPredecessor(unsigned node) {
-    return predecessors[node];
-}
-//---------------------------------------------------------------------------
-void SlowDijkstraEngine::setPredecessor(unsigned a, unsigned b) {
-    predecessors[a] = b;
-}
-//---------------------------------------------------------------------------
-void SlowDijkstraEngine::setShortestDistance(unsigned node, unsigned oldDistance, unsigned distance) {
-    //    cout<<"               deleting node "<<node<<", dist = "<<oldDistance<<endl;
-	workingSet.erase(pair<unsigned, unsigned>(oldDistance, node));
-
-    shortestDistances[node] = distance;
-    workingSet.insert(pair<unsigned, unsigned>(distance, node));
-
+    return traversal.getParent(node).node;
 }
 //---------------------------------------------------------------------------
 void SlowDijkstraEngine::init(unsigned start) {
-    settledNodes.clear();
-    shortestDistances.clear();
-    predecessors.clear();
-    workingSet.clear();
-    shortestDistances[start] = 0;
-
-    workingSet.insert(pair<unsigned, unsigned>(0, start));
+    traversal.reset();
+    traversal.start(start);
 }
 //---------------------------------------------------------------------------
 void SlowDijkstraEngine::updateNeighbors(unsigned node) {
@@ -101,8 +83,7 @@ void SlowDijkstraEngine::updateNeighbors(unsigned node) {
         unsigned oldDist = DijkstraEngine::getShortestDist(iter->second);
         if (shortDist < oldDist) {
             //         cout << "the distance was " << oldDist << ", updated to " << shortDist << endl;
-            setShortestDistance(iter->second, oldDist, shortDist);
-            setPredecessor(iter->second, node);
+            traversal.relax(iter->second, shortDist, node, iter->first);
         }
     }
     Timestamp t3;
@@ -112,19 +93,9 @@ void SlowDijkstraEngine::updateNeighbors(unsigned node) {
 void SlowDijkstraEngine::computeSP(unsigned source) {
 	init(source);
     unsigned curNode = 0;
-    unsigned maxHeapSize = 0;
-    while (!workingSet.empty()) {
-        curNode = (workingSet.begin())->second;
-        if (workingSet.size() > maxHeapSize)
-            maxHeapSize = workingSet.size();
-        workingSet.erase(workingSet.begin());
-
-        assert(!DijkstraEngine::isHandled(curNode));
-
-        settledNodes.insert(curNode);
+    while (traversal.pop(curNode)) {
         updateNeighbors(curNode);
-
     }
 
-//    cerr<<"settled nodes: "<<settledNodes.size()<<endl;
+//    cerr<<"settled nodes: "<<traversal.getReached().size()<<endl;
 }
@@ -16,9 +16,8 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
-#include <stack>
+#include <algorithm>
 #include <map>
-#include <set>
 #include <string.h>
 #include "infra/osdep/Timestamp.hpp"
 using namespace std;
@@ -80,101 +79,156 @@ Graph::Graph(const std::string& filename) :
   }
 }
 //--------------------------------------------------------------------------------------------------
-// Tarjan's algorithm for finding the SCC
-static void strongcomponent(unsigned v, map<unsigned, std::vector<unsigned> >& adjlist,
-		map<unsigned,unsigned>& visited,
-		map<unsigned,unsigned>& lowlink,
-		vector<unsigned>& stack,
-		set<unsigned>& setnodes,
-		map<unsigned,unsigned>& scc,
-		unsigned& index,unsigned& sccId)
+/**
+ * Constructor for an empty graph, filled when loading a persisted index
+ */
+//--------------------------------------------------------------------------------------------------
+Graph::Graph() :
+    n(0), m(0) {
+}
+//--------------------------------------------------------------------------------------------------
+// Tarjan's algorithm for finding the SCCs, iterative over a CSR adjacency array.
+// Components are numbered in the order they are completed
+static unsigned strongcomponents(const vector<unsigned>& offsets,const vector<unsigned>& targets,
+		const vector<unsigned>& roots,vector<unsigned>& scc)
 {
-	visited[v]=index;
-	lowlink[v]=index;
-	++index;
-	stack.push_back(v);
-	setnodes.insert(v);
-   vector<unsigned>& neighbors = adjlist[v];
-	for (auto node: neighbors){
-		if (!visited.count(node)){
-			strongcomponent(node,adjlist,visited,lowlink,stack,setnodes,scc,index,sccId);
-			lowlink[v]=std::min(lowlink[v],lowlink[node]);
-		} else if (/*find(stack.begin(), stack.end(), node)!= stack.end()*/setnodes.count(node)){
-			lowlink[v]=std::min(lowlink[v],visited[node]);
-		}
-	}
+	const unsigned unvisited=~0u;
+	unsigned count=offsets.size()-1;
+	vector<unsigned> visited(count,unvisited),lowlink(count);
+	vector<char> onstack(count,0);
+	vector<unsigned> stack;
+	// the DFS call stack, node and position in its adjacency list
+	vector<pair<unsigned,unsigned> > calls;
+	unsigned index=0,sccId=0;
 
-	if (lowlink[v]==visited[v]){
-		//cerr<<"SCC: ";
-		//cerr<<" root "<<v<<" ("<<visited[v]<<", "<<sccId<<") ";
-		scc[v]=sccId;
+	scc.assign(count,0);
+	for (auto root: roots) {
+		if (visited[root]!=unvisited)
+			continue;
+		calls.push_back(pair<unsigned,unsigned>(root,offsets[root]));
+		visited[root]=lowlink[root]=index++;
+		stack.push_back(root);
+		onstack[root]=1;
 
-		unsigned node=0;
-		while (true) {
-			node=stack.back();
-		//	cerr<<node<<" ("<<visited[node]<<", "<<sccId<<")";
-			stack.pop_back();
-		//	cerr<<" ["<<setnodes.size()<<"] ";
-			setnodes.erase(node);
-			scc[node]=sccId;
-			if (node==v)
-				break;
-		};
-		++sccId;
-		//cerr<<endl;
-	}
+		while (!calls.empty()) {
+			unsigned v=calls.back().first;
+			unsigned& pos=calls.back().second;
+			if (pos<offsets[v+1]) {
+				unsigned node=targets[pos++];
+				if (visited[node]==unvisited) {
+					// descend
+					visited[node]=lowlink[node]=index++;
+					stack.push_back(node);
+					onstack[node]=1;
+					calls.push_back(pair<unsigned,unsigned>(node,offsets[node]));
+				} else if (onstack[node]) {
+					lowlink[v]=std::min(lowlink[v],visited[node]);
+				}
+				continue;
+			}
 
+			// all neighbors done, v is the root of a component?
+			if (lowlink[v]==visited[v]) {
+				while (true) {
+					unsigned node=stack.back();
+					stack.pop_back();
+					onstack[node]=0;
+					scc[node]=sccId;
+					if (node==v)
+						break;
+				}
+				++sccId;
+			}
+
+			// return to the caller
+			calls.pop_back();
+			if (!calls.empty()) {
+				unsigned parent=calls.back().first;
+				lowlink[parent]=std::min(lowlink[parent],lowlink[v]);
+			}
+		}
+	}
+	return sccId;
 }
 //--------------------------------------------------------------------------------------------------
-Graph::Graph(const std::vector<std::pair<unsigned,unsigned> >& edge_list,unsigned nodes):  n(nodes), m(edge_list.size()) {
-  // convert names to internal Ids
-	unsigned id=0;
-	map<unsigned,unsigned> visited,lowlink,scc;
-	std::vector<std::pair<unsigned,unsigned> > edges;
-	std::map<unsigned, std::vector<unsigned> > adjList;
-	vector<unsigned> stack;
-	set<unsigned> setnodes;
-	unsigned sccId=0;
-	// fill out the adjacency list
-	for (auto edge: edge_list)
-		adjList[edge.first].push_back(edge.second);
+Graph::Graph(const std::vector<std::pair<unsigned,unsigned> >& edge_list,unsigned nodes):  n(nodes), m(0) {
+	// map the node names to dense ids
+	vector<unsigned> names;
+	names.reserve(2*edge_list.size());
+	for (auto edge: edge_list) {
+		names.push_back(edge.first);
+		names.push_back(edge.second);
+	}
+	sort(names.begin(),names.end());
+	eliminateDuplicates(names);
+	vector<pair<unsigned,unsigned> > dense(edge_list.size());
+	for (unsigned i=0;i<edge_list.size();i++) {
+		dense[i].first=lower_bound(names.begin(),names.end(),edge_list[i].first)-names.begin();
+		dense[i].second=lower_bound(names.begin(),names.end(),edge_list[i].second)-names.begin();
+	}
 
-	for (auto edge: edge_list){
-		if (!visited.count(edge.first)){
-			strongcomponent(edge.first,adjList,visited,lowlink,stack,setnodes,name2id,id,sccId);
-		}
+	// build the CSR adjacency array, keeping the edge order per node
+	unsigned count=names.size();
+	vector<unsigned> offsets(count+1,0),targets(dense.size());
+	for (auto edge: dense)
+		++offsets[edge.first+1];
+	for (unsigned i=0;i<count;i++)
+		offsets[i+1]+=offsets[i];
+	{
+		vector<unsigned> fill(offsets.begin(),offsets.end()-1);
+		for (auto edge: dense)
+			targets[fill[edge.first]++]=edge.second;
 	}
-	for (auto edge:edge_list){
-		if (name2id[edge.first]!=name2id[edge.second]){
-			edges.push_back({name2id[edge.first],name2id[edge.second]});
+
+	// find the SCCs, starting from the sources in edge order
+	vector<unsigned> starts,scc;
+	starts.reserve(dense.size());
+	for (auto edge: dense)
+		starts.push_back(edge.first);
+	unsigned sccId=strongcomponents(offsets,targets,starts,scc);
+
+	// names are sorted, so the map can be filled in order
+	for (unsigned i=0;i<count;i++)
+		name2id.insert(name2id.end(),pair<unsigned,unsigned>(names[i],scc[i]));
+
+	// condense the graph
+	std::vector<std::pair<unsigned,unsigned> > edges;
+	edges.reserve(dense.size());
+	for (auto edge: dense){
+		if (scc[edge.first]!=scc[edge.second]){
+			edges.push_back({scc[edge.first],scc[edge.second]});
 		}
 	}
+	vector<pair<unsigned,unsigned> >().swap(dense);
+	vector<unsigned>().swap(targets);
+	vector<unsigned>().swap(starts);
 
 	sort(edges.begin(), edges.end());
 	eliminateDuplicates(edges);
 
 	n=sccId+1;
+	m=edges.size();
 	id2name.resize(n);
-	for (auto id:name2id){
-		id2name[id.second]=id.first;
-	}
-	cerr<<"   nodes: "<<n<<endl;
-	cerr<<"   edges: "<<edges.size()<<endl;
-	cerr<<"   name2id: "<<name2id.size()<<endl;
+	for (unsigned i=0;i<count;i++)
+		id2name[scc[i]]=names[i];
 
 	nb = std::vector<std::vector<unsigned> >(n);
    pd = std::vector<std::vector<unsigned> >(n);
    deg = std::vector<unsigned>(n, 0);
-   for (unsigned i = 0; i < n; ++i)
-     deg[i] = 0;
    indeg = std::vector<unsigned>(n, 0);
    leaves = std::deque<unsigned>();
    std::vector<bool> is_root(n, true);
    for (auto p: edges){
-   	nb[p.first].push_back(p.second);
-   	pd[p.second].push_back(p.first);
    	++indeg[p.second];
    	++deg[p.first];
+   }
+   for (unsigned i = 0; i < n; ++i) {
+      nb[i].reserve(deg[i]);
+      pd[i].reserve(indeg[i]);
+   }
+   for (auto p: edges){
+   	nb[p.first].push_back(p.second);
+   	pd[p.second].push_back(p.first);
       is_root[p.second] = false;
    }
    for (unsigned i = 0; i < n; ++i) {
@@ -10,6 +10,7 @@
 //--------------------------------------------------------------------------------------------------
 #include "rts/ferrari/Index.hpp"
 //--------------------------------------------------------------------------------------------------
+#include <algorithm>
 #include <assert.h>
 #include <iostream>
 #include <math.h>
@@ -18,8 +19,7 @@
 #include <queue>
 //--------------------------------------------------------------------------------------------------
 Index::Index(Graph* g, unsigned s, unsigned k, bool global) :
-    g(g), n_(g->num_nodes()), s_(s), k_(k), global_(global), queryId(0), expanded(
-        0) {
+    g(g), n_(g->num_nodes()), s_(s), k_(k), global_(global) {
 }
 //--------------------------------------------------------------------------------------------------
 Index::~Index() {
@@ -32,9 +32,6 @@ Index::~Index() {
 }
 //--------------------------------------------------------------------------------------------------
 void Index::build() {
-  visited = std::vector<unsigned>(n_, 0);
-  expanded = 0;
-
   // determine seeds
   if (s_) {
     seed_nodes = std::vector<unsigned>();
@@ -77,20 +74,45 @@ void Index::build() {
     assign_sketches();
 }
 //--------------------------------------------------------------------------------------------------
-bool Index::reachable_dfs(unsigned x, unsigned y) {
-  ++queryId;
-  return __reachable_dfs(x, y);
+void Index::QueryContext::begin(unsigned n) {
+  if (visited.size() < n) {
+    visited.assign(n, 0);
+    queryId = 0;
+  }
+  if (!++queryId) {
+    // epoch overflow, forget all old marks
+    memset(&visited[0], 0, sizeof(visited[0]) * visited.size());
+    queryId = 1;
+  }
+}
+//--------------------------------------------------------------------------------------------------
+unsigned Index::QueryContext::reset() {
+  unsigned _expanded = expanded;
+  expanded = 0;
+  queryId = 0;
+  if (!visited.empty())
+    memset(&visited[0], 0, sizeof(visited[0]) * visited.size());
+  return _expanded;
+}
+//--------------------------------------------------------------------------------------------------
+bool Index::reachable_dfs(unsigned x, unsigned y, QueryContext& ctx) const {
+  ctx.begin(n_);
+  return __reachable_dfs(x, y, ctx);
 }
 //--------------------------------------------------------------------------------------------------
-void Index::get_reachable(unsigned x, std::vector<unsigned>& nodes){
+void Index::get_reachable(unsigned x, std::vector<unsigned>& nodes) const {
+	unsigned name=x;
 	x=g->getNodeId(x);
 
-	if (!intervals[x])
+	// not part of the graph or a leaf, only reaches itself
+	if ((!~x)||(!intervals[x])) {
+		nodes.push_back(name);
 		return;
+	}
 
 	IntervalList* intlist = intervals[x];
-	const std::vector<unsigned>& lower=intlist->get_lower();
-	const std::vector<unsigned>& upper=intlist->get_upper();
+	const IntervalList::bounds& lower=intlist->get_lower();
+	const IntervalList::bounds& upper=intlist->get_upper();
 
 	for (unsigned i=0; i < lower.size(); i++){
 		for (unsigned node=lower[i]; node<=upper[i];++node){
@@ -99,37 +121,37 @@ void Index::get_reachable(unsigned x, std::vector<unsigned>& nodes){
 	}
 }
 //--------------------------------------------------------------------------------------------------
-bool Index::__reachable_dfs(unsigned x, unsigned y) {
+bool Index::__reachable_dfs(unsigned x, unsigned y, QueryContext& ctx) const {
   if (x == y)
     return true;
-  if (visited[x] == queryId)
+  if (ctx.visited[x] == ctx.queryId)
     return false;
-  visited[x] = queryId;
-  ++expanded;
+  ctx.visited[x] = ctx.queryId;
+  ++ctx.expanded;
   const std::vector<unsigned> *nb = g->get_neighbors(x);
   for (std::vector<unsigned>::const_iterator it = nb->begin(); it != nb->end();
       ++it) {
-    if (__reachable_dfs(*it, y)) {
+    if (__reachable_dfs(*it, y, ctx)) {
       return true;
     }
   }
   return false;
 }
 //--------------------------------------------------------------------------------------------------
-bool Index::reachable_bfs(unsigned x, unsigned y) {
+bool Index::reachable_bfs(unsigned x, unsigned y, QueryContext& ctx) const {
   if (x == y)
     return true;
-  ++queryId;
+  ctx.begin(n_);
   std::deque<unsigned> queue(1, x);
   unsigned v;
   const std::vector<unsigned> *nb;
   while (!queue.empty()) {
     v = queue.front();
     queue.pop_front();
-    if (visited[v] == queryId)
+    if (ctx.visited[v] == ctx.queryId)
       continue;
-    visited[v] = queryId;
-    ++expanded;
+    ctx.visited[v] = ctx.queryId;
+    ++ctx.expanded;
     nb = g->get_neighbors(v);
     for (std::vector<unsigned>::const_iterator it = nb->begin();
         it != nb->end(); ++it) {
@@ -141,11 +163,16 @@ bool Index::reachable_bfs(unsigned x, unsigned y) {
   return false;
 }
 //--------------------------------------------------------------------------------------------------
-bool Index::reachable(unsigned x, unsigned y) {
-  ++queryId;
-
-  x=g->getNodeId(x);
-  y=g->getNodeId(y);
+bool Index::reachable(unsigned x, unsigned y, QueryContext& ctx) const {
+  // nodes outside of the graph only reach themselves
+  unsigned nx=g->getNodeId(x), ny=g->getNodeId(y);
+  if ((!~nx)||(!~ny)) {
+    return x == y;
+  }
+  return reachable_node(nx, ny, ctx);
+}
+//--------------------------------------------------------------------------------------------------
+bool Index::reachable_node(unsigned x, unsigned y, QueryContext& ctx) const {
   if (!intervals[x]) {
     return x == y;
   }
@@ -168,21 +195,99 @@ bool Index::reachable(unsigned x, unsigned y) {
   case IntervalList::YES:
     return true;
   default:
-    const std::vector<unsigned> *nb = g->get_neighbors(x);
-    for (std::vector<unsigned>::const_iterator it = nb->begin();
-        it != nb->end(); ++it) {
-      if (y == *it
-          || (visited[*it] < queryId && __reachable(*it, y))) {
-        return true;
-      }
+    return __expand(x, y, ctx);
+  }
+}
+//--------------------------------------------------------------------------------------------------
+bool Index::__expand(unsigned x, unsigned y, QueryContext& ctx) const {
+  ctx.begin(n_);
+  const std::vector<unsigned> *nb = g->get_neighbors(x);
+  for (std::vector<unsigned>::const_iterator it = nb->begin();
+      it != nb->end(); ++it) {
+    if (y == *it
+        || (ctx.visited[*it] < ctx.queryId && __reachable(*it, y, ctx))) {
+      return true;
     }
-    return false;
   }
+  return false;
 }
 //--------------------------------------------------------------------------------------------------
-bool Index::__reachable(const unsigned& x, const unsigned& y) {
-  visited[x] = queryId;
-  ++expanded;
+void Index::prepare_batch(const std::vector<unsigned>& nodes, Batch& batch) const {
+  batch.entries.resize(nodes.size());
+  for (unsigned i = 0; i < nodes.size(); ++i) {
+    Batch::Entry& e = batch.entries[i];
+    e.name = nodes[i];
+    e.node = g->getNodeId(nodes[i]);
+    e.order = (~e.node) ? id_[e.node] : ~0u;
+    e.pos = i;
+  }
+  // sort by position in the interval order, unknown nodes go last
+  std::sort(batch.entries.begin(), batch.entries.end());
+}
+//--------------------------------------------------------------------------------------------------
+void Index::reachable(unsigned x, const Batch& targets, std::vector<unsigned>& result, QueryContext& ctx) const {
+  result.clear();
+  const std::vector<Batch::Entry>& entries = targets.entries;
+  unsigned nx = g->getNodeId(x);
+
+  // not part of the graph or a leaf, only reaches itself
+  if ((!~nx) || (!intervals[nx])) {
+    for (std::vector<Batch::Entry>::const_iterator it = entries.begin();
+        it != entries.end(); ++it) {
+      if ((~nx) ? (it->node == nx) : (it->name == x))
+        result.push_back(it->pos);
+    }
+    std::sort(result.begin(), result.end());
+    return;
+  }
+
+  // merge the sorted targets with the interval bounds
+  const IntervalList* intlist = intervals[nx];
+  const IntervalList::bounds& lower = intlist->get_lower();
+  const IntervalList::bounds& upper = intlist->get_upper();
+  unsigned i = 0, limit = lower.size();
+  for (std::vector<Batch::Entry>::const_iterator it = entries.begin();
+      it != entries.end(); ++it) {
+    unsigned y = it->node;
+    if (!~y)
+      break;
+    if (y == nx || (s_ && seed_out[nx].intersects(seed_in[y]))) {
+      result.push_back(it->pos);
+      continue;
+    }
+    if (tlevel_[nx] <= tlevel_[y] || torder_[nx] > torder_[y])
+      continue;
+    while (i < limit && upper[i] < it->order)
+      ++i;
+    if (i == limit)
+      continue;
+    if (lower[i] > it->order)
+      continue;
+    if (intlist->is_exact(i) || __expand(nx, y, ctx))
+      result.push_back(it->pos);
+  }
+  std::sort(result.begin(), result.end());
+}
+//--------------------------------------------------------------------------------------------------
+void Index::reaching(const Batch& sources, unsigned y, std::vector<unsigned>& result, QueryContext& ctx) const {
+  result.clear();
+  const std::vector<Batch::Entry>& entries = sources.entries;
+  unsigned ny = g->getNodeId(y);
+  for (std::vector<Batch::Entry>::const_iterator it = entries.begin();
+      it != entries.end(); ++it) {
+    if ((!~ny) || (!~it->node)) {
+      if (it->name == y)
+        result.push_back(it->pos);
+    } else if (reachable_node(it->node, ny, ctx)) {
+      result.push_back(it->pos);
+    }
+  }
+  std::sort(result.begin(), result.end());
+}
+//--------------------------------------------------------------------------------------------------
+bool Index::__reachable(const unsigned& x, const unsigned& y, QueryContext& ctx) const {
+  ctx.visited[x] = ctx.queryId;
+  ++ctx.expanded;
 
   if (tlevel_[x] <= tlevel_[y] || torder_[x] > torder_[y]) {
     return false;
@@ -205,7 +310,7 @@ bool Index::__reachable(const unsigned& x, const unsigned& y) {
     for (std::vector<unsigned>::const_iterator it = nb->begin();
         it != nb->end(); ++it) {
       if (*it == y
-          || (visited[*it] < queryId && __reachable(*it, y))) {
+          || (ctx.visited[*it] < ctx.queryId && __reachable(*it, y, ctx))) {
         return true;
       }
     }
@@ -347,9 +452,11 @@ void Index::assign_sketches_global() {
 
   unsigned multiplier = 4;
   unsigned leaf_count = g->get_leaves()->size();
-  unsigned budget = k_ * (n + leaf_count) / n;
-  unsigned max_space = n * k_ + leaf_count;
-  unsigned current_space = 0;
+  // computed in 64 bit, k_ is ~0u for unrestricted indexes
+  unsigned budget = std::min<unsigned long long>(
+      static_cast<unsigned long long>(k_) * (n + leaf_count) / n, ~0u);
+  unsigned long long max_space = static_cast<unsigned long long>(n) * k_ + leaf_count;
+  unsigned long long current_space = 0;
   std::vector<unsigned> restriction_queue;
   restriction_queue.reserve(n);
   std::vector<unsigned>* deg = g->get_degrees();
@@ -440,28 +547,20 @@ void Index::generate_seeds_degree(unsigned s) {
   s_ = std::min((unsigned) seed_nodes.size(), s_);
 }
 //--------------------------------------------------------------------------------------------------
-unsigned Index::reset() {
-  unsigned _expanded = expanded;
-  expanded = 0;
-  queryId = 0;
-  memset(&visited[0], 0, sizeof(visited[0]) * visited.size());
-  return _expanded;
-}
-//--------------------------------------------------------------------------------------------------
-bool Index::path(unsigned x, unsigned y, std::vector<unsigned>* p) {
+bool Index::path(unsigned x, unsigned y, std::vector<unsigned>* p, QueryContext& ctx) const {
   if (x == y) {
     p->push_back(x);
     return true;
   } else {
-    if (!reachable_dfs(x, y)) {
+    if (!reachable_dfs(x, y, ctx)) {
       return false;
     } else {
       p->push_back(x);
       const std::vector<unsigned> *nb = g->get_neighbors(x);
       for (std::vector<unsigned>::const_iterator it = nb->begin();
           it != nb->end(); ++it) {
-        if (reachable_dfs(*it, y)) {
-          return path(*it, y, p);
+        if (reachable_dfs(*it, y, ctx)) {
+          return path(*it, y, p, ctx);
         }
       }
     }
@@ -13,6 +13,106 @@
 #include <algorithm>
 #include <assert.h>
 #include <cstdio>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FERRARI_SIMD
+#include <immintrin.h>
+#endif
+//-------------------------------------------------------------------------------------------------
+namespace {
+//-------------------------------------------------------------------------------------------------
+/// Count the lower bounds <= x in a small window of a sorted list
+typedef unsigned (*rank_function)(const unsigned* lower, unsigned n, unsigned x);
+//-------------------------------------------------------------------------------------------------
+unsigned rank_scalar(const unsigned* lower, unsigned n, unsigned x) {
+  unsigned count = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    count += (lower[i] <= x);
+  }
+  return count;
+}
+//-------------------------------------------------------------------------------------------------
+#ifdef FERRARI_SIMD
+__attribute__((target("sse4.1,popcnt")))
+unsigned rank_sse4(const unsigned* lower, unsigned n, unsigned x) {
+  const __m128i vx = _mm_set1_epi32(x);
+  unsigned count = 0, i = 0;
+  for (; i + 4 <= n; i += 4) {
+    // unsigned lower <= x iff max(lower, x) == x
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lower + i));
+    __m128i le = _mm_cmpeq_epi32(_mm_max_epu32(v, vx), vx);
+    count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(le)));
+  }
+  for (; i < n; ++i) {
+    count += (lower[i] <= x);
+  }
+  return count;
+}
+//-------------------------------------------------------------------------------------------------
+__attribute__((target("avx2,popcnt")))
+unsigned rank_avx2(const unsigned* lower, unsigned n, unsigned x) {
+  const __m256i vx = _mm256_set1_epi32(x);
+  unsigned count = 0, i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lower + i));
+    __m256i le = _mm256_cmpeq_epi32(_mm256_max_epu32(v, vx), vx);
+    count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(le)));
+  }
+  for (; i < n; ++i) {
+    count += (lower[i] <= x);
+  }
+  return count;
+}
+#endif
+//-------------------------------------------------------------------------------------------------
+/// A search kernel. Binary search narrows the range down to at most window
+/// entries, which are then counted by the rank function
+struct search_kernel {
+  IntervalList::kernel id;
+  rank_function rank;
+  unsigned window;
+};
+//-------------------------------------------------------------------------------------------------
+const search_kernel kernels[] = {
+  { IntervalList::BINARY_SEARCH, rank_scalar, 0 },
+  { IntervalList::SCALAR, rank_scalar, 8 },
+#ifdef FERRARI_SIMD
+  { IntervalList::SSE4, rank_sse4, 16 },
+  { IntervalList::AVX2, rank_avx2, 32 },
+#endif
+};
+//-------------------------------------------------------------------------------------------------
+bool kernel_supported(IntervalList::kernel k) {
+  switch (k) {
+  case IntervalList::BINARY_SEARCH:
+  case IntervalList::SCALAR:
+    return true;
+#ifdef FERRARI_SIMD
+  case IntervalList::SSE4:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt");
+  case IntervalList::AVX2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+  default:
+    return false;
+  }
+}
+//-------------------------------------------------------------------------------------------------
+const search_kernel* detect_kernel() {
+  // the best kernel supported by the cpu
+  const search_kernel* best = kernels;
+  for (unsigned i = 0; i < sizeof(kernels) / sizeof(kernels[0]); ++i) {
+    if (kernel_supported(kernels[i].id)) {
+      best = kernels + i;
+    }
+  }
+  return best;
+}
+//-------------------------------------------------------------------------------------------------
+const search_kernel* active_kernel = detect_kernel();
+//-------------------------------------------------------------------------------------------------
+}
 //-------------------------------------------------------------------------------------------------
 IntervalList::IntervalList() {
 }
@@ -20,12 +120,62 @@ IntervalList::IntervalList() {
 IntervalList::IntervalList(unsigned a, unsigned b, char ex) {
   lower_.push_back(a);
   upper_.push_back(b);
-  exact_.push_back(ex);
+  push_exact(ex);
 }
 //-------------------------------------------------------------------------------------------------
 IntervalList::~IntervalList() {
 }
 //-------------------------------------------------------------------------------------------------
+IntervalList::kernel IntervalList::get_kernel() {
+  return active_kernel->id;
+}
+//-------------------------------------------------------------------------------------------------
+bool IntervalList::set_kernel(kernel k) {
+  if (!kernel_supported(k)) {
+    return false;
+  }
+  for (unsigned i = 0; i < sizeof(kernels) / sizeof(kernels[0]); ++i) {
+    if (kernels[i].id == k) {
+      active_kernel = kernels + i;
+      return true;
+    }
+  }
+  return false;
+}
+//-------------------------------------------------------------------------------------------------
+void IntervalList::push_exact(bool ex) {
+  // called after the interval has been appended
+  unsigned index = lower_.size() - 1;
+  if ((index >> 6) >= exact_.size()) {
+    exact_.push_back(0);
+  }
+  set_exact(index, ex);
+}
+//-------------------------------------------------------------------------------------------------
+void IntervalList::insert_exact(unsigned pos, bool ex) {
+  // called after the interval has been inserted, shifts the bits >= pos up
+  exact_.resize((lower_.size() + 63) / 64, 0);
+  unsigned word = pos >> 6;
+  for (unsigned w = exact_.size() - 1; w > word; --w) {
+    exact_[w] = (exact_[w] << 1) | (exact_[w - 1] >> 63);
+  }
+  uint64_t keep = (uint64_t(1) << (pos & 63)) - 1;
+  exact_[word] = (exact_[word] & keep) | ((exact_[word] & ~keep) << 1);
+  set_exact(pos, ex);
+}
+//-------------------------------------------------------------------------------------------------
+void IntervalList::erase_exact(unsigned from, unsigned to) {
+  // called after the intervals have been erased, drops the bits [from,to)
+  unsigned count = lower_.size(), shift = to - from;
+  for (unsigned i = from; i < count; ++i) {
+    set_exact(i, is_exact(i + shift));
+  }
+  for (unsigned i = count, limit = std::min<unsigned>(count + shift, exact_.size() * 64); i < limit; ++i) {
+    set_exact(i, false);
+  }
+  exact_.resize((count + 63) / 64);
+}
+//-------------------------------------------------------------------------------------------------
 void IntervalList::merge_exact(const IntervalList& other) {
   // find starting point
   if (other.empty()) {
@@ -33,11 +183,12 @@ void IntervalList::merge_exact(const IntervalList& other) {
   }
   int last_index = 0;
 
-  const std::vector<unsigned>& o_lower = other.get_lower();
-  const std::vector<unsigned>& o_upper = other.get_upper();
+  const bounds& o_lower = other.get_lower();
+  const bounds& o_upper = other.get_upper();
   if (empty()) {
     std::copy(o_lower.begin(), o_lower.end(), std::back_inserter(lower_));
     std::copy(o_upper.begin(), o_upper.end(), std::back_inserter(upper_));
+    exact_.assign((lower_.size() + 63) / 64, ~uint64_t(0));
     return;
   } else {
     // find relevant position in interval list
@@ -74,12 +225,14 @@ void IntervalList::merge_exact(const IntervalList& other) {
         // before everything
         lower_.insert(lower_.begin(), a);
         upper_.insert(upper_.begin(), b);
+        insert_exact(0, true);
         last_index = 0;
         continue;                 // done
       } else if (!insa && idxa == int(lower_.size()) - 1) {
         // after everything
         lower_.push_back(a);
         upper_.push_back(b);
+        push_exact(true);
         last_index = lower_.size() - 1;
         continue;                 // done
       }
@@ -95,6 +248,7 @@ void IntervalList::merge_exact(const IntervalList& other) {
         //assert(int(lower_.size()) > idxa);
         lower_.insert(lower_.begin() + idxa, a);
         upper_.insert(upper_.begin() + idxa, b);
+        insert_exact(idxa, true);
         last_index = idxa;
         continue;                 // done
       }
@@ -106,6 +260,7 @@ void IntervalList::merge_exact(const IntervalList& other) {
       // general case
       lower_.erase(lower_.begin() + idxa + 1, lower_.begin() + idxb + 1);
       upper_.erase(upper_.begin() + idxa, upper_.begin() + idxb);
+      erase_exact(idxa + 1, idxb + 1);
       last_index = idxb - idxa - 1;
     }
   }
@@ -118,14 +273,12 @@ void IntervalList::merge(const IntervalList& other) {
   }
   int last_index = 0;
 
-  const std::vector<unsigned>& o_lower = other.get_lower();
-  const std::vector<unsigned>& o_upper = other.get_upper();
-  const std::vector<char>& o_exact = other.get_exact();
-  //assert((o_lower.size() == o_upper.size()) && (o_lower.size() == o_exact.size()));
+  const bounds& o_lower = other.get_lower();
+  const bounds& o_upper = other.get_upper();
   if (empty()) {
     std::copy(o_lower.begin(), o_lower.end(), std::back_inserter(lower_));
     std::copy(o_upper.begin(), o_upper.end(), std::back_inserter(upper_));
-    std::copy(o_exact.begin(), o_exact.end(), std::back_inserter(exact_));
+    exact_ = other.exact_;
     return;
   } else {
     // find relevant position in interval list
@@ -135,7 +288,7 @@ void IntervalList::merge(const IntervalList& other) {
     bool insa, insb;
     for (unsigned i = 0; i < o_lower.size(); ++i) {
       a = o_lower[i], b = o_upper[i];
-      ex = o_exact[i];
+      ex = other.is_exact(i);
       insa = false, insb = false;
 
       // determine idxa
@@ -192,14 +345,14 @@ void IntervalList::merge(const IntervalList& other) {
         // before everything
         lower_.insert(lower_.begin(), a);
         upper_.insert(upper_.begin(), b);
-        exact_.insert(exact_.begin(), ex);
+        insert_exact(0, ex);
         last_index = 0;
         continue;                 // done
       } else if (!insa && idxa == int(lower_.size()) - 1) {
         // after everything
         lower_.push_back(a);
         upper_.push_back(b);
-        exact_.push_back(ex);
+        push_exact(ex);
         last_index = lower_.size() - 1;
         continue;                 // done
       }
@@ -216,7 +369,7 @@ void IntervalList::merge(const IntervalList& other) {
         //assert(int(lower_.size()) > idxa);
         lower_.insert(lower_.begin() + idxa, a);
         upper_.insert(upper_.begin() + idxa, b);
-        exact_.insert(exact_.begin() + idxa, ex);
+        insert_exact(idxa, ex);
         last_index = idxa;
         continue;                 // done
       }
@@ -234,19 +387,19 @@ void IntervalList::merge(const IntervalList& other) {
 
       // general case
       assert(idxb <= int(lower_.size()));
-      lower_.erase(lower_.begin() + idxa + 1, lower_.begin() + idxb + 1);
-      upper_.erase(upper_.begin() + idxa, upper_.begin() + idxb);
       char new_exact = ex;
       if (ex) {
         for (int i = idxa; i <= idxb; ++i) {
-          if (!exact_[i]) {
+          if (!is_exact(i)) {
             new_exact = 0;
             break;
           }
         }
       }
-      exact_[idxa] = new_exact;
-      exact_.erase(exact_.begin() + idxa + 1, exact_.begin() + idxb + 1);
+      lower_.erase(lower_.begin() + idxa + 1, lower_.begin() + idxb + 1);
+      upper_.erase(upper_.begin() + idxa, upper_.begin() + idxb);
+      set_exact(idxa, new_exact);
+      erase_exact(idxa + 1, idxb + 1);
       last_index = std::max(0, idxa);
     }
   }
@@ -256,7 +409,7 @@ void IntervalList::add(unsigned a, unsigned b, char ex) {
   //assert(empty());
   lower_.push_back(a);
   upper_.push_back(b);
-  exact_.push_back(ex);
+  push_exact(ex);
 }
 //-------------------------------------------------------------------------------------------------
 int IntervalList::find(const unsigned& x, int min) const {
@@ -266,56 +419,30 @@ int IntervalList::find(const unsigned& x, int min) const {
     return upper_.size() - 1;
   }
 
-  // no special case, perform binary search
-  int _min = std::max(0, min), _max = lower_.size(), _mid;
-  while (true) {
-    if (_min == _max) {
-      if (x < lower_[_min]) {
-        return _min - 1; // immediately to the left
-      } else {
-        return _min; // included in interval, or immediately to the right
-      }
-    }
+  // all lower bounds before _min are <= x, all from _max on are > x
+  const search_kernel* k = active_kernel;
+  unsigned _min = std::max(0, min), _max = lower_.size(), _mid;
+  while (_max - _min > k->window) {
     _mid = (_max + _min) / 2;
-    if (lower_[_mid] <= x && x <= upper_[_mid]) {
-      return _mid;
-    } else if (x < lower_[_mid]) {
-      _max = _mid;
-    } else {
+    if (lower_[_mid] <= x) {
       _min = _mid + 1;
+    } else {
+      _max = _mid;
     }
   }
-  return -1;
+  // interval containing x, or immediately to the left
+  return _min + k->rank(&lower_[0] + _min, _max - _min, x) - 1;
 }
 //-------------------------------------------------------------------------------------------------
 IntervalList::containment IntervalList::contains(const unsigned& x) const {
-  if (x < lower_.front() || x > upper_.back()) {
+  if (empty() || x < lower_.front() || x > upper_.back()) {
     return IntervalList::NOT;
   }
-  int _min = 0, _max = lower_.size(), _mid;
-  while (true) {
-    if (_min == _max) {
-      if (lower_[_min] <= x && x <= upper_[_min]) {
-        if (exact_[_min])
-          return IntervalList::YES;
-        else
-          return IntervalList::MAYBE;
-      } else
-        return IntervalList::NOT;
-    }
-    _mid = (_max + _min) / 2;
-    if (lower_[_mid] <= x && x <= upper_[_mid]) {
-      if (exact_[_mid])
-        return IntervalList::YES;
-      else
-        return IntervalList::MAYBE;
-    } else if (x < lower_[_mid]) {
-      _max = _mid;
-    } else {
-      _min = _mid + 1;
-    }
+  int index = find(x);
+  if (x > upper_[index]) {
+    return IntervalList::NOT;
   }
-  return IntervalList::NOT; // never reached
+  return is_exact(index) ? IntervalList::YES : IntervalList::MAYBE;
 }
 //-------------------------------------------------------------------------------------------------
 void IntervalList::restrict(const unsigned& k) {
@@ -325,9 +452,9 @@ void IntervalList::restrict(const unsigned& k) {
 
   std::vector<std::pair<unsigned, unsigned> > gaps;
   for (unsigned i = 0; i < lower_.size() - 1; ++i) {
-    if (i == 0 && exact_.front()) {
+    if (i == 0 && is_exact(0)) {
       gaps.push_back(std::make_pair(0, lower_[1] - lower_[0]));
-    } else if (i == lower_.size() - 1 && exact_.back()) {
+    } else if (i == lower_.size() - 1 && is_exact(i)) {
       gaps.push_back(std::make_pair(i, upper_[i] - upper_[i - 1]));
     } else {
       gaps.push_back(std::make_pair(i, gap_length(i)));
@@ -375,7 +502,7 @@ void IntervalList::restrict(const unsigned& k) {
     }
   }
 
-  std::vector<unsigned> n_lower, n_upper;
+  bounds n_lower, n_upper;
   std::vector<char> n_exact;
   n_lower.push_back(lower_.front());
   bool prev_gap_selected = true;
@@ -383,25 +510,28 @@ void IntervalList::restrict(const unsigned& k) {
     if (selected[i]) {
       n_upper.push_back(upper_[i]);
       n_lower.push_back(lower_[i + 1]);
-      n_exact.push_back(prev_gap_selected && exact_[i] == 1);
+      n_exact.push_back(prev_gap_selected && is_exact(i));
       prev_gap_selected = true;
     } else {
       prev_gap_selected = false;
     }
   }
   n_upper.push_back(upper_.back());
-  n_exact.push_back(prev_gap_selected && exact_.back() == 1);
+  n_exact.push_back(prev_gap_selected && is_exact(lower_.size() - 1));
 
   lower_ = n_lower;
   upper_ = n_upper;
-  exact_ = n_exact;
-  assert(lower_.size() == exact_.size());
+  exact_.assign((n_exact.size() + 63) / 64, 0);
+  for (unsigned i = 0; i < n_exact.size(); ++i) {
+    set_exact(i, n_exact[i]);
+  }
+  assert(lower_.size() == n_exact.size());
 }
 //-------------------------------------------------------------------------------------------------
 std::ostream& operator<<(std::ostream& out, const IntervalList &il) {
   out << "{";
   for (unsigned i = 0; i < il.size(); ++i) {
-    if (il.exact_[i])
+    if (il.is_exact(i))
       out << " [" << il.lower_[i] << "," << il.upper_[i] << "]";
     else
       out << " (" << il.lower_[i] << "," << il.upper_[i] << ")";
@@ -1,4 +1,5 @@
 #include "rts/operator/AggregatedIndexScan.hpp"
+#include "rts/operator/Batch.hpp"
 #include "rts/operator/PlanPrinter.hpp"
 #include "rts/runtime/Runtime.hpp"
 #include <cassert>
@@ -130,9 +131,29 @@ void AggregatedIndexScan::Hint::next(unsigned& value1,unsigned& value2)
    }
 }
 //---------------------------------------------------------------------------
+unsigned AggregatedIndexScan::Splitter::prepareMorsels(unsigned maxMorsels)
+   // Split the scan into morsels
+{
+   // Bound leading values limit the range
+   unsigned prefix=scan.bound1?(scan.bound2?2:1):0;
+   AggregatedFactsSegment::Pair from,to;
+   from.value1=(prefix>0)?scan.value1->value:0; to.value1=(prefix>0)?scan.value1->value:~0u;
+   from.value2=(prefix>1)?scan.value2->value:0; to.value2=(prefix>1)?scan.value2->value:~0u;
+
+   scan.facts.splitRange(from,to,maxMorsels,Scheduler::minMorselPages,scan.morselBounds);
+   scan.morsel=~0u;
+   return scan.morselBounds.size()+1;
+}
+//---------------------------------------------------------------------------
+void AggregatedIndexScan::Splitter::selectMorsel(unsigned morsel)
+   // Restrict the next scans to a morsel
+{
+   scan.morsel=morsel;
+}
+//---------------------------------------------------------------------------
 AggregatedIndexScan::AggregatedIndexScan(Database& db,Database::DataOrder order,Register* value1,bool bound1,Register* value2,bool bound2,double expectedOutputCardinality)
    : Operator(expectedOutputCardinality),value1(value1),value2(value2),bound1(bound1),bound2(bound2),facts(db.getAggregatedFacts(order)),order(order),
-     scan(disableSkipping?0:&hint),hint(*this)
+     scan(disableSkipping?0:&hint),hint(*this),splitter(*this),morsel(~0u)
    // Constructor
 {
 }
@@ -183,9 +204,117 @@ void AggregatedIndexScan::addMergeHint(Register* reg1,Register* reg2)
    handleHints(reg1,reg2,value2,merge2);
 }
 //---------------------------------------------------------------------------
-void AggregatedIndexScan::getAsyncInputCandidates(Scheduler& /*scheduler*/)
+unsigned AggregatedIndexScan::fillBatch(Batch& batch,bool hasCurrent)
+   // Produce a batch
+{
+   batch.clear();
+   if (batchesDone)
+      return 0;
+
+   // Find the columns of the values, all other registers are constant
+   unsigned* target1=0,*target2=0;
+   for (unsigned column=0,limit=batch.getColumnCount();column<limit;column++) {
+      Register* reg=batch.getRegisters()[column];
+      if (reg==value1) target1=batch.getColumn(column); else
+      if (reg==value2) target2=batch.getColumn(column);
+   }
+
+   // Values outside the domains published by hash join build sides cannot join
+   const DomainDescription* domain1=0,*domain2=0;
+   if (!disableSkipping) {
+      domain1=value1->domain; domain2=value2->domain;
+   }
+
+   // Scan the entries
+   unsigned* counts=batch.getCounts();
+   unsigned size=0;
+   while (size<Batch::capacity) {
+      if (hasCurrent) {
+         hasCurrent=false;
+      } else if (!scan.next()) {
+         batchesDone=true;
+         break;
+      }
+      unsigned v1=scan.getValue1(),v2=scan.getValue2();
+
+      // Beyond the bound prefix?
+      if (batchPrefix&&((v1>batchValue1)||((batchPrefix>1)&&(v1==batchValue1)&&(v2>batchValue2)))) {
+         batchesDone=true;
+         break;
+      }
+      // Beyond the morsel?
+      if (batchLimited&&((v1>batchLimit.value1)||((v1==batchLimit.value1)&&(v2>batchLimit.value2)))) {
+         batchesDone=true;
+         break;
+      }
+      if (batchFilter2&&(v2!=batchValue2))
+         continue;
+      if ((domain1&&(!domain1->couldQualify(v1)))||(domain2&&(!domain2->couldQualify(v2))))
+         continue;
+
+      if (target1) target1[size]=v1;
+      if (target2) target2[size]=v2;
+      unsigned count=scan.getCount();
+      counts[size++]=count;
+      observedOutputCardinality+=count;
+   }
+   batch.setSize(size);
+
+   for (unsigned column=0,limit=batch.getColumnCount();column<limit;column++) {
+      Register* reg=batch.getRegisters()[column];
+      if ((reg!=value1)&&(reg!=value2))
+         batch.fillConstant(column);
+   }
+   return size;
+}
+//---------------------------------------------------------------------------
+unsigned AggregatedIndexScan::firstBatch(Batch& batch)
+   // Produce the first batch of tuples
+{
+   observedOutputCardinality=0;
+
+   // Bound leading values limit the scan, a bound second value alone is filtered
+   batchValue1=value1->value;
+   batchValue2=value2->value;
+   batchPrefix=bound1?(bound2?2:1):0;
+   batchFilter2=bound2&&(batchPrefix<2);
+
+   // A morsel starts behind the last entry of its predecessor and ends with its own last entry
+   bool hasMorsel=~morsel;
+   batchLimited=hasMorsel&&(morsel<morselBounds.size());
+   if (batchLimited)
+      batchLimit=morselBounds[morsel];
+
+   bool found;
+   if (hasMorsel&&morsel) {
+      AggregatedFactsSegment::Pair start=morselBounds[morsel-1];
+      if (~start.value2) start.value2++; else { start.value2=0; start.value1++; }
+      found=scan.first(facts,start.value1,start.value2);
+   } else if (batchPrefix) {
+      found=scan.first(facts,batchValue1,(batchPrefix>1)?batchValue2:0);
+   } else {
+      found=scan.first(facts);
+   }
+   batchesDone=!found;
+   return fillBatch(batch,true);
+}
+//---------------------------------------------------------------------------
+unsigned AggregatedIndexScan::nextBatch(Batch& batch)
+   // Produce the next batch of tuples
+{
+   return fillBatch(batch,false);
+}
+//---------------------------------------------------------------------------
+bool AggregatedIndexScan::supportsBatches() const
+   // Are batches produced natively?
+{
+   return true;
+}
+//---------------------------------------------------------------------------
+void AggregatedIndexScan::getAsyncInputCandidates(Scheduler& scheduler)
    // Register parts of the tree that can be executed asynchronous
 {
+   scheduler.registerMorselSource(splitter);
 }
 //---------------------------------------------------------------------------
 AggregatedIndexScan* AggregatedIndexScan::create(Database& db,Database::DataOrder order,Register* subject,bool subjectBound,Register* predicate,bool predicateBound,Register* object,bool objectBound,double expectedOutputCardinality)
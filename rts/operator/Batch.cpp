@@ -0,0 +1,69 @@
+#include "rts/operator/Batch.hpp"
+#include "rts/runtime/Runtime.hpp"
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+Batch::Batch()
+   : counts(capacity),size(0)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+Batch::~Batch()
+   // Destructor
+{
+}
+//---------------------------------------------------------------------------
+void Batch::setRegisters(const vector<Register*>& registers)
+   // Set the registers
+{
+   this->registers.clear();
+   for (vector<Register*>::const_iterator iter=registers.begin(),limit=registers.end();iter!=limit;++iter)
+      if (!~findColumn(*iter))
+         this->registers.push_back(*iter);
+   values.resize(this->registers.size()*capacity);
+   size=0;
+}
+//---------------------------------------------------------------------------
+unsigned Batch::findColumn(const Register* reg) const
+   // Find the column of a register
+{
+   for (unsigned index=0,limit=registers.size();index<limit;index++)
+      if (registers[index]==reg)
+         return index;
+   return ~0u;
+}
+//---------------------------------------------------------------------------
+void Batch::fillConstant(unsigned column)
+   // Fill a column with the current value of its register
+{
+   unsigned value=registers[column]->value;
+   unsigned* target=getColumn(column);
+   for (unsigned index=0;index<size;index++)
+      target[index]=value;
+}
+//---------------------------------------------------------------------------
+void Batch::append(unsigned count)
+   // Append a tuple from the current register values
+{
+   for (unsigned index=0,limit=registers.size();index<limit;index++)
+      values[index*capacity+size]=registers[index]->value;
+   counts[size++]=count;
+}
+//---------------------------------------------------------------------------
+void Batch::loadRegisters(unsigned row) const
+   // Copy a tuple into the registers
+{
+   for (unsigned index=0,limit=registers.size();index<limit;index++)
+      registers[index]->value=values[index*capacity+row];
+}
+//---------------------------------------------------------------------------
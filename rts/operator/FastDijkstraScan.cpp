@@ -1,5 +1,6 @@
 #include "rts/operator/FastDijkstraScan.hpp"
 #include "rts/operator/PlanPrinter.hpp"
+#include "rts/dijkstra/PathTraversal.hpp"
 #include "rts/runtime/Runtime.hpp"
 #include "rts/segment/FactsSegment.hpp"
 #include "cts/infra/QueryGraph.hpp"
@@ -57,21 +58,8 @@ unsigned FastDijkstraScan::next()
 //---------------------------------------------------------------------------
 class FastDijkstraScan::DijkstraPrefix: public FastDijkstraScan {
 private:
-	/// comparing nodes by distance to source
-	struct CompareByDistance {
-	    bool operator()(const pair<unsigned,unsigned> &lhs, const pair<unsigned, unsigned> &rhs) {
-	        if (lhs.first == rhs.first)
-	            return lhs.second < rhs.second;
-	        return lhs.first < rhs.first;
-	    }
-	};
 	/// struct to keep predecessors info
-	struct PreviousNode{
-		/// node id
-		unsigned node;
-		/// edge id
-		unsigned edge;
-	};
+	typedef PathTraversal::Parent PreviousNode;
 	/// Struct to keep values of path predicates on bfs tree prefix
 	struct PredicateOnNode{
 		// value on current node
@@ -96,20 +84,8 @@ private:
 	map<unsigned,PredicateOnNode> predicates;
 	/// cutoff for length, if specified
 	unsigned lenmax;
-	/// Neighbors
-	vector<pair<unsigned,unsigned> > neighbors;
-	/// Iterator on neighbors
-	vector<pair<unsigned, unsigned> >::const_iterator iter;
-	/// Dijkstra's settled nodes
-	set<unsigned> settledNodes;
-	/// Dijkstra's predecessors
-	map<unsigned,PreviousNode> predecessors;
-	/// Dijkstra's working set
-	set<pair<unsigned, unsigned>,CompareByDistance > workingSet;
-	/// Dijkstra's shortest distances
-	map<unsigned,unsigned> shortestDistances;
-	/// Find neighbors (according to scan order) of given order
-	void findNeighbors(unsigned node);
+	/// Dijkstra's distances, predecessors, settled nodes and working set
+	PathTraversal traversal;
 	/// Dijkstra's init
 	void init();
 	/// is the node handled already?
@@ -117,19 +93,14 @@ private:
 	/// get the shortest dist from the start to the node
 	unsigned getShortestDist(unsigned node);
 
-	void getNeighbors();
-	void updateNeighbors(unsigned node,unsigned nodeIndex);
+	/// Reach the neighbors of the current level
+	void expandLevel();
 	void findConstraints(const QueryGraph::Filter& filter, Constraints& constr);
-	struct Neighbors{
-		vector<vector<pair<unsigned,unsigned> > > connections;
-		vector<unsigned> ids;
-	};
-	Neighbors n;
-	set<unsigned> curNodes;
-	set<unsigned>::iterator curnodes_iter;
+	/// The neighbors of the current level
+	vector<PathTraversal::Discovery> found;
+	vector<unsigned> curNodes;
 	unsigned curIndex;
 	Database& db;
-	unsigned workingsetmax;
 	bool output;
 	Constraints constr;
 	set<unsigned> startNodes;
@@ -148,110 +119,25 @@ public:
 	bool evaledge(const QueryGraph::Filter& filter,PreviousNode& node,PredicateOnNode& predicate,unsigned curNode);
 };
 //---------------------------------------------------------------------------
-void FastDijkstraScan::DijkstraPrefix::findNeighbors(unsigned node) {
-	// get the neighbors according to Database Order
-	neighbors.clear();
-	FactsSegment::Scan scan1;
-    if (scan1.first(facts, node, 0, 0)) do {
-            if (scan1.getValue1() != node) break;
-            neighbors.push_back(pair<unsigned, unsigned>(scan1.getValue2(), scan1.getValue3()));
-        } while (scan1.next());
-    iter=neighbors.begin();
-}
-//---------------------------------------------------------------------------
-namespace {
-//---------------------------------------------------------------------------
-class ConstantOperator: public Operator{
-	private:
-	/// The  register
-	Register* reg;
-	/// The filter
-	const set<unsigned>& neighbors;
-	set<unsigned>::const_iterator cur;
-
-	public:
-	/// Constructor
-	ConstantOperator(Register* reg,const set<unsigned>& neighbors) : Operator(0),reg(reg),neighbors(neighbors),cur(neighbors.begin()){}
-	/// Destructor
-	~ConstantOperator() { }
-	/// Find the first tuple
-	unsigned first();
-	/// Find the next tuple
-	unsigned next();
-	/// Print the operator
-	void print(PlanPrinter& out);
-	/// Handle a merge hint
-	void addMergeHint(Register* /*l*/,Register* /*r*/) {};
-	/// Register parts of the tree that can be executed asynchronous
-	void getAsyncInputCandidates(Scheduler& /*scheduler*/) {};
-};
-//---------------------------------------------------------------------------
-void ConstantOperator::print(PlanPrinter& out){
-	out.beginOperator("ConstantOperator",expectedOutputCardinality,observedOutputCardinality);
-}
-//---------------------------------------------------------------------------
-unsigned ConstantOperator::first(){
-	return next();
-}
-//---------------------------------------------------------------------------
-unsigned ConstantOperator::next(){
-	if (cur!=neighbors.end()){
-		reg->value=*cur;
-		cur++;
-		return 1;
+void FastDijkstraScan::DijkstraPrefix::expandLevel(){
+	// one pass for the whole level, top-down or bottom-up
+	traversal.discover(db,order,curNodes,found);
+	for (vector<PathTraversal::Discovery>::const_iterator iter=found.begin(),limit=found.end(); iter!=limit; iter++){
+		unsigned node=iter->parent;
+		traversal.reach(iter->node,getShortestDist(node)+1,node,iter->edge);
+		PreviousNode prevnode=traversal.getParent(iter->node);
+		PredicateOnNode p;
+		p.prefixlength=predicates[node].prefixlength+1;
+		p.onprefix=predicates[node].onprefix;
+		if (pathfilter)
+			p.onnode=evaledge(*pathfilter,prevnode,p,iter->node);
+
+		// don't add to the working set nodes that lead to cut-off branches
+		if (!pathfilter || (pathfilter && !constr.cutOff.count(iter->node)))
+			traversal.push(iter->node);
+
+		predicates[iter->node]=p;
 	}
-	return 0;
-}
-//---------------------------------------------------------------------------
-}
-//---------------------------------------------------------------------------
-void FastDijkstraScan::DijkstraPrefix::getNeighbors(){
-	Register reg;
-	Register rs,rp,ro;
-	Register *s=0, *o=0;
-	rs.reset(); rp.reset(); ro.reset();
-	IndexScan* scan1=IndexScan::create(db,order,&rs,false,&rp,false,&ro,false,0);
-
-	ConstantOperator* scan2=new ConstantOperator(&reg,curNodes);
-	vector<Register*> lt,rt;
-
-	// forward or backward search?
-	if (order==Database::Order_Subject_Predicate_Object){
-		s=&rs;
-		o=&ro;
-	}
-	else {
-		s=&ro;
-		o=&rs;
-	}
-
-	rt.push_back(&rp);rt.push_back(o);
-	MergeJoin join(scan2,&reg,lt,scan1,s,rt,0);
-	n.connections.clear();
-	n.connections.resize(curNodes.size());
-	unsigned old=s->value;
-	unsigned i=0;
-	bool firstiter=true;
-
-	for (set<unsigned>::iterator it = curNodes.begin(); it != curNodes.end(); it++)
-		n.ids.push_back(*it);
-
-	if (join.first()) do {
-		if (old==s->value||firstiter){
-		   old=s->value;
-		   while (n.ids[i]!=s->value) i++;
-
-		   n.connections[i].push_back(pair<unsigned,unsigned>(rp.value,o->value));
-		   firstiter=false;
-		}
-		else {
-		   old=s->value;
-		   i++;
-		   while (n.ids[i]!=s->value) i++;
-		   n.connections[i].push_back(pair<unsigned,unsigned>(rp.value,o->value));
-		}
-    } while (join.next());
-
 }
 //---------------------------------------------------------------------------
 void FastDijkstraScan::DijkstraPrefix::findConstraints(const QueryGraph::Filter& filter, FastDijkstraScan::DijkstraPrefix::Constraints& constr){
@@ -270,10 +156,7 @@ void FastDijkstraScan::DijkstraPrefix::findConstraints(const QueryGraph::Filter&
 //---------------------------------------------------------------------------
 void FastDijkstraScan::DijkstraPrefix::init() {
 	// init the computation. Original value of the pathfilter set to false
-	predecessors.clear();
-	workingSet.clear();
-	settledNodes.clear();
-	shortestDistances.clear();
+	traversal.reset();
 	curNodes.clear();
 	startNodes.clear();
 
@@ -289,61 +172,28 @@ void FastDijkstraScan::DijkstraPrefix::init() {
 	cerr<<"StartNodes size: "<<startNodes.size()<<endl;
 
 	for (set<unsigned>::iterator it=startNodes.begin(); it!=startNodes.end(); it++){
-		workingSet.insert(pair<unsigned, unsigned>(0,*it));
-		shortestDistances[*it]=0;
+		traversal.start(*it);
 		PredicateOnNode p; p.onnode=false; p.prefixlength=0;
 		predicates[*it]=p;
-		curNodes.insert(*it);
 	}
-	curnodes_iter=curNodes.begin();
 	curIndex=0;
-	workingsetmax=0;
 	constr.maxlen=0;
 	constr.violated=false;
 	if (pathfilter)
 		findConstraints(*pathfilter, constr);
+	traversal.nextBucket(curNodes);
+	expandLevel();
 	cerr<<"constrains for scan "<<value1->value<<", "<<value3->value<<": "<<constr.containsonly.size()<<endl;
 	output=false;
 }
 //---------------------------------------------------------------------------
 unsigned FastDijkstraScan::DijkstraPrefix::getShortestDist(unsigned node){
-	if (shortestDistances.find(node)!=shortestDistances.end())
-		return shortestDistances[node];
-	return ~0u;
+	return traversal.getDistance(node);
 }
 //---------------------------------------------------------------------------
 bool FastDijkstraScan::DijkstraPrefix::isHandled(unsigned node){
 // the node is "black" in Dijkstra's algo
-	return (settledNodes.find(node)!=settledNodes.end());
-}
-//---------------------------------------------------------------------------
-void FastDijkstraScan::DijkstraPrefix::updateNeighbors(unsigned node,unsigned nodeindex){
-	vector<pair<unsigned,unsigned> >& succ=n.connections[nodeindex];
-	for (vector<pair<unsigned,unsigned> >::iterator iter=succ.begin(),limit=succ.end(); iter!=limit; iter++){
-		if (isHandled(iter->second))
-			continue;
-		unsigned shortDist=getShortestDist(node)+1;
-		unsigned oldShortDist=getShortestDist(iter->second);
-		if (shortDist<oldShortDist) {
-			workingSet.erase(pair<unsigned,unsigned>(oldShortDist,iter->second));
-			shortestDistances[iter->second]=shortDist;
-			PreviousNode prevnode;
-			prevnode.edge=iter->first;
-			prevnode.node=node;
-			PredicateOnNode p;
-			p.prefixlength=predicates[node].prefixlength+1;
-			p.onprefix=predicates[node].onprefix;
-			if (pathfilter)
-				p.onnode=evaledge(*pathfilter,prevnode,p,iter->second);
-
-			// don't add to the working set nodes that lead to cut-off branches
-			if (!pathfilter || (pathfilter && !constr.cutOff.count(iter->second)))
-				workingSet.insert(pair<unsigned,unsigned>(shortDist,iter->second));
-
-			predicates[iter->second]=p;
-			predecessors[iter->second]=prevnode;
-		}
-	}
+	return traversal.isSettled(node);
 }
 //---------------------------------------------------------------------------
 unsigned FastDijkstraScan::DijkstraPrefix::first(){
@@ -402,79 +252,35 @@ bool FastDijkstraScan::DijkstraPrefix::evaledge(const QueryGraph::Filter& filter
 unsigned FastDijkstraScan::DijkstraPrefix::next()
 	// Return next tuple
 {
-	if (curnodes_iter==curNodes.begin()){
-		cerr<<"AAA"<<endl;
-		getNeighbors();
-
-	}
-
 	// if it's a point-to-point search and we've already found the result
 	if (output && bound3)
 		return 0;
 	else
 		output=false;
 
-	while (!workingSet.empty()) {
-		if (curnodes_iter==curNodes.end() && !workingSet.empty()){
+	while (true) {
+		if (curIndex==curNodes.size()){
 			if (constr.violated)
 				return 0;
-			curNodes.clear();
-			// copying the neighbors.
-			for (unsigned i=0; i<n.connections.size(); i++){
-				for (unsigned j=0; j<n.connections[i].size(); j++){
-					if (!isHandled((n.connections[i])[j].second) && !constr.cutOff.count((n.connections[i])[j].second))
-						curNodes.insert((n.connections[i])[j].second);
-				}
-			}
-			n.connections.clear();
-			n.ids.clear();
+			// the working set is processed level by level
+			if (!traversal.nextBucket(curNodes))
+				break;
 			curIndex=0;
 
 			Timestamp t1;
-/*
-			if (count>2)
-				return 0;
-			count++;
-*/
-
-			getNeighbors();
+			expandLevel();
 			Timestamp t2;
 			cerr<<"getting neighbors: "<<t2-t1<<" ms"<<endl;
 			cerr<<"curNodes: "<<curNodes.size()<<endl;
-			curnodes_iter=curNodes.begin();
 		}
 
-//	for (set<pair<unsigned, unsigned>,CompareByDistance >::iterator itw=workingSet.begin(); itw!=workingSet.end(); itw++)
-//		cerr<<"("<<(*itw).first<<", "<<(*itw).second<<") ";
-//	cerr<<endl;
-
-		while (curnodes_iter!=curNodes.end()){
-			unsigned curNode=*curnodes_iter;
-			unsigned curDist=getShortestDist(curNode); // we need to store it in curNodes!!!
-
-			workingSet.erase(pair<unsigned,unsigned>(curDist,curNode));
-			curnodes_iter++;
-
-			if (isHandled(curNode)){
-				curIndex++;
-				continue;
-			}
-
-			updateNeighbors(curNode,curIndex);
-
-			if (workingSet.size()>workingsetmax)
-				workingsetmax=workingSet.size();
+		while (curIndex<curNodes.size()){
+			unsigned curNode=curNodes[curIndex];
 			curIndex++;
 
-			settledNodes.insert(curNode);
-
 			// this is not point-to-point search
 			if (!bound3){
 				value3->value=curNode;
-/*
-				cerr<<value3->value<<endl;
-				cerr<<predicates[value3->value].onnode<<endl;
-*/
 			}
 			if (!pathfilter){
 				// no pathfilter specified, output every reachable node
@@ -488,16 +294,14 @@ unsigned FastDijkstraScan::DijkstraPrefix::next()
 				// this is a point-to-point search and current value does not pass
 				output=false;
 			}
-			unsigned prev=0;
 			if (output) {
-//				cerr<<value3->value<<endl;
 				observedOutputCardinality++;
 				// form the path from the end to the beginning
 				value2->value.clear();
 
-				while (predecessors.find(curNode)!=predecessors.end()){
-					PreviousNode node=predecessors[curNode];
-					prev=node.node;
+				while (traversal.getParent(curNode).node!=~0u){
+					PreviousNode node=traversal.getParent(curNode);
+					unsigned prev=node.node;
 					value2->value.push_front(node.edge);
 					if (prev!=value1->value)
 						value2->value.push_front(prev);
@@ -508,13 +312,7 @@ unsigned FastDijkstraScan::DijkstraPrefix::next()
 		}
 	}
 
-//	cerr<<"settled nodes: "<<settledNodes.size()<<endl;
-//	cerr<<"max working set size: "<<workingsetmax<<endl;
-//	for (unsigned j=0; j<n.connections.size(); j++){
-//		cerr<<"node "<<lookupLiteral(db,n.ids[j])<<" has "<<n.connections[j].size()<<" neighbors"<<endl;
-//	//		for (unsigned k=0; k<n.connections[j].size(); k++)
-//	//			cerr<<"    "<<lookupLiteral(db,(n.connections[j])[k].first)<<" "<<lookupLiteral(db,(n.connections[j])[k].second)<<endl;
-//	}
+//	cerr<<"settled nodes: "<<traversal.getReached().size()<<endl;
 
     return 0;
 }
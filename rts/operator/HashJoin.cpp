@@ -1,6 +1,8 @@
 #include "rts/operator/HashJoin.hpp"
 #include "rts/operator/PlanPrinter.hpp"
 #include "rts/runtime/Runtime.hpp"
+#include <algorithm>
+#include <cassert>
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -13,177 +15,310 @@
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
-static inline unsigned hash1(unsigned key,unsigned hashTableSize) { return key&(hashTableSize-1); }
-static inline unsigned hash2(unsigned key,unsigned hashTableSize) { return hashTableSize+((key^(key>>3))&(hashTableSize-1)); }
+/// The desired number of build entries per partition
+static const unsigned partitionSize = 4096;
+/// The maximum number of bits selecting the partition
+static const unsigned maxPartitionBits = 10;
+/// The first tag bit of a directory entry. Pointers use the lower 48 bits, as on x86-64 and AArch64
+static const unsigned tagShift = 48;
+/// The pointer bits of a directory entry
+static const uint64_t pointerMask = (static_cast<uint64_t>(1)<<tagShift)-1;
 //---------------------------------------------------------------------------
-void HashJoin::BuildHashTable::run()
-   // Build the hash table
+static inline unsigned hashKey(unsigned key)
+   // Hash a join key
 {
-   if (done) return; // XXX support repeated executions under nested loop joins etc!
+   key^=key>>16; key*=0x85ebca6b;
+   key^=key>>13; key*=0xc2b2ae35;
+   key^=key>>16;
+   return key;
+}
+//---------------------------------------------------------------------------
+static inline unsigned partitionOf(unsigned hash,unsigned partitionBits) { return static_cast<unsigned>((static_cast<uint64_t>(hash)<<partitionBits)>>32); }
+static inline uint64_t tagOf(unsigned key) { return static_cast<uint64_t>(1)<<(tagShift+((key*2654435761u)>>28)); }
+//---------------------------------------------------------------------------
+void HashJoin::BuildHashTable::consumeMorsel(unsigned /*morsel*/)
+   // Consume a morsel of the build side
+{
+   join.readBuildInput();
+}
+//---------------------------------------------------------------------------
+unsigned HashJoin::BuildHashTable::preparePartitions(const vector<Scheduler::PipelineSink*>& workers)
+   // Prepare building the partitions
+{
+   join.buildWorkers.clear();
+   for (vector<Scheduler::PipelineSink*>::const_iterator iter=workers.begin(),limit=workers.end();iter!=limit;++iter)
+      join.buildWorkers.push_back(&static_cast<BuildHashTable*>(*iter)->join);
+   return join.partitions.size();
+}
+//---------------------------------------------------------------------------
+void HashJoin::BuildHashTable::finishPartition(unsigned partition)
+   // Build a partition from the entries of all workers
+{
+   join.buildPartition(partition,join.buildWorkers);
+}
+//---------------------------------------------------------------------------
+void HashJoin::BuildHashTable::finishPipeline(const vector<Scheduler::PipelineSink*>& workers)
+   // Share the hash table with all workers
+{
+   // Combine the observed domains
+   for (unsigned worker=1;worker<workers.size();worker++) {
+      HashJoin& other=static_cast<BuildHashTable*>(workers[worker])->join;
+      for (unsigned index=0,limit=join.observedDomains.size();index<limit;++index)
+         join.observedDomains[index].merge(other.observedDomains[index]);
+   }
+
+   // Share the table and update the domains of all workers
+   for (unsigned worker=0;worker<workers.size();worker++) {
+      HashJoin& other=static_cast<BuildHashTable*>(workers[worker])->join;
+      other.table=&join.partitions;
+      other.restrictDomains(join.observedDomains);
+      other.built=true;
+   }
+}
+//---------------------------------------------------------------------------
+HashJoin::HashJoin(Operator* left,Register* leftValue,const vector<Register*>& leftTail,Operator* right,Register* rightValue,const vector<Register*>& rightTail,double expectedOutputCardinality)
+   : Operator(expectedOutputCardinality),left(left),right(right),leftValue(leftValue),rightValue(rightValue),
+     leftTail(leftTail),rightTail(rightTail),entryPool(leftTail.size()*sizeof(unsigned)),
+     partitionBits(0),table(&partitions),built(false),buildHashTableTask(*this)
+   // Constructor
+{
+   // Partition the build side by its expected size
+   for (double size=left->getExpectedOutputCardinality();(size>partitionSize)&&(partitionBits<maxPartitionBits);size/=2)
+      partitionBits++;
+   partitions.resize(1<<partitionBits);
+
+   // The join attribute is the first column of the probe side
+   vector<Register*> registers;
+   registers.push_back(rightValue);
+   registers.insert(registers.end(),rightTail.begin(),rightTail.end());
+   probeBatch.setRegisters(registers);
 
    // Prepare relevant domain informations
-   Register* leftValue=join.leftValue;
-   vector<Register*> domainRegs;
    if (leftValue->domain)
       domainRegs.push_back(leftValue);
-   for (vector<Register*>::const_iterator iter=join.leftTail.begin(),limit=join.leftTail.end();iter!=limit;++iter)
+   for (vector<Register*>::const_iterator iter=leftTail.begin(),limit=leftTail.end();iter!=limit;++iter)
       if ((*iter)->domain)
          domainRegs.push_back(*iter);
-   vector<ObservedDomainDescription> observedDomains;
-   observedDomains.resize(domainRegs.size());
-
-   // Build the hash table from the left side
-   unsigned hashTableSize = 1024;
-   unsigned tailLength=join.leftTail.size();
-   join.hashTable.clear();
-   join.hashTable.resize(2*hashTableSize);
-   for (unsigned leftCount=join.left->first();leftCount;leftCount=join.left->next()) {
-      // Check the domain first
-      bool joinCandidate=true;
-      for (unsigned index=0,limit=domainRegs.size();index<limit;++index) {
-         if (!domainRegs[index]->domain->couldQualify(domainRegs[index]->value)) {
-            joinCandidate=false;
-            break;
-         }
-         observedDomains[index].add(domainRegs[index]->value);
+   observedDomains.assign(domainRegs.size(),ObservedDomainDescription(left->getExpectedOutputCardinality()));
+}
+//---------------------------------------------------------------------------
+HashJoin::~HashJoin()
+   // Destructor
+{
+   delete left;
+   delete right;
+}
+//---------------------------------------------------------------------------
+void HashJoin::buildPartition(unsigned partition,const vector<HashJoin*>& workers)
+   // Build a partition from the entries of the workers
+{
+   // Size the directory for two keys per slot on average
+   Partition& target=partitions[partition];
+   unsigned entryCount=0;
+   for (vector<HashJoin*>::const_iterator iter=workers.begin(),limit=workers.end();iter!=limit;++iter)
+      entryCount+=(*iter)->partitions[partition].entryCount;
+   unsigned slots=1;
+   while ((2*slots)<entryCount)
+      slots*=2;
+   unsigned mask=slots-1;
+   target.directory.assign(slots,0);
+
+   // Count the entries per slot. The buckets of a slot are consecutive and can hold all its entries
+   for (vector<HashJoin*>::const_iterator iter=workers.begin(),limit=workers.end();iter!=limit;++iter)
+      for (Entry* e=(*iter)->partitions[partition].entries;e;e=e->next)
+         target.directory[hashKey(e->key)&mask]++;
+   unsigned bucketCount=0;
+   for (vector<uint64_t>::iterator iter=target.directory.begin(),limit=target.directory.end();iter!=limit;++iter)
+      if (*iter) {
+         unsigned count=(*iter);
+         (*iter)=bucketCount+1;
+         bucketCount+=(count+bucketSlots-1)/bucketSlots;
       }
-      if (!joinCandidate)
-         continue;
-      // Compute the slots
-      unsigned leftKey=leftValue->value;
-      unsigned slot1=hash1(leftKey,hashTableSize),slot2=hash2(leftKey,hashTableSize);
-
-      // Scan if the entry already exists
-      Entry* e=join.hashTable[slot1];
-      if ((!e)||(e->key!=leftKey))
-         e=join.hashTable[slot2];
-      if (e&&(e->key==leftKey)) {
-         unsigned ofs=(e==join.hashTable[slot1])?slot1:slot2;
-         bool match=false;
-         for (Entry* iter=e;iter;iter=iter->next)
-            if (leftKey==iter->key) {
-               // Tuple already in the table?
-               match=true;
-               for (unsigned index2=0;index2<tailLength;index2++)
-                  if (join.leftTail[index2]->value!=iter->values[index2]) {
-                     match=false;
-                     break;
-                  }
-               // Then aggregate
-               if (match) {
-                  iter->count+=leftCount;
+   target.buckets.assign(bucketCount,Bucket());
+   for (vector<uint64_t>::iterator iter=target.directory.begin(),limit=target.directory.end();iter!=limit;++iter)
+      if (*iter) {
+         uint64_t bucket=reinterpret_cast<uintptr_t>(&target.buckets[(*iter)-1]);
+         // The tags occupy the upper bits
+         assert(!(bucket&~pointerMask));
+         (*iter)=bucket;
+      }
+
+   // Insert the entries
+   unsigned tailLength=leftTail.size();
+   for (vector<HashJoin*>::const_iterator iter=workers.begin(),limit=workers.end();iter!=limit;++iter) {
+      Partition& source=(*iter)->partitions[partition];
+      for (Entry* e=source.entries,*next;e;e=next) {
+         next=e->next;
+         uint64_t& slot=target.directory[hashKey(e->key)&mask];
+         slot|=tagOf(e->key);
+
+         // Find the key within the buckets of the slot
+         Bucket* b=reinterpret_cast<Bucket*>(static_cast<uintptr_t>(slot&pointerMask));
+         Entry** chain=0;
+         while (true) {
+            for (unsigned index=0;index<b->used;index++)
+               if (b->keys[index]==e->key) {
+                  chain=b->entries+index;
                   break;
                }
-            }
-         if (match)
+            if (chain||(b->used<bucketSlots))
+               break;
+            if (!b->next)
+               b->next=b+1;
+            b=b->next;
+         }
+
+         // A new key?
+         if (!chain) {
+            e->next=0;
+            b->keys[b->used]=e->key;
+            b->entries[b->used++]=e;
             continue;
+         }
 
-         // Append to the current bucket
-         e=join.entryPool.alloc();
-         e->next=join.hashTable[ofs];
-         join.hashTable[ofs]=e;
-         e->key=leftKey;
-         e->count=leftCount;
-         for (unsigned index2=0;index2<tailLength;index2++)
-            e->values[index2]=join.leftTail[index2]->value;
-         continue;
-      }
+         // Tuple already in the table? Then aggregate
+         Entry* match=*chain;
+         for (;match;match=match->next) {
+            unsigned index=0;
+            for (;index<tailLength;index++)
+               if (e->values[index]!=match->values[index])
+                  break;
+            if (index==tailLength)
+               break;
+         }
+         if (match) {
+            match->count+=e->count;
+            continue;
+         }
 
-      // Create a new tuple
-      e=join.entryPool.alloc();
-      e->next=0;
-      e->key=leftKey;
-      e->count=leftCount;
-      for (unsigned index2=0;index2<tailLength;index2++)
-         e->values[index2]=join.leftTail[index2]->value;
-
-      // And insert it
-      join.insert(e);
-      hashTableSize=join.hashTable.size()/2;
+         // Append to the chain of the key
+         e->next=*chain;
+         *chain=e;
+      }
+      source.entries=0;
+      source.entryCount=0;
    }
-
-   // Update the domains
-   for (unsigned index=0,limit=domainRegs.size();index<limit;++index)
-      domainRegs[index]->domain->restrictTo(observedDomains[index]);
-
-   done=true;
 }
 //---------------------------------------------------------------------------
-void HashJoin::ProbePeek::run()
-   // Produce the first tuple from the probe side
+HashJoin::Entry* HashJoin::lookup(unsigned key)
+   // Search an entry in the hash table
 {
-   if (done) return; // XXX support repeated executions under nested loop joins etc!
+   unsigned hash=hashKey(key);
+   const Partition& partition=(*table)[partitionOf(hash,partitionBits)];
+   uint64_t slot=partition.directory[hash&(partition.directory.size()-1)];
 
-   count=join.right->first();
-   done=true;
+   // Reject most misses by the tags
+   if (!(slot&tagOf(key)))
+      return 0;
+   for (const Bucket* b=reinterpret_cast<const Bucket*>(static_cast<uintptr_t>(slot&pointerMask));b;b=b->next)
+      for (unsigned index=0;index<b->used;index++)
+         if (b->keys[index]==key)
+            return b->entries[index];
+   return 0;
 }
 //---------------------------------------------------------------------------
-HashJoin::HashJoin(Operator* left,Register* leftValue,const vector<Register*>& leftTail,Operator* right,Register* rightValue,const vector<Register*>& rightTail,double hashPriority,double probePriority,double expectedOutputCardinality)
-   : Operator(expectedOutputCardinality),left(left),right(right),leftValue(leftValue),rightValue(rightValue),
-     leftTail(leftTail),rightTail(rightTail),entryPool(leftTail.size()*sizeof(unsigned)),
-     buildHashTableTask(*this),probePeekTask(*this),hashPriority(hashPriority),probePriority(probePriority)
-   // Constructor
+void HashJoin::readBuildInput()
+   // Read the build side into the partitions
 {
+   // Read the left side in batches
+   Batch batch;
+   vector<Register*> registers;
+   registers.push_back(leftValue);
+   registers.insert(registers.end(),leftTail.begin(),leftTail.end());
+   batch.setRegisters(registers);
+   const unsigned* keys=batch.getColumn(0);
+   vector<const unsigned*> tails,domainValues;
+   for (vector<Register*>::const_iterator iter=leftTail.begin(),limit=leftTail.end();iter!=limit;++iter)
+      tails.push_back(batch.getColumn(batch.findColumn(*iter)));
+   for (vector<Register*>::const_iterator iter=domainRegs.begin(),limit=domainRegs.end();iter!=limit;++iter)
+      domainValues.push_back(batch.getColumn(batch.findColumn(*iter)));
+
+   // Partition the left side
+   unsigned tailLength=leftTail.size();
+   for (unsigned size=left->firstBatch(batch);size;size=left->nextBatch(batch)) {
+      const unsigned* counts=batch.getCounts();
+      for (unsigned row=0;row<size;row++) {
+         // Check the domain first
+         bool joinCandidate=true;
+         for (unsigned index=0,limit=domainRegs.size();index<limit;++index) {
+            if (!domainRegs[index]->domain->couldQualify(domainValues[index][row])) {
+               joinCandidate=false;
+               break;
+            }
+            observedDomains[index].add(domainValues[index][row]);
+         }
+         if (!joinCandidate)
+            continue;
+
+         // Create a new tuple
+         Entry* e=entryPool.alloc();
+         e->key=keys[row];
+         e->count=counts[row];
+         for (unsigned index=0;index<tailLength;index++)
+            e->values[index]=tails[index][row];
+
+         // And remember it in its partition. Duplicates are aggregated when the partition is built
+         Partition& partition=partitions[partitionOf(hashKey(e->key),partitionBits)];
+         e->next=partition.entries;
+         partition.entries=e;
+         partition.entryCount++;
+      }
+   }
 }
 //---------------------------------------------------------------------------
-HashJoin::~HashJoin()
-   // Destructor
+void HashJoin::restrictDomains(const vector<ObservedDomainDescription>& domains)
+   // Restrict the domains of the build attributes to the observed values
 {
-   delete left;
-   delete right;
+   for (unsigned index=0,limit=domainRegs.size();index<limit;++index)
+      domainRegs[index]->domain->restrictTo(domains[index]);
 }
 //---------------------------------------------------------------------------
-void HashJoin::insert(Entry* e)
-   // Insert into the hash table
+bool HashJoin::startProbe()
+   // Read the first probe batch
 {
-   unsigned hashTableSize=hashTable.size()/2;
-   // Try to insert
-   bool firstTable=true;
-   for (unsigned index=0;index<hashTableSize;index++) {
-      unsigned slot=firstTable?hash1(e->key,hashTableSize):hash2(e->key,hashTableSize);
-      swap(e,hashTable[slot]);
-      if (!e)
-         return;
-      firstTable=!firstTable;
+   // Build the hash table if not already done
+   if (!built) { // XXX support repeated executions under nested loop joins etc!
+      readBuildInput();
+      vector<HashJoin*> workers;
+      workers.push_back(this);
+      for (unsigned index=0;index<partitions.size();index++)
+         buildPartition(index,workers);
+      restrictDomains(observedDomains);
+      built=true;
    }
 
-   // No place found, rehash
-   vector<Entry*> oldTable;
-   oldTable.resize(4*hashTableSize);
-   swap(hashTable,oldTable);
-   for (vector<Entry*>::const_iterator iter=oldTable.begin(),limit=oldTable.end();iter!=limit;++iter)
-      if (*iter)
-         insert(*iter);
-   insert(e);
+   // Read the first batch from the right side
+   if (!right->firstBatch(probeBatch))
+      return false;
+
+   // Setup the lookup
+   probePos=0;
+   if ((hashTableIter=lookup(probeBatch.getColumn(0)[0]))!=0)
+      return true;
+   return nextProbe();
 }
 //---------------------------------------------------------------------------
-HashJoin::Entry* HashJoin::lookup(unsigned key)
-   // Search an entry in the hash table
+bool HashJoin::nextProbe()
+   // Move to the next probe tuple with matches
 {
-   unsigned hashTableSize=hashTable.size()/2;
-   Entry* e=hashTable[hash1(key,hashTableSize)];
-   if (e&&(e->key==key))
-      return e;
-   e=hashTable[hash2(key,hashTableSize)];
-   if (e&&(e->key==key))
-      return e;
-   return 0;
+   while (true) {
+      if ((++probePos)>=probeBatch.getSize()) {
+         if (!right->nextBatch(probeBatch))
+            return false;
+         probePos=0;
+      }
+      if ((hashTableIter=lookup(probeBatch.getColumn(0)[probePos]))!=0)
+         return true;
+   }
 }
 //---------------------------------------------------------------------------
 unsigned HashJoin::first()
    // Produce the first tuple
 {
    observedOutputCardinality=0;
-   // Build the hash table if not already done
-   buildHashTableTask.run();
-
-   // Read the first tuple from the right side
-   probePeekTask.run();
-   if ((rightCount=probePeekTask.count)==0)
+   if (!startProbe())
       return false;
-
-   // Setup the lookup
-   hashTableIter=lookup(rightValue->value);
+   probeBatch.loadRegisters(probePos);
 
    return next();
 }
@@ -191,26 +326,92 @@ unsigned HashJoin::first()
 unsigned HashJoin::next()
    // Produce the next tuple
 {
-   // Repeat until a match is found
-   while (true) {
-      // Still scanning the hash table?
-      for (;hashTableIter;hashTableIter=hashTableIter->next) {
-         unsigned leftCount=hashTableIter->count;
-         leftValue->value=hashTableIter->key;
-         for (unsigned index=0,limit=leftTail.size();index<limit;++index)
-            leftTail[index]->value=hashTableIter->values[index];
-         hashTableIter=hashTableIter->next;
-
-         unsigned count=leftCount*rightCount;
-         observedOutputCardinality+=count;
-         return count;
+   // Find the next probe tuple with matches
+   if (!hashTableIter) {
+      if (!nextProbe())
+         return false;
+      probeBatch.loadRegisters(probePos);
+   }
+
+   // Produce the next match
+   Entry* e=hashTableIter;
+   hashTableIter=e->next;
+   leftValue->value=e->key;
+   for (unsigned index=0,limit=leftTail.size();index<limit;++index)
+      leftTail[index]->value=e->values[index];
+
+   unsigned count=e->count*probeBatch.getCounts()[probePos];
+   observedOutputCardinality+=count;
+   return count;
+}
+//---------------------------------------------------------------------------
+unsigned HashJoin::firstBatch(Batch& batch)
+   // Produce the first batch of tuples
+{
+   observedOutputCardinality=0;
+   batchesDone=!startProbe();
+
+   return nextBatch(batch);
+}
+//---------------------------------------------------------------------------
+unsigned HashJoin::nextBatch(Batch& batch)
+   // Produce the next batch of tuples
+{
+   batch.clear();
+   if (batchesDone)
+      return 0;
+
+   // Find the sources of the output columns. Left values come from the hash entries, with ~0u denoting the key
+   vector<pair<unsigned*,unsigned> > leftColumns;
+   vector<pair<unsigned*,const unsigned*> > rightColumns;
+   vector<unsigned> constantColumns;
+   for (unsigned column=0,limit=batch.getColumnCount();column<limit;column++) {
+      Register* reg=batch.getRegisters()[column];
+      unsigned* target=batch.getColumn(column);
+      if (reg==leftValue) {
+         leftColumns.push_back(pair<unsigned*,unsigned>(target,~0u));
+         continue;
       }
+      vector<Register*>::const_iterator pos=find(leftTail.begin(),leftTail.end(),reg);
+      if (pos!=leftTail.end()) {
+         leftColumns.push_back(pair<unsigned*,unsigned>(target,pos-leftTail.begin()));
+         continue;
+      }
+      unsigned probeColumn=probeBatch.findColumn(reg);
+      if (~probeColumn)
+         rightColumns.push_back(pair<unsigned*,const unsigned*>(target,probeBatch.getColumn(probeColumn))); else
+         constantColumns.push_back(column);
+   }
 
-      // Read the next tuple from the right
-      if ((rightCount=right->next())==0)
-         return false;
-      hashTableIter=lookup(rightValue->value);
+   // Produce the matches
+   unsigned* counts=batch.getCounts();
+   unsigned size=0;
+   while (size<Batch::capacity) {
+      if ((!hashTableIter)&&(!nextProbe())) {
+         batchesDone=true;
+         break;
+      }
+      Entry* e=hashTableIter;
+      hashTableIter=e->next;
+      for (vector<pair<unsigned*,unsigned> >::const_iterator iter=leftColumns.begin(),limit=leftColumns.end();iter!=limit;++iter)
+         (*iter).first[size]=(~(*iter).second)?e->values[(*iter).second]:e->key;
+      for (vector<pair<unsigned*,const unsigned*> >::const_iterator iter=rightColumns.begin(),limit=rightColumns.end();iter!=limit;++iter)
+         (*iter).first[size]=(*iter).second[probePos];
+      unsigned count=e->count*probeBatch.getCounts()[probePos];
+      counts[size++]=count;
+      observedOutputCardinality+=count;
    }
+   batch.setSize(size);
+
+   for (vector<unsigned>::const_iterator iter=constantColumns.begin(),limit=constantColumns.end();iter!=limit;++iter)
+      batch.fillConstant(*iter);
+   return size;
+}
+//---------------------------------------------------------------------------
+bool HashJoin::supportsBatches() const
+   // Are batches produced natively?
+{
+   return left->supportsBatches()&&right->supportsBatches();
 }
 //---------------------------------------------------------------------------
 void HashJoin::print(PlanPrinter& out)
@@ -234,12 +435,10 @@ void HashJoin::addMergeHint(Register* /*reg1*/,Register* /*reg2*/)
 void HashJoin::getAsyncInputCandidates(Scheduler& scheduler)
    // Register parts of the tree that can be executed asynchronous
 {
-   unsigned p1=scheduler.getRegisteredPoints();
+   scheduler.beginPipeline();
    left->getAsyncInputCandidates(scheduler);
-   scheduler.registerAsyncPoint(buildHashTableTask,0,hashPriority,p1);
+   scheduler.endPipeline(buildHashTableTask);
 
-   unsigned p2=scheduler.getRegisteredPoints();
    right->getAsyncInputCandidates(scheduler);
-   scheduler.registerAsyncPoint(probePeekTask,1,probePriority,p2);
 }
 //---------------------------------------------------------------------------
@@ -1,4 +1,5 @@
 #include "rts/operator/IndexScan.hpp"
+#include "rts/operator/Batch.hpp"
 #include "rts/operator/PlanPrinter.hpp"
 #include "rts/runtime/Runtime.hpp"
 //---------------------------------------------------------------------------
@@ -221,9 +222,30 @@ void IndexScan::Hint::next(unsigned& value1,unsigned& value2,unsigned& value3)
    }
 }
 //---------------------------------------------------------------------------
+unsigned IndexScan::Splitter::prepareMorsels(unsigned maxMorsels)
+   // Split the scan into morsels
+{
+   // Bound leading values limit the range
+   unsigned prefix=scan.bound1?(scan.bound2?(scan.bound3?3:2):1):0;
+   FactsSegment::Triple from,to;
+   from.value1=(prefix>0)?scan.value1->value:0; to.value1=(prefix>0)?scan.value1->value:~0u;
+   from.value2=(prefix>1)?scan.value2->value:0; to.value2=(prefix>1)?scan.value2->value:~0u;
+   from.value3=(prefix>2)?scan.value3->value:0; to.value3=(prefix>2)?scan.value3->value:~0u;
+
+   scan.facts.splitRange(from,to,maxMorsels,Scheduler::minMorselPages,scan.morselBounds);
+   scan.morsel=~0u;
+   return scan.morselBounds.size()+1;
+}
+//---------------------------------------------------------------------------
+void IndexScan::Splitter::selectMorsel(unsigned morsel)
+   // Restrict the next scans to a morsel
+{
+   scan.morsel=morsel;
+}
+//---------------------------------------------------------------------------
 IndexScan::IndexScan(Database& db,Database::DataOrder order,Register* value1,bool bound1,Register* value2,bool bound2,Register* value3,bool bound3,double expectedOutputCardinality)
    : Operator(expectedOutputCardinality),value1(value1),value2(value2),value3(value3),bound1(bound1),bound2(bound2),bound3(bound3),facts(db.getFacts(order)),order(order),
-     scan(disableSkipping?0:&hint),hint(*this)
+     scan(disableSkipping?0:&hint),hint(*this),splitter(*this),morsel(~0u)
    // Constructor
 {
 }
@@ -276,9 +298,127 @@ void IndexScan::addMergeHint(Register* reg1,Register* reg2)
    handleHints(reg1,reg2,value3,merge3);
 }
 //---------------------------------------------------------------------------
-void IndexScan::getAsyncInputCandidates(Scheduler& /*scheduler*/)
+unsigned IndexScan::fillBatch(Batch& batch,bool hasCurrent)
+   // Produce a batch
+{
+   batch.clear();
+   if (batchesDone)
+      return 0;
+
+   // Find the columns of the triple values, all other registers are constant
+   unsigned* target1=0,*target2=0,*target3=0;
+   for (unsigned column=0,limit=batch.getColumnCount();column<limit;column++) {
+      Register* reg=batch.getRegisters()[column];
+      if (reg==value1) target1=batch.getColumn(column); else
+      if (reg==value2) target2=batch.getColumn(column); else
+      if (reg==value3) target3=batch.getColumn(column);
+   }
+
+   // Values outside the domains published by hash join build sides cannot join
+   const DomainDescription* domain1=0,*domain2=0,*domain3=0;
+   if (!disableSkipping) {
+      domain1=value1->domain; domain2=value2->domain; domain3=value3->domain;
+   }
+
+   // Scan the triples
+   unsigned* counts=batch.getCounts();
+   unsigned size=0;
+   while (size<Batch::capacity) {
+      if (hasCurrent) {
+         hasCurrent=false;
+      } else if (!scan.next()) {
+         batchesDone=true;
+         break;
+      }
+      unsigned v1=scan.getValue1(),v2=scan.getValue2(),v3=scan.getValue3();
+
+      // Beyond the bound prefix?
+      if (batchPrefix&&((v1>batchValue1)||((batchPrefix>1)&&(v1==batchValue1)&&
+          ((v2>batchValue2)||((batchPrefix>2)&&(v2==batchValue2)&&(v3>batchValue3)))))) {
+         batchesDone=true;
+         break;
+      }
+      // Beyond the morsel?
+      if (batchLimited&&((v1>batchLimit.value1)||((v1==batchLimit.value1)&&
+          ((v2>batchLimit.value2)||((v2==batchLimit.value2)&&(v3>batchLimit.value3)))))) {
+         batchesDone=true;
+         break;
+      }
+      if ((batchFilter2&&(v2!=batchValue2))||(batchFilter3&&(v3!=batchValue3)))
+         continue;
+      if ((domain1&&(!domain1->couldQualify(v1)))||(domain2&&(!domain2->couldQualify(v2)))||(domain3&&(!domain3->couldQualify(v3))))
+         continue;
+
+      if (target1) target1[size]=v1;
+      if (target2) target2[size]=v2;
+      if (target3) target3[size]=v3;
+      counts[size++]=1;
+   }
+   batch.setSize(size);
+   observedOutputCardinality+=size;
+
+   for (unsigned column=0,limit=batch.getColumnCount();column<limit;column++) {
+      Register* reg=batch.getRegisters()[column];
+      if ((reg!=value1)&&(reg!=value2)&&(reg!=value3))
+         batch.fillConstant(column);
+   }
+   return size;
+}
+//---------------------------------------------------------------------------
+unsigned IndexScan::firstBatch(Batch& batch)
+   // Produce the first batch of tuples
+{
+   observedOutputCardinality=0;
+
+   // Bound leading values limit the scan, further bound values are filtered
+   batchValue1=value1->value;
+   batchValue2=value2->value;
+   batchValue3=value3->value;
+   batchPrefix=bound1?(bound2?(bound3?3:2):1):0;
+   batchFilter2=bound2&&(batchPrefix<2);
+   batchFilter3=bound3&&(batchPrefix<3);
+
+   // A morsel starts behind the last entry of its predecessor and ends with its own last entry
+   bool hasMorsel=~morsel;
+   batchLimited=hasMorsel&&(morsel<morselBounds.size());
+   if (batchLimited)
+      batchLimit=morselBounds[morsel];
+
+   bool found;
+   if (hasMorsel&&morsel) {
+      FactsSegment::Triple start=morselBounds[morsel-1];
+      if (~start.value3) {
+         start.value3++;
+      } else {
+         start.value3=0;
+         if (~start.value2) start.value2++; else { start.value2=0; start.value1++; }
+      }
+      found=scan.first(facts,start.value1,start.value2,start.value3);
+   } else if (batchPrefix) {
+      found=scan.first(facts,batchValue1,(batchPrefix>1)?batchValue2:0,(batchPrefix>2)?batchValue3:0);
+   } else {
+      found=scan.first(facts);
+   }
+   batchesDone=!found;
+   return fillBatch(batch,true);
+}
+//---------------------------------------------------------------------------
+unsigned IndexScan::nextBatch(Batch& batch)
+   // Produce the next batch of tuples
+{
+   return fillBatch(batch,false);
+}
+//---------------------------------------------------------------------------
+bool IndexScan::supportsBatches() const
+   // Are batches produced natively?
+{
+   return true;
+}
+//---------------------------------------------------------------------------
+void IndexScan::getAsyncInputCandidates(Scheduler& scheduler)
    // Register parts of the tree that can be executed asynchronous
 {
+   scheduler.registerMorselSource(splitter);
 }
 //---------------------------------------------------------------------------
 IndexScan* IndexScan::create(Database& db,Database::DataOrder order,Register* subject,bool subjectBound,Register* predicate,bool predicateBound,Register* object,bool objectBound,double expectedOutputCardinality)
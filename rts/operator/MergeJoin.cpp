@@ -1,5 +1,6 @@
 #include "rts/operator/MergeJoin.hpp"
 #include "rts/operator/PlanPrinter.hpp"
+#include "rts/operator/Scheduler.hpp"
 #include "rts/runtime/Runtime.hpp"
 #include <iostream>
 using namespace std;
@@ -21,6 +22,15 @@ MergeJoin::MergeJoin(Operator* left,Register* leftValue,const std::vector<Regist
    leftShadow.resize(leftTail.size()+2);
    rightShadow.resize(rightTail.size()+2);
 
+   std::vector<Register*> registers;
+   registers.push_back(leftValue);
+   registers.insert(registers.end(),leftTail.begin(),leftTail.end());
+   leftBatch.setRegisters(registers);
+   registers.clear();
+   registers.push_back(rightValue);
+   registers.insert(registers.end(),rightTail.begin(),rightTail.end());
+   rightBatch.setRegisters(registers);
+
    left->addMergeHint(leftValue,rightValue);
    right->addMergeHint(leftValue,rightValue);
 }
@@ -355,6 +365,176 @@ unsigned MergeJoin::next()
    }
 }
 //---------------------------------------------------------------------------
+void MergeJoin::publishHints()
+   // Publish the smallest join values that are still needed as merge hints
+{
+   // The inputs do not write their registers in batch mode. The scans below
+   // us skip using these registers, so they must never run ahead of the join
+   leftValue->value=(leftPos<leftBatch.getSize())?leftBatch.getColumn(0)[leftPos]:lastLeft;
+   if (inGroup)
+      rightValue->value=groupValue; else
+      rightValue->value=(rightPos<rightBatch.getSize())?rightBatch.getColumn(0)[rightPos]:lastRight;
+}
+//---------------------------------------------------------------------------
+bool MergeJoin::hasLeft()
+   // Make a left tuple available in batch mode
+{
+   if (leftPos<leftBatch.getSize())
+      return true;
+   if (leftDone)
+      return false;
+   publishHints();
+   leftPos=0;
+   leftDone=!left->nextBatch(leftBatch);
+   return !leftDone;
+}
+//---------------------------------------------------------------------------
+bool MergeJoin::hasRight()
+   // Make a right tuple available in batch mode
+{
+   if (rightPos<rightBatch.getSize())
+      return true;
+   if (rightDone)
+      return false;
+   publishHints();
+   rightPos=0;
+   rightDone=!right->nextBatch(rightBatch);
+   return !rightDone;
+}
+//---------------------------------------------------------------------------
+unsigned MergeJoin::firstBatch(Batch& batch)
+   // Produce the first batch of tuples
+{
+   observedOutputCardinality=0;
+   leftBatch.clear();
+   rightBatch.clear();
+   leftPos=rightPos=0;
+   lastLeft=lastRight=~0u;
+   inGroup=false;
+
+   // Read the first batches
+   publishHints();
+   leftDone=!left->firstBatch(leftBatch);
+   rightDone=true;
+   if (!leftDone) {
+      publishHints();
+      rightDone=!right->firstBatch(rightBatch);
+   }
+   batchesDone=leftDone||rightDone;
+
+   return nextBatch(batch);
+}
+//---------------------------------------------------------------------------
+unsigned MergeJoin::nextBatch(Batch& batch)
+   // Produce the next batch of tuples
+{
+   batch.clear();
+   if (batchesDone)
+      return 0;
+
+   // Find the sources of the output columns. Right values are read from the spooled tuples
+   unsigned rowSize=1+rightBatch.getColumnCount();
+   std::vector<unsigned*> keyColumns;
+   std::vector<std::pair<unsigned*,const unsigned*> > leftColumns;
+   std::vector<std::pair<unsigned*,unsigned> > rightColumns;
+   std::vector<unsigned> constantColumns;
+   for (unsigned column=0,limit=batch.getColumnCount();column<limit;column++) {
+      Register* reg=batch.getRegisters()[column];
+      unsigned* target=batch.getColumn(column);
+      if ((reg==leftValue)||(reg==rightValue)) {
+         keyColumns.push_back(target);
+      } else if (~leftBatch.findColumn(reg)) {
+         leftColumns.push_back(std::pair<unsigned*,const unsigned*>(target,leftBatch.getColumn(leftBatch.findColumn(reg))));
+      } else if (~rightBatch.findColumn(reg)) {
+         rightColumns.push_back(std::pair<unsigned*,unsigned>(target,1+rightBatch.findColumn(reg)));
+      } else {
+         constantColumns.push_back(column);
+      }
+   }
+   const unsigned* leftKeys=leftBatch.getColumn(0),*leftCounts=leftBatch.getCounts();
+   const unsigned* rightKeys=rightBatch.getColumn(0);
+
+   unsigned* counts=batch.getCounts();
+   unsigned size=0;
+   while (size<Batch::capacity) {
+      if (inGroup) {
+         // Combine the current left tuple with the spooled right tuples
+         unsigned groupSize=buffer.size()/rowSize;
+         for (;(groupPos<groupSize)&&(size<Batch::capacity);groupPos++,size++) {
+            const unsigned* row=&buffer[groupPos*rowSize];
+            for (std::vector<unsigned*>::const_iterator iter=keyColumns.begin(),limit=keyColumns.end();iter!=limit;++iter)
+               (*iter)[size]=groupValue;
+            for (std::vector<std::pair<unsigned*,const unsigned*> >::const_iterator iter=leftColumns.begin(),limit=leftColumns.end();iter!=limit;++iter)
+               (*iter).first[size]=(*iter).second[leftPos];
+            for (std::vector<std::pair<unsigned*,unsigned> >::const_iterator iter=rightColumns.begin(),limit=rightColumns.end();iter!=limit;++iter)
+               (*iter).first[size]=row[(*iter).second];
+            unsigned count=leftCounts[leftPos]*row[0];
+            counts[size]=count;
+            observedOutputCardinality+=count;
+         }
+         if (groupPos<groupSize)
+            break;
+
+         // Does the next left tuple match the same tuples?
+         lastLeft=groupValue;
+         leftPos++;
+         if (hasLeft()&&(leftKeys[leftPos]==groupValue)) {
+            groupPos=0;
+            continue;
+         }
+         inGroup=false;
+      }
+
+      // Find the next match
+      if ((!hasLeft())||(!hasRight())) {
+         batchesDone=true;
+         break;
+      }
+      unsigned l=leftKeys[leftPos],r=rightKeys[rightPos];
+      if (l<r) {
+         lastLeft=l;
+         leftPos++;
+         continue;
+      }
+      if (l>r) {
+         lastRight=r;
+         rightPos++;
+         continue;
+      }
+
+      // Spool all right tuples with the join value
+      buffer.clear();
+      groupValue=l;
+      groupPos=0;
+      inGroup=true;
+      while (hasRight()&&(rightKeys[rightPos]==groupValue)) {
+         buffer.push_back(rightBatch.getCounts()[rightPos]);
+         for (unsigned column=0,limit=rightBatch.getColumnCount();column<limit;column++)
+            buffer.push_back(rightBatch.getColumn(column)[rightPos]);
+         lastRight=groupValue;
+         rightPos++;
+      }
+   }
+   batch.setSize(size);
+
+   for (std::vector<unsigned>::const_iterator iter=constantColumns.begin(),limit=constantColumns.end();iter!=limit;++iter)
+      batch.fillConstant(*iter);
+
+   // Read the remaining input when debugging without skipping
+   if (batchesDone&&Operator::disableSkipping) {
+      while ((!leftDone)&&left->nextBatch(leftBatch)) ;
+      while ((!rightDone)&&right->nextBatch(rightBatch)) ;
+      leftDone=rightDone=true;
+   }
+   return size;
+}
+//---------------------------------------------------------------------------
+bool MergeJoin::supportsBatches() const
+   // Are batches produced natively?
+{
+   return left->supportsBatches()&&right->supportsBatches();
+}
+//---------------------------------------------------------------------------
 void MergeJoin::print(PlanPrinter& out)
    // Print the operator tree. Debugging only.
 {
@@ -378,6 +558,10 @@ void MergeJoin::getAsyncInputCandidates(Scheduler& scheduler)
    // Register parts of the tree that can be executed asynchronous
 {
    left->getAsyncInputCandidates(scheduler);
+
+   // Every morsel of the left side joins with the whole right side
+   bool blocked=scheduler.blockMorselSources(true);
    right->getAsyncInputCandidates(scheduler);
+   scheduler.blockMorselSources(blocked);
 }
 //---------------------------------------------------------------------------
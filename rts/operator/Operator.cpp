@@ -1,4 +1,5 @@
 #include "rts/operator/Operator.hpp"
+#include "rts/operator/Batch.hpp"
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -12,7 +13,7 @@
 bool Operator::disableSkipping = false;
 //---------------------------------------------------------------------------
 Operator::Operator(double expectedOutputCardinality)
-   : expectedOutputCardinality(expectedOutputCardinality),observedOutputCardinality(0)
+   : expectedOutputCardinality(expectedOutputCardinality),observedOutputCardinality(0),batchesDone(false)
    // Constructor
 {
 }
@@ -22,3 +23,44 @@ Operator::~Operator()
 {
 }
 //---------------------------------------------------------------------------
+unsigned Operator::appendTuples(Batch& batch)
+   // Append tuples produced by next() until the batch is full
+{
+   while ((!batchesDone)&&(!batch.isFull())) {
+      unsigned count=next();
+      if (!count) {
+         batchesDone=true;
+         break;
+      }
+      batch.append(count);
+   }
+   return batch.getSize();
+}
+//---------------------------------------------------------------------------
+unsigned Operator::firstBatch(Batch& batch)
+   // Produce the first batch of tuples
+{
+   batch.clear();
+   unsigned count=first();
+   if (!count) {
+      batchesDone=true;
+      return 0;
+   }
+   batchesDone=false;
+   batch.append(count);
+   return appendTuples(batch);
+}
+//---------------------------------------------------------------------------
+unsigned Operator::nextBatch(Batch& batch)
+   // Produce the next batch of tuples
+{
+   batch.clear();
+   return appendTuples(batch);
+}
+//---------------------------------------------------------------------------
+bool Operator::supportsBatches() const
+   // Are batches produced natively by this operator and all its inputs?
+{
+   return false;
+}
+//---------------------------------------------------------------------------
@@ -1,4 +1,5 @@
 #include "rts/operator/PlanPrinter.hpp"
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/runtime/Runtime.hpp"
@@ -159,8 +160,9 @@ string DebugPlanPrinter::formatValue(unsigned value)
 {
    stringstream result;
    if (~value) {
+      BufferReference page;
       const char* start,*stop; Type::ID type; unsigned subType;
-      if (runtime.getDatabase().getDictionary().lookupById(value,start,stop,type,subType)) {
+      if (runtime.getDatabase().getDictionary().lookupById(value,page,start,stop,type,subType)) {
          result << '\"';
          for (const char* iter=start;iter!=stop;++iter)
            result << *iter;
@@ -0,0 +1,253 @@
+#include "rts/operator/PropertyPathScan.hpp"
+#include "rts/operator/PlanPrinter.hpp"
+#include "rts/runtime/Runtime.hpp"
+#include "rts/segment/FactsSegment.hpp"
+#include <algorithm>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2013 Andrey Gubichev, Thomas Neumann.
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+PropertyPathScan::PropertyPathScan(Database& db,Register* subject,bool subjectBound,Register* object,bool objectBound,const vector<Step>& steps,double expectedOutputCardinality)
+   : Operator(expectedOutputCardinality),subject(subject),object(object),subjectBound(subjectBound),objectBound(objectBound),
+     edges(db.getFacts((objectBound&&!subjectBound)?Database::Order_Object_Predicate_Subject:Database::Order_Subject_Predicate_Object)),
+     starts(db.getFacts(Database::Order_Predicate_Subject_Object)),inverse(objectBound&&!subjectBound),steps(steps),
+     nextSource(0),source(0),nextResult(0)
+   // Constructor
+{
+   // Walk backwards from a bound object
+   if (inverse)
+      reverse(this->steps.begin(),this->steps.end());
+   buildAutomaton();
+
+   // Only forward reachability is indexed, and it only helps if we know where to stop
+   useFerrari=(!inverse)&&objectBound&&(this->steps.back().modifier!=One)&&this->steps.back().ferrari;
+}
+//---------------------------------------------------------------------------
+PropertyPathScan::~PropertyPathScan()
+   // Destructor
+{
+}
+//---------------------------------------------------------------------------
+void PropertyPathScan::buildAutomaton()
+   // Build the automaton
+{
+   // State i means that the first i steps are matched
+   unsigned k=steps.size();
+   accept=k;
+   closure.resize(k+1);
+   for (unsigned state=k+1;state>0;--state) {
+      unsigned i=state-1;
+      closure[i].push_back(i);
+      if ((i<k)&&(steps[i].modifier==Mul))
+         closure[i].insert(closure[i].end(),closure[i+1].begin(),closure[i+1].end());
+   }
+
+   transitions.resize(k+1);
+   for (unsigned i=0;i<=k;i++) {
+      vector<pair<unsigned,unsigned> > moves;
+      // Repeat the previous step
+      if ((i>0)&&(steps[i-1].modifier!=One))
+         for (vector<unsigned>::const_iterator iter=closure[i].begin(),limit=closure[i].end();iter!=limit;++iter)
+            moves.push_back(pair<unsigned,unsigned>(steps[i-1].predicate,*iter));
+      // Take the next step
+      if (i<k)
+         for (vector<unsigned>::const_iterator iter=closure[i+1].begin(),limit=closure[i+1].end();iter!=limit;++iter)
+            moves.push_back(pair<unsigned,unsigned>(steps[i].predicate,*iter));
+
+      // Group by predicate, each predicate needs only one lookup
+      sort(moves.begin(),moves.end());
+      moves.erase(unique(moves.begin(),moves.end()),moves.end());
+      for (vector<pair<unsigned,unsigned> >::const_iterator iter=moves.begin(),limit=moves.end();iter!=limit;++iter) {
+         if (transitions[i].empty()||(transitions[i].back().predicate!=(*iter).first)) {
+            transitions[i].push_back(Transition());
+            transitions[i].back().predicate=(*iter).first;
+         }
+         transitions[i].back().targets.push_back((*iter).second);
+      }
+   }
+
+   visited.resize(k+1);
+}
+//---------------------------------------------------------------------------
+void PropertyPathScan::collectSources()
+   // Collect all nodes that can start a path
+{
+   sources.clear();
+
+   // Every node with a matching first edge, and every node if the empty path matches
+   bool empty=false;
+   vector<unsigned> predicates;
+   for (vector<unsigned>::const_iterator iter=closure[0].begin(),limit=closure[0].end();iter!=limit;++iter) {
+      if ((*iter)==accept)
+         empty=true;
+      for (vector<Transition>::const_iterator iter2=transitions[*iter].begin(),limit2=transitions[*iter].end();iter2!=limit2;++iter2)
+         predicates.push_back((*iter2).predicate);
+   }
+   sort(predicates.begin(),predicates.end());
+   predicates.erase(unique(predicates.begin(),predicates.end()),predicates.end());
+
+   for (vector<unsigned>::const_iterator iter=predicates.begin(),limit=predicates.end();iter!=limit;++iter) {
+      FactsSegment::Scan scan;
+      if (scan.first(starts,*iter,0,0)) do {
+         if (scan.getValue1()!=(*iter)) break;
+         if (sources.empty()||(sources.back()!=scan.getValue2()))
+            sources.push_back(scan.getValue2());
+         if (empty)
+            sources.push_back(scan.getValue3());
+      } while (scan.next());
+   }
+   sort(sources.begin(),sources.end());
+   sources.erase(unique(sources.begin(),sources.end()),sources.end());
+}
+//---------------------------------------------------------------------------
+void PropertyPathScan::findNeighbors(unsigned node,unsigned predicate)
+   // Find all neighbors of a node along a predicate
+{
+   neighbors.clear();
+   FactsSegment::Scan scan;
+   if (scan.first(edges,node,predicate,0)) do {
+      if ((scan.getValue1()!=node)||(scan.getValue2()!=predicate)) break;
+      neighbors.push_back(scan.getValue3());
+   } while (scan.next());
+}
+//---------------------------------------------------------------------------
+bool PropertyPathScan::enter(unsigned node,const vector<unsigned>& states,unsigned target)
+   // Enter a node in a set of states. Returns true if the target was reached
+{
+   for (vector<unsigned>::const_iterator iter=states.begin(),limit=states.end();iter!=limit;++iter) {
+      unsigned state=*iter;
+      // The last step is checked by the reachability index
+      if (useFerrari&&(state==accept))
+         continue;
+
+      boost::dynamic_bitset<>& seen=visited[state];
+      if (node>=seen.size())
+         seen.resize(max<size_t>(node+1,2*seen.size()));
+      if (seen[node])
+         continue;
+      seen[node]=true;
+      Entry e; e.node=node; e.state=state;
+      queue.push_back(e);
+
+      if ((state==accept)&&((!~target)||(node==target))) {
+         results.push_back(node);
+         if (~target)
+            return true;
+      }
+   }
+   return false;
+}
+//---------------------------------------------------------------------------
+bool PropertyPathScan::checkLastStep(unsigned node,unsigned target)
+   // Is the target reachable from a node along the last step?
+{
+   const Step& step=steps.back();
+   if (step.modifier==Mul)
+      return step.ferrari->reachable(node,target,ferrariContext);
+
+   // At least one edge, the index would accept the empty path
+   findNeighbors(node,step.predicate);
+   for (vector<unsigned>::const_iterator iter=neighbors.begin(),limit=neighbors.end();iter!=limit;++iter)
+      if (step.ferrari->reachable(*iter,target,ferrariContext))
+         return true;
+   return false;
+}
+//---------------------------------------------------------------------------
+void PropertyPathScan::search(unsigned start,unsigned target)
+   // Find all nodes reachable from a start node. Stops early if target is reached
+{
+   results.clear();
+   nextResult=0;
+   queue.clear();
+
+   // Breadth-first search over (node,state) pairs
+   bool found=enter(start,closure[0],target);
+   for (unsigned head=0;(!found)&&(head<queue.size());++head) {
+      Entry e=queue[head];
+      if (useFerrari&&(e.state+1==accept)&&checkLastStep(e.node,target)) {
+         results.push_back(target);
+         break;
+      }
+      for (vector<Transition>::const_iterator iter=transitions[e.state].begin(),limit=transitions[e.state].end();(!found)&&(iter!=limit);++iter) {
+         findNeighbors(e.node,(*iter).predicate);
+         for (vector<unsigned>::const_iterator iter2=neighbors.begin(),limit2=neighbors.end();iter2!=limit2;++iter2)
+            if (enter(*iter2,(*iter).targets,target)) {
+               found=true;
+               break;
+            }
+      }
+   }
+
+   // Reset the visited sets, touching only the entries we set
+   for (vector<Entry>::const_iterator iter=queue.begin(),limit=queue.end();iter!=limit;++iter)
+      visited[(*iter).state][(*iter).node]=false;
+}
+//---------------------------------------------------------------------------
+unsigned PropertyPathScan::first()
+   // Produce the first tuple
+{
+   observedOutputCardinality=0;
+   results.clear();
+   nextResult=0;
+   sources.clear();
+   nextSource=0;
+
+   if (inverse) {
+      search(object->value,~0u);
+   } else if (subjectBound) {
+      source=subject->value;
+      search(source,objectBound?object->value:~0u);
+   } else {
+      collectSources();
+   }
+   return next();
+}
+//---------------------------------------------------------------------------
+unsigned PropertyPathScan::next()
+   // Produce the next tuple
+{
+   while (nextResult>=results.size()) {
+      if (nextSource>=sources.size())
+         return 0;
+      source=sources[nextSource++];
+      search(source,~0u);
+   }
+
+   unsigned node=results[nextResult++];
+   if (inverse) {
+      subject->value=node;
+   } else {
+      if (!subjectBound) subject->value=source;
+      if (!objectBound) object->value=node;
+   }
+   observedOutputCardinality++;
+   return 1;
+}
+//---------------------------------------------------------------------------
+void PropertyPathScan::print(PlanPrinter& out)
+   // Print the operator tree. Debugging only.
+{
+   out.beginOperator("PropertyPathScan",expectedOutputCardinality,observedOutputCardinality);
+   out.addScanAnnotation(subject,subjectBound);
+   out.addScanAnnotation(object,objectBound);
+   out.endOperator();
+}
+//---------------------------------------------------------------------------
+void PropertyPathScan::addMergeHint(Register* /*reg1*/,Register* /*reg2*/)
+   // Add a merge join hint
+{
+}
+//---------------------------------------------------------------------------
+void PropertyPathScan::getAsyncInputCandidates(Scheduler& /*scheduler*/)
+   // Register parts of the tree that can be executed asynchronous
+{
+}
+//---------------------------------------------------------------------------
@@ -56,21 +56,28 @@ RegularPathScan::~RegularPathScan()
 		delete entryPool;
 }
 //---------------------------------------------------------------------------
+bool RegularPathScan::storesSubject() const
+   // Does the stored subtree bind the subject of the path?
+{
+   // The first input joins on the subject until checkAndSwap flips the inputs
+   return inverse==(order==Database::Order_Object_Predicate_Subject);
+}
+//---------------------------------------------------------------------------
 void RegularPathScan::buildStorage(){
 	storage.reserve(1024);
 
-   // Prepare relevant domain information
-   vector<Register*> domainRegs;
-   if (secondSource->domain){
-      domainRegs.push_back(secondSource);
-   }
+   // Only forward reachability is indexed, restrict the probe side if it binds the object
+   bool restrict=storesSubject()&&secondSource->domain;
    ObservedDomainDescription observedDomain;
 
+   vector<unsigned> keys;
    for (unsigned leftCount=op1->first();leftCount;leftCount=op1->next()) {
-   	vector<unsigned> reachable;
-   	ferrari->get_reachable(firstSource->value,reachable);
-   	for (auto node: reachable)
-   		observedDomain.add(node);
+   	if (restrict) {
+   		vector<unsigned> reachable;
+   		ferrari->get_reachable(firstSource->value,reachable);
+   		for (auto node: reachable)
+   			observedDomain.add(node);
+   	}
 
       Entry* e=entryPool->alloc();
       e->key=firstSource->value;
@@ -79,9 +86,23 @@ void RegularPathScan::buildStorage(){
       }
       e->count=leftCount;
       storage.push_back(e);
+      keys.push_back(e->key);
    }
+   ferrari->prepare_batch(keys,storageBatch);
+
    // Update the domains
-   secondSource->domain->restrictTo(observedDomain);
+   if (restrict)
+      secondSource->domain->restrictTo(observedDomain);
+}
+//---------------------------------------------------------------------------
+void RegularPathScan::probe()
+   // Find all stored entries connected to the current probe tuple
+{
+   if (storesSubject())
+      ferrari->reaching(storageBatch,secondSource->value,matches,ferrariContext);
+   else
+      ferrari->reachable(secondSource->value,storageBatch,matches,ferrariContext);
+   matchIterator=matches.begin();
 }
 //---------------------------------------------------------------------------
 unsigned RegularPathScan::first()
@@ -92,49 +113,37 @@ unsigned RegularPathScan::first()
 		return 0;
 	}
 
-	storageIterator=storage.begin();
+	probe();
 	return next();
 }
 //---------------------------------------------------------------------------
 unsigned RegularPathScan::next()
 {
-   /*	if (op1){
-		while (op1->next()&&op2->next()){
-			this->value3->value=firstSource->value;
-			this->value1->value=secondSource->value;
-			return 1;
-		}
-	}
-	*/
-	while (true){
-		for (;storageIterator!=storage.end();++storageIterator){
-			unsigned leftCount=(*storageIterator)->count;
-			firstSource->value=(*storageIterator)->key;
-			// IF ! reachable continue
-			this->value1->value=firstSource->value;
-			this->value3->value=secondSource->value;
+	Register* subject=value1,*object=value3;
+	if (order==Database::Order_Object_Predicate_Subject)
+		swap(subject,object);
 
-			if (!inverse){
-//				cerr<<value1->value<<" "<<value3->value<<endl;
-				if (!ferrari->reachable(value1->value,value3->value))
-					continue;
+	while (true){
+		if (matchIterator!=matches.end()){
+			const Entry* e=storage[*matchIterator];
+			++matchIterator;
+			firstSource->value=e->key;
+			if (storesSubject()){
+				subject->value=e->key;
+				object->value=secondSource->value;
 			} else {
-				//cerr<<value3->value<<" "<<value1->value<<endl;
-				if (!ferrari->reachable(value3->value,value1->value))
-					continue;
+				subject->value=secondSource->value;
+				object->value=e->key;
 			}
-
-         for (unsigned index=0,limit=firstBinding.size();index<limit;++index)
-         	firstBinding[index]->value=(*storageIterator)->values[index];
-         ++storageIterator;
-         return rightCount*leftCount;
+			for (unsigned index=0,limit=firstBinding.size();index<limit;++index)
+				firstBinding[index]->value=e->values[index];
+			return rightCount*e->count;
 		}
 
 		if ((rightCount=op2->next())==0)
 			return 0;
-		storageIterator=storage.begin();
+		probe();
 	}
-	return 0;
 }
 //---------------------------------------------------------------------------
 class RegularPathScan::RPConstant: public RegularPathScan {
@@ -156,10 +165,10 @@ unsigned RegularPathScan::RPConstant::first(){
 		if (op1->first()){
 			// bounded scan: check that value1 reaches nodes from value3
 			this->value3->value=firstSource->value;
-			if (!inverse&&ferrari->reachable(value1->value,value3->value)){
+			if (!inverse&&ferrari->reachable(value1->value,value3->value,ferrariContext)){
 				return 1;
 			}
-			if (inverse&&ferrari->reachable(value3->value,value1->value)){
+			if (inverse&&ferrari->reachable(value3->value,value1->value,ferrariContext)){
 				//cerr<<value1->value<<" "<<value3->value<<endl;
 				return 1;
 			}
@@ -182,9 +191,9 @@ unsigned RegularPathScan::RPConstant::next(){
 			//cerr<<"bound: "<<const1<<" "<<const3<<endl;
 
 			//cerr<<g->getNodeId(value1->value)<<" "<<g->getNodeId(value3->value)<<endl;
-			if (!inverse&&ferrari->reachable(value1->value,value3->value))
+			if (!inverse&&ferrari->reachable(value1->value,value3->value,ferrariContext))
 				return 1;
-			if (inverse&&ferrari->reachable(value3->value,value1->value))
+			if (inverse&&ferrari->reachable(value3->value,value1->value,ferrariContext))
 				return 1;
 		}
 	} else{
@@ -251,6 +260,10 @@ bool RegularPathScan::isSecondInputSet(){
 	return this->op2!=0;
 }
 //---------------------------------------------------------------------------
+bool RegularPathScan::isComplete(){
+	return this->op1&&(this->op2||const1||const3);
+}
+//---------------------------------------------------------------------------
 void RegularPathScan::setFirstBinding(std::vector<Register*>& firstBinding){
 	this->firstBinding=firstBinding;
 	this->entryPool=new VarPool<RegularPathScan::Entry>(firstBinding.size()*sizeof(unsigned));
@@ -1,11 +1,15 @@
 #include "rts/operator/ResultsPrinter.hpp"
+#include "rts/buffer/BufferReference.hpp"
+#include "rts/operator/Batch.hpp"
 #include "rts/operator/PlanPrinter.hpp"
+#include "rts/operator/Scheduler.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/runtime/DifferentialIndex.hpp"
 #include "rts/runtime/Runtime.hpp"
 #include "rts/runtime/TemporaryDictionary.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "infra/osdep/Timestamp.hpp"
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <set>
@@ -23,7 +27,7 @@
 using namespace std;
 //---------------------------------------------------------------------------
 ResultsPrinter::ResultsPrinter(Runtime& runtime,Operator* input,const CodeGen::Output& output,DuplicateHandling duplicateHandling,unsigned limit,bool silent)
-   : Operator(1),output(output),input(input),runtime(runtime),dictionary(runtime.getDatabase().getDictionary()),duplicateHandling(duplicateHandling),outputMode(DefaultOutput),limit(limit),silent(silent)
+   : Operator(1),output(output),input(input),runtime(runtime),dictionary(runtime.getDatabase().getDictionary()),duplicateHandling(duplicateHandling),outputMode(DefaultOutput),limit(limit),silent(silent),batchMode(false)
    // Constructor
 {
 }
@@ -32,6 +36,18 @@ ResultsPrinter::~ResultsPrinter()
    // Destructor
 {
    delete input;
+   for (vector<Operator*>::const_iterator iter=workerInputs.begin(),limit=workerInputs.end();iter!=limit;++iter)
+      delete *iter;
+   for (vector<Runtime*>::const_iterator iter=workerRuntimes.begin(),limit=workerRuntimes.end();iter!=limit;++iter)
+      delete *iter;
+}
+//---------------------------------------------------------------------------
+void ResultsPrinter::addWorker(Runtime* runtime,Operator* input,const CodeGen::Output& output)
+   // Add a worker with its own copy of the input
+{
+   workerRuntimes.push_back(runtime);
+   workerInputs.push_back(input);
+   workerOutputs.push_back(output);
 }
 //---------------------------------------------------------------------------
 namespace {
@@ -100,67 +116,238 @@ template<class T> static void printResult(map<unsigned,CacheEntry>& stringCache,
    }
 }
 //---------------------------------------------------------------------------
+static void lookupStrings(DictionarySegment& dictionary,TemporaryDictionary* tempDict,DifferentialIndex* diffIndex,map<unsigned,CacheEntry>& stringCache,vector<char>& text)
+   // Lookup the strings of all entries in one batch. The strings are copied into text
+{
+   vector<unsigned> ids;
+   ids.reserve(stringCache.size());
+   for (map<unsigned,CacheEntry>::const_iterator iter=stringCache.begin(),limit=stringCache.end();iter!=limit;++iter)
+      ids.push_back((*iter).first);
+
+   vector<DictionarySegment::IdString> strings;
+   if ((!tempDict)&&(!diffIndex)) {
+      // The ids are sorted, look them up page by page
+      dictionary.lookupByIds(ids,strings,text);
+   } else {
+      // Copy the strings one by one, the pages are released after each lookup
+      strings.resize(ids.size());
+      text.clear();
+      vector<pair<unsigned,unsigned> > bounds(ids.size());
+      for (unsigned index=0,count=ids.size();index<count;index++) {
+         DictionarySegment::IdString& s=strings[index];
+         BufferReference page;
+         const char* start,*stop;
+         if (tempDict)
+            s.found=tempDict->lookupById(ids[index],page,start,stop,s.type,s.subType); else
+            s.found=diffIndex->lookupById(ids[index],page,start,stop,s.type,s.subType);
+         if (!s.found) {
+            s.start=s.stop=0; s.type=Type::Literal; s.subType=0;
+            continue;
+         }
+         bounds[index].first=text.size();
+         text.insert(text.end(),start,stop);
+         bounds[index].second=text.size();
+      }
+      // Point into the copies once the text buffer is complete
+      const char* base=text.empty()?0:&text[0];
+      for (unsigned index=0,count=ids.size();index<count;index++)
+         if (strings[index].found) {
+            strings[index].start=base+bounds[index].first;
+            strings[index].stop=base+bounds[index].second;
+         }
+   }
+
+   vector<DictionarySegment::IdString>::const_iterator found=strings.begin();
+   for (map<unsigned,CacheEntry>::iterator iter=stringCache.begin(),limit=stringCache.end();iter!=limit;++iter,++found) {
+      CacheEntry& c=(*iter).second;
+      c.start=(*found).start;
+      c.stop=(*found).stop;
+      c.type=(*found).type;
+      c.subType=(*found).subType;
+   }
+}
+//---------------------------------------------------------------------------
+/// Collects the results of one worker morsel by morsel
+class ResultCollector : public Scheduler::PipelineSink {
+   public:
+   /// The results of a morsel
+   typedef pair<unsigned,vector<unsigned> > MorselResult;
+
+   private:
+   /// The input
+   Operator* input;
+   /// The current batch
+   Batch batch;
+   /// The output columns
+   vector<const unsigned*> columns;
+   /// The minimum count of an entry
+   unsigned minCount;
+
+   public:
+   /// The results
+   vector<MorselResult> results;
+
+   /// Constructor
+   ResultCollector(Operator* input,const vector<Register*>& output,unsigned minCount);
+
+   /// Consume a morsel
+   void consumeMorsel(unsigned morsel);
+   /// Combine the results. Nothing to do, the printer merges them
+   void finishPipeline(const vector<Scheduler::PipelineSink*>& /*workers*/) {}
 };
 //---------------------------------------------------------------------------
+ResultCollector::ResultCollector(Operator* input,const vector<Register*>& output,unsigned minCount)
+   : input(input),minCount(minCount)
+   // Constructor
+{
+   batch.setRegisters(output);
+   for (vector<Register*>::const_iterator iter=output.begin(),limit=output.end();iter!=limit;++iter)
+      columns.push_back(batch.getColumn(batch.findColumn(*iter)));
+}
+//---------------------------------------------------------------------------
+void ResultCollector::consumeMorsel(unsigned morsel)
+   // Consume a morsel
+{
+   results.push_back(MorselResult(morsel,vector<unsigned>()));
+   vector<unsigned>& target=results.back().second;
+   for (unsigned count=input->firstBatch(batch);count;count=input->nextBatch(batch)) {
+      const unsigned* counts=batch.getCounts();
+      for (unsigned row=0;row<count;row++) {
+         if (counts[row]<minCount) continue;
+         target.push_back(counts[row]);
+         for (vector<const unsigned*>::const_iterator iter=columns.begin(),limit=columns.end();iter!=limit;++iter)
+            target.push_back((*iter)[row]);
+      }
+   }
+}
+//---------------------------------------------------------------------------
+static bool orderMorsels(const ResultCollector::MorselResult* a,const ResultCollector::MorselResult* b)
+   // Order the morsel results
+{
+   return a->first<b->first;
+}
+//---------------------------------------------------------------------------
+};
+//---------------------------------------------------------------------------
+void ResultsPrinter::collectParallel(unsigned minCount,vector<unsigned>& results)
+   // Consume the input with all workers
+{
+   // Run the pipelines of all copies
+   vector<ResultCollector*> collectors;
+   vector<Operator*> roots;
+   vector<Scheduler::PipelineSink*> sinks;
+   collectors.push_back(new ResultCollector(input,output.valueoutput,minCount));
+   roots.push_back(input);
+   for (unsigned index=0;index<workerInputs.size();index++) {
+      collectors.push_back(new ResultCollector(workerInputs[index],workerOutputs[index].valueoutput,minCount));
+      roots.push_back(workerInputs[index]);
+   }
+   sinks.assign(collectors.begin(),collectors.end());
+   Scheduler().execute(roots,sinks);
+
+   // Concatenate the morsels in scan order, which is the sequential order
+   vector<const ResultCollector::MorselResult*> morsels;
+   for (vector<ResultCollector*>::const_iterator iter=collectors.begin(),limit=collectors.end();iter!=limit;++iter)
+      for (vector<ResultCollector::MorselResult>::const_iterator iter2=(*iter)->results.begin(),limit2=(*iter)->results.end();iter2!=limit2;++iter2)
+         morsels.push_back(&(*iter2));
+   sort(morsels.begin(),morsels.end(),orderMorsels);
+   for (vector<const ResultCollector::MorselResult*>::const_iterator iter=morsels.begin(),limit=morsels.end();iter!=limit;++iter)
+      results.insert(results.end(),(*iter)->second.begin(),(*iter)->second.end());
+
+   for (vector<ResultCollector*>::const_iterator iter=collectors.begin(),limit=collectors.end();iter!=limit;++iter)
+      delete *iter;
+}
+//---------------------------------------------------------------------------
 unsigned ResultsPrinter::first()
    // Produce the first tuple
 {
    observedOutputCardinality=1;
    // Empty input?
    unsigned count;
-   if ((count=input->first())==0) {
+   Batch batch;
+   vector<unsigned> results;
+   unsigned minCount=(duplicateHandling==ShowDuplicates)?2:1;
+   if (!workerInputs.empty()) {
+      collectParallel(minCount,results);
+      count=results.size();
+   } else if (batchMode) {
+      batch.setRegisters(output.valueoutput);
+      count=input->firstBatch(batch);
+   } else {
+      count=input->first();
+   }
+   if (count==0) {
       if ((!silent)&&(outputMode!=Embedded))
          cout << "<empty result>" << endl;
       return 1;
    }
 
    // Collect the values
-   vector<unsigned> results;
    vector<list<unsigned> > pathresults;
    map<unsigned,CacheEntry> stringCache;
-   unsigned minCount=(duplicateHandling==ShowDuplicates)?2:1;
    unsigned entryCount=0;
-   do {
-      if (count<minCount) continue;
-      results.push_back(count);
-
-	  for (vector<Register*>::const_iterator iter=output.valueoutput.begin(),limit=output.valueoutput.end();iter!=limit;++iter) {
-         unsigned id=(*iter)->value;
-         results.push_back(id);
-         if (~id) stringCache[id];
+   if (!workerInputs.empty()) {
+      // The workers collected the values already
+      for (vector<unsigned>::const_iterator iter=results.begin(),limit=results.end();iter!=limit;) {
+         ++iter;
+         for (unsigned index=0,columns=output.valueoutput.size();index<columns;index++,++iter)
+            if (~(*iter)) stringCache[*iter];
       }
+   } else if (batchMode) {
+      // Consume the input batch by batch
+      vector<const unsigned*> columns;
+      for (vector<Register*>::const_iterator iter=output.valueoutput.begin(),limit=output.valueoutput.end();iter!=limit;++iter)
+         columns.push_back(batch.getColumn(batch.findColumn(*iter)));
+      do {
+         const unsigned* counts=batch.getCounts();
+         for (unsigned row=0;row<count;row++) {
+            if (counts[row]<minCount) continue;
+            results.push_back(counts[row]);
 
-      for (vector<VectorRegister*>::const_iterator iter=output.pathoutput.begin(),limit=output.pathoutput.end();iter!=limit;++iter){
-    	  list<unsigned>& path=(*iter)->value;
-    	  pathresults.push_back(path);
-    	  for (list<unsigned>::iterator itlist=path.begin();itlist!=path.end();itlist++)
-    		  if (~(*itlist)) stringCache[*itlist];
-      }
-      if ((++entryCount)>=this->limit) break;
-   } while ((count=input->next())!=0);
+            for (vector<const unsigned*>::const_iterator iter=columns.begin(),limit=columns.end();iter!=limit;++iter) {
+               unsigned id=(*iter)[row];
+               results.push_back(id);
+               if (~id) stringCache[id];
+            }
+            if ((++entryCount)>=this->limit) break;
+         }
+      } while ((entryCount<this->limit)&&((count=input->nextBatch(batch))!=0));
+   } else {
+      do {
+         if (count<minCount) continue;
+         results.push_back(count);
+
+         for (vector<Register*>::const_iterator iter=output.valueoutput.begin(),limit=output.valueoutput.end();iter!=limit;++iter) {
+            unsigned id=(*iter)->value;
+            results.push_back(id);
+            if (~id) stringCache[id];
+         }
+
+         for (vector<VectorRegister*>::const_iterator iter=output.pathoutput.begin(),limit=output.pathoutput.end();iter!=limit;++iter){
+            list<unsigned>& path=(*iter)->value;
+            pathresults.push_back(path);
+            for (list<unsigned>::iterator itlist=path.begin();itlist!=path.end();itlist++)
+               if (~(*itlist)) stringCache[*itlist];
+         }
+         if ((++entryCount)>=this->limit) break;
+      } while ((count=input->next())!=0);
+   }
 
    // Lookup the strings
    set<unsigned> subTypes;
+   vector<char> stringText,subTypeText;
    TemporaryDictionary* tempDict=runtime.hasTemporaryDictionary()?(&runtime.getTemporaryDictionary()):0;
    DifferentialIndex* diffIndex=runtime.hasDifferentialIndex()?(&runtime.getDifferentialIndex()):0;
-   for (map<unsigned,CacheEntry>::iterator iter=stringCache.begin(),limit=stringCache.end();iter!=limit;++iter) {
-      CacheEntry& c=(*iter).second;
-      if (tempDict)
-         tempDict->lookupById((*iter).first,c.start,c.stop,c.type,c.subType); else
-      if (diffIndex)
-         diffIndex->lookupById((*iter).first,c.start,c.stop,c.type,c.subType); else
-         dictionary.lookupById((*iter).first,c.start,c.stop,c.type,c.subType);
-      if (Type::hasSubType(c.type))
-         subTypes.insert(c.subType);
-   }
-   for (set<unsigned>::const_iterator iter=subTypes.begin(),limit=subTypes.end();iter!=limit;++iter) {
-      CacheEntry& c=stringCache[*iter];
-      if (tempDict)
-         tempDict->lookupById(*iter,c.start,c.stop,c.type,c.subType); else
-      if (diffIndex)
-         diffIndex->lookupById(*iter,c.start,c.stop,c.type,c.subType); else
-         dictionary.lookupById(*iter,c.start,c.stop,c.type,c.subType);
-   }
+   lookupStrings(dictionary,tempDict,diffIndex,stringCache,stringText);
+   for (map<unsigned,CacheEntry>::const_iterator iter=stringCache.begin(),limit=stringCache.end();iter!=limit;++iter)
+      if (Type::hasSubType((*iter).second.type))
+         subTypes.insert((*iter).second.subType);
+   map<unsigned,CacheEntry> subTypeCache;
+   for (set<unsigned>::const_iterator iter=subTypes.begin(),limit=subTypes.end();iter!=limit;++iter)
+      if (!stringCache.count(*iter))
+         subTypeCache[*iter];
+   lookupStrings(dictionary,tempDict,diffIndex,subTypeCache,subTypeText);
+   stringCache.insert(subTypeCache.begin(),subTypeCache.end());
 
    // Skip printing the results?
    if (silent)
@@ -1,67 +1,92 @@
 #include "rts/operator/Scheduler.hpp"
 #include "rts/operator/Operator.hpp"
 #include "infra/osdep/Thread.hpp"
+#include <cassert>
 #include <cstdlib>
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
-Scheduler::AsyncPoint::~AsyncPoint()
+Scheduler::MorselSource::~MorselSource()
    // Destructor
 {
 }
 //---------------------------------------------------------------------------
-Scheduler::RegisteredPoint::RegisteredPoint(AsyncPoint& point,unsigned schedulingClass,double priority)
-   : point(point),schedulingClass(schedulingClass),priority(priority)
-   // Constructor
+Scheduler::PipelineSink::~PipelineSink()
+   // Destructor
+{
+}
+//---------------------------------------------------------------------------
+unsigned Scheduler::PipelineSink::preparePartitions(const vector<PipelineSink*>& /*workers*/)
+   // Prepare combining the results of all workers
+{
+   return 0;
+}
+//---------------------------------------------------------------------------
+void Scheduler::PipelineSink::finishPartition(unsigned /*partition*/)
+   // Combine a partition of the results
 {
 }
 //---------------------------------------------------------------------------
 Scheduler::Scheduler()
-   : activeWorkers(0),workerThreads(0),workersDie(false)
+   : registeringWorker(0),currentPipeline(0),partitionSink(0),nextMorsel(0),morselCount(0),round(0),finishedWorkers(0),workerThreads(0),workersDie(false)
    // Constructor
+{
+}
+//---------------------------------------------------------------------------
+Scheduler::~Scheduler()
+   // Destructor
+{
+}
+//---------------------------------------------------------------------------
+unsigned Scheduler::getWorkerCount()
+   // The number of workers a query should use
 {
    // How many threads should we use?
-   threads=0;
+   unsigned threads=Thread::guessProcessorCount();
    if (getenv("MAXTHREADS"))
       threads=atoi(getenv("MAXTHREADS"));
-   if ((threads<2)||(threads>1000))
-      threads=0;
-
-   // Start worker threads
-   if (threads) {
-      workerLock.lock();
-      for (unsigned index=0;index<threads;index++)
-         Thread::start(asyncWorker,this);
-      workerLock.unlock();
-   }
+   if ((threads<1)||(threads>1000))
+      threads=1;
+   return threads;
 }
 //---------------------------------------------------------------------------
-Scheduler::~Scheduler()
-   // Destructor
+void Scheduler::beginPipeline()
+   // Start a new pipeline
 {
-   // Wait for all workers to stop
-   if (threads) {
-      workerLock.lock();
-      workersDie=true;
-      workerSignal.notifyAll(workerLock);
-      while (workerThreads)
-         workerSignal.wait(workerLock);
-      workerLock.unlock();
-   }
-
-   // Cleanup registered execution points
-   for (vector<RegisteredPoint*>::const_iterator iter=registeredPoints.begin(),limit=registeredPoints.end();iter!=limit;++iter)
-      delete *iter;
-   registeredPoints.clear();
+   OpenPipeline pipeline;
+   pipeline.source=0;
+   pipeline.blocked=false;
+   openPipelines.push_back(pipeline);
 }
 //---------------------------------------------------------------------------
-void Scheduler::registerAsyncPoint(AsyncPoint& point,unsigned schedulingClass,double priority,unsigned dependencies)
-   // Register an async execution point
+void Scheduler::endPipeline(PipelineSink& sink)
+   // Finish the current pipeline
 {
-   RegisteredPoint* p=new RegisteredPoint(point,schedulingClass,priority);
-   for (unsigned index=dependencies;index<registeredPoints.size();index++)
-      p->dependencies.insert(registeredPoints[index]);
-   registeredPoints.push_back(p);
+   Pipeline pipeline;
+   pipeline.sink=&sink;
+   pipeline.source=openPipelines.back().source;
+   openPipelines.pop_back();
+   pipelines[registeringWorker].push_back(pipeline);
+}
+//---------------------------------------------------------------------------
+void Scheduler::registerMorselSource(MorselSource& source)
+   // Register a scan
+{
+   if (openPipelines.empty())
+      return;
+   OpenPipeline& pipeline=openPipelines.back();
+   if ((!pipeline.source)&&(!pipeline.blocked))
+      pipeline.source=&source;
+}
+//---------------------------------------------------------------------------
+bool Scheduler::blockMorselSources(bool block)
+   // Exclude further scans of the current pipeline from driving it
+{
+   if (openPipelines.empty())
+      return false;
+   bool old=openPipelines.back().blocked;
+   openPipelines.back().blocked=block;
+   return old;
 }
 //---------------------------------------------------------------------------
 void Scheduler::executeSingleThreaded(Operator* root)
@@ -72,36 +97,58 @@ void Scheduler::executeSingleThreaded(Operator* root)
    }
 }
 //---------------------------------------------------------------------------
-void Scheduler::performWork()
+void Scheduler::execute(Operator* root)
+   // Execute a plan
+{
+   // Parallel execution needs a copy of the plan per worker, see ResultsPrinter
+   executeSingleThreaded(root);
+}
+//---------------------------------------------------------------------------
+void Scheduler::consumeMorsels(unsigned worker)
+   // Consume morsels of the current pipeline until none is left
+{
+   Pipeline& pipeline=pipelines[worker][currentPipeline];
+   while (true) {
+      // Steal the next morsel
+      workerLock.lock();
+      if (nextMorsel>=morselCount) {
+         workerLock.unlock();
+         return;
+      }
+      unsigned morsel=nextMorsel++;
+      workerLock.unlock();
+
+      // Combine a partition?
+      if (partitionSink) {
+         partitionSink->finishPartition(morsel);
+         continue;
+      }
+
+      // Push the morsel through the pipeline
+      if (pipeline.source)
+         pipeline.source->selectMorsel(morsel);
+      pipeline.sink->consumeMorsel(morsel);
+   }
+}
+//---------------------------------------------------------------------------
+void Scheduler::performWork(unsigned worker)
    // Perform the work of a worker thread
 {
-   // Register as worker
    workerLock.lock();
-   workerThreads++;
-
-   // Perform the work
+   unsigned seenRound=0;
    while (!workersDie) {
       // Nothing to do?
-      if (workQueue.empty()) {
+      if (round==seenRound) {
          workerSignal.wait(workerLock);
          continue;
       }
-      // Grab the next job
-      RegisteredPoint* job=workQueue.front();
-      workQueue.erase(workQueue.begin());
-      workerSignal.notifyAll(workerLock);
+      seenRound=round;
 
-      // Run the job
-      activeWorkers++;
+      // Work on the current pipeline
       workerLock.unlock();
-      job->point.run();
+      consumeMorsels(worker);
       workerLock.lock();
-      activeWorkers--;
-
-      // Eliminate it as done
-      for (vector<RegisteredPoint*>::iterator iter=registeredPoints.begin(),limit=registeredPoints.end();iter!=limit;++iter)
-         (*iter)->dependencies.erase(job);
-      delete job;
+      finishedWorkers++;
       workerSignal.notifyAll(workerLock);
    }
 
@@ -111,72 +158,111 @@ void Scheduler::performWork()
    workerLock.unlock();
 }
 //---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Start info for a worker thread
+struct WorkerInfo {
+   /// The scheduler
+   Scheduler* scheduler;
+   /// The worker
+   unsigned worker;
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
 void Scheduler::asyncWorker(void* info)
    // Thread entry point
 {
-   static_cast<Scheduler*>(info)->performWork();
+   WorkerInfo workerInfo=*static_cast<WorkerInfo*>(info);
+   delete static_cast<WorkerInfo*>(info);
+   workerInfo.scheduler->performWork(workerInfo.worker);
 }
 //---------------------------------------------------------------------------
-void Scheduler::execute(Operator* root)
-   // Execute a plan using, using potentially multiple threads
+void Scheduler::runRound(unsigned workers,unsigned count)
+   // Let all workers consume the morsels (or partitions) of a round
 {
-   // Run single threaded?
-   if (!threads) {
-      executeSingleThreaded(root);
-      return;
-   }
-
-   // Collect all asynchronous execution points
-   for (vector<RegisteredPoint*>::const_iterator iter=registeredPoints.begin(),limit=registeredPoints.end();iter!=limit;++iter)
-      delete *iter;
-   registeredPoints.clear();
-   root->getAsyncInputCandidates(*this);
-
-   // Execute all asynchronous execution points
-   while (!registeredPoints.empty()) {
-      // Is the worker queue full?
-      if ((workQueue.size()+activeWorkers)>=threads) {
-         workerSignal.wait(workerLock);
-         continue;
-      }
-      // Search for the best candidate the schedule next
-      RegisteredPoint* best=0;
-      vector<RegisteredPoint*>::iterator bestPos=registeredPoints.begin();
-      for (vector<RegisteredPoint*>::iterator iter=registeredPoints.begin(),limit=registeredPoints.end();iter!=limit;++iter) {
-         RegisteredPoint* p=*iter;
-         if (p->dependencies.empty()) {
-            if ((!best)||(best->schedulingClass>p->schedulingClass)||
-                ((best->schedulingClass==p->schedulingClass)&&(best->priority<p->priority))) {
-               best=p;
-               bestPos=iter;
-            }
-         }
-      }
-      // No candidate found?
-      if (!best) {
-         // Still work?
-         if (activeWorkers||workQueue.size()) {
-            workerSignal.wait(workerLock);
-            continue;
-         }
-         // No, cyclic dependency!
-         throw;
+   // Start the worker threads when there is something to share
+   workerLock.lock();
+   if ((count>1)&&(!workerThreads)) {
+      for (unsigned worker=1;worker<workers;worker++) {
+         WorkerInfo* info=new WorkerInfo();
+         info->scheduler=this;
+         info->worker=worker;
+         if (Thread::start(asyncWorker,info))
+            workerThreads++; else
+            delete info;
       }
-      // Add the task
-      workQueue.push_back(best);
-      swap(*bestPos,registeredPoints.back());
-      registeredPoints.pop_back();
-      workerSignal.notifyAll(workerLock);
    }
-   while (!workQueue.empty())
-      workerSignal.wait(workerLock);
-   while (activeWorkers)
+
+   // The calling thread is the first worker
+   nextMorsel=0;
+   morselCount=count;
+   finishedWorkers=0;
+   round++;
+   workerSignal.notifyAll(workerLock);
+   workerLock.unlock();
+   consumeMorsels(0);
+   workerLock.lock();
+   while (finishedWorkers<workerThreads)
       workerSignal.wait(workerLock);
    workerLock.unlock();
+}
+//---------------------------------------------------------------------------
+void Scheduler::runPipeline(unsigned pipeline)
+   // Execute a pipeline on all workers
+{
+   // Split the driving scan into morsels
+   unsigned workers=pipelines.size(),count=1;
+   if (pipelines[0][pipeline].source) {
+      count=pipelines[0][pipeline].source->prepareMorsels(workers*morselsPerWorker);
+      for (unsigned worker=1;worker<workers;worker++)
+         pipelines[worker][pipeline].source->prepareMorsels(workers*morselsPerWorker);
+   }
 
-   // Now run the main parts if any
-   if (root->first()) {
-      while (root->next()) ;
+   // Let all workers consume morsels
+   currentPipeline=pipeline;
+   runRound(workers,count);
+
+   // Combine the results, partition by partition if supported
+   vector<PipelineSink*> sinks;
+   for (unsigned worker=0;worker<workers;worker++)
+      sinks.push_back(pipelines[worker][pipeline].sink);
+   unsigned partitions=sinks[0]->preparePartitions(sinks);
+   if (partitions) {
+      partitionSink=sinks[0];
+      runRound(workers,partitions);
+      partitionSink=0;
    }
+   sinks[0]->finishPipeline(sinks);
+}
+//---------------------------------------------------------------------------
+void Scheduler::execute(const vector<Operator*>& roots,const vector<PipelineSink*>& sinks)
+   // Execute copies of a plan using one worker per copy
+{
+   // Collect the pipelines of every copy. The copies are identical, so the pipelines correspond
+   pipelines.clear();
+   pipelines.resize(roots.size());
+   for (unsigned worker=0;worker<roots.size();worker++) {
+      registeringWorker=worker;
+      openPipelines.clear();
+      beginPipeline();
+      roots[worker]->getAsyncInputCandidates(*this);
+      endPipeline(*sinks[worker]);
+      assert(pipelines[worker].size()==pipelines[0].size());
+   }
+
+   // Run the pipelines, inner pipelines were registered first
+   for (unsigned index=0;index<pipelines[0].size();index++)
+      runPipeline(index);
+
+   // Wait for all workers to stop
+   workerLock.lock();
+   workersDie=true;
+   workerSignal.notifyAll(workerLock);
+   while (workerThreads)
+      workerSignal.wait(workerLock);
+   workersDie=false;
+   workerLock.unlock();
+   pipelines.clear();
 }
 //---------------------------------------------------------------------------
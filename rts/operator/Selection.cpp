@@ -3,6 +3,7 @@
 #include "rts/database/Database.hpp"
 #include "rts/runtime/Runtime.hpp"
 #include "rts/segment/DictionarySegment.hpp"
+#include <algorithm>
 #include <sstream>
 #include <cassert>
 #include <cstdlib>
@@ -36,9 +37,7 @@ void Selection::Result::ensureString(Selection* selection)
 {
    if (!(flags&stringAvailable)) {
       if (flags&idAvailable) {
-         const char* start,*stop;
-         if ((~id)&&(selection->runtime.getDatabase().getDictionary().lookupById(id,start,stop,type,subType))) {
-            value=string(start,stop);
+         if ((~id)&&(selection->runtime.getDatabase().getDictionary().lookupById(id,value,type,subType))) {
             flags|=typeAvailable;
          } else {
             value="NULL";
@@ -59,9 +58,7 @@ void Selection::Result::ensureType(Selection* selection)
 {
    if (!(flags&typeAvailable)) {
       if (flags&idAvailable) {
-         const char* start,*stop;
-         if ((~id)&&(selection->runtime.getDatabase().getDictionary().lookupById(id,start,stop,type,subType))) {
-            value=string(start,stop);
+         if ((~id)&&(selection->runtime.getDatabase().getDictionary().lookupById(id,value,type,subType))) {
             flags|=stringAvailable;
          } else {
             type=Type::Literal; // XXX NULL type?
@@ -81,11 +78,8 @@ void Selection::Result::ensureSubType(Selection* selection)
    ensureType(selection);
    if (!(flags&subTypeAvailable)) {
       if ((type==Type::CustomLanguage)||(type==Type::CustomType)) {
-         const char* start,*stop;
          Type::ID t; unsigned st;
-         if (selection->runtime.getDatabase().getDictionary().lookupById(subType,start,stop,t,st)) {
-            subTypeValue=string(start,stop);
-         } else {
+         if (!selection->runtime.getDatabase().getDictionary().lookupById(subType,subTypeValue,t,st)) {
             subTypeValue.clear();
          }
       } else {
@@ -153,6 +147,11 @@ void Selection::Predicate::setSelection(Selection* s)
    selection=s;
 }
 //---------------------------------------------------------------------------
+void Selection::Predicate::collectRegisters(vector<Register*>& /*registers*/)
+   // Collect the registers read by the predicate
+{
+}
+//---------------------------------------------------------------------------
 bool Selection::Predicate::check()
    // Check the predicate
 {
@@ -177,6 +176,13 @@ void Selection::BinaryPredicate::setSelection(Selection* s)
    right->setSelection(s);
 }
 //---------------------------------------------------------------------------
+void Selection::BinaryPredicate::collectRegisters(vector<Register*>& registers)
+   // Collect the registers read by the predicate
+{
+   left->collectRegisters(registers);
+   right->collectRegisters(registers);
+}
+//---------------------------------------------------------------------------
 Selection::UnaryPredicate::~UnaryPredicate()
    // Destructor
 {
@@ -190,6 +196,12 @@ void Selection::UnaryPredicate::setSelection(Selection* s)
    input->setSelection(s);
 }
 //---------------------------------------------------------------------------
+void Selection::UnaryPredicate::collectRegisters(vector<Register*>& registers)
+   // Collect the registers read by the predicate
+{
+   input->collectRegisters(registers);
+}
+//---------------------------------------------------------------------------
 void Selection::Or::eval(Result& result)
    // Evaluate the predicate
 {
@@ -436,6 +448,12 @@ string Selection::False::print(PlanPrinter& /*out*/)
    return "false";
 }
 //---------------------------------------------------------------------------
+void Selection::Variable::collectRegisters(vector<Register*>& registers)
+   // Collect the registers read by the predicate
+{
+   registers.push_back(reg);
+}
+//---------------------------------------------------------------------------
 void Selection::Variable::eval(Result& result)
    // Evaluate the predicate
 {
@@ -504,6 +522,13 @@ void Selection::FunctionCall::setSelection(Selection* s)
       (*iter)->setSelection(s);
 }
 //---------------------------------------------------------------------------
+void Selection::FunctionCall::collectRegisters(vector<Register*>& registers)
+   // Collect the registers read by the predicate
+{
+   for (vector<Predicate*>::iterator iter=args.begin(),limit=args.end();iter!=limit;++iter)
+      (*iter)->collectRegisters(registers);
+}
+//---------------------------------------------------------------------------
 void Selection::FunctionCall::eval(Result& result)
    // Evaluate the predicate
 {
@@ -610,6 +635,12 @@ string Selection::BuiltinDatatype::print(PlanPrinter& out)
    return "datatype("+input->print(out)+")";
 }
 //---------------------------------------------------------------------------
+void Selection::BuiltinBound::collectRegisters(vector<Register*>& registers)
+   // Collect the registers read by the predicate
+{
+   registers.push_back(reg);
+}
+//---------------------------------------------------------------------------
 void Selection::BuiltinBound::eval(Result& result)
    // Evaluate the predicate
 {
@@ -720,6 +751,14 @@ void Selection::BuiltinRegEx::setSelection(Selection* s)
    if (arg3) arg3->setSelection(s);
 }
 //---------------------------------------------------------------------------
+void Selection::BuiltinRegEx::collectRegisters(vector<Register*>& registers)
+   // Collect the registers read by the predicate
+{
+   arg1->collectRegisters(registers);
+   arg2->collectRegisters(registers);
+   if (arg3) arg3->collectRegisters(registers);
+}
+//---------------------------------------------------------------------------
 void Selection::BuiltinRegEx::eval(Result& result)
    // Evaluate the predicate
 {
@@ -772,6 +811,14 @@ void Selection::BuiltinIn::setSelection(Selection* s)
       (*iter)->setSelection(s);
 }
 //---------------------------------------------------------------------------
+void Selection::BuiltinIn::collectRegisters(vector<Register*>& registers)
+   // Collect the registers read by the predicate
+{
+   probe->collectRegisters(registers);
+   for (vector<Predicate*>::iterator iter=args.begin(),limit=args.end();iter!=limit;++iter)
+      (*iter)->collectRegisters(registers);
+}
+//---------------------------------------------------------------------------
 void Selection::BuiltinIn::eval(Result& result)
    // Evaluate the predicate
 {
@@ -858,6 +905,87 @@ unsigned Selection::next()
    }
 }
 //---------------------------------------------------------------------------
+unsigned Selection::filterBatch(Batch& batch)
+   // Filter input batches until a tuple qualifies
+{
+   batch.clear();
+
+   // Map the output columns to the input
+   unsigned columnCount=batch.getColumnCount();
+   vector<const unsigned*> sources(columnCount);
+   vector<unsigned*> targets(columnCount);
+   for (unsigned column=0;column<columnCount;column++) {
+      sources[column]=inputBatch.getColumn(inputBatch.findColumn(batch.getRegisters()[column]));
+      targets[column]=batch.getColumn(column);
+   }
+   unsigned* counts=batch.getCounts();
+
+   // Both batches have the same capacity, a single input batch always fits
+   unsigned size=0;
+   while (true) {
+      const unsigned* inputCounts=inputBatch.getCounts();
+      for (unsigned row=0,limit=inputBatch.getSize();row<limit;row++) {
+         // Load the values seen by the predicate
+         for (vector<unsigned>::const_iterator iter=predicateColumns.begin(),limit2=predicateColumns.end();iter!=limit2;++iter)
+            inputBatch.getRegisters()[*iter]->value=inputBatch.getColumn(*iter)[row];
+         if (!predicate->check())
+            continue;
+
+         for (unsigned column=0;column<columnCount;column++)
+            targets[column][size]=sources[column][row];
+         counts[size++]=inputCounts[row];
+         observedOutputCardinality+=inputCounts[row];
+      }
+      if (size)
+         break;
+      if (!input->nextBatch(inputBatch))
+         break;
+   }
+   batch.setSize(size);
+   return size;
+}
+//---------------------------------------------------------------------------
+unsigned Selection::firstBatch(Batch& batch)
+   // Produce the first batch of tuples
+{
+   observedOutputCardinality=0;
+   predicate->setSelection(this);
+
+   // Request the output columns and everything the predicate reads
+   vector<Register*> registers=batch.getRegisters(),predicateRegisters;
+   predicate->collectRegisters(predicateRegisters);
+   registers.insert(registers.end(),predicateRegisters.begin(),predicateRegisters.end());
+   inputBatch.setRegisters(registers);
+   predicateColumns.clear();
+   for (vector<Register*>::const_iterator iter=predicateRegisters.begin(),limit=predicateRegisters.end();iter!=limit;++iter) {
+      unsigned column=inputBatch.findColumn(*iter);
+      if (find(predicateColumns.begin(),predicateColumns.end(),column)==predicateColumns.end())
+         predicateColumns.push_back(column);
+   }
+
+   if (!input->firstBatch(inputBatch)) {
+      batch.clear();
+      return 0;
+   }
+   return filterBatch(batch);
+}
+//---------------------------------------------------------------------------
+unsigned Selection::nextBatch(Batch& batch)
+   // Produce the next batch of tuples
+{
+   if (!input->nextBatch(inputBatch)) {
+      batch.clear();
+      return 0;
+   }
+   return filterBatch(batch);
+}
+//---------------------------------------------------------------------------
+bool Selection::supportsBatches() const
+   // Are batches produced natively?
+{
+   return input->supportsBatches();
+}
+//---------------------------------------------------------------------------
 void Selection::print(PlanPrinter& out)
    // Print the operator tree. Debugging only.
 {
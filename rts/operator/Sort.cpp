@@ -5,6 +5,8 @@
 #include "rts/runtime/Runtime.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include <algorithm>
+#include <cstring>
+#include <iostream>
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -17,84 +19,203 @@
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
-/// Comparator
-class Sort::Sorter
+namespace {
+//---------------------------------------------------------------------------
+static void appendUint32(vector<unsigned char>& key,unsigned value)
+   // Append a value in big endian order
+{
+   key.push_back(static_cast<unsigned char>(value>>24));
+   key.push_back(static_cast<unsigned char>(value>>16));
+   key.push_back(static_cast<unsigned char>(value>>8));
+   key.push_back(static_cast<unsigned char>(value));
+}
+//---------------------------------------------------------------------------
+static void encodeString(vector<unsigned char>& key,unsigned id,const DictionarySegment::IdString& string)
+   // Append the binary key of a string. Comparing keys with memcmp compares by type, sub-type, string, and id
+{
+   // Unknown ids compare equal, but after NULL values
+   if (!string.found) {
+      key.push_back(1);
+      return;
+   }
+
+   // Type and sub-type
+   key.push_back(2);
+   key.push_back(static_cast<unsigned char>(string.type));
+   if (Type::hasSubType(string.type))
+      appendUint32(key,string.subType);
+
+   // The string. Zero bytes are escaped, so that shorter strings sort first
+   for (const char* iter=string.start,*limit=string.stop;iter!=limit;++iter) {
+      key.push_back(static_cast<unsigned char>(*iter));
+      if (!*iter)
+         key.push_back(0xFF);
+   }
+   key.push_back(0);
+   key.push_back(0);
+
+   // Tie breaker. Should not be necessary...
+   appendUint32(key,id);
+}
+//---------------------------------------------------------------------------
+static inline int compareKeys(const unsigned char* a,unsigned lenA,const unsigned char* b,unsigned lenB)
+   // Compare two binary keys
+{
+   int c=memcmp(a,b,min(lenA,lenB));
+   if (c) return c;
+   if (lenA<lenB) return -1;
+   if (lenA>lenB) return 1;
+   return 0;
+}
+//---------------------------------------------------------------------------
+/// Order the distinct ids by their binary keys
+class IdSorter
+{
+   private:
+   /// The binary keys
+   const vector<unsigned char>& keys;
+   /// The offsets of the keys
+   const vector<unsigned>& ofs;
+
+   public:
+   /// Constructor
+   IdSorter(const vector<unsigned char>& keys,const vector<unsigned>& ofs) : keys(keys),ofs(ofs) {}
+
+   /// Compare
+   bool operator()(unsigned a,unsigned b) const { return compareKeys(&keys[ofs[a]],ofs[a+1]-ofs[a],&keys[ofs[b]],ofs[b+1]-ofs[b])<0; }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+/// Compare sort entries by the ranks of their sort keys
+class Sort::EntrySorter
 {
    private:
-   /// The dictionary
-   DictionarySegment& dict;
-   /// The sort order
-   const vector<Order>& order;
+   /// The ranks
+   const unsigned* ranks;
+   /// The number of sort keys
+   unsigned keyCount;
 
    public:
    /// Constructor
-   Sorter(DictionarySegment& dict,const vector<Order>& order) : dict(dict),order(order) {}
+   EntrySorter(const vector<unsigned>& ranks,unsigned keyCount) : ranks(ranks.empty()?0:&ranks[0]),keyCount(keyCount) {}
 
    /// Compare
-   bool operator()(const Tuple* a,const Tuple* b);
+   bool operator()(const Entry& a,const Entry& b) const;
 };
 //---------------------------------------------------------------------------
-bool Sort::Sorter::operator()(const Tuple* a,const Tuple* b)
+bool Sort::EntrySorter::operator()(const Entry& a,const Entry& b) const
    // Compare
 {
-   for (vector<Order>::const_iterator iter=order.begin(),limit=order.end();iter!=limit;++iter) {
-      unsigned slot=(*iter).slot;
-      if (~slot) {
-         // Access values
-         unsigned v1,v2;
-         if ((*iter).descending) {
-            v1=b->values[slot];
-            v2=a->values[slot];
-         } else {
-            v1=a->values[slot];
-            v2=b->values[slot];
-         }
+   // The first two keys decide most comparisons
+   if (a.prefix<b.prefix) return true;
+   if (a.prefix>b.prefix) return false;
 
-         // Equal?
-         if (v1==v2) continue;
-
-         // Null values
-         if (!~v1) return true;
-         if (!~v2) return false;
-
-         // Load the strings
-         const char* start1,*stop1,*start2,*stop2;
-         Type::ID type1,type2; unsigned subType1,subType2;
-         if (!dict.lookupById(v1,start1,stop1,type1,subType1)) continue;
-         if (!dict.lookupById(v2,start2,stop2,type2,subType2)) continue;
-
-         // Compare
-         if (type1<type2) return true;
-         if (type1>type2) return false;
-         if (Type::hasSubType(type1)) {
-            if (subType1<subType2) return true;
-            if (subType1>subType2) return false;
-         }
-         int c=memcmp(start1,start2,min(stop1-start1,stop2-start2));
-         if (c<0) return true;
-         if (c>0) return false;
-         if ((stop1-start1)<(stop2-start2)) return true;
-         if ((stop1-start1)>(stop2-start2)) return false;
-
-         // Tie breaker. Should not be necessary...
-         if (v1<v2) return true;
-         if (v1>v2) return false;
-      } else {
-         // Sort by count
-         if ((*iter).descending) {
-            if (a->count>b->count) return true;
-            if (a->count<b->count) return false;
-         } else {
-            if (a->count<b->count) return true;
-            if (a->count>b->count) return false;
-         }
-      }
+   // Check the remaining keys
+   const unsigned* ra=ranks+a.tuple*keyCount,*rb=ranks+b.tuple*keyCount;
+   for (unsigned index=2;index<keyCount;index++) {
+      if (ra[index]<rb[index]) return true;
+      if (ra[index]>rb[index]) return false;
    }
    return false;
 }
 //---------------------------------------------------------------------------
+/// A spilled run
+class Sort::Run
+{
+   private:
+   /// The size of the read buffer in words
+   static const unsigned bufferSize = 16384;
+
+   /// The file
+   FILE* file;
+   /// The unread part of the run
+   long ofs,end;
+   /// The number of words of a tuple
+   unsigned width;
+   /// The read buffer
+   vector<unsigned> buffer;
+   /// The position in the buffer
+   unsigned pos,size;
+   /// The current tuple
+   const unsigned* tuple;
+   /// The key of the current tuple
+   const unsigned char* key;
+   /// The key length
+   unsigned keyLen;
+
+   /// Make sure the buffer contains the next words. Reports read errors
+   bool ensure(unsigned words);
+
+   public:
+   /// Constructor
+   Run(FILE* file,long begin,long end,unsigned width) : file(file),ofs(begin),end(end),width(width),pos(0),size(0),tuple(0),key(0),keyLen(0) {}
+
+   /// Read the next tuple
+   bool next();
+   /// The current tuple. The count followed by the values
+   const unsigned* getTuple() const { return tuple; }
+   /// Compare the current tuples of two runs
+   static int compare(const Run& a,const Run& b) { return compareKeys(a.key,a.keyLen,b.key,b.keyLen); }
+};
+//---------------------------------------------------------------------------
+bool Sort::Run::ensure(unsigned words)
+   // Make sure the buffer contains the next words
+{
+   if (size-pos>=words)
+      return true;
+
+   // Keep the unread part
+   if (pos) {
+      memmove(buffer.data(),buffer.data()+pos,(size-pos)*sizeof(unsigned));
+      size-=pos;
+      pos=0;
+   }
+   if (buffer.size()<words)
+      buffer.resize(max(words,bufferSize));
+
+   // Read as much as possible
+   long bytes=min(static_cast<long>((buffer.size()-size)*sizeof(unsigned)),end-ofs);
+   if (bytes>0) {
+      if ((fseek(file,ofs,SEEK_SET)!=0)||(fread(buffer.data()+size,1,bytes,file)!=static_cast<size_t>(bytes))) {
+         cerr << "error: unable to read a spilled sort run, the result is incomplete" << endl;
+         ofs=end; size=pos;
+         return false;
+      }
+      ofs+=bytes;
+      size+=bytes/sizeof(unsigned);
+   }
+   return size-pos>=words;
+}
+//---------------------------------------------------------------------------
+bool Sort::Run::next()
+   // Read the next tuple
+{
+   // A tuple is stored as key length, count, values, and key
+   if (!ensure(2))
+      return false;
+   unsigned words=1+width+(buffer[pos]/sizeof(unsigned));
+   if (!ensure(words))
+      return false;
+
+   const unsigned* record=buffer.data()+pos;
+   keyLen=record[0];
+   tuple=record+1;
+   key=reinterpret_cast<const unsigned char*>(record+1+width);
+   pos+=words;
+   return true;
+}
+//---------------------------------------------------------------------------
+/// Order runs by their current tuple, the smallest first
+class Sort::RunSorter
+{
+   public:
+   /// Compare
+   bool operator()(const Run* a,const Run* b) const { return Run::compare(*a,*b)>0; }
+};
+//---------------------------------------------------------------------------
 Sort::Sort(Database& db,Operator* input,const vector<Register*>& values,const vector<pair<Register*,bool> >& registerOrder,double expectedOutputCardinality)
-   : Operator(expectedOutputCardinality),values(values),input(input),tuplesPool(values.size()*sizeof(unsigned)),dict(db.getDictionary())
+   : Operator(expectedOutputCardinality),values(values),input(input),dict(db.getDictionary()),memoryLimit(db.getSortMemoryLimit()),spillFile(0),entriesPos(0)
    // Constructor
 {
    for (vector<pair<Register*,bool> >::const_iterator iter=registerOrder.begin(),limit=registerOrder.end();iter!=limit;++iter) {
@@ -119,47 +240,261 @@ Sort::Sort(Database& db,Operator* input,const vector<Register*>& values,const ve
 Sort::~Sort()
    // Destructor
 {
+   discardRuns();
    delete input;
 }
 //---------------------------------------------------------------------------
+void Sort::sortTuples()
+   // Rank and sort the buffered tuples
+{
+   unsigned width=values.size()+1,count=tuples.size()/width,keyCount=order.size();
+
+   // Collect the distinct ids of the sort keys
+   keyIds.clear();
+   for (vector<Order>::const_iterator iter=order.begin(),limit=order.end();iter!=limit;++iter)
+      if (~(*iter).slot)
+         for (unsigned index=0;index<count;index++) {
+            unsigned v=tuples[index*width+1+(*iter).slot];
+            if (~v)
+               keyIds.push_back(v);
+         }
+   sort(keyIds.begin(),keyIds.end());
+   keyIds.erase(unique(keyIds.begin(),keyIds.end()),keyIds.end());
+
+   // Resolve the strings at once and build their binary keys
+   vector<DictionarySegment::IdString> strings;
+   vector<char> text;
+   dict.lookupByIds(keyIds,strings,text);
+   idKeys.clear();
+   idKeyOfs.clear();
+   for (unsigned index=0,limit=keyIds.size();index<limit;index++) {
+      idKeyOfs.push_back(idKeys.size());
+      encodeString(idKeys,keyIds[index],strings[index]);
+   }
+   idKeyOfs.push_back(idKeys.size());
+
+   // Rank the ids by their keys. Rank 0 is NULL, equal keys share a rank
+   vector<unsigned> byKey(keyIds.size()),idRanks(keyIds.size());
+   for (unsigned index=0,limit=byKey.size();index<limit;index++)
+      byKey[index]=index;
+   IdSorter idSorter(idKeys,idKeyOfs);
+   sort(byKey.begin(),byKey.end(),idSorter);
+   rankedIds.clear();
+   for (unsigned index=0,limit=byKey.size();index<limit;index++) {
+      if ((!index)||(idSorter(byKey[index-1],byKey[index])))
+         rankedIds.push_back(byKey[index]);
+      idRanks[byKey[index]]=rankedIds.size();
+   }
+
+   // Compute the ranks of the tuples
+   ranks.resize(count*keyCount);
+   entries.resize(count);
+   for (unsigned index=0;index<count;index++) {
+      const unsigned* t=&tuples[index*width];
+      unsigned* r=ranks.data()+index*keyCount;
+      for (unsigned index2=0;index2<keyCount;index2++) {
+         const Order& o=order[index2];
+         unsigned rank;
+         if (~o.slot) {
+            unsigned v=t[1+o.slot];
+            rank=(~v)?idRanks[lower_bound(keyIds.begin(),keyIds.end(),v)-keyIds.begin()]:0;
+         } else {
+            rank=t[0];
+         }
+         r[index2]=o.descending?~rank:rank;
+      }
+      entries[index].prefix=(static_cast<uint64_t>((keyCount>0)?r[0]:0)<<32)|((keyCount>1)?r[1]:0);
+      entries[index].tuple=index;
+   }
+
+   // Sort them
+   sort(entries.begin(),entries.end(),EntrySorter(ranks,keyCount));
+}
+//---------------------------------------------------------------------------
+bool Sort::spillTuples()
+   // Sort the buffered tuples and spill them as a run. Keeps them buffered if writing fails
+{
+   // Create the temporary file
+   if (!spillFile) {
+      spillFile=tmpfile();
+      if (!spillFile)
+         return false;
+   }
+
+   // Sort the tuples
+   sortTuples();
+
+   // And write them with their binary keys
+   unsigned width=values.size()+1,keyCount=order.size();
+   if (fseek(spillFile,0,SEEK_END)!=0)
+      return false;
+   long begin=ftell(spillFile);
+   if (begin<0)
+      return false;
+   vector<unsigned char> key;
+   for (vector<Entry>::const_iterator iter=entries.begin(),limit=entries.end();iter!=limit;++iter) {
+      const unsigned* t=&tuples[(*iter).tuple*width];
+      const unsigned* r=&ranks[(*iter).tuple*keyCount];
+      key.clear();
+      for (unsigned index=0;index<keyCount;index++) {
+         const Order& o=order[index];
+         unsigned start=key.size();
+         if (~o.slot) {
+            unsigned rank=o.descending?~r[index]:r[index];
+            if (rank) {
+               unsigned id=rankedIds[rank-1];
+               key.insert(key.end(),idKeys.begin()+idKeyOfs[id],idKeys.begin()+idKeyOfs[id+1]);
+            } else key.push_back(0);
+         } else {
+            appendUint32(key,t[0]);
+         }
+         if (o.descending)
+            for (unsigned index2=start,limit2=key.size();index2<limit2;index2++)
+               key[index2]=~key[index2];
+      }
+      while (key.size()%sizeof(unsigned))
+         key.push_back(0);
+
+      unsigned keyLen=key.size();
+      if (fwrite(&keyLen,sizeof(unsigned),1,spillFile)!=1)
+         return false;
+      if (fwrite(t,sizeof(unsigned),width,spillFile)!=width)
+         return false;
+      if (keyLen&&(fwrite(key.data(),1,keyLen,spillFile)!=keyLen))
+         return false;
+   }
+   // Flush, so that write errors show up now and the merge can read the run
+   if (fflush(spillFile)!=0)
+      return false;
+   long end=ftell(spillFile);
+   if (end<0)
+      return false;
+   runs.push_back(new Run(spillFile,begin,end,width));
+
+   // Release the tuples
+   tuples.clear();
+   ranks.clear();
+   entries.clear();
+   return true;
+}
+//---------------------------------------------------------------------------
+void Sort::loadRuns()
+   // Read the spilled runs back into the buffer
+{
+   unsigned width=values.size()+1;
+   for (vector<Run*>::const_iterator iter=runs.begin(),limit=runs.end();iter!=limit;++iter)
+      while ((*iter)->next()) {
+         const unsigned* t=(*iter)->getTuple();
+         tuples.insert(tuples.end(),t,t+width);
+      }
+   discardRuns();
+}
+//---------------------------------------------------------------------------
+void Sort::discardRuns()
+   // Release spilled runs
+{
+   for (vector<Run*>::const_iterator iter=runs.begin(),limit=runs.end();iter!=limit;++iter)
+      delete *iter;
+   runs.clear();
+   if (spillFile) {
+      fclose(spillFile);
+      spillFile=0;
+   }
+}
+//---------------------------------------------------------------------------
 unsigned Sort::first()
    // Produce the first tuple
 {
    observedOutputCardinality=0;
 
-   // Collect the input
+   // Collect the input, spill runs if the memory limit is reached
+   discardRuns();
    tuples.clear();
-   tuplesPool.freeAll();
+   entries.clear();
+   unsigned width=values.size()+1;
+   // Every buffered tuple needs its values, its ranks, and a sort entry
+   uint64_t tupleSize=(width+order.size())*sizeof(unsigned)+sizeof(Entry);
+   uint64_t maxTuples=max<uint64_t>(memoryLimit/tupleSize,1);
+   bool spill=true;
    for (unsigned count=input->first();count;count=input->next()) {
-      Tuple* t=tuplesPool.alloc();
-      t->count=count;
+      if (spill&&(tuples.size()+width>tuples.capacity())) {
+         uint64_t capacity=tuples.capacity()/width;
+         if (capacity>=maxTuples) {
+            // The buffer is full, spill it. Sort in memory if that fails
+            if (!spillTuples()) {
+               cerr << "warning: unable to spill a sort run, sorting in memory" << endl;
+               loadRuns();
+               spill=false;
+            }
+         } else if (2*capacity>maxTuples) {
+            // Growing doubles the buffer, grow only up to the limit
+            tuples.reserve(maxTuples*width);
+         }
+      }
+      tuples.push_back(count);
       for (unsigned index=0,limit=values.size();index<limit;index++)
-         t->values[index]=values[index]->value;
-      tuples.push_back(t);
+         tuples.push_back(values[index]->value);
    }
 
-   // Sort it
-   Sorter sorter(dict,order);
-   sort(tuples.begin(),tuples.end(),sorter);
+   // Spill the rest if some runs are spilled already
+   entriesPos=0;
+   if ((!runs.empty())&&(!tuples.empty())&&(!spillTuples())) {
+      cerr << "warning: unable to spill a sort run, sorting in memory" << endl;
+      loadRuns();
+   }
+
+   // Did everything fit?
+   if (runs.empty()) {
+      sortTuples();
+      return next();
+   }
+
+   // No, merge the runs
+   vector<Run*> heads;
+   for (vector<Run*>::const_iterator iter=runs.begin(),limit=runs.end();iter!=limit;++iter)
+      if ((*iter)->next())
+         heads.push_back(*iter); else
+         delete *iter;
+   runs.swap(heads);
+   make_heap(runs.begin(),runs.end(),RunSorter());
 
-   // Return the first one
-   tuplesIter=tuples.begin();
    return next();
 }
 //---------------------------------------------------------------------------
 unsigned Sort::next()
    // Produce the next tuple
 {
+   // Merging spilled runs?
+   if (!runs.empty()) {
+      // Produce the smallest head
+      Run* run=runs.front();
+      pop_heap(runs.begin(),runs.end(),RunSorter());
+      const unsigned* t=run->getTuple();
+      for (unsigned index=0,limit=values.size();index<limit;index++)
+         values[index]->value=t[1+index];
+      unsigned count=t[0];
+
+      // Advance the run
+      if (run->next()) {
+         push_heap(runs.begin(),runs.end(),RunSorter());
+      } else {
+         delete run;
+         runs.pop_back();
+      }
+
+      observedOutputCardinality+=count;
+      return count;
+   }
+
    // End of input
-   if (tuplesIter==tuples.end())
+   if (entriesPos>=entries.size())
       return 0;
 
    // Produce the next tuple
-   const Tuple& t=**tuplesIter;
+   const unsigned* t=&tuples[entries[entriesPos++].tuple*(values.size()+1)];
    for (unsigned index=0,limit=values.size();index<limit;index++)
-      values[index]->value=t.values[index];
-   unsigned count=t.count;
-   ++tuplesIter;
+      values[index]->value=t[1+index];
+   unsigned count=t[0];
 
    observedOutputCardinality+=count;
    return count;
@@ -1,4 +1,5 @@
 #include "rts/operator/TableFunction.hpp"
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/operator/PlanPrinter.hpp"
 #include "rts/runtime/Runtime.hpp"
@@ -62,12 +63,13 @@ void TableFunction::requestTable()
          if (!~v) {
             cout << "NULL";
          } else {
+            BufferReference page;
             const char* start,*stop; Type::ID type; unsigned subType;
             bool ok;
             if (runtime.hasTemporaryDictionary()) {
-               ok=runtime.getTemporaryDictionary().lookupById(v,start,stop,type,subType);
+               ok=runtime.getTemporaryDictionary().lookupById(v,page,start,stop,type,subType);
             } else {
-               ok=runtime.getDatabase().getDictionary().lookupById(v,start,stop,type,subType);
+               ok=runtime.getDatabase().getDictionary().lookupById(v,page,start,stop,type,subType);
             }
             if (!ok) {
                cout << "NULL";
@@ -85,9 +87,9 @@ void TableFunction::requestTable()
                      case Type::Literal: break;
                      case Type::CustomLanguage:
                         if (runtime.hasTemporaryDictionary()) {
-                           ok=runtime.getTemporaryDictionary().lookupById(subType,start,stop,type,subType);
+                           ok=runtime.getTemporaryDictionary().lookupById(subType,page,start,stop,type,subType);
                         } else {
-                           ok=runtime.getDatabase().getDictionary().lookupById(subType,start,stop,type,subType);
+                           ok=runtime.getDatabase().getDictionary().lookupById(subType,page,start,stop,type,subType);
                         }
                         if (ok) {
                            cout << "@";
@@ -96,9 +98,9 @@ void TableFunction::requestTable()
                         break;
                      case Type::CustomType:
                         if (runtime.hasTemporaryDictionary()) {
-                           ok=runtime.getTemporaryDictionary().lookupById(subType,start,stop,type,subType);
+                           ok=runtime.getTemporaryDictionary().lookupById(subType,page,start,stop,type,subType);
                         } else {
-                           ok=runtime.getDatabase().getDictionary().lookupById(subType,start,stop,type,subType);
+                           ok=runtime.getDatabase().getDictionary().lookupById(subType,page,start,stop,type,subType);
                         }
                         if (ok) {
                            cout << "^^<";
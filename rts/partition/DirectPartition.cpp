@@ -0,0 +1,216 @@
+#include "rts/partition/DirectPartition.hpp"
+#include "rts/buffer/BufferReference.hpp"
+#include "infra/osdep/MemoryArena.hpp"
+#include <cassert>
+#include <iostream>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//----------------------------------------------------------------------------
+using namespace std;
+//----------------------------------------------------------------------------
+/// The size of a block of page buffers
+static const size_t blockSize = MemoryArena::hugePageSize;
+//----------------------------------------------------------------------------
+DirectPartition::DirectPartition(bool direct)
+   : size(0),blockPos(0),blockLimit(0),direct(direct)
+   // Constructor
+{
+}
+//----------------------------------------------------------------------------
+DirectPartition::~DirectPartition()
+   // Destructor
+{
+   close();
+}
+//----------------------------------------------------------------------------
+void* DirectPartition::allocBuffer(unsigned pageNo)
+   // Allocate a new buffer
+{
+   BufferPool& pool=pools[pageNo%poolCount];
+   pool.mutex.lock();
+   if (!pool.buffers.empty()) {
+      void* result=pool.buffers.back();
+      pool.buffers.pop_back();
+      pool.mutex.unlock();
+      return result;
+   }
+   pool.mutex.unlock();
+
+   // Buffers are cut from huge page blocks shared by all threads. Their
+   // number is bounded by the frames in the buffer manager, they are reused
+   auto_lock lock(mutex);
+   if (blockPos==blockLimit) {
+      blockPos=static_cast<char*>(MemoryArena::alloc(blockSize,MemoryArena::Placement_Interleaved));
+      blockLimit=blockPos+blockSize;
+      blocks.push_back(blockPos);
+   }
+   void* result=blockPos;
+   blockPos+=BufferReference::pageSize;
+   return result;
+}
+//----------------------------------------------------------------------------
+void DirectPartition::freeBuffer(unsigned pageNo,void* buffer)
+   // Release a buffer
+{
+   BufferPool& pool=pools[pageNo%poolCount];
+   auto_lock lock(pool.mutex);
+   pool.buffers.push_back(buffer);
+}
+//----------------------------------------------------------------------------
+bool DirectPartition::open(const char* name,bool readOnly)
+   // Open an existing partition
+{
+   close();
+
+   // Try to open the file
+   if (!file.open(name,readOnly,direct))
+      return false;
+   size=file.getSize()/BufferReference::pageSize;
+
+   return true;
+}
+//----------------------------------------------------------------------------
+bool DirectPartition::create(const char* name)
+   // Create a new partition
+{
+   close();
+
+   // Try to create the file
+   if (!file.create(name,direct))
+      return false;
+   size=0;
+
+   return true;
+}
+//----------------------------------------------------------------------------
+void DirectPartition::close()
+   // Close the partition
+{
+   file.close();
+   size=0;
+
+   for (unsigned index=0;index<poolCount;index++)
+      pools[index].buffers.clear();
+   for (vector<void*>::const_iterator iter=blocks.begin(),limit=blocks.end();iter!=limit;++iter)
+      MemoryArena::free(*iter,blockSize);
+   blocks.clear();
+   blockPos=blockLimit=0;
+}
+//----------------------------------------------------------------------------
+const void* DirectPartition::readPage(unsigned pageNo,PageInfo& info)
+   // Acess a page for reading
+{
+   assert(pageNo<size);
+
+   info.ptr=0;
+   info.aux=0;
+   info.pageNo=pageNo;
+   info.auxInfo=0;
+
+   // Read into a private buffer. The buffer manager holds at most one frame per page
+   void* buffer=allocBuffer(pageNo);
+   if (!file.read(static_cast<RandomAccessFile::ofs_t>(pageNo)*BufferReference::pageSize,buffer,BufferReference::pageSize)) {
+      std::cerr << "unable to read page " << pageNo << std::endl;
+      freeBuffer(pageNo,buffer);
+      return 0;
+   }
+   return info.ptr=buffer;
+}
+//----------------------------------------------------------------------------
+void DirectPartition::finishReadPage(PageInfo& info)
+   // Finish reading a page
+{
+   // Recycle the buffer
+   if (info.ptr)
+      freeBuffer(info.pageNo,info.ptr);
+
+   // Clean up. Not required, but can help debugging
+   info.ptr=0;
+   info.aux=0;
+   info.pageNo=0;
+   info.auxInfo=0;
+}
+//----------------------------------------------------------------------------
+void* DirectPartition::writePage(unsigned pageNo,PageInfo& info)
+   // Access a page for writing
+{
+   // First read the page
+   if (!readPage(pageNo,info))
+      return 0;
+
+   // And mark it for writing
+   return writeReadPage(info);
+}
+//----------------------------------------------------------------------------
+void* DirectPartition::buildPage(unsigned pageNo,PageInfo& info)
+   // Acess a page for writing without reading it first
+{
+   info.ptr=allocBuffer(pageNo);
+   info.aux=0;
+   info.pageNo=pageNo;
+   info.auxInfo=0;
+
+   return info.ptr;
+}
+//----------------------------------------------------------------------------
+void* DirectPartition::writeReadPage(PageInfo& info)
+   // Access an already read page for writing
+{
+   // The buffer is private already, changes reach the file when flushed
+   return info.ptr;
+}
+//----------------------------------------------------------------------------
+bool DirectPartition::flushWrittenPage(PageInfo& info)
+   // Write the changes back
+{
+   return file.write(static_cast<RandomAccessFile::ofs_t>(info.pageNo)*BufferReference::pageSize,info.ptr,BufferReference::pageSize);
+}
+//----------------------------------------------------------------------------
+void DirectPartition::finishWrittenPage(PageInfo& info)
+   // Finish writing a page
+{
+   // Recycle the buffer
+   finishReadPage(info);
+}
+//----------------------------------------------------------------------------
+bool DirectPartition::flush()
+   // Flush the parition
+{
+   return file.flush();
+}
+//----------------------------------------------------------------------------
+bool DirectPartition::grow(unsigned minIncrease,unsigned& start,unsigned& len)
+   // Grow the partition.
+{
+   auto_lock lock(mutex);
+
+   // Compute a reasonable increase
+   unsigned increase=size/8;
+   if (increase<minIncrease)
+      increase=minIncrease;
+
+   // Try to grow the underlying file
+   if (!file.grow(static_cast<RandomAccessFile::ofs_t>(increase)*BufferReference::pageSize))
+      return false;
+
+   // Report success
+   start=size;
+   len=increase;
+   size+=increase;
+
+   return true;
+}
+//----------------------------------------------------------------------------
+unsigned DirectPartition::getSize() const
+   // The the partition size in pages
+{
+   return size;
+}
+//----------------------------------------------------------------------------
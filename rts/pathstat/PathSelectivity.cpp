@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/pathstat/PathSelectivity.hpp"
 #include "rts/segment/DictionarySegment.hpp"
@@ -47,8 +48,9 @@ static void clusterPredicates(set<unsigned>& toURI, set<unsigned>& toLiterals, D
 		if (!decided){
 			assert(predicate==scan.getValue1());
 			unsigned o=scan.getValue3();
+			BufferReference page;
 			const char* start=0,*stop=0; Type::ID type; unsigned subType;
-			db.getDictionary().lookupById(o,start,stop,type,subType);
+			db.getDictionary().lookupById(o,page,start,stop,type,subType);
 			if (type==Type::Literal)
 				toLiterals.insert(scan.getValue1());
 			else
@@ -112,7 +114,7 @@ void PathSelectivity::computeSelectivity(Database& db, vector<unsigned>& back_se
 	for (set<unsigned>::iterator it=leaves.begin(); it != leaves.end(); it++){
 		cerr<<"node: "<<*it<<endl;
 		scan.computeSP(*it);
-		cerr<<"map size: "<<scan.getSPMap().size()<<endl;
+		cerr<<"map size: "<<scan.getReached().size()<<endl;
 		scan.countSelectivity(*it);
 	}
     forw_selectivity=scan.getBackwardSelectivity();
@@ -1426,7 +1426,7 @@ bool DifferentialIndex::lookup(const std::string& text,::Type::ID type,unsigned
    return result;
 }
 //---------------------------------------------------------------------------
-bool DifferentialIndex::lookupById(unsigned id,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType)
+bool DifferentialIndex::lookupById(unsigned id,BufferReference& page,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType)
    // Lookup a string for a given id
 {
    // A local string?
@@ -1449,6 +1449,6 @@ bool DifferentialIndex::lookupById(unsigned id,const char*& start,const char*& s
    }
 
    // Lookup in the main dictionary
-   return dict.lookupById(id,start,stop,type,subType);
+   return dict.lookupById(id,page,start,stop,type,subType);
 }
 //---------------------------------------------------------------------------
@@ -1,6 +1,7 @@
 #include "rts/runtime/DomainDescription.hpp"
 #include "infra/osdep/Mutex.hpp"
 #include <cstring>
+#include <stdint.h>
 //---------------------------------------------------------------------------
 // Protect against messy system headers under Windows
 #undef min
@@ -18,10 +19,9 @@
 using namespace std;
 //---------------------------------------------------------------------------
 DomainDescription::DomainDescription(const DomainDescription& other)
-   : min(other.min),max(other.max)
+   : min(other.min),max(other.max),filter(other.filter),summary(other.summary)
    // Copy-Constructor
 {
-   memcpy(filter,other.filter,sizeof(filter));
 }
 //---------------------------------------------------------------------------
 DomainDescription& DomainDescription::operator=(const DomainDescription& other)
@@ -30,18 +30,62 @@ DomainDescription& DomainDescription::operator=(const DomainDescription& other)
    if (this!=&other) {
       min=other.min;
       max=other.max;
-      memcpy(filter,other.filter,sizeof(filter));
+      filter=other.filter;
+      summary=other.summary;
    }
    return *this;
 }
 //---------------------------------------------------------------------------
+void DomainDescription::growFilter(unsigned size)
+   // Grow the filter
+{
+   // The sizes are powers of two, so the bit of a value in the smaller filter is the bit of the larger filter modulo the smaller size
+   unsigned oldSize=filter.size();
+   filter.resize(size);
+   for (unsigned index=oldSize;index<size;index++)
+      filter[index]=filter[index&(oldSize-1)];
+   rebuildSummary();
+}
+//---------------------------------------------------------------------------
+void DomainDescription::rebuildSummary()
+   // Recompute the summary after changing the filter
+{
+   summary.assign((filter.size()+filterEntryBits-1)/filterEntryBits,0);
+   for (unsigned index=0,limit=filter.size();index<limit;index++)
+      if (filter[index])
+         summary[index/filterEntryBits]|=filterEntry1<<(index%filterEntryBits);
+}
+//---------------------------------------------------------------------------
+unsigned DomainDescription::nextEntry(unsigned index) const
+   // Find the first non-zero filter entry at or after index (or the filter size)
+{
+   unsigned word=index/filterEntryBits,ofs=index%filterEntryBits;
+   if (word>=summary.size())
+      return filter.size();
+
+   // Skip empty entries one summary word at a time
+   FilterEntry entry=summary[word]&(~static_cast<FilterEntry>(0)<<ofs);
+   while (!entry) {
+      if ((++word)>=summary.size())
+         return filter.size();
+      entry=summary[word];
+      ofs=0;
+   }
+   FilterEntry mask=filterEntry1<<ofs;
+   while (!(entry&mask)) {
+      mask<<=1;
+      ofs++;
+   }
+   return word*filterEntryBits+ofs;
+}
+//---------------------------------------------------------------------------
 bool DomainDescription::couldQualify(unsigned value) const
    // Could this value qualify?
 {
    if ((value<min)||(value>max))
       return false;
 
-   unsigned bit=value%(filterSize*filterEntryBits);
+   unsigned bit=value&(filter.size()*filterEntryBits-1);
    return filter[bit/filterEntryBits]&(filterEntry1<<(bit%filterEntryBits));
 }
 //---------------------------------------------------------------------------
@@ -52,7 +96,8 @@ unsigned DomainDescription::nextCandidate(unsigned value) const
    if (value>max) return ~0u;
 
    // Potential value?
-   unsigned bit=value%(filterSize*filterEntryBits);
+   unsigned filterSize=filter.size();
+   unsigned bit=value&(filterSize*filterEntryBits-1);
    unsigned slot=bit/filterEntryBits,ofs=bit%filterEntryBits;
    FilterEntry entry=filter[slot],mask=filterEntry1<<ofs;
    if (entry&mask)
@@ -67,35 +112,25 @@ unsigned DomainDescription::nextCandidate(unsigned value) const
       if (value>max) return ~0u;
       return value;
    }
-   value+=filterEntryBits-ofs;
+   uint64_t candidate=static_cast<uint64_t>(value)+(filterEntryBits-ofs);
 
-   // Scan for the next non-zero entry
-   for (unsigned index=slot+1;index<filterSize;index++)
-      if (filter[index]) {
-         value+=filterEntryBits*(index-slot-1);
-         entry=filter[index]; mask=filterEntry1;
-         while (!(entry&mask)) {
-            mask<<=1;
-            value++;
-         }
-         if (value>max) return ~0u;
-         return value;
-      }
-   value+=filterEntryBits*(filterSize-slot);
-   for (unsigned index=0;index<=slot;index++)
-      if (filter[index]) {
-         value+=filterEntryBits*(index);
-         entry=filter[index]; mask=filterEntry1;
-         while (!(entry&mask)) {
-            mask<<=1;
-            value++;
-         }
-         if (value>max) return ~0u;
-         return value;
-      }
-
-   // No set bit? This should not happen...
-   return ~0u;
+   // Find the next non-zero entry, wrapping around at the end of the filter
+   unsigned index=nextEntry(slot+1);
+   if (index<filterSize) {
+      candidate+=filterEntryBits*(index-slot-1);
+   } else {
+      index=nextEntry(0);
+      if (index>slot)
+         return ~0u; // No set bit? This should not happen...
+      candidate+=filterEntryBits*(filterSize-slot-1+index);
+   }
+   entry=filter[index]; mask=filterEntry1;
+   while (!(entry&mask)) {
+      mask<<=1;
+      candidate++;
+   }
+   if (candidate>max) return ~0u;
+   return candidate;
 }
 //---------------------------------------------------------------------------
 PotentialDomainDescription::PotentialDomainDescription()
@@ -103,7 +138,8 @@ PotentialDomainDescription::PotentialDomainDescription()
 {
    min=0;
    max=~0u;
-   memset(filter,0xFF,sizeof(filter));
+   filter.assign(filterSize,~static_cast<FilterEntry>(0));
+   rebuildSummary();
 }
 //---------------------------------------------------------------------------
 static const unsigned lockCount = 16;
@@ -124,11 +160,17 @@ void PotentialDomainDescription::sync(PotentialDomainDescription& other)
       max=other.max;
    if (max<other.max)
       other.max=max;
-   for (unsigned index=0;index<filterSize;index++) {
+   if (filter.size()<other.filter.size())
+      growFilter(other.filter.size());
+   if (other.filter.size()<filter.size())
+      other.growFilter(filter.size());
+   for (unsigned index=0,limit=filter.size();index<limit;index++) {
       FilterEntry n=filter[index]&other.filter[index];
       filter[index]=n;
       other.filter[index]=n;
    }
+   rebuildSummary();
+   other.rebuildSummary();
 
    lock.unlock();
 }
@@ -143,18 +185,25 @@ void PotentialDomainDescription::restrictTo(const ObservedDomainDescription& oth
       min=other.min;
    if (max>other.max)
       max=other.max;
-   for (unsigned index=0;index<filterSize;index++)
-      filter[index]&=other.filter[index];
+   if (filter.size()<other.filter.size())
+      growFilter(other.filter.size());
+   for (unsigned index=0,limit=filter.size(),mask=other.filter.size()-1;index<limit;index++)
+      filter[index]&=other.filter[index&mask];
+   rebuildSummary();
 
    lock.unlock();
 }
 //---------------------------------------------------------------------------
-ObservedDomainDescription::ObservedDomainDescription()
+ObservedDomainDescription::ObservedDomainDescription(double expectedValues)
    // Constructor
 {
    min=~0u;
    max=0;
-   memset(filter,0,sizeof(filter));
+   unsigned size=filterSize;
+   while ((size<maxFilterSize)&&((static_cast<double>(size)*filterEntryBits)<(expectedValues*filterBitsPerValue)))
+      size*=2;
+   filter.assign(size,0);
+   rebuildSummary();
 }
 //---------------------------------------------------------------------------
 void ObservedDomainDescription::add(unsigned value)
@@ -165,7 +214,23 @@ void ObservedDomainDescription::add(unsigned value)
    if (value>max)
       max=value;
 
-   unsigned bit=value%(filterSize*filterEntryBits);
-   filter[bit/filterEntryBits]|=filterEntry1<<(bit%filterEntryBits);
+   unsigned bit=value&(filter.size()*filterEntryBits-1),slot=bit/filterEntryBits;
+   filter[slot]|=filterEntry1<<(bit%filterEntryBits);
+   summary[slot/filterEntryBits]|=filterEntry1<<(slot%filterEntryBits);
+}
+//---------------------------------------------------------------------------
+void ObservedDomainDescription::merge(const ObservedDomainDescription& other)
+   // Add the values observed by another description
+{
+   if (other.min<min)
+      min=other.min;
+   if (other.max>max)
+      max=other.max;
+
+   if (filter.size()<other.filter.size())
+      growFilter(other.filter.size());
+   for (unsigned index=0,limit=filter.size(),mask=other.filter.size()-1;index<limit;index++)
+      filter[index]|=other.filter[index&mask];
+   rebuildSummary();
 }
 //---------------------------------------------------------------------------
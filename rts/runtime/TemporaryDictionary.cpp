@@ -63,7 +63,7 @@ bool TemporaryDictionary::lookup(const std::string& text,Type::ID type,unsigned
    return true;
 }
 //---------------------------------------------------------------------------
-bool TemporaryDictionary::lookupById(unsigned id,const char*& start,const char*& stop,Type::ID& type,unsigned& subType)
+bool TemporaryDictionary::lookupById(unsigned id,BufferReference& page,const char*& start,const char*& stop,Type::ID& type,unsigned& subType)
    // Lookup a string for a given id
 {
    if (id>=idBase) {
@@ -76,9 +76,9 @@ bool TemporaryDictionary::lookupById(unsigned id,const char*& start,const char*&
       subType=l.subType;
       return true;
    } else if (diffIndex) {
-      return diffIndex->lookupById(id,start,stop,type,subType);
+      return diffIndex->lookupById(id,page,start,stop,type,subType);
    } else {
-      return dict.lookupById(id,start,stop,type,subType);
+      return dict.lookupById(id,page,start,stop,type,subType);
    }
 }
 //---------------------------------------------------------------------------
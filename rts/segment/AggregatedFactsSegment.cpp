@@ -1,6 +1,7 @@
 #include "rts/segment/AggregatedFactsSegment.hpp"
 #include "rts/database/DatabaseBuilder.hpp"
 #include "rts/segment/BTree.hpp"
+#include <algorithm>
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -448,6 +449,36 @@ void AggregatedFactsSegment::update(AggregatedFactsSegment::Source& reader)
    Index(*this).performUpdate(source);
 }
 //---------------------------------------------------------------------------
+void AggregatedFactsSegment::splitRange(const Pair& from,const Pair& to,unsigned parts,unsigned minPages,vector<Pair>& bounds)
+   // Split a key range into ranges of about equal numbers of leaf pages
+{
+   bounds.clear();
+   vector<pair<Index::InnerKey,unsigned> > leafBounds;
+   Index(*this).collectLeafBounds(leafBounds);
+   if (leafBounds.empty())
+      return;
+
+   // Find the leaves overlapping the range
+   unsigned start=lower_bound(leafBounds.begin(),leafBounds.end(),pair<Index::InnerKey,unsigned>(Index::InnerKey(from.value1,from.value2),0))-leafBounds.begin();
+   unsigned stop=lower_bound(leafBounds.begin(),leafBounds.end(),pair<Index::InnerKey,unsigned>(Index::InnerKey(to.value1,to.value2),0))-leafBounds.begin();
+   if (stop>=leafBounds.size())
+      stop=leafBounds.size()-1;
+   if (start>=stop)
+      return;
+   unsigned leaves=stop-start+1;
+   if (parts>leaves/minPages)
+      parts=leaves/minPages;
+
+   // Split after the last entry of every range, all of them are below the end of the range
+   for (unsigned part=1;part<parts;part++) {
+      const Index::InnerKey& key=leafBounds[start+(static_cast<uint64_t>(leaves)*part)/parts-1].first;
+      Pair bound;
+      bound.value1=key.value1;
+      bound.value2=key.value2;
+      bounds.push_back(bound);
+   }
+}
+//---------------------------------------------------------------------------
 AggregatedFactsSegment::Scan::Hint::Hint()
    // Constructor
 {
@@ -524,11 +555,12 @@ bool AggregatedFactsSegment::Scan::readNextPage()
    // Read the next page
 {
    // Alread read the first page? Then read the next one
-   if (pos-1) {
+   if (posLimit) {
       const unsigned char* page=static_cast<const unsigned char*>(current.getPage());
       unsigned nextPage=readUint32Aligned(page+8);
       if (!nextPage)
          return false;
+      readahead.advance(*seg,nextPage);
       current=seg->readShared(nextPage);
    }
 
@@ -710,6 +742,7 @@ bool AggregatedFactsSegment::Scan::readNextPage()
          if (!find(next1,next2)) {
             if (!Index(*seg).findLeaf(current,Index::InnerKey(next1,next2)))
                return false;
+            readahead.reset(*seg);
             pos=posLimit=0;
             ++pos;
             return readNextPage();
@@ -727,6 +760,8 @@ bool AggregatedFactsSegment::Scan::readNextPage()
 void AggregatedFactsSegment::Scan::close()
    // Close the scan
 {
+   if (seg)
+      readahead.reset(*seg);
    seg=0;
    current.reset();
 }
@@ -0,0 +1,133 @@
+#include "rts/segment/DictionaryCache.hpp"
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// Memory used by an entry besides the string, including the map entry
+static const unsigned entryOverhead = 64+48;
+//---------------------------------------------------------------------------
+void DictionaryCache::Shard::unlink(Entry* entry)
+   // Unlink an entry from the LRU list
+{
+   if (entry->prev)
+      entry->prev->next=entry->next; else
+      head=entry->next;
+   if (entry->next)
+      entry->next->prev=entry->prev; else
+      tail=entry->prev;
+   entry->next=entry->prev=0;
+}
+//---------------------------------------------------------------------------
+void DictionaryCache::Shard::pushFront(Entry* entry)
+   // Add an entry at the front of the LRU list
+{
+   entry->prev=0;
+   entry->next=head;
+   if (head)
+      head->prev=entry; else
+      tail=entry;
+   head=entry;
+}
+//---------------------------------------------------------------------------
+DictionaryCache::DictionaryCache(uint64_t capacityInBytes)
+   : shardCapacity(capacityInBytes/shardCount)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+DictionaryCache::~DictionaryCache()
+   // Destructor
+{
+   for (unsigned index=0;index<shardCount;index++)
+      for (map<unsigned,Entry*>::iterator iter=shards[index].entries.begin(),limit=shards[index].entries.end();iter!=limit;++iter)
+         delete (*iter).second;
+}
+//---------------------------------------------------------------------------
+bool DictionaryCache::lookup(unsigned id,string& value,::Type::ID& type,unsigned& subType)
+   // Find a string and copy it
+{
+   Shard& shard=getShard(id);
+   auto_lock lock(shard.mutex);
+
+   map<unsigned,Entry*>::iterator iter=shard.entries.find(id);
+   if (iter==shard.entries.end()) {
+      shard.misses++;
+      return false;
+   }
+   Entry* entry=(*iter).second;
+   if (shard.head!=entry) {
+      shard.unlink(entry);
+      shard.pushFront(entry);
+   }
+   shard.hits++;
+
+   value=entry->value;
+   type=entry->type;
+   subType=entry->subType;
+   return true;
+}
+//---------------------------------------------------------------------------
+void DictionaryCache::insert(unsigned id,const char* start,const char* stop,::Type::ID type,unsigned subType)
+   // Add a string
+{
+   // Does not fit at all?
+   uint64_t entrySize=(stop-start)+entryOverhead;
+   if (entrySize>shardCapacity)
+      return;
+
+   // Build the entry outside the lock
+   Entry* entry=new Entry();
+   entry->id=id;
+   entry->type=type;
+   entry->subType=subType;
+   entry->value.assign(start,stop);
+   entry->prev=entry->next=0;
+
+   Shard& shard=getShard(id);
+   auto_lock lock(shard.mutex);
+
+   // Somebody else was faster?
+   if (shard.entries.count(id)) {
+      delete entry;
+      return;
+   }
+   shard.entries[id]=entry;
+   shard.pushFront(entry);
+   shard.size+=entrySize;
+
+   // Evict the least recently used entries
+   while (shard.size>shardCapacity) {
+      Entry* victim=shard.tail;
+      shard.entries.erase(victim->id);
+      shard.unlink(victim);
+      shard.size-=victim->value.size()+entryOverhead;
+      shard.evictions++;
+      delete victim;
+   }
+}
+//---------------------------------------------------------------------------
+void DictionaryCache::getStatistics(Statistics& statistics)
+   // Get statistics
+{
+   statistics.hits=statistics.misses=statistics.evictions=0;
+   statistics.entries=0;
+   statistics.size=0;
+   for (unsigned index=0;index<shardCount;index++) {
+      Shard& shard=shards[index];
+      auto_lock lock(shard.mutex);
+      statistics.hits+=shard.hits;
+      statistics.misses+=shard.misses;
+      statistics.evictions+=shard.evictions;
+      statistics.entries+=shard.entries.size();
+      statistics.size+=shard.size;
+   }
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,283 @@
+#include "rts/segment/DictionaryFingerprintSegment.hpp"
+#include "rts/buffer/BufferReference.hpp"
+#include "rts/database/DatabaseBuilder.hpp"
+#include "rts/segment/DictionarySegment.hpp"
+#include "infra/osdep/MemoryArena.hpp"
+#include "infra/util/Hash.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+// Layout of the segment:
+//
+// The table is a chain of pages, each page contains
+//    LSN (8 bytes), next page (4 bytes), group count (4 bytes)
+// followed by the groups in table order. Each group contains
+//    control bytes (16 bytes), fingerprints (16*8 bytes), ids (16*4 bytes)
+// A control byte holds the lower 7 bits of the fingerprint of a used slot.
+// The remaining bits select the first group to probe, collisions probe the
+// following groups. Fingerprints of different strings share the id
+// conflictId, these strings are only found by the b-tree.
+//
+using namespace std;
+//---------------------------------------------------------------------------
+// Info slots
+static const unsigned slotTableStart = 0;
+static const unsigned slotGroupCount = 1;
+static const unsigned slotCoveredIds = 2;
+static const unsigned slotFormat = 3;
+//---------------------------------------------------------------------------
+/// The current format
+static const unsigned formatVersion = 1;
+/// The size of the page header
+static const unsigned headerSize = 16;
+/// The size of a stored group
+static const unsigned groupBytes = DictionaryFingerprintSegment::groupSize*(1+8+4);
+/// The control byte of an empty slot
+static const unsigned char emptyControl = 0x80;
+/// The id of fingerprints shared by multiple strings
+static const unsigned conflictId = ~0u;
+/// The longest string that is indexed. Longer strings span multiple pages
+static const unsigned maxLength = BufferReference::pageSize-32;
+/// The number of ids looked up at once while building
+static const unsigned buildBatchSize = 4096;
+//---------------------------------------------------------------------------
+static inline unsigned char controlOf(uint64_t fingerprint) { return fingerprint&0x7F; }
+//---------------------------------------------------------------------------
+static unsigned matchControl(const unsigned char* control,unsigned char value)
+   // Find all slots of a group with a given control byte. Returns a bit mask
+{
+#if defined(__SSE2__)
+   __m128i bytes=_mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes,_mm_set1_epi8(static_cast<char>(value))));
+#else
+   unsigned result=0;
+   for (unsigned slot=0;slot<DictionaryFingerprintSegment::groupSize;slot++)
+      if (control[slot]==value)
+         result|=1u<<slot;
+   return result;
+#endif
+}
+//---------------------------------------------------------------------------
+DictionaryFingerprintSegment::DictionaryFingerprintSegment(DatabasePartition& partition)
+   : Segment(partition),tableStart(0),groupCount(0),coveredIds(0),table(0),loaded(false)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+DictionaryFingerprintSegment::~DictionaryFingerprintSegment()
+   // Destructor
+{
+   freeTable();
+}
+//---------------------------------------------------------------------------
+Segment::Type DictionaryFingerprintSegment::getType() const
+   // Get the type
+{
+   return Segment::Type_DictionaryFingerprint;
+}
+//---------------------------------------------------------------------------
+void DictionaryFingerprintSegment::refreshInfo()
+   // Refresh segment info stored in the partition
+{
+   Segment::refreshInfo();
+
+   tableStart=getSegmentData(slotTableStart);
+   groupCount=getSegmentData(slotGroupCount);
+   coveredIds=getSegmentData(slotCoveredIds);
+
+   // Unknown formats are ignored, the b-tree finds all strings
+   if (getSegmentData(slotFormat)!=formatVersion)
+      groupCount=0;
+}
+//---------------------------------------------------------------------------
+uint64_t DictionaryFingerprintSegment::fingerprint(const char* start,unsigned len,::Type::ID type,unsigned subType)
+   // Compute the fingerprint of a string
+{
+   return Hash::hash64(start,len,(static_cast<Hash::hash64_t>(type)<<32)|subType);
+}
+//---------------------------------------------------------------------------
+void DictionaryFingerprintSegment::freeTable()
+   // Release the table
+{
+   if (table) {
+      MemoryArena::free(table,static_cast<size_t>(groupCount)*sizeof(Group));
+      table=0;
+   }
+}
+//---------------------------------------------------------------------------
+void DictionaryFingerprintSegment::insert(Group* table,unsigned groupCount,uint64_t fingerprint,unsigned id)
+   // Insert a fingerprint into the table
+{
+   unsigned char control=controlOf(fingerprint);
+   for (unsigned groupNo=(fingerprint>>7)&(groupCount-1);;groupNo=(groupNo+1)&(groupCount-1)) {
+      Group& group=table[groupNo];
+
+      // Already known? Then multiple strings share the fingerprint
+      for (unsigned matches=matchControl(group.control,control),slot=0;matches;matches>>=1,slot++)
+         if ((matches&1)&&(group.fingerprints[slot]==fingerprint)) {
+            group.ids[slot]=conflictId;
+            return;
+         }
+
+      // Use the first empty slot. Slots are never freed, so the fingerprint cannot follow
+      unsigned empty=matchControl(group.control,emptyControl);
+      if (empty) {
+         unsigned slot=0;
+         while (!(empty&1)) { empty>>=1; slot++; }
+         group.control[slot]=control;
+         group.fingerprints[slot]=fingerprint;
+         group.ids[slot]=id;
+         return;
+      }
+   }
+}
+//---------------------------------------------------------------------------
+void DictionaryFingerprintSegment::computeFingerprints(DictionarySegment& dictionary)
+   // Build the table from the dictionary
+{
+   freeTable();
+
+   // Keep the load factor below 7/8
+   coveredIds=dictionary.getNextId();
+   groupCount=1;
+   while ((static_cast<uint64_t>(groupCount)*groupSize*7)<(static_cast<uint64_t>(coveredIds)*8))
+      groupCount*=2;
+   table=static_cast<Group*>(MemoryArena::alloc(static_cast<size_t>(groupCount)*sizeof(Group),MemoryArena::Placement_Interleaved));
+   for (unsigned index=0;index<groupCount;index++)
+      memset(table[index].control,emptyControl,groupSize);
+
+   // Insert all strings, reading the dictionary in id order
+   vector<unsigned> ids;
+   vector<DictionarySegment::IdString> strings;
+   vector<char> text;
+   for (unsigned from=0;from<coveredIds;from+=buildBatchSize) {
+      ids.clear();
+      for (unsigned id=from,limit=min(coveredIds,from+buildBatchSize);id<limit;id++)
+         ids.push_back(id);
+      dictionary.lookupByIds(ids,strings,text);
+      for (unsigned index=0;index<ids.size();index++) {
+         const DictionarySegment::IdString& s=strings[index];
+         if (s.found&&(static_cast<unsigned>(s.stop-s.start)<=maxLength))
+            insert(table,groupCount,fingerprint(s.start,s.stop-s.start,s.type,s.subType),ids[index]);
+      }
+   }
+
+   writeTable();
+
+   // The table stays in memory
+   loaded.store(true,std::memory_order_release);
+}
+//---------------------------------------------------------------------------
+void DictionaryFingerprintSegment::writeTable()
+   // Write the table
+{
+   const unsigned groupsPerPage=(BufferReference::pageSize-headerSize)/groupBytes;
+   DatabaseBuilder::PageChainer chainer(8);
+   unsigned char buffer[BufferReference::pageSize];
+   for (unsigned pos=0;pos<groupCount;) {
+      unsigned count=min(groupCount-pos,groupsPerPage);
+      writeUint32(buffer+12,count);
+      unsigned char* writer=buffer+headerSize;
+      for (unsigned index=0;index<count;index++) {
+         const Group& group=table[pos+index];
+         memcpy(writer,group.control,groupSize);
+         writer+=groupSize;
+         for (unsigned slot=0;slot<groupSize;slot++,writer+=8) {
+            writeUint32(writer,static_cast<unsigned>(group.fingerprints[slot]>>32));
+            writeUint32(writer+4,static_cast<unsigned>(group.fingerprints[slot]));
+         }
+         for (unsigned slot=0;slot<groupSize;slot++,writer+=4)
+            writeUint32(writer,group.ids[slot]);
+      }
+      memset(writer,0,(buffer+BufferReference::pageSize)-writer);
+      chainer.store(this,buffer);
+      pos+=count;
+   }
+   chainer.finish();
+
+   tableStart=chainer.getFirstPageNo();
+   setSegmentData(slotTableStart,tableStart);
+   setSegmentData(slotGroupCount,groupCount);
+   setSegmentData(slotCoveredIds,coveredIds);
+   setSegmentData(slotFormat,formatVersion);
+}
+//---------------------------------------------------------------------------
+void DictionaryFingerprintSegment::loadTable()
+   // Load the table
+{
+   table=static_cast<Group*>(MemoryArena::alloc(static_cast<size_t>(groupCount)*sizeof(Group),MemoryArena::Placement_Interleaved));
+   unsigned pos=0;
+   for (unsigned pageNo=tableStart;pageNo&&(pos<groupCount);) {
+      BufferReference page(readShared(pageNo));
+      const unsigned char* reader=static_cast<const unsigned char*>(page.getPage());
+      unsigned count=min(readUint32(reader+12),groupCount-pos);
+      pageNo=readUint32(reader+8);
+      reader+=headerSize;
+      for (unsigned index=0;index<count;index++) {
+         Group& group=table[pos+index];
+         memcpy(group.control,reader,groupSize);
+         reader+=groupSize;
+         for (unsigned slot=0;slot<groupSize;slot++,reader+=8)
+            group.fingerprints[slot]=(static_cast<uint64_t>(readUint32(reader))<<32)|readUint32(reader+4);
+         for (unsigned slot=0;slot<groupSize;slot++,reader+=4)
+            group.ids[slot]=readUint32(reader);
+      }
+      pos+=count;
+   }
+
+   // A truncated table is useless
+   if (pos<groupCount) {
+      freeTable();
+      groupCount=0;
+   }
+}
+//---------------------------------------------------------------------------
+DictionaryFingerprintSegment::Result DictionaryFingerprintSegment::lookup(const string& text,::Type::ID type,unsigned subType,unsigned& id)
+   // Lookup the id of a string
+{
+   // Long strings are not indexed
+   if (text.length()>maxLength)
+      return Result_Unknown;
+
+   // Load the table on first use. Afterwards table and groupCount no longer change
+   if (!loaded.load(std::memory_order_acquire)) {
+      auto_lock lock(loadLock);
+      if (!loaded.load(std::memory_order_relaxed)) {
+         if ((!table)&&groupCount)
+            loadTable();
+         loaded.store(true,std::memory_order_release);
+      }
+   }
+   if (!table)
+      return Result_Unknown;
+
+   // Probe the groups
+   uint64_t fingerprint=DictionaryFingerprintSegment::fingerprint(text.data(),text.length(),type,subType);
+   unsigned char control=controlOf(fingerprint);
+   for (unsigned groupNo=(fingerprint>>7)&(groupCount-1);;groupNo=(groupNo+1)&(groupCount-1)) {
+      const Group& group=table[groupNo];
+      for (unsigned matches=matchControl(group.control,control),slot=0;matches;matches>>=1,slot++)
+         if ((matches&1)&&(group.fingerprints[slot]==fingerprint)) {
+            if (group.ids[slot]==conflictId)
+               return Result_Unknown;
+            id=group.ids[slot];
+            return Result_Found;
+         }
+      if (matchControl(group.control,emptyControl))
+         return Result_Absent;
+   }
+}
+//---------------------------------------------------------------------------
@@ -1,6 +1,9 @@
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/buffer/BufferReference.hpp"
 #include "rts/segment/BTree.hpp"
+#include "rts/segment/DictionaryCache.hpp"
+#include "rts/segment/DictionaryFingerprintSegment.hpp"
+#include "rts/database/DatabasePartition.hpp"
 #include "infra/util/Hash.hpp"
 #include <algorithm>
 #include <cstring>
@@ -212,7 +215,7 @@ DictionarySegment::HashSource::~HashSource()
 }
 //---------------------------------------------------------------------------
 DictionarySegment::DictionarySegment(DatabasePartition& partition)
-   : Segment(partition),tableStart(0),nextId(0),indexRoot(0)
+   : Segment(partition),tableStart(0),nextId(0),mappingLoaded(false),indexRoot(0),fingerprints(0)
    // Constructor
 {
 }
@@ -231,12 +234,21 @@ void DictionarySegment::refreshInfo()
    tableStart=getSegmentData(slotTableStart);
    nextId=getSegmentData(slotNextId);
    mappings.push_back(pair<unsigned,unsigned>(getSegmentData(slotMappingStart),0));
+   mappingLoaded.store(false,std::memory_order_release);
    indexRoot=getSegmentData(slotIndexRoot);
+   fingerprints=getPartition().lookupSegment<DictionaryFingerprintSegment>(DatabasePartition::Tag_DictionaryFingerprint);
 }
 //---------------------------------------------------------------------------
 void DictionarySegment::refreshMapping()
    // Refresh the mapping table if needed
 {
+   // Concurrent lookups wait until the first one has read the chain
+   if (mappingLoaded.load(std::memory_order_acquire))
+      return;
+   auto_lock lock(mappingLock);
+   if (mappingLoaded.load(std::memory_order_relaxed))
+      return;
+
    // Check if we only know the start mapge
    if ((mappings.size()==1)&&(mappings[0].second==0)) {
       unsigned iter=mappings[0].first;
@@ -250,6 +262,7 @@ void DictionarySegment::refreshMapping()
          iter=next;
       }
    }
+   mappingLoaded.store(true,std::memory_order_release);
 }
 //---------------------------------------------------------------------------
 static inline unsigned getLiteralLen(unsigned header) { return header&0x00FFFFFF; }
@@ -291,6 +304,24 @@ bool DictionarySegment::lookupOnPage(unsigned pageNo,const string& text,::Type::
 bool DictionarySegment::lookup(const string& text,::Type::ID type,unsigned subType,unsigned& id)
    // Lookup an id for a given string
 {
+   // Try the fingerprint index first
+   if (fingerprints) {
+      unsigned candidate;
+      DictionaryFingerprintSegment::Result result=fingerprints->lookup(text,type,subType,candidate);
+      if (result==DictionaryFingerprintSegment::Result_Found) {
+         // Check that it is really the same string and not just the same fingerprint
+         BufferReference candidatePage;
+         const char* start,*stop;
+         ::Type::ID candidateType; unsigned candidateSubType;
+         if (lookupById(candidate,candidatePage,start,stop,candidateType,candidateSubType)&&(candidateType==type)&&(candidateSubType==subType)&&(static_cast<unsigned>(stop-start)==text.length())&&(memcmp(start,text.data(),text.length())==0)) {
+            id=candidate;
+            return true;
+         }
+      } else if ((result==DictionaryFingerprintSegment::Result_Absent)&&(fingerprints->getCoveredIds()==nextId)) {
+         return false;
+      }
+   }
+
    // Determine the hash value
    unsigned hash=Hash::hash(text,(type<<24)^subType);
 
@@ -335,12 +366,9 @@ bool DictionarySegment::lookup(const string& text,::Type::ID type,unsigned subTy
    return false;
 }
 //---------------------------------------------------------------------------
-bool DictionarySegment::lookupById(unsigned id,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType)
-   // Lookup a string for a given id
+bool DictionarySegment::findDirectoryEntry(unsigned id,unsigned& dirPage,unsigned& dirSlot) const
+   // Find the mapping entry of an id
 {
-   // Fill the mappings if needed
-   refreshMapping();
-
    // Find the relevant mapping chunk
    unsigned mappingStart,relId=id;
    for (vector<pair<unsigned,unsigned> >::const_iterator iter=mappings.begin(),limit=mappings.end();;++iter) {
@@ -356,7 +384,6 @@ bool DictionarySegment::lookupById(unsigned id,const char*& start,const char*& s
    }
 
    // Compute position in directory
-   unsigned dirPage,dirSlot;
    if (relId<entriesOnFirstMappingPage) {
       dirPage=mappingStart;
       dirSlot=relId+1;
@@ -364,37 +391,119 @@ bool DictionarySegment::lookupById(unsigned id,const char*& start,const char*& s
       dirPage=mappingStart+1+((relId-entriesOnFirstMappingPage)/entriesPerMappingPage);
       dirSlot=(relId-entriesOnFirstMappingPage)%entriesPerMappingPage;
    }
-
-   // Lookup the direct mapping entry
-   BufferReference ref(readShared(dirPage));
-   unsigned pageNo=readUint32(static_cast<const unsigned char*>(ref.getPage())+8+8*dirSlot);
-   unsigned ofsLen=readUint32(static_cast<const unsigned char*>(ref.getPage())+8+8*dirSlot+4);
-   unsigned ofs=ofsLen>>16,len=(ofsLen&0xFFFF);
-
-//   cerr<<"pageno: "<<pageNo<<endl;
-   // Now search the entry on the page itself
-   ref=readShared(pageNo);
-   const char* page=static_cast<const char*>(ref.getPage());
-
+   return true;
+}
+//---------------------------------------------------------------------------
+static void readString(const char* page,unsigned ofs,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType)
+   // Read a string from a page of the raw string table
+{
    // Read the type info
-   unsigned typeLen=readUint32(reinterpret_cast<const unsigned char*>(page+ofs+8));
+   unsigned typeLen=Segment::readUint32(reinterpret_cast<const unsigned char*>(page+ofs+8));
    type=static_cast< ::Type::ID>(typeLen>>24);
-   len=(typeLen&0x00FFFFFF);
+   unsigned len=(typeLen&0x00FFFFFF);
 
    // Has a sub type?
    if (::Type::hasSubType(type)) {
       ofs+=4;
-      subType=readUint32(reinterpret_cast<const unsigned char*>(page+ofs+8));
+      subType=Segment::readUint32(reinterpret_cast<const unsigned char*>(page+ofs+8));
    } else {
       subType=0;
    }
 
    // And return the string bounds
    start=page+ofs+12; stop=start+len;
+}
+//---------------------------------------------------------------------------
+bool DictionarySegment::lookupById(unsigned id,BufferReference& page,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType)
+   // Lookup a string for a given id
+{
+   // Fill the mappings if needed
+   refreshMapping();
+
+   // Find the directory entry
+   unsigned dirPage,dirSlot;
+   if (!findDirectoryEntry(id,dirPage,dirSlot))
+      return false;
+
+   // Lookup the direct mapping entry
+   BufferReference ref(readShared(dirPage));
+   unsigned pageNo=readUint32(static_cast<const unsigned char*>(ref.getPage())+8+8*dirSlot);
+   unsigned ofsLen=readUint32(static_cast<const unsigned char*>(ref.getPage())+8+8*dirSlot+4);
+
+   // Now read the entry on the page itself. The caller keeps the page fixed
+   page=readShared(pageNo);
+   readString(static_cast<const char*>(page.getPage()),ofsLen>>16,start,stop,type,subType);
 
    return true;
 }
 //---------------------------------------------------------------------------
+bool DictionarySegment::lookupById(unsigned id,string& value,::Type::ID& type,unsigned& subType)
+   // Lookup a string for a given id and copy it
+{
+   DictionaryCache* cache=getPartition().getDictionaryCache();
+   if (cache&&cache->lookup(id,value,type,subType))
+      return true;
+
+   BufferReference page;
+   const char* start,*stop;
+   if (!lookupById(id,page,start,stop,type,subType))
+      return false;
+   value.assign(start,stop);
+   if (cache)
+      cache->insert(id,start,stop,type,subType);
+   return true;
+}
+//---------------------------------------------------------------------------
+void DictionarySegment::lookupByIds(const vector<unsigned>& ids,vector<IdString>& strings,vector<char>& text)
+   // Lookup strings for many ids
+{
+   // Fill the mappings if needed
+   refreshMapping();
+
+   // Ascending ids share directory and string pages, keep the current ones fixed
+   strings.resize(ids.size());
+   text.clear();
+   vector<pair<unsigned,unsigned> > bounds(ids.size());
+   BufferReference dirRef,stringRef;
+   unsigned dirRefPage=~0u,stringRefPage=~0u;
+   for (unsigned index=0,count=ids.size();index<count;index++) {
+      IdString& s=strings[index];
+      unsigned dirPage,dirSlot;
+      if (!findDirectoryEntry(ids[index],dirPage,dirSlot)) {
+         s.start=s.stop=0; s.type=::Type::Literal; s.subType=0; s.found=false;
+         continue;
+      }
+
+      // Lookup the direct mapping entry
+      if (dirRefPage!=dirPage) {
+         dirRef=readShared(dirPage);
+         dirRefPage=dirPage;
+      }
+      unsigned pageNo=readUint32(static_cast<const unsigned char*>(dirRef.getPage())+8+8*dirSlot);
+      unsigned ofsLen=readUint32(static_cast<const unsigned char*>(dirRef.getPage())+8+8*dirSlot+4);
+
+      // And the string. Copy it, the page is released afterwards
+      if (stringRefPage!=pageNo) {
+         stringRef=readShared(pageNo);
+         stringRefPage=pageNo;
+      }
+      const char* start,*stop;
+      readString(static_cast<const char*>(stringRef.getPage()),ofsLen>>16,start,stop,s.type,s.subType);
+      bounds[index].first=text.size();
+      text.insert(text.end(),start,stop);
+      bounds[index].second=text.size();
+      s.found=true;
+   }
+
+   // Point into the copies once the text buffer is complete
+   const char* base=text.empty()?0:&text[0];
+   for (unsigned index=0,count=ids.size();index<count;index++)
+      if (strings[index].found) {
+         strings[index].start=base+bounds[index].first;
+         strings[index].stop=base+bounds[index].second;
+      }
+}
+//---------------------------------------------------------------------------
 void DictionarySegment::loadStrings(StringSource& reader)
    // Load the raw strings (must be in id order)
 {
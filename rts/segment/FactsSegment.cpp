@@ -2,6 +2,9 @@
 #include "rts/database/DatabaseBuilder.hpp"
 #include "rts/transaction/LogAction.hpp"
 #include "rts/segment/BTree.hpp"
+#include "rts/segment/LeafCache.hpp"
+#include "rts/segment/PackedLeaf.hpp"
+#include "rts/database/DatabasePartition.hpp"
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -21,6 +24,7 @@ static const unsigned slotPages = 2;
 static const unsigned slotGroups1 = 3;
 static const unsigned slotGroups2 = 4;
 static const unsigned slotCardinality = 5;
+static const unsigned slotLeafFormat = 6;
 //---------------------------------------------------------------------------
 /// Compare
 static inline bool greater(unsigned a1,unsigned a2,unsigned a3,unsigned b1,unsigned b2,unsigned b3) {
@@ -91,6 +95,8 @@ class FactsSegment::IndexImplementation
    static InnerKey deriveInnerKey(const LeafEntry& e) { return InnerKey(e.value1,e.value2,e.value3); }
    /// Read the first leaf entry
    static void readFirstLeafEntryKey(InnerKey& key,const unsigned char* ptr) {
+      if (PackedLeaf::isPacked(ptr))
+         ptr=PackedLeaf::getFirstTriple(ptr);
       key.value1=Segment::readUint32Aligned(ptr);
       key.value2=Segment::readUint32Aligned(ptr+4);
       key.value3=Segment::readUint32Aligned(ptr+8);
@@ -123,7 +129,7 @@ class FactsSegment::IndexImplementation
    static bool mergeConflictWith(const LeafEntry& newEntry,LeafEntry& oldEntry) { return (newEntry.value1==oldEntry.value1)&&(newEntry.value2==oldEntry.value2)&&(newEntry.value3==oldEntry.value3)&&(!~oldEntry.deleted); }
 
    /// Pack leaf entries
-   static unsigned packLeafEntries(unsigned char* writer,unsigned char* limit,vector<LeafEntry>::const_iterator entriesStart,vector<LeafEntry>::const_iterator entriesLimit);
+   unsigned packLeafEntries(unsigned char* writer,unsigned char* limit,vector<LeafEntry>::const_iterator entriesStart,vector<LeafEntry>::const_iterator entriesLimit);
    /// Unpack leaf entries
    static void unpackLeafEntries(vector<LeafEntry>& entries,const unsigned char* reader,const unsigned char* limit);
 };
@@ -177,9 +183,46 @@ static unsigned char* writeDelta(unsigned char* writer,unsigned value)
    }
 }
 //---------------------------------------------------------------------------
+static unsigned packLeafEntriesBlocked(unsigned char* writer,unsigned char* writerLimit,vector<FactsSegment::IndexImplementation::LeafEntry>::const_iterator entriesStart,vector<FactsSegment::IndexImplementation::LeafEntry>::const_iterator entriesLimit)
+   // Pack unversioned facts into columnar blocks. Returns 0 if the delta encoding must be used
+{
+   // Collect the leading unversioned triples, skipping duplicates
+   vector<FactsSegment::Triple> triples;
+   vector<unsigned> ends;
+   for (vector<FactsSegment::IndexImplementation::LeafEntry>::const_iterator iter=entriesStart;iter!=entriesLimit;++iter) {
+      if (((*iter).created!=0)||(~(*iter).deleted))
+         break;
+      if ((!triples.empty())&&(triples.back().value1==(*iter).value1)&&(triples.back().value2==(*iter).value2)&&(triples.back().value3==(*iter).value3)) {
+         ends.back()=(iter-entriesStart)+1;
+         continue;
+      }
+      if (triples.size()>=BufferReference::pageSize)
+         break;
+      FactsSegment::Triple t;
+      t.value1=(*iter).value1; t.value2=(*iter).value2; t.value3=(*iter).value3;
+      triples.push_back(t);
+      ends.push_back((iter-entriesStart)+1);
+   }
+   if (triples.empty())
+      return 0;
+
+   // Store as many as possible
+   unsigned stored=PackedLeaf::pack(writer,writerLimit,&triples[0],triples.size());
+   if (!stored)
+      return 0;
+   return ends[stored-1];
+}
+//---------------------------------------------------------------------------
 unsigned FactsSegment::IndexImplementation::packLeafEntries(unsigned char* writer,unsigned char* writerLimit,vector<FactsSegment::IndexImplementation::LeafEntry>::const_iterator entriesStart,vector<FactsSegment::IndexImplementation::LeafEntry>::const_iterator entriesLimit)
    // Pack the facts into leaves using prefix compression
 {
+   // Use the block encoding if requested and possible
+   if (segment.leafFormat==LeafFormat_Packed) {
+      unsigned stored=packLeafEntriesBlocked(writer,writerLimit,entriesStart,entriesLimit);
+      if (stored)
+         return stored;
+   }
+
    unsigned lastValue1,lastValue2,lastValue3,lastDeleted;
    // we need a copy of deleted values, but we don't want to put them into lastValues because the compression should not be applied for them
    unsigned lastDeleted1=0, lastDeleted2=0, lastDeleted3=0;
@@ -381,6 +424,19 @@ static unsigned readDelta4(const unsigned char* pos) { return (pos[0]<<24)|(pos[
 void FactsSegment::IndexImplementation::unpackLeafEntries(vector<FactsSegment::IndexImplementation::LeafEntry>& entries,const unsigned char* reader,const unsigned char* limit)
    // Read the facts stored on a leaf page
 {
+   // Block-packed?
+   if (PackedLeaf::isPacked(reader)) {
+      vector<Triple> triples(PackedLeaf::getCount(reader));
+      PackedLeaf::unpack(reader,&triples[0]);
+      for (vector<Triple>::const_iterator iter=triples.begin(),limit=triples.end();iter!=limit;++iter) {
+         LeafEntry e;
+         e.value1=(*iter).value1; e.value2=(*iter).value2; e.value3=(*iter).value3;
+         e.created=0; e.deleted=~0u;
+         entries.push_back(e);
+      }
+      return;
+   }
+
    // Decompress the first triple
    LeafEntry e;
    e.value1=readUint32Aligned(reader); reader+=4;
@@ -522,17 +578,55 @@ class FactsSegment::Index : public BTree<IndexImplementation>
    using BTree<IndexImplementation>::leafHeaderSize;
 };
 //---------------------------------------------------------------------------
+/// The key ranges of the leaf pages in chain order, taken from the lowest
+/// inner level. Lets hinted scans skip pages without decompressing them
+class FactsSegment::LeafSummary
+{
+   public:
+   /// The segment generation
+   unsigned generation;
+   /// The number of references. The segment holds one to its current summary
+   unsigned references;
+   /// The last key of each leaf
+   vector<Triple> bounds;
+   /// The leaf pages
+   vector<unsigned> pages;
+
+   /// Find the first leaf that may contain an entry. Returns the number of leaves if there is none
+   unsigned find(unsigned value1,unsigned value2,unsigned value3) const;
+};
+//---------------------------------------------------------------------------
+unsigned FactsSegment::LeafSummary::find(unsigned value1,unsigned value2,unsigned value3) const
+   // Find the first leaf that may contain an entry
+{
+   unsigned left=0,right=bounds.size();
+   while (left<right) {
+      unsigned middle=(left+right)/2;
+      const Triple& t=bounds[middle];
+      if (::greater(value1,value2,value3,t.value1,t.value2,t.value3))
+         left=middle+1; else
+         right=middle;
+   }
+   return left;
+}
+//---------------------------------------------------------------------------
 FactsSegment::Source::~Source()
    // Destructor
 {
 }
 //---------------------------------------------------------------------------
 FactsSegment::FactsSegment(DatabasePartition& partition)
-   : Segment(partition),tableStart(0),indexRoot(0),pages(0),groups1(0),groups2(0),cardinality(0)
+   : Segment(partition),tableStart(0),indexRoot(0),pages(0),groups1(0),groups2(0),cardinality(0),generation(0),leafFormat(LeafFormat_Delta),summary(0)
    // Constructor
 {
 }
 //---------------------------------------------------------------------------
+FactsSegment::~FactsSegment()
+   // Destructor
+{
+   delete summary;
+}
+//---------------------------------------------------------------------------
 Segment::Type FactsSegment::getType() const
    // Get the type
 {
@@ -550,6 +644,7 @@ void FactsSegment::refreshInfo()
    groups1=getSegmentData(slotGroups1);
    groups2=getSegmentData(slotGroups2);
    cardinality=getSegmentData(slotCardinality);
+   leafFormat=(getSegmentData(slotLeafFormat)==LeafFormat_Packed)?LeafFormat_Packed:LeafFormat_Delta;
 }
 //---------------------------------------------------------------------------
 void FactsSegment::loadFullFacts(Source& reader)
@@ -567,11 +662,86 @@ void FactsSegment::loadCounts(unsigned groups1,unsigned groups2,unsigned cardina
    this->cardinality=cardinality; setSegmentData(slotCardinality,cardinality);
 }
 //---------------------------------------------------------------------------
+void FactsSegment::setLeafFormat(LeafFormat leafFormat)
+   // Set the encoding for new leaves
+{
+   this->leafFormat=leafFormat;
+   setSegmentData(slotLeafFormat,leafFormat);
+}
+//---------------------------------------------------------------------------
 void FactsSegment::update(FactsSegment::Source& reader)
    // Load new facts into the segment
 {
    Index::LeafEntrySource source(reader);
    Index(*this).performUpdate(source);
+
+   // Cached decompressed pages are stale now
+   generation++;
+}
+//---------------------------------------------------------------------------
+FactsSegment::LeafSummary* FactsSegment::acquireLeafSummary()
+   // Get a reference to the leaf summary of the current generation
+{
+   auto_lock lock(summaryMutex);
+
+   // Rebuild after updates
+   if ((!summary)||(summary->generation!=generation)) {
+      vector<pair<Index::InnerKey,unsigned> > bounds;
+      Index(*this).collectLeafBounds(bounds);
+
+      // Scans may still use the old summary, the last one frees it
+      if (summary&&(!--summary->references))
+         delete summary;
+      summary=new LeafSummary();
+      summary->generation=generation;
+      summary->references=1;
+      summary->bounds.resize(bounds.size());
+      summary->pages.resize(bounds.size());
+      for (unsigned index=0;index<bounds.size();index++) {
+         summary->bounds[index].value1=bounds[index].first.value1;
+         summary->bounds[index].value2=bounds[index].first.value2;
+         summary->bounds[index].value3=bounds[index].first.value3;
+         summary->pages[index]=bounds[index].second;
+      }
+   }
+
+   if (summary->pages.empty())
+      return 0;
+   summary->references++;
+   return summary;
+}
+//---------------------------------------------------------------------------
+void FactsSegment::releaseLeafSummary(LeafSummary* summary)
+   // Release a reference to a leaf summary
+{
+   auto_lock lock(summaryMutex);
+
+   if (!--summary->references)
+      delete summary;
+}
+//---------------------------------------------------------------------------
+void FactsSegment::splitRange(const Triple& from,const Triple& to,unsigned parts,unsigned minPages,vector<Triple>& bounds)
+   // Split a key range into ranges of about equal numbers of leaf pages
+{
+   bounds.clear();
+   LeafSummary* summary=acquireLeafSummary();
+   if (!summary)
+      return;
+
+   // Find the leaves overlapping the range
+   unsigned start=summary->find(from.value1,from.value2,from.value3),stop=summary->find(to.value1,to.value2,to.value3);
+   if (stop>=summary->bounds.size())
+      stop=summary->bounds.size()-1;
+   if (start<stop) {
+      unsigned leaves=stop-start+1;
+      if (parts>leaves/minPages)
+         parts=leaves/minPages;
+
+      // Split after the last entry of every range, all of them are below the end of the range
+      for (unsigned part=1;part<parts;part++)
+         bounds.push_back(summary->bounds[start+(static_cast<uint64_t>(leaves)*part)/parts-1]);
+   }
+   releaseLeafSummary(summary);
 }
 //---------------------------------------------------------------------------
 FactsSegment::Scan::Hint::Hint()
@@ -585,7 +755,7 @@ FactsSegment::Scan::Hint::~Hint()
 }
 //---------------------------------------------------------------------------
 FactsSegment::Scan::Scan(Hint* hint,unsigned time)
-   : seg(0),hint(hint),time(time)
+   : seg(0),cache(0),leaf(0),summary(0),triples(0),hint(hint),time(time)
    // Constructor
 {
 }
@@ -594,13 +764,18 @@ FactsSegment::Scan::~Scan()
    // Destructor
 {
    close();
+   delete[] triples;
 }
 //---------------------------------------------------------------------------
 bool FactsSegment::Scan::first(FactsSegment& segment)
    // Start a new scan over the whole segment
 {
    current=segment.readShared(segment.tableStart);
+   releaseLeaf();
+   releaseSummary();
    seg=&segment;
+   cache=segment.getPartition().getLeafCache();
+   summary=hint?segment.acquireLeafSummary():0;
    pos=posLimit=0;
 
    return next();
@@ -614,7 +789,11 @@ bool FactsSegment::Scan::first(FactsSegment& segment,unsigned start1,unsigned st
       return false;
 
    // Place the iterator
+   releaseLeaf();
+   releaseSummary();
    seg=&segment;
+   cache=segment.getPartition().getLeafCache();
+   summary=hint?segment.acquireLeafSummary():0;
    pos=posLimit=0;
 
    // Skip over leading entries that are too small
@@ -781,6 +960,10 @@ static bool skipInTime(const unsigned char*& oreader,const unsigned char* limit,
 static FactsSegment::Triple* decompress(const unsigned char* reader,const unsigned char* limit,FactsSegment::Triple* writer,unsigned time)
    // Decompress triples
 {
+   // Block-packed pages contain only triples that were never deleted
+   if (PackedLeaf::isPacked(reader))
+      return (time!=~0u)?PackedLeaf::unpack(reader,writer):writer;
+
    // Decompress the first triple
    unsigned value1=Segment::readUint32Aligned(reader); reader+=4;
    unsigned value2=Segment::readUint32Aligned(reader); reader+=4;
@@ -926,24 +1109,100 @@ static FactsSegment::Triple* decompress(const unsigned char* reader,const unsign
    return writer;
 }
 //---------------------------------------------------------------------------
+void FactsSegment::Scan::decodePage()
+   // Decompress the current page or use the cached copy
+{
+   releaseLeaf();
+   const unsigned char* page=static_cast<const unsigned char*>(current.getPage());
+
+   // Without cache decompress into our own buffer
+   if (!cache) {
+      if (!triples)
+         triples=new Triple[maxCount];
+      pos=triples;
+      posLimit=decompress(page+Index::leafHeaderSize,page+BufferReference::pageSize,triples,time);
+      return;
+   }
+
+   // Decompress only if nobody did before
+   unsigned pageNo=current.getPageNo();
+   if ((leaf=cache->lookup(seg,seg->generation,pageNo,time))==0) {
+      Triple* buffer=cache->allocateBuffer();
+      Triple* bufferLimit=decompress(page+Index::leafHeaderSize,page+BufferReference::pageSize,buffer,time);
+      leaf=cache->insert(seg,seg->generation,pageNo,time,buffer,bufferLimit);
+   }
+   pos=leaf->begin();
+   posLimit=leaf->end();
+}
+//---------------------------------------------------------------------------
+void FactsSegment::Scan::releaseLeaf()
+   // Unpin the cached page
+{
+   if (leaf) {
+      cache->release(leaf);
+      leaf=0;
+   }
+}
+//---------------------------------------------------------------------------
+void FactsSegment::Scan::releaseSummary()
+   // Release the leaf summary
+{
+   if (summary) {
+      seg->releaseLeafSummary(summary);
+      summary=0;
+   }
+}
+//---------------------------------------------------------------------------
+bool FactsSegment::Scan::skipPages(unsigned value1,unsigned value2,unsigned value3)
+   // Move to the first page that may contain an entry using the leaf summary
+{
+   // Locate the current page. Versioned entries may repeat a bound on the next page
+   Index::InnerKey first;
+   Index::readFirstLeafEntryKey(first,static_cast<const unsigned char*>(current.getPage())+Index::leafHeaderSize);
+   unsigned pageNo=current.getPageNo(),count=summary->pages.size();
+   unsigned here=summary->find(first.value1,first.value2,first.value3);
+   while ((here<count)&&(summary->pages[here]!=pageNo))
+      ++here;
+   if (here==count)
+      return true;
+
+   // Leapfrog over all pages that end before the entry
+   unsigned target=summary->find(value1,value2,value3);
+   if (target>=count)
+      return false;
+   if (target>here) {
+      current=seg->readShared(summary->pages[target]);
+      readahead.reset(*seg);
+   }
+   return true;
+}
+//---------------------------------------------------------------------------
 bool FactsSegment::Scan::readNextPage()
    // Read the next entry
 {
    readNext:
 
    // Alread read the first page? Then read the next one
-   if (pos-1) {
+   if (posLimit) {
       const unsigned char* page=static_cast<const unsigned char*>(current.getPage());
       unsigned nextPage=readUint32Aligned(page+8);
       if (!nextPage)
          return false;
+      readahead.advance(*seg,nextPage);
       current=seg->readShared(nextPage);
+
+      // Skip pages that cannot contain the hinted entry before decompressing them
+      if (summary) {
+         Index::InnerKey key;
+         Index::readFirstLeafEntryKey(key,static_cast<const unsigned char*>(current.getPage())+Index::leafHeaderSize);
+         hint->next(key.value1,key.value2,key.value3);
+         if (!skipPages(key.value1,key.value2,key.value3))
+            return false;
+      }
    }
 
    // Decompress the triples
-   const unsigned char* page=static_cast<const unsigned char*>(current.getPage());
-   pos=triples;
-   posLimit=decompress(page+Index::leafHeaderSize,page+BufferReference::pageSize,triples,time);
+   decodePage();
 
    // Empty page? Can happen due to versioning
    if (pos==posLimit)
@@ -951,7 +1210,7 @@ bool FactsSegment::Scan::readNextPage()
 
    // Check if we should make a skip
    if (hint) {
-      unsigned next1=triples[0].value1,next2=triples[0].value2,next3=triples[0].value3;
+      unsigned next1=(*pos).value1,next2=(*pos).value2,next3=(*pos).value3;
       while (true) {
          // Compute the next hint
          hint->next(next1,next2,next3);
@@ -959,8 +1218,18 @@ bool FactsSegment::Scan::readNextPage()
          // No entry on this page?
          const Triple* oldPos=pos;
          if (!find(next1,next2,next3)) {
-            if (!Index(*seg).findLeaf(current,Index::InnerKey(next1,next2,next3)))
-               return false;
+            if (summary) {
+               // Continue with the next page if the entry might still follow
+               unsigned pageNo=current.getPageNo();
+               if (!skipPages(next1,next2,next3))
+                  return false;
+               if (current.getPageNo()==pageNo)
+                  goto readNext;
+            } else {
+               if (!Index(*seg).findLeaf(current,Index::InnerKey(next1,next2,next3)))
+                  return false;
+               readahead.reset(*seg);
+            }
             pos=posLimit=0;
             ++pos;
             goto readNext;
@@ -978,6 +1247,10 @@ bool FactsSegment::Scan::readNextPage()
 void FactsSegment::Scan::close()
    // Close the scan
 {
+   if (seg)
+      readahead.reset(*seg);
+   releaseLeaf();
+   releaseSummary();
    seg=0;
    current.reset();
 }
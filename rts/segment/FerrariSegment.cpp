@@ -1,15 +1,17 @@
 #include "rts/segment/FerrariSegment.hpp"
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/database/DatabaseBuilder.hpp"
 #include "rts/database/DatabasePartition.hpp"
 #include "rts/operator/MergeJoin.hpp"
-#include "infra/util/fastlz.hpp"
 #include "rts/operator/AggregatedIndexScan.hpp"
 #include "rts/segment/FactsSegment.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/FullyAggregatedFactsSegment.hpp"
 #include "rts/ferrari/Graph.hpp"
 #include "rts/ferrari/Index.hpp"
+#include "infra/osdep/Event.hpp"
+#include "infra/osdep/Thread.hpp"
 #include "infra/osdep/Timestamp.hpp"
 #include "rts/runtime/Runtime.hpp"
 #include <algorithm>
@@ -26,10 +28,40 @@
 // or send a letter to Creative Commons, 171 Second Street, Suite 300,
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
+// Layout of the segment:
+//
+// The directory is a chain of pages, each page contains
+//    LSN (8 bytes), next page (4 bytes), entry count (4 bytes)
+// followed by the entries in predicate order. Each entry contains
+//    predicate (4 bytes), first index page (4 bytes), nodes (4 bytes),
+//    components (4 bytes), edges (4 bytes), intervals (8 bytes),
+//    reachable (8 bytes)
+// The statistics are used by the cost model. Version 1 directories only
+// contained the (predicate,first index page) pairs.
+//
+// Each index is serialized into a byte stream that is stored in its own chain
+// of pages, each page contains
+//    LSN (8 bytes), next page (4 bytes), used bytes (4 bytes)
+// followed by the payload. The stream contains the SCC mapping, the condensed
+// adjacency lists, the topological filters, the interval lists and the seed
+// bitsets, all values are encoded with variable length.
+//---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
 // Info slots
 static const unsigned slotDirectoryPage = 0;
+static const unsigned slotFormat = 1;
+//---------------------------------------------------------------------------
+/// The current format version
+static const unsigned formatVersion = 2;
+/// The size of a directory entry
+static const unsigned entrySize = 36;
+/// Size of the page header
+static const unsigned headerSize = 16;
+/// The number of seeds
+static const unsigned seeds = 5;
+/// Estimated memory required to build the index of a predicate, per edge
+static const uint64_t buildMemoryPerEdge = 128;
 //---------------------------------------------------------------------------
 static bool contains(const vector<unsigned>& allNodes,unsigned id)
    // Is the id in the list?
@@ -41,8 +73,9 @@ static bool contains(const vector<unsigned>& allNodes,unsigned id)
 static string lookupId(Database& db,unsigned id)
    // Lookup a string id
 {
+   BufferReference page;
    const char* start=0,*stop=0; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,stop,type,subType);
+   db.getDictionary().lookupById(id,page,start,stop,type,subType);
    return string(start,stop);
 }
 //---------------------------------------------------------------------------
@@ -69,216 +102,478 @@ static void findPredicates(Database& db, vector<unsigned>& predicates){
    cerr<<"#predicates: "<<predicates.size()<<endl;
 }
 //---------------------------------------------------------------------------
+static void writeUIntV(vector<unsigned char>& out,unsigned long long v)
+   // Write a value with variable length
+{
+   while (v>=128) {
+      out.push_back(static_cast<unsigned char>((v&0x7F)|0x80));
+      v>>=7;
+   }
+   out.push_back(static_cast<unsigned char>(v));
+}
+//---------------------------------------------------------------------------
+static unsigned long long readUIntV(const unsigned char*& reader)
+   // Read a value with variable length
+{
+   unsigned long long result=0;
+   unsigned shift=0;
+   while ((*reader)&0x80) {
+      result|=static_cast<unsigned long long>((*reader)&0x7F)<<shift;
+      shift+=7;
+      ++reader;
+   }
+   result|=static_cast<unsigned long long>(*reader)<<shift;
+   ++reader;
+   return result;
+}
+//---------------------------------------------------------------------------
+static void writeBits(vector<unsigned char>& out,const ::bitset& bits)
+   // Write a bitset in 32bit words
+{
+   for (unsigned ofs=0,limit=bits.size();ofs<limit;ofs+=32) {
+      unsigned word=0;
+      for (unsigned index=ofs;(index<limit)&&(index<ofs+32);index++)
+         if (bits[index])
+            word|=1u<<(index-ofs);
+      writeUIntV(out,word);
+   }
+}
+//---------------------------------------------------------------------------
+static void readBits(const unsigned char*& reader,::bitset& bits)
+   // Read a bitset in 32bit words
+{
+   for (unsigned ofs=0,limit=bits.size();ofs<limit;ofs+=32) {
+      unsigned word=readUIntV(reader);
+      for (unsigned index=ofs;(index<limit)&&(index<ofs+32);index++)
+         bits[index]=(word>>(index-ofs))&1;
+   }
+}
+//---------------------------------------------------------------------------
 FerrariSegment::FerrariSegment(DatabasePartition& partition)
    : Segment(partition),directoryPage(0)
    // Constructor
 {
 }
 //---------------------------------------------------------------------------
+FerrariSegment::~FerrariSegment()
+   // Destructor
+{
+   for (map<unsigned,Index*>::const_iterator iter=loaded.begin(),limit=loaded.end();iter!=limit;++iter) {
+      Graph* g=(*iter).second->get_graph();
+      delete (*iter).second;
+      delete g;
+   }
+}
+//---------------------------------------------------------------------------
 Segment::Type FerrariSegment::getType() const
    // Get the type
 {
    return Segment::Type_Ferrari;
 }
 //---------------------------------------------------------------------------
-/// Refresh segment info stored in the partition
 void FerrariSegment::refreshInfo()
+   // Refresh segment info stored in the partition
 {
    Segment::refreshInfo();
    directoryPage=getSegmentData(slotDirectoryPage);
-   BufferReference page(readShared(directoryPage));
-   const unsigned char* directory=static_cast<const unsigned char*>(page.getPage());
-   unsigned pred=readUint32(directory);
-   cerr<<"number of predicates: "<<pred<<endl;
+   directory.clear();
+   statistics.clear();
+
+   // Segments written by older versions only contained a single graph
+   unsigned format=getSegmentData(slotFormat);
+   if ((format!=1)&&(format!=formatVersion)) {
+      cerr << "warning: outdated FERRARI segment, reachability indexes are not available" << endl;
+      return;
+   }
+
+   // Read the directory
+   for (unsigned pageNo=directoryPage;pageNo;) {
+      BufferReference page(readShared(pageNo));
+      const unsigned char* reader=static_cast<const unsigned char*>(page.getPage());
+      unsigned count=readUint32(reader+12);
+      for (unsigned index=0;index<count;index++) {
+         if (format==1) {
+            directory.push_back(pair<unsigned,unsigned>(readUint32(reader+headerSize+8*index),readUint32(reader+headerSize+8*index+4)));
+            continue;
+         }
+         const unsigned char* entry=reader+headerSize+entrySize*index;
+         directory.push_back(pair<unsigned,unsigned>(readUint32(entry),readUint32(entry+4)));
+         Statistics stats;
+         stats.nodes=readUint32(entry+8);
+         stats.components=readUint32(entry+12);
+         stats.edges=readUint32(entry+16);
+         stats.intervals=readUint64(entry+20);
+         stats.reachable=readUint64(entry+28);
+         statistics.push_back(stats);
+      }
+      pageNo=readUint32(reader+8);
+   }
 }
 //---------------------------------------------------------------------------
-class FerrariSegment::Dumper{
-private:
-   /// The maximum number of entries per page
-   static const unsigned maxEntries = 32768;
-   /// The segment
-   FerrariSegment& seg;
-   /// Page chainer
-   DatabaseBuilder::PageChainer chainer;
-   /// The entries
-   vector<vector<unsigned> > &data;
-   /// The current count
-   unsigned count;
-   /// Current offset in the data
-   unsigned offset;
-   /// Pages
-   vector<unsigned>& pages;
-   /// Write entries to a buffer
-   bool writeEntries(unsigned start,unsigned count,unsigned char* pageBuffer);
-   /// Write some entries
-   unsigned writeSome();
-public:
-   /// Constructor
-   Dumper(FerrariSegment& seg,vector<vector<unsigned> >& data,vector<unsigned>& pages) : seg(seg),chainer(8),data(data),count(0),offset(0),pages(pages) {}
+void FerrariSegment::computeStatistics(Index& index,Statistics& stats)
+   // Compute the statistics of an index
+{
+   Graph& g=*index.get_graph();
+   unsigned n=index.n_;
+   stats.nodes=g.name2id.size();
+   stats.components=n;
+   stats.edges=g.num_edges();
+   stats.intervals=0;
+   stats.reachable=0;
 
-   void write();
-};
+   // The component sizes, summed up in interval order
+   vector<unsigned> sizes(n);
+   for (map<unsigned,unsigned>::const_iterator iter=g.name2id.begin(),limit=g.name2id.end();iter!=limit;++iter)
+      sizes[(*iter).second]++;
+   vector<unsigned long long> prefix(n+1);
+   for (unsigned v=0;v<n;v++)
+      if (~index.id_[v])
+         prefix[index.id_[v]+1]=sizes[v];
+   for (unsigned v=0;v<n;v++)
+      prefix[v+1]+=prefix[v];
+
+   // The reachable set of a node covers all components in its intervals.
+   // Approximate intervals overestimate it, which is fine for a cost model
+   for (unsigned v=0;v<n;v++) {
+      const IntervalList* intervals=index.intervals[v];
+      if (!intervals) {
+         stats.reachable+=static_cast<unsigned long long>(sizes[v])*sizes[v];
+         continue;
+      }
+      const IntervalList::bounds& lower=intervals->get_lower(),&upper=intervals->get_upper();
+      unsigned long long reachable=0;
+      for (unsigned index=0,limit=lower.size();index<limit;index++)
+         reachable+=prefix[upper[index]+1]-prefix[lower[index]];
+      stats.intervals+=lower.size();
+      stats.reachable+=reachable*sizes[v];
+   }
+}
 //---------------------------------------------------------------------------
-void FerrariSegment::Dumper::write(){
-	while (offset < data.size()){
-		count=std::min(static_cast<unsigned>(data.size()-offset), maxEntries);
-		offset=offset+writeSome();
-		cerr<<"count: "<<count<<endl;
-		cerr<<"offset: "<<offset<<endl;
+void FerrariSegment::packIndex(Index& index,vector<unsigned char>& out)
+   // Serialize an index
+{
+   Graph& g=*index.get_graph();
+   unsigned n=index.n_;
+   out.clear();
 
-	}
-   chainer.finish();
+   // The header
+   writeUIntV(out,n);
+   writeUIntV(out,index.s_);
+   writeUIntV(out,g.name2id.size());
+
+   // The SCC mapping
+   unsigned last=0;
+   for (map<unsigned,unsigned>::const_iterator iter=g.name2id.begin(),limit=g.name2id.end();iter!=limit;++iter) {
+      writeUIntV(out,(*iter).first-last);
+      writeUIntV(out,(*iter).second);
+      last=(*iter).first;
+   }
+
+   // The condensed graph
+   for (unsigned v=0;v<n;v++) {
+      const vector<unsigned>& nb=g.nb[v];
+      writeUIntV(out,nb.size());
+      unsigned last=0;
+      for (vector<unsigned>::const_iterator iter=nb.begin(),limit=nb.end();iter!=limit;++iter) {
+         writeUIntV(out,(*iter)-last);
+         last=(*iter);
+      }
+   }
+
+   // Reachable ids and filters
+   for (unsigned v=0;v<n;v++) {
+      writeUIntV(out,index.id_[v]+1);
+      writeUIntV(out,index.tlevel_[v]);
+      writeUIntV(out,index.torder_[v]+1);
+   }
+
+   // The intervals
+   for (unsigned v=0;v<n;v++) {
+      const IntervalList* intervals=index.intervals[v];
+      if (!intervals) {
+         writeUIntV(out,0);
+         continue;
+      }
+      const IntervalList::bounds& lower=intervals->get_lower(),&upper=intervals->get_upper();
+      writeUIntV(out,lower.size()+1);
+      unsigned last=0;
+      for (unsigned index=0,limit=lower.size();index<limit;index++) {
+         writeUIntV(out,lower[index]-last);
+         writeUIntV(out,(static_cast<unsigned long long>(upper[index]-lower[index])<<1)|(intervals->is_exact(index)?1:0));
+         last=upper[index];
+      }
+   }
+
+   // The seeds
+   if (index.s_) {
+      for (unsigned v=0;v<n;v++) {
+         writeBits(out,index.seed_in[v]);
+         writeBits(out,index.seed_out[v]);
+      }
+   }
 
 }
 //---------------------------------------------------------------------------
-unsigned FerrariSegment::Dumper::writeSome(){
-	// Find the maximum fill size
-	unsigned char pageBuffer[2*BufferReference::pageSize];
-	unsigned l=0,r=count,best=1;
-	while (l<r) {
-		unsigned m=(l+r)/2;
-		if (writeEntries(offset,m+1,pageBuffer)) {
-			if (m+1>best)
-				best=m+1;
-			l=m+1;
-		} else
-			r=m;
-	}
-   // Write the page
-   writeEntries(offset,best,pageBuffer);
-   chainer.store(&seg,pageBuffer);
-   pages.push_back(chainer.getPageNo());
-	count=best;
-	return best;
+unsigned FerrariSegment::writeIndex(const vector<unsigned char>& data)
+   // Write a serialized index, returns the first page
+{
+   DatabaseBuilder::PageChainer chainer(8);
+   unsigned char buffer[BufferReference::pageSize];
+   const unsigned char* reader=data.data(),*readerLimit=reader+data.size();
+   do {
+      unsigned len=min(static_cast<unsigned>(readerLimit-reader),BufferReference::pageSize-headerSize);
+      writeUint32(buffer+12,len);
+      memcpy(buffer+headerSize,reader,len);
+      memset(buffer+headerSize+len,0,BufferReference::pageSize-(headerSize+len));
+      chainer.store(this,buffer);
+      reader+=len;
+   } while (reader<readerLimit);
+   chainer.finish();
+
+   return chainer.getFirstPageNo();
 }
 //---------------------------------------------------------------------------
-static unsigned char* writeUIntV(unsigned char* writer,unsigned long long v)
-   // Write a value with variable length
+Index* FerrariSegment::unpackIndex(unsigned firstPage)
+   // Deserialize an index
 {
-   while (v>=128) {
-      *writer=static_cast<unsigned char>((v&0x7F)|0x80);
-      v>>=7;
-      ++writer;
+   // Collect the serialized data
+   vector<unsigned char> data;
+   for (unsigned pageNo=firstPage;pageNo;) {
+      BufferReference page(readShared(pageNo));
+      const unsigned char* reader=static_cast<const unsigned char*>(page.getPage());
+      unsigned len=readUint32(reader+12);
+      data.insert(data.end(),reader+headerSize,reader+headerSize+len);
+      pageNo=readUint32(reader+8);
    }
-   *writer=static_cast<unsigned char>(v);
-   return writer+1;
-}
-//---------------------------------------------------------------------------
-bool FerrariSegment::Dumper::writeEntries(unsigned start,unsigned count,unsigned char* pageBuffer){
-   // Refuse to handle empty ranges
-   if (!count)
-      return false;
+   const unsigned char* reader=data.data();
 
-   // Temp space
-   static const unsigned maxSize=10*BufferReference::pageSize;
-   unsigned char buffer1[maxSize+32];
-   unsigned char buffer2[maxSize+(maxSize/15)];
+   // The header
+   Graph* g=new Graph();
+   unsigned n=readUIntV(reader);
+   unsigned s=readUIntV(reader);
+   unsigned names=readUIntV(reader);
+   g->n=n;
 
-   // Write the entries
-   unsigned char* writer=buffer1,*limit=buffer1+maxSize;
-   writer=writeUIntV(writer,count);
-   for (unsigned i=start; i<start+count; i++){
-   	writer=writeUIntV(writer,data[i].size());
-   	if (writer>limit) return false;
-   	for (unsigned j=0; j<data[i].size(); j++){
-      	writer=writeUIntV(writer,data[i][j]);
-      	if (writer>limit) return false;
-   	}
+   // The SCC mapping
+   unsigned last=0;
+   for (unsigned index=0;index<names;index++) {
+      unsigned name=last+readUIntV(reader);
+      unsigned id=readUIntV(reader);
+      g->name2id.insert(g->name2id.end(),pair<unsigned,unsigned>(name,id));
+      last=name;
    }
+   g->id2name.resize(n);
+   for (map<unsigned,unsigned>::const_iterator iter=g->name2id.begin(),limit=g->name2id.end();iter!=limit;++iter)
+      g->id2name[(*iter).second]=(*iter).first;
 
-   // Compress them
-   unsigned len=fastlz_compress(buffer1,writer-buffer1,buffer2);
-   if (len>=(BufferReference::pageSize-16))
-      return false;
-   // And write the page
-   writeUint32(pageBuffer+8,0);
-   writeUint32(pageBuffer+12,len);
-   cerr<<"len "<<len<<endl;
-   memcpy(pageBuffer+16,buffer2,len);
-   memset(pageBuffer+16+len,0,BufferReference::pageSize-(16+len));
+   // The condensed graph
+   g->nb.resize(n);
+   for (unsigned v=0;v<n;v++) {
+      vector<unsigned>& nb=g->nb[v];
+      nb.resize(readUIntV(reader));
+      unsigned last=0;
+      for (vector<unsigned>::iterator iter=nb.begin(),limit=nb.end();iter!=limit;++iter)
+         last=(*iter)=last+readUIntV(reader);
+      g->m+=nb.size();
+   }
 
-   return true;
+   // Reachable ids and filters
+   Index* index=new Index(g,s);
+   index->id_.resize(n);
+   index->id2node.assign(n,~0u);
+   index->tlevel_.resize(n);
+   index->torder_.resize(n);
+   for (unsigned v=0;v<n;v++) {
+      index->id_[v]=readUIntV(reader)-1;
+      index->tlevel_[v]=readUIntV(reader);
+      index->torder_[v]=readUIntV(reader)-1;
+      if (~(index->id_[v]))
+         index->id2node[index->id_[v]]=v;
+   }
+
+   // The intervals
+   index->intervals.assign(n,0);
+   for (unsigned v=0;v<n;v++) {
+      unsigned count=readUIntV(reader);
+      if (!count)
+         continue;
+      IntervalList* intervals=new IntervalList();
+      unsigned last=0;
+      for (unsigned i=1;i<count;i++) {
+         unsigned lower=last+readUIntV(reader);
+         unsigned long long info=readUIntV(reader);
+         unsigned upper=lower+static_cast<unsigned>(info>>1);
+         intervals->add(lower,upper,static_cast<char>(info&1));
+         last=upper;
+      }
+      index->intervals[v]=intervals;
+   }
+
+   // The seeds
+   if (s) {
+      index->seed_in.assign(n,::bitset(s));
+      index->seed_out.assign(n,::bitset(s));
+      for (unsigned v=0;v<n;v++) {
+         readBits(reader,index->seed_in[v]);
+         readBits(reader,index->seed_out[v]);
+      }
+   }
+
+   return index;
 }
-//static unsigned writeSome(DatabaseBuilder::PageChainer& chainer,vector<vector<unsigned> >& data){
-//   // Find the maximum fill size
-//   unsigned char pageBuffer[2*BufferReference::pageSize];
-//   unsigned l=0,r=count,best=1;
-//   while (l<r) {
-//      unsigned m=(l+r)/2;
-//      if (writeEntries(m+1,pageBuffer)) {
-//         if (m+1>best)
-//            best=m+1;
-//         l=m+1;
-//      } else {
-//         r=m;
-//      }
-//   }
-//
-//}
 //---------------------------------------------------------------------------
-static void writeUint32(unsigned char* target,unsigned value)
-   // Write a 32bit value
+void FerrariSegment::writeDirectory()
+   // Write the directory
 {
-   target[0]=value>>24;
-   target[1]=(value>>16)&0xFF;
-   target[2]=(value>>8)&0xFF;
-   target[3]=value&0xFF;
-}
-//---------------------------------------------------------------------------
-static void packGraphInner(FerrariSegment& seg,const vector<unsigned>& data, vector<unsigned>& pages){
-	// inner (page) nodes for the serialized graph
-   const unsigned headerSize = 24; // LSN+marker+next+count+padding
-   DatabaseBuilder::PageChainer chainer(12);
+   const unsigned maxEntries=(BufferReference::pageSize-headerSize)/entrySize;
+   DatabaseBuilder::PageChainer chainer(8);
    unsigned char buffer[BufferReference::pageSize];
-   unsigned bufferPos=headerSize,bufferCount=0;
-   for (const auto iter:data) {
-      // Do we have to start a new page?
-      if ((bufferPos+12)>BufferReference::pageSize) {
-         writeUint32(buffer+8,0xFFFFFFFF);
-         writeUint32(buffer+16,bufferCount);
-         writeUint32(buffer+20,0);
-         for (unsigned index=bufferPos;index<BufferReference::pageSize;index++)
-            buffer[index]=0;
-         chainer.store(&seg,buffer);
-         pages.push_back(chainer.getPageNo());
-         bufferPos=headerSize; bufferCount=0;
+   unsigned pos=0;
+   do {
+      unsigned count=min(static_cast<unsigned>(directory.size()-pos),maxEntries);
+      writeUint32(buffer+12,count);
+      unsigned char* writer=buffer+headerSize;
+      for (unsigned index=0;index<count;index++,writer+=entrySize) {
+         const Statistics& stats=statistics[pos+index];
+         writeUint32(writer,directory[pos+index].first);
+         writeUint32(writer+4,directory[pos+index].second);
+         writeUint32(writer+8,stats.nodes);
+         writeUint32(writer+12,stats.components);
+         writeUint32(writer+16,stats.edges);
+         writeUint32(writer+20,static_cast<unsigned>(stats.intervals>>32));
+         writeUint32(writer+24,static_cast<unsigned>(stats.intervals));
+         writeUint32(writer+28,static_cast<unsigned>(stats.reachable>>32));
+         writeUint32(writer+32,static_cast<unsigned>(stats.reachable));
       }
-      // Write the entry
-      writeUint32(buffer+bufferPos,(iter)); bufferPos+=4;
-      bufferCount++;
-   }
-   // Write the last page
-   writeUint32(buffer+8,0xFFFFFFFF);
-   writeUint32(buffer+16,bufferCount);
-   writeUint32(buffer+20,0);
-   for (unsigned index=bufferPos;index<BufferReference::pageSize;index++)
-      buffer[index]=0;
-   chainer.store(&seg,buffer);
-   pages.push_back(chainer.getPageNo());
+      memset(writer,0,(buffer+BufferReference::pageSize)-writer);
+      chainer.store(this,buffer);
+      pos+=count;
+   } while (pos<directory.size());
    chainer.finish();
+
+   directoryPage=chainer.getFirstPageNo();
+   setSegmentData(slotDirectoryPage,directoryPage);
+   setSegmentData(slotFormat,formatVersion);
 }
 //---------------------------------------------------------------------------
-unsigned FerrariSegment::packGraph(Graph* g){
-   vector<unsigned> pages;
-   cerr<<"data size: "<<g->nb.size()<<endl;
-   FerrariSegment::Dumper d(*this,g->nb,pages);
-   d.write();
-   cerr<<"pages: "<<pages.size()<<endl;
-   if (pages.size()==1){
-   	vector<unsigned> newPages;
-   	packGraphInner(*this,pages,newPages);
-   	return newPages.back();
-   }
+/// A predicate whose index is being built
+struct FerrariSegment::BuildJob {
+   /// The predicate
+   unsigned predicate;
+   /// The edges, released once the graph is built
+   vector<pair<unsigned,unsigned> > edges;
+   /// The serialized index
+   vector<unsigned char> data;
+   /// Statistics
+   Statistics statistics;
+   /// Timings
+   unsigned graphTime,indexTime;
+   /// The memory accounted for the job
+   uint64_t memory;
+   /// Finished?
+   bool done;
+};
+//---------------------------------------------------------------------------
+/// State shared between the scan and the build workers
+struct FerrariSegment::BuildPipeline {
+   /// The number of nodes
+   unsigned nodeCount;
+   /// Jobs waiting for a worker
+   deque<BuildJob*> queue;
+   /// No more jobs will be added
+   bool finished;
+   /// The number of running workers
+   unsigned activeWorkers;
+   /// The memory of all jobs that are not written yet
+   uint64_t memory;
+   /// Protects the pipeline and the done flags of the jobs
+   Mutex mutex;
+   /// Signaled when jobs are added
+   Event jobAdded;
+   /// Signaled when a job is done or a worker exits
+   Event jobDone;
+};
+//---------------------------------------------------------------------------
+void FerrariSegment::buildIndex(BuildJob& job,unsigned nodeCount)
+   // Build and serialize the index of a predicate
+{
+   Timestamp t1;
+   Graph g(job.edges,nodeCount);
+   vector<pair<unsigned,unsigned> >().swap(job.edges);
+   Timestamp t2;
+   Index index(&g, seeds, ~0u, true);
+   index.build();
+   packIndex(index,job.data);
+   computeStatistics(index,job.statistics);
+   Timestamp t3;
+
+   job.graphTime=t2-t1;
+   job.indexTime=t3-t2;
+}
+//---------------------------------------------------------------------------
+void FerrariSegment::buildWorker(void* data)
+   // A build worker
+{
+   BuildPipeline& pipeline=*static_cast<BuildPipeline*>(data);
+   pipeline.mutex.lock();
+   while (true) {
+      while (pipeline.queue.empty()&&(!pipeline.finished))
+         pipeline.jobAdded.wait(pipeline.mutex);
+      if (pipeline.queue.empty())
+         break;
+      BuildJob& job=*pipeline.queue.front();
+      pipeline.queue.pop_front();
+      pipeline.mutex.unlock();
+
+      buildIndex(job,pipeline.nodeCount);
 
-   while (pages.size()>1){
-   	vector<unsigned> newPages;
-   	packGraphInner(*this,pages,newPages);
-   	swap(pages,newPages);
+      pipeline.mutex.lock();
+      pipeline.memory-=job.memory;
+      job.memory=job.data.size();
+      pipeline.memory+=job.memory;
+      job.done=true;
+      pipeline.jobDone.notifyAll(pipeline.mutex);
    }
-   return pages.back();
+   pipeline.activeWorkers--;
+   pipeline.jobDone.notifyAll(pipeline.mutex);
+   pipeline.mutex.unlock();
 }
+//---------------------------------------------------------------------------
+void FerrariSegment::writeJob(Database& db,BuildJob& job)
+   // Write a built index
+{
+   cerr<<"predicate: "<<lookupId(db,job.predicate)<<" "<<job.predicate<<endl;
+   cerr<<"   nodes: "<<job.statistics.components<<endl;
+   cerr<<"   edges: "<<job.statistics.edges<<endl;
+   cerr<<"   time to build the graph: "<<job.graphTime<<" ms"<<endl;
+   cerr<<"   time to construct ferrari: "<<job.indexTime<<" ms"<<endl;
+   directory.push_back(pair<unsigned,unsigned>(job.predicate,writeIndex(job.data)));
+   statistics.push_back(job.statistics);
+}
+//---------------------------------------------------------------------------
+void FerrariSegment::writeFinished(Database& db,deque<BuildJob*>& pending,BuildPipeline& pipeline)
+   // Write the finished jobs at the front of the pending list. Called without holding the pipeline lock
+{
+   while (!pending.empty()) {
+      BuildJob* job=pending.front();
+      pipeline.mutex.lock();
+      bool done=job->done;
+      pipeline.mutex.unlock();
+      if (!done)
+         break;
 
-void FerrariSegment::computeFerrari(Database& db){
+      pending.pop_front();
+      writeJob(db,*job);
+      pipeline.mutex.lock();
+      pipeline.memory-=job->memory;
+      pipeline.mutex.unlock();
+      delete job;
+   }
+}
+//---------------------------------------------------------------------------
+void FerrariSegment::computeFerrari(Database& db,unsigned threads,uint64_t memoryBudget)
+   // Compute the reachability indexes for all predicates that form paths
+{
    unsigned nodeCount=0;
    {
       FullyAggregatedFactsSegment::Scan scan;
@@ -291,44 +586,146 @@ void FerrariSegment::computeFerrari(Database& db){
    cerr<<"nodes: "<<nodeCount<<endl;
    vector<unsigned> predicates;
    findPredicates(db, predicates);
-   vector<Graph*> graphs;
+
+   // Start the workers. The scan slices the facts into per-predicate jobs,
+   // the workers build the indexes, and finished indexes are written in
+   // predicate order
+   BuildPipeline pipeline;
+   pipeline.nodeCount=nodeCount;
+   pipeline.finished=false;
+   pipeline.activeWorkers=0;
+   pipeline.memory=0;
+   if (threads>1) {
+      for (unsigned index=0;index<threads;index++) {
+         pipeline.mutex.lock();
+         pipeline.activeWorkers++;
+         pipeline.mutex.unlock();
+         if (!Thread::start(buildWorker,&pipeline)) {
+            pipeline.mutex.lock();
+            pipeline.activeWorkers--;
+            pipeline.mutex.unlock();
+            break;
+         }
+      }
+   }
+   bool parallel=(pipeline.activeWorkers>0);
+   if (parallel)
+      cerr<<"building with "<<pipeline.activeWorkers<<" threads"<<endl;
+
+   Timestamp start;
+   directory.clear();
+   statistics.clear();
+   deque<BuildJob*> pending;
    {
       FactsSegment::Scan scan;
       unsigned current=~0u;
-      bool global = true;
-      unsigned seeds=5;
       vector<pair<unsigned,unsigned> > edge_list;
-      if (scan.first(db.getFacts(Database::Order_Predicate_Subject_Object),0,0,0)) do {
-         // A new node?
-         if (scan.getValue1()!=current) {
-         	// add new Graph
+      bool hasData=scan.first(db.getFacts(Database::Order_Predicate_Subject_Object),0,0,0);
+      while (true) {
+         // A new predicate?
+         if ((!hasData)||(scan.getValue1()!=current)) {
          	if (~current&&contains(predicates,current)){
-            	cerr<<"predicate: "<<lookupId(db,current)<<" "<<current<<endl;
-            	Timestamp t1;
-            	Graph* g = new Graph(edge_list, nodeCount);
-            	Timestamp t2;
-            	cerr<<"   time to build the graph: "<<t2-t1<<" ms"<<endl;
-            	// construct an index
-            	Timestamp a;
-            	Index *bm = new Index(g, seeds, ~0u, global);
-            	bm->build();
-            	graphs.push_back(g);
+         	   BuildJob* job=new BuildJob();
+         	   job->predicate=current;
+         	   job->edges.swap(edge_list);
+         	   job->memory=job->edges.size()*buildMemoryPerEdge;
+         	   job->done=false;
+         	   if (!parallel) {
+         	      buildIndex(*job,nodeCount);
+         	      writeJob(db,*job);
+         	      delete job;
+         	   } else {
+         	      // Respect the memory budget, but always keep at least one job in flight
+         	      pipeline.mutex.lock();
+         	      while (pipeline.memory&&(pipeline.memory+job->memory>memoryBudget)) {
+         	         if (pending.front()->done) {
+         	            pipeline.mutex.unlock();
+         	            writeFinished(db,pending,pipeline);
+         	            pipeline.mutex.lock();
+         	         } else {
+         	            pipeline.jobDone.wait(pipeline.mutex);
+         	         }
+         	      }
+         	      pipeline.memory+=job->memory;
+         	      pipeline.queue.push_back(job);
+         	      pipeline.jobAdded.notify(pipeline.mutex);
+         	      pipeline.mutex.unlock();
+         	      pending.push_back(job);
+         	      writeFinished(db,pending,pipeline);
+         	   }
          	}
+            if (!hasData)
+               break;
             current=scan.getValue1();
          	edge_list.clear();
          }
          edge_list.push_back({scan.getValue2(),scan.getValue3()});
-      }while (scan.next());
+         hasData=scan.next();
+      }
    }
 
-   Graph* g=graphs[0];
-   unsigned graphPacked=packGraph(g);
-   // Write the directory page
-   BufferReferenceModified page;
-   allocPage(page);
-   unsigned char* directory=static_cast<unsigned char*>(page.getPage());
-   writeUint32(directory,graphPacked);
-   directoryPage=page.getPageNo();
-   page.unfixWithoutRecovery();
-   setSegmentData(slotDirectoryPage,directoryPage);
+   // Wait for the remaining jobs and stop the workers
+   if (parallel) {
+      pipeline.mutex.lock();
+      pipeline.finished=true;
+      pipeline.jobAdded.notifyAll(pipeline.mutex);
+      while (!pending.empty()) {
+         if (pending.front()->done) {
+            pipeline.mutex.unlock();
+            writeFinished(db,pending,pipeline);
+            pipeline.mutex.lock();
+         } else {
+            pipeline.jobDone.wait(pipeline.mutex);
+         }
+      }
+      while (pipeline.activeWorkers)
+         pipeline.jobDone.wait(pipeline.mutex);
+      pipeline.mutex.unlock();
+   }
+
+   // Write the directory
+   writeDirectory();
+   Timestamp stop;
+   cerr<<"number of indexes: "<<directory.size()<<endl;
+   cerr<<"time to build all indexes: "<<(stop-start)<<" ms"<<endl;
 }
+//---------------------------------------------------------------------------
+bool FerrariSegment::hasIndex(unsigned predicate) const
+   // Is there an index for the predicate?
+{
+   vector<pair<unsigned,unsigned> >::const_iterator pos=lower_bound(directory.begin(),directory.end(),pair<unsigned,unsigned>(predicate,0));
+   return (pos!=directory.end())&&((*pos).first==predicate);
+}
+//---------------------------------------------------------------------------
+Index* FerrariSegment::lookupIndex(unsigned predicate)
+   // Get the index for a predicate, loading it if required
+{
+   vector<pair<unsigned,unsigned> >::const_iterator pos=lower_bound(directory.begin(),directory.end(),pair<unsigned,unsigned>(predicate,0));
+   if ((pos==directory.end())||((*pos).first!=predicate))
+      return 0;
+
+   auto_lock lock(loadLock);
+   Index*& index=loaded[predicate];
+   if (!index)
+      index=unpackIndex((*pos).second);
+   return index;
+}
+//---------------------------------------------------------------------------
+void FerrariSegment::getPredicates(vector<unsigned>& predicates) const
+   // Get all indexed predicates
+{
+   predicates.clear();
+   for (vector<pair<unsigned,unsigned> >::const_iterator iter=directory.begin(),limit=directory.end();iter!=limit;++iter)
+      predicates.push_back((*iter).first);
+}
+//---------------------------------------------------------------------------
+bool FerrariSegment::getStatistics(unsigned predicate,Statistics& stats) const
+   // Get the statistics of the index for a predicate
+{
+   vector<pair<unsigned,unsigned> >::const_iterator pos=lower_bound(directory.begin(),directory.end(),pair<unsigned,unsigned>(predicate,0));
+   if ((pos==directory.end())||((*pos).first!=predicate)||(statistics.size()!=directory.size()))
+      return false;
+   stats=statistics[pos-directory.begin()];
+   return true;
+}
+//---------------------------------------------------------------------------
@@ -411,7 +411,7 @@ bool FullyAggregatedFactsSegment::Scan::readNextPage()
    // Read the next page
 {
    // Alread read the first page? Then read the next one
-   if (pos-1) {
+   if (posLimit) {
       const unsigned char* page=static_cast<const unsigned char*>(current.getPage());
       unsigned nextPage=readUint32Aligned(page+8);
       if (!nextPage)
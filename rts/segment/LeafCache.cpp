@@ -0,0 +1,199 @@
+#include "rts/segment/LeafCache.hpp"
+#include <cassert>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// Memory used by a page besides the triples, including the map entry
+static const unsigned pageOverhead = sizeof(DecodedLeaf)+64;
+/// Maximum number of kept decompression buffers
+static const unsigned maxBuffers = 16;
+//---------------------------------------------------------------------------
+DecodedLeaf::DecodedLeaf(const FactsSegment* segment,unsigned generation,unsigned pageNo,unsigned time,const FactsSegment::Triple* begin,const FactsSegment::Triple* end)
+   : segment(segment),generation(generation),pageNo(pageNo),time(time),triples((end-begin)+1),pins(0),prev(0),next(0)
+   // Constructor
+{
+   for (unsigned index=0;begin!=end;++begin,++index)
+      triples[index]=*begin;
+}
+//---------------------------------------------------------------------------
+bool LeafCache::Key::operator<(const Key& k) const
+   // Comparison
+{
+   if (segment!=k.segment) return segment<k.segment;
+   if (generation!=k.generation) return generation<k.generation;
+   if (pageNo!=k.pageNo) return pageNo<k.pageNo;
+   return time<k.time;
+}
+//---------------------------------------------------------------------------
+void LeafCache::Shard::unlink(DecodedLeaf* leaf)
+   // Unlink a page from the LRU list
+{
+   if (leaf->prev)
+      leaf->prev->next=leaf->next; else
+      head=leaf->next;
+   if (leaf->next)
+      leaf->next->prev=leaf->prev; else
+      tail=leaf->prev;
+   leaf->next=leaf->prev=0;
+}
+//---------------------------------------------------------------------------
+void LeafCache::Shard::pushFront(DecodedLeaf* leaf)
+   // Add a page at the front of the LRU list
+{
+   leaf->prev=0;
+   leaf->next=head;
+   if (head)
+      head->prev=leaf; else
+      tail=leaf;
+   head=leaf;
+}
+//---------------------------------------------------------------------------
+void LeafCache::Shard::shrink(uint64_t capacity)
+   // Evict pages until the shard fits into its budget
+{
+   // Pinned pages stay, the shard may exceed its budget while they are used
+   DecodedLeaf* leaf=tail;
+   while ((size>capacity)&&leaf) {
+      DecodedLeaf* prev=leaf->prev;
+      if (!leaf->pins) {
+         Key key; key.segment=leaf->segment; key.generation=leaf->generation; key.pageNo=leaf->pageNo; key.time=leaf->time;
+         pages.erase(key);
+         unlink(leaf);
+         size-=(leaf->triples.size()*sizeof(FactsSegment::Triple))+pageOverhead;
+         delete leaf;
+         evictions++;
+      }
+      leaf=prev;
+   }
+}
+//---------------------------------------------------------------------------
+LeafCache::LeafCache(uint64_t capacityInBytes)
+   : shardCapacity(capacityInBytes/shardCount)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+LeafCache::~LeafCache()
+   // Destructor
+{
+   for (unsigned index=0;index<shardCount;index++)
+      for (map<Key,DecodedLeaf*>::iterator iter=shards[index].pages.begin(),limit=shards[index].pages.end();iter!=limit;++iter) {
+         assert(!(*iter).second->pins);
+         delete (*iter).second;
+      }
+   for (vector<FactsSegment::Triple*>::iterator iter=buffers.begin(),limit=buffers.end();iter!=limit;++iter)
+      delete[] (*iter);
+}
+//---------------------------------------------------------------------------
+const DecodedLeaf* LeafCache::lookup(const FactsSegment* segment,unsigned generation,unsigned pageNo,unsigned time)
+   // Find a page and pin it
+{
+   Key key; key.segment=segment; key.generation=generation; key.pageNo=pageNo; key.time=time;
+   Shard& shard=getShard(pageNo);
+   auto_lock lock(shard.mutex);
+
+   map<Key,DecodedLeaf*>::iterator iter=shard.pages.find(key);
+   if (iter==shard.pages.end()) {
+      shard.misses++;
+      return 0;
+   }
+   DecodedLeaf* leaf=(*iter).second;
+   leaf->pins++;
+   if (shard.head!=leaf) {
+      shard.unlink(leaf);
+      shard.pushFront(leaf);
+   }
+   shard.hits++;
+
+   return leaf;
+}
+//---------------------------------------------------------------------------
+FactsSegment::Triple* LeafCache::allocateBuffer()
+   // Get a buffer to decompress into
+{
+   {
+      auto_lock lock(bufferMutex);
+      if (!buffers.empty()) {
+         FactsSegment::Triple* buffer=buffers.back();
+         buffers.pop_back();
+         return buffer;
+      }
+   }
+
+   return new FactsSegment::Triple[maxTriples];
+}
+//---------------------------------------------------------------------------
+const DecodedLeaf* LeafCache::insert(const FactsSegment* segment,unsigned generation,unsigned pageNo,unsigned time,FactsSegment::Triple* buffer,const FactsSegment::Triple* bufferEnd)
+   // Copy a decompressed page into the cache and pin it
+{
+   // Copy outside the lock
+   DecodedLeaf* leaf=new DecodedLeaf(segment,generation,pageNo,time,buffer,bufferEnd);
+   Key key; key.segment=segment; key.generation=generation; key.pageNo=pageNo; key.time=time;
+
+   // Keep the buffer for the next decompression
+   {
+      auto_lock lock(bufferMutex);
+      if (buffers.size()<maxBuffers) {
+         buffers.push_back(buffer);
+         buffer=0;
+      }
+   }
+   delete[] buffer;
+
+   Shard& shard=getShard(pageNo);
+   auto_lock lock(shard.mutex);
+
+   // Somebody else was faster?
+   map<Key,DecodedLeaf*>::iterator iter=shard.pages.find(key);
+   if (iter!=shard.pages.end()) {
+      delete leaf;
+      leaf=(*iter).second;
+      shard.unlink(leaf);
+   } else {
+      shard.pages[key]=leaf;
+      shard.size+=(leaf->triples.size()*sizeof(FactsSegment::Triple))+pageOverhead;
+   }
+   leaf->pins++;
+   shard.pushFront(leaf);
+   shard.shrink(shardCapacity);
+
+   return leaf;
+}
+//---------------------------------------------------------------------------
+void LeafCache::release(const DecodedLeaf* leaf)
+   // Unpin a page
+{
+   Shard& shard=getShard(leaf->pageNo);
+   auto_lock lock(shard.mutex);
+   assert(leaf->pins);
+   const_cast<DecodedLeaf*>(leaf)->pins--;
+   if ((!leaf->pins)&&(shard.size>shardCapacity))
+      shard.shrink(shardCapacity);
+}
+//---------------------------------------------------------------------------
+void LeafCache::getStatistics(Statistics& statistics)
+   // Get statistics
+{
+   statistics.hits=statistics.misses=statistics.evictions=0;
+   statistics.pages=0;
+   statistics.size=0;
+   for (unsigned index=0;index<shardCount;index++) {
+      Shard& shard=shards[index];
+      auto_lock lock(shard.mutex);
+      statistics.hits+=shard.hits;
+      statistics.misses+=shard.misses;
+      statistics.evictions+=shard.evictions;
+      statistics.pages+=shard.pages.size();
+      statistics.size+=shard.size;
+   }
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,213 @@
+#include "rts/segment/PackedLeaf.hpp"
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// The number of interleaved lanes
+static const unsigned lanes = 4;
+/// The size of a block header
+static const unsigned blockHeaderSize = 16;
+//---------------------------------------------------------------------------
+static unsigned bitsFor(unsigned value)
+   // The number of bits required to store a value
+{
+   unsigned bits=0;
+   while (value) { bits++; value>>=1; }
+   return bits;
+}
+//---------------------------------------------------------------------------
+static unsigned columnWords(unsigned count,unsigned bits)
+   // The number of words per lane for a column
+{
+   return ((((count+lanes-1)/lanes)*bits)+31)/32;
+}
+//---------------------------------------------------------------------------
+static inline unsigned readWord(const unsigned char* data) { unsigned value; memcpy(&value,data,4); return value; }
+static inline void writeWord(unsigned char* data,unsigned value) { memcpy(data,&value,4); }
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The layout of a block
+struct BlockInfo {
+   /// The block minimum of each column
+   unsigned base[3];
+   /// The bit width of each column
+   unsigned bits[3];
+
+   /// Compute the layout for triples
+   void compute(const FactsSegment::Triple* triples,unsigned count);
+   /// The size in bytes
+   unsigned getSize(unsigned count) const { return blockHeaderSize+(lanes*4)*(columnWords(count,bits[0])+columnWords(count,bits[1])+columnWords(count,bits[2])); }
+};
+//---------------------------------------------------------------------------
+void BlockInfo::compute(const FactsSegment::Triple* triples,unsigned count)
+   // Compute the layout for triples
+{
+   unsigned low[3]={~0u,~0u,~0u},high[3]={0,0,0};
+   for (const FactsSegment::Triple* iter=triples,*limit=triples+count;iter!=limit;++iter) {
+      const unsigned values[3]={(*iter).value1,(*iter).value2,(*iter).value3};
+      for (unsigned column=0;column<3;column++) {
+         if (values[column]<low[column]) low[column]=values[column];
+         if (values[column]>high[column]) high[column]=values[column];
+      }
+   }
+   for (unsigned column=0;column<3;column++) {
+      base[column]=low[column];
+      bits[column]=bitsFor(high[column]-low[column]);
+   }
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+static unsigned char* packColumn(unsigned char* writer,const FactsSegment::Triple* triples,unsigned count,unsigned column,unsigned base,unsigned bits)
+   // Pack one column of a block
+{
+   unsigned words=columnWords(count,bits);
+   unsigned data[(PackedLeaf::blockSize/lanes)*lanes];
+   memset(data,0,words*lanes*4);
+   for (unsigned index=0;index<count;index++) {
+      const FactsSegment::Triple& t=triples[index];
+      unsigned value=((column==0)?t.value1:((column==1)?t.value2:t.value3))-base;
+      unsigned lane=index%lanes,bit=(index/lanes)*bits,word=bit/32,shift=bit%32;
+      data[word*lanes+lane]|=value<<shift;
+      if (shift+bits>32)
+         data[(word+1)*lanes+lane]|=value>>(32-shift);
+   }
+   for (unsigned index=0;index<words*lanes;index++)
+      writeWord(writer+4*index,data[index]);
+   return writer+words*lanes*4;
+}
+//---------------------------------------------------------------------------
+static const unsigned char* unpackColumn(const unsigned char* reader,unsigned count,unsigned base,unsigned bits,unsigned* values)
+   // Unpack one column of a block. Writes a multiple of four values
+{
+   unsigned rows=(count+lanes-1)/lanes;
+   if (!bits) {
+      for (unsigned index=0;index<rows*lanes;index++)
+         values[index]=base;
+      return reader;
+   }
+   unsigned mask=(bits==32)?(~0u):((1u<<bits)-1);
+
+#if defined(__SSE2__)
+   // Decode four values at once
+   const __m128i* in=reinterpret_cast<const __m128i*>(reader);
+   __m128i* out=reinterpret_cast<__m128i*>(values);
+   __m128i maskVector=_mm_set1_epi32(mask),baseVector=_mm_set1_epi32(base);
+   for (unsigned row=0;row<rows;row++) {
+      unsigned bit=row*bits,word=bit/32,shift=bit%32;
+      __m128i v=_mm_srl_epi32(_mm_loadu_si128(in+word),_mm_cvtsi32_si128(shift));
+      if (shift+bits>32)
+         v=_mm_or_si128(v,_mm_sll_epi32(_mm_loadu_si128(in+word+1),_mm_cvtsi32_si128(32-shift)));
+      _mm_storeu_si128(out+row,_mm_add_epi32(_mm_and_si128(v,maskVector),baseVector));
+   }
+#else
+   // Scalar fallback
+   for (unsigned row=0;row<rows;row++) {
+      unsigned bit=row*bits,word=bit/32,shift=bit%32;
+      for (unsigned lane=0;lane<lanes;lane++) {
+         unsigned v=readWord(reader+4*(word*lanes+lane))>>shift;
+         if (shift+bits>32)
+            v|=readWord(reader+4*((word+1)*lanes+lane))<<(32-shift);
+         values[row*lanes+lane]=(v&mask)+base;
+      }
+   }
+#endif
+
+   return reader+columnWords(count,bits)*lanes*4;
+}
+//---------------------------------------------------------------------------
+unsigned PackedLeaf::pack(unsigned char* writer,unsigned char* limit,const FactsSegment::Triple* triples,unsigned count)
+   // Pack sorted, distinct triples
+{
+   // Scans decompress at most a page worth of triples
+   if (count>BufferReference::pageSize)
+      count=BufferReference::pageSize;
+   if ((!count)||((writer+headerSize)>limit))
+      return 0;
+   unsigned char* header=writer;
+   writer+=headerSize;
+
+   // Store as many blocks as possible
+   unsigned stored=0;
+   while (stored<count) {
+      // Shrink the block until it fits
+      unsigned n=count-stored;
+      if (n>blockSize) n=blockSize;
+      BlockInfo info;
+      while (n) {
+         info.compute(triples+stored,n);
+         if ((writer+info.getSize(n))<=limit)
+            break;
+         n=(n>lanes)?(n-lanes):(n-1);
+      }
+      if (!n)
+         break;
+
+      // Write the block
+      for (unsigned column=0;column<3;column++)
+         writeWord(writer+4*column,info.base[column]);
+      writer[12]=n;
+      writer[13]=info.bits[0];
+      writer[14]=info.bits[1];
+      writer[15]=info.bits[2];
+      writer+=blockHeaderSize;
+      for (unsigned column=0;column<3;column++)
+         writer=packColumn(writer,triples+stored,n,column,info.base[column],info.bits[column]);
+      stored+=n;
+   }
+   if (!stored)
+      return 0;
+
+   // Write the header
+   Segment::writeUint32Aligned(header,0xFFFFFFFF);
+   Segment::writeUint32Aligned(header+4,stored);
+   Segment::writeUint32Aligned(header+8,triples[0].value1);
+   Segment::writeUint32Aligned(header+12,triples[0].value2);
+   Segment::writeUint32Aligned(header+16,triples[0].value3);
+   memset(writer,0,limit-writer);
+
+   return stored;
+}
+//---------------------------------------------------------------------------
+FactsSegment::Triple* PackedLeaf::unpack(const unsigned char* reader,FactsSegment::Triple* writer)
+   // Unpack all triples
+{
+   unsigned count=getCount(reader);
+   reader+=headerSize;
+
+   unsigned values[3][blockSize];
+   while (count) {
+      // Decode the columns
+      unsigned n=reader[12];
+      unsigned base1=readWord(reader),base2=readWord(reader+4),base3=readWord(reader+8);
+      unsigned bits1=reader[13],bits2=reader[14],bits3=reader[15];
+      reader+=blockHeaderSize;
+      reader=unpackColumn(reader,n,base1,bits1,values[0]);
+      reader=unpackColumn(reader,n,base2,bits2,values[1]);
+      reader=unpackColumn(reader,n,base3,bits3,values[2]);
+
+      // And combine them
+      for (unsigned index=0;index<n;index++,++writer) {
+         (*writer).value1=values[0][index];
+         (*writer).value2=values[1][index];
+         (*writer).value3=values[2][index];
+      }
+      count-=n;
+   }
+   return writer;
+}
+//---------------------------------------------------------------------------
@@ -15,6 +15,11 @@
 // or send a letter to Creative Commons, 171 Second Street, Suite 300,
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
+/// The initial readahead window
+static const unsigned minReadahead = 4;
+/// The maximum readahead window
+static const unsigned maxReadahead = 64;
+//---------------------------------------------------------------------------
 namespace {
 //---------------------------------------------------------------------------
 LOGACTION2(SegmentInventorySegment,UpdateFreePageList,uint32_t,oldValue,uint32_t,newValue)
@@ -61,6 +66,18 @@ BufferRequest Segment::readShared(unsigned page) const
    return partition.readShared(page);
 }
 //---------------------------------------------------------------------------
+unsigned Segment::prefetch(unsigned start,unsigned count,const void* owner) const
+   // Read pages in the background
+{
+   return partition.prefetch(start,count,owner);
+}
+//---------------------------------------------------------------------------
+void Segment::cancelPrefetch(const void* owner) const
+   // Drop the waiting background reads of an owner
+{
+   partition.cancelPrefetch(owner);
+}
+//---------------------------------------------------------------------------
 BufferRequestExclusive Segment::readExclusive(unsigned page)
    // Read a specific page
 {
@@ -176,3 +193,37 @@ unsigned long long Segment::readUint64(const unsigned char* data)
    return result;
 }
 //---------------------------------------------------------------------------
+void Segment::Readahead::advance(const Segment& segment,unsigned page)
+   // The scan moves to a page
+{
+   // Not sequential? Then stop
+   if ((!last)||(page!=last+1)) {
+      reset(segment);
+      last=page;
+      return;
+   }
+   last=page;
+
+   // Request the next part when half of the window is consumed
+   if (!window) {
+      window=minReadahead;
+      next=page+1;
+   } else if (next>page+window/2) {
+      return;
+   }
+   unsigned waiting=segment.prefetch(next,window,this);
+   next+=window;
+
+   // Grow the window if the background reads keep up
+   if ((!waiting)&&(window<maxReadahead))
+      window*=2;
+}
+//---------------------------------------------------------------------------
+void Segment::Readahead::reset(const Segment& segment)
+   // Stop reading ahead
+{
+   if (window)
+      segment.cancelPrefetch(this);
+   last=next=window=0;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,126 @@
+#include "rts/buffer/BufferManager.hpp"
+#include "rts/buffer/BufferReference.hpp"
+#include "rts/partition/FilePartition.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+class BufferManagerTest : public testing::Test {
+   protected:
+   /// The partition
+   FilePartition partition;
+
+   /// Constructor
+   BufferManagerTest();
+   /// Destructor
+   ~BufferManagerTest();
+};
+//---------------------------------------------------------------------------
+static const char tempFileName[]="buffermanagertest.tmp";
+/// Number of pages in the file
+static const unsigned filePages = 2048;
+/// Number of pages in the buffer
+static const unsigned bufferPages = 256;
+//---------------------------------------------------------------------------
+BufferManagerTest::BufferManagerTest()
+   // Constructor
+{
+   remove(tempFileName);
+   unsigned start,len;
+   if (partition.create(tempFileName)&&partition.grow(filePages,start,len))
+      partition.close();
+   partition.open(tempFileName,true);
+}
+//---------------------------------------------------------------------------
+BufferManagerTest::~BufferManagerTest()
+   // Destructor
+{
+   partition.close();
+   remove(tempFileName);
+}
+//---------------------------------------------------------------------------
+TEST_F(BufferManagerTest,HitsAndMisses)
+   // Pages stay in the buffer after they are unfixed
+{
+   ASSERT_EQ(partition.getSize(),filePages);
+   BufferManager buffer(bufferPages*BufferReference::pageSize);
+   BufferManager::Statistics stats;
+
+   { BufferReference ref(BufferRequest(buffer,partition,7)); }
+   buffer.getStatistics(stats);
+   EXPECT_EQ(stats.misses,1u);
+   EXPECT_EQ(stats.hits,0u);
+   EXPECT_EQ(stats.resident,1u);
+
+   { BufferReference ref(BufferRequest(buffer,partition,7)); }
+   buffer.getStatistics(stats);
+   EXPECT_EQ(stats.misses,1u);
+   EXPECT_EQ(stats.hits,1u);
+}
+//---------------------------------------------------------------------------
+TEST_F(BufferManagerTest,ScanResistance)
+   // A scan must neither exceed the budget nor evict hot pages
+{
+   ASSERT_EQ(partition.getSize(),filePages);
+   BufferManager buffer(bufferPages*BufferReference::pageSize);
+   BufferManager::Statistics before,after;
+
+   // Some hot pages, like inner B-tree nodes
+   static const unsigned hotPages = 8;
+   for (unsigned index=0;index<hotPages;index++) {
+      BufferReference ref(BufferRequest(buffer,partition,index));
+      ref.markHot();
+   }
+
+   // Scan everything else
+   for (unsigned index=hotPages;index<filePages;index++) {
+      BufferReference ref(BufferRequest(buffer,partition,index));
+   }
+   buffer.getStatistics(before);
+   EXPECT_LE(before.resident,bufferPages);
+   EXPECT_GE(before.evictions,filePages-bufferPages);
+
+   // The hot pages are still there
+   for (unsigned index=0;index<hotPages;index++) {
+      BufferReference ref(BufferRequest(buffer,partition,index));
+   }
+   buffer.getStatistics(after);
+   EXPECT_EQ(after.misses,before.misses);
+   EXPECT_EQ(after.hits,before.hits+hotPages);
+}
+//---------------------------------------------------------------------------
+TEST_F(BufferManagerTest,SharedBudget)
+   // Directory parts borrow unused budget, the whole buffer fills before evicting
+{
+   ASSERT_EQ(partition.getSize(),filePages);
+   BufferManager buffer(bufferPages*BufferReference::pageSize);
+   BufferManager::Statistics stats;
+
+   for (unsigned index=0;index<bufferPages;index++) {
+      BufferReference ref(BufferRequest(buffer,partition,index));
+   }
+   buffer.getStatistics(stats);
+   EXPECT_EQ(stats.resident,bufferPages);
+   EXPECT_EQ(stats.evictions,0u);
+
+   // Beyond that every miss evicts a page somewhere
+   for (unsigned index=bufferPages;index<2*bufferPages;index++) {
+      BufferReference ref(BufferRequest(buffer,partition,index));
+   }
+   buffer.getStatistics(stats);
+   EXPECT_EQ(stats.resident,bufferPages);
+   EXPECT_EQ(stats.evictions,bufferPages);
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
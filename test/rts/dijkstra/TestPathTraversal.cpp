@@ -0,0 +1,104 @@
+#include "rts/dijkstra/PathTraversal.hpp"
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <deque>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+static vector<unsigned> referenceDistances(const vector<vector<unsigned> >& graph,unsigned start)
+   // Plain breadth-first search
+{
+   vector<unsigned> distances(graph.size(),~0u);
+   deque<unsigned> queue;
+   distances[start]=0;
+   queue.push_back(start);
+   while (!queue.empty()) {
+      unsigned node=queue.front(); queue.pop_front();
+      for (vector<unsigned>::const_iterator iter=graph[node].begin(),limit=graph[node].end();iter!=limit;++iter)
+         if (!~distances[*iter]) {
+            distances[*iter]=distances[node]+1;
+            queue.push_back(*iter);
+         }
+   }
+   return distances;
+}
+//---------------------------------------------------------------------------
+TEST(TestPathTraversal,Distances)
+   // Node-wise and level-wise searches must find the shortest distances, also when the state is reused
+{
+   srand(42);
+   PathTraversal traversal;
+   for (unsigned round=0;round<20;round++) {
+      unsigned size=1+rand()%200;
+      vector<vector<unsigned> > graph(size);
+      for (unsigned index=0,edges=rand()%(3*size);index<edges;index++)
+         graph[rand()%size].push_back(rand()%size);
+      unsigned start=rand()%size;
+      vector<unsigned> expected=referenceDistances(graph,start);
+
+      // One node at a time
+      traversal.reset();
+      traversal.start(start);
+      unsigned node,last=0;
+      while (traversal.pop(node)) {
+         ASSERT_GE(traversal.getDistance(node),last);
+         last=traversal.getDistance(node);
+         for (vector<unsigned>::const_iterator iter=graph[node].begin(),limit=graph[node].end();iter!=limit;++iter)
+            if (!traversal.isSettled(*iter))
+               traversal.relax(*iter,last+1,node,0);
+      }
+      for (unsigned index=0;index<size;index++) {
+         ASSERT_EQ(expected[index],traversal.getDistance(index));
+         if (~expected[index]&&(index!=start)) {
+            ASSERT_EQ(expected[index],traversal.getDistance(traversal.getParent(index).node)+1);
+         }
+      }
+
+      // One level at a time
+      traversal.reset();
+      traversal.start(start);
+      vector<unsigned> frontier;
+      unsigned level=0,reached=0;
+      while (traversal.nextBucket(frontier)) {
+         for (vector<unsigned>::const_iterator iter=frontier.begin(),limit=frontier.end();iter!=limit;++iter) {
+            ASSERT_EQ(level,expected[*iter]);
+            for (vector<unsigned>::const_iterator iter2=graph[*iter].begin(),limit2=graph[*iter].end();iter2!=limit2;++iter2)
+               if (!traversal.isSettled(*iter2))
+                  traversal.relax(*iter2,level+1,*iter,0);
+         }
+         reached+=frontier.size();
+         level++;
+      }
+      ASSERT_EQ(reached,traversal.getReached().size());
+      for (unsigned index=0;index<size;index++)
+         ASSERT_EQ(expected[index],traversal.getDistance(index));
+   }
+}
+//---------------------------------------------------------------------------
+TEST(TestPathTraversal,Marks)
+   // Marks are independent of the search state
+{
+   PathTraversal traversal;
+   traversal.reset();
+   traversal.start(5);
+   ASSERT_TRUE(traversal.mark(7));
+   ASSERT_FALSE(traversal.mark(7));
+   ASSERT_TRUE(traversal.isMarked(7));
+   traversal.clearMarks();
+   ASSERT_FALSE(traversal.isMarked(7));
+   ASSERT_TRUE(traversal.isReached(5));
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
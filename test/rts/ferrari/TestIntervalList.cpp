@@ -0,0 +1,92 @@
+#include "rts/ferrari/IntervalList.hpp"
+#include <gtest/gtest.h>
+#include <cstdlib>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+static IntervalList::containment referenceContains(const vector<unsigned>& lower,const vector<unsigned>& upper,const vector<char>& exact,unsigned x)
+   // Linear reference implementation
+{
+   for (unsigned index=0;index<lower.size();index++)
+      if ((lower[index]<=x)&&(x<=upper[index]))
+         return exact[index]?IntervalList::YES:IntervalList::MAYBE;
+   return IntervalList::NOT;
+}
+//---------------------------------------------------------------------------
+TEST(TestIntervalList,Kernels)
+   // All search kernels must agree with the reference
+{
+   srand(42);
+   IntervalList::kernel initial=IntervalList::get_kernel();
+   static const IntervalList::kernel kernels[]={IntervalList::BINARY_SEARCH,IntervalList::SCALAR,IntervalList::SSE4,IntervalList::AVX2};
+
+   for (unsigned size=1;size<300;size+=7) {
+      IntervalList list;
+      vector<unsigned> lower,upper;
+      vector<char> exact;
+      unsigned next=rand()%5;
+      for (unsigned index=0;index<size;index++) {
+         unsigned a=next,b=a+rand()%4;
+         char ex=rand()&1;
+         list.add(a,b,ex);
+         lower.push_back(a); upper.push_back(b); exact.push_back(ex);
+         next=b+2+rand()%5;
+      }
+      for (unsigned index=0;index<size;index++)
+         EXPECT_EQ(static_cast<bool>(exact[index]),list.is_exact(index));
+
+      for (unsigned k=0;k<sizeof(kernels)/sizeof(kernels[0]);k++) {
+         if (!IntervalList::set_kernel(kernels[k]))
+            continue;
+         for (unsigned x=0;x<next+2;x++) {
+            ASSERT_EQ(referenceContains(lower,upper,exact,x),list.contains(x));
+            int pos=list.find(x);
+            int expected=-1;
+            while ((expected+1<static_cast<int>(size))&&(lower[expected+1]<=x))
+               expected++;
+            ASSERT_EQ(expected,pos);
+         }
+      }
+   }
+   IntervalList::set_kernel(initial);
+}
+//---------------------------------------------------------------------------
+TEST(TestIntervalList,MergeExactness)
+   // Merging must keep the exactness bits aligned with the intervals
+{
+   IntervalList list;
+   for (unsigned index=0;index<100;index++)
+      list.add(index*10,index*10+2,(index%3)!=0);
+   IntervalList other;
+   other.add(5,6,1);
+   other.add(33,37,0);
+   other.add(500,515,1);
+   list.merge(other);
+
+   EXPECT_EQ(IntervalList::NOT,list.contains(4));
+   EXPECT_EQ(IntervalList::YES,list.contains(5));
+   EXPECT_EQ(IntervalList::MAYBE,list.contains(1));
+   EXPECT_EQ(IntervalList::MAYBE,list.contains(35));
+   EXPECT_EQ(IntervalList::MAYBE,list.contains(505));
+   EXPECT_EQ(IntervalList::MAYBE,list.contains(992));
+   EXPECT_EQ(IntervalList::YES,list.contains(982));
+   EXPECT_EQ(IntervalList::MAYBE,list.contains(990-90));
+
+   // interval 70 is exact, 69 not
+   EXPECT_EQ(IntervalList::YES,list.contains(701));
+   EXPECT_EQ(IntervalList::MAYBE,list.contains(691));
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,223 @@
+#include "rts/operator/HashJoin.hpp"
+#include "rts/operator/Scheduler.hpp"
+#include "rts/runtime/Runtime.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// A table, every row holds one value per register followed by the count
+typedef vector<vector<unsigned> > Table;
+/// Join results and their counts
+typedef map<vector<unsigned>,unsigned> Results;
+//---------------------------------------------------------------------------
+/// Scans a table, optionally split into morsels
+class TableScan : public Operator, public Scheduler::MorselSource
+{
+   private:
+   /// The registers
+   vector<Register*> registers;
+   /// The rows
+   const Table& rows;
+   /// The current row and the selected range
+   unsigned pos,from,to;
+   /// The number of morsels
+   unsigned morselCount;
+
+   public:
+   /// Constructor
+   TableScan(const vector<Register*>& registers,const Table& rows) : Operator(rows.size()),registers(registers),rows(rows),pos(0),from(0),to(rows.size()),morselCount(1) {}
+
+   /// Produce the first tuple
+   unsigned first() { pos=from; return next(); }
+   /// Produce the next tuple
+   unsigned next() {
+      if (pos>=to) return 0;
+      const vector<unsigned>& row=rows[pos++];
+      for (unsigned index=0;index<registers.size();index++)
+         registers[index]->value=row[index];
+      return row.back();
+   }
+   /// Print the operator tree
+   void print(PlanPrinter& /*out*/) {}
+   /// Add a merge join hint
+   void addMergeHint(Register* /*reg1*/,Register* /*reg2*/) {}
+   /// Register parts of the tree that can be executed asynchronous
+   void getAsyncInputCandidates(Scheduler& scheduler) { scheduler.registerMorselSource(*this); }
+
+   /// Split the scan into morsels
+   unsigned prepareMorsels(unsigned maxMorsels) { morselCount=max(1u,min<unsigned>(maxMorsels,rows.size())); return morselCount; }
+   /// Restrict the next scans to a morsel
+   void selectMorsel(unsigned morsel) { from=(rows.size()*morsel)/morselCount; to=(rows.size()*(morsel+1))/morselCount; }
+};
+//---------------------------------------------------------------------------
+/// A join of (key,left) with (key,right) over its own registers
+struct JoinCopy
+{
+   /// The registers
+   Register leftKey,leftValue,rightKey,rightValue;
+   /// The join
+   HashJoin* join;
+
+   /// Constructor
+   JoinCopy(const Table& left,const Table& right);
+   /// Destructor
+   ~JoinCopy() { delete join; }
+
+   /// Remember the current result
+   void collect(Results& results,unsigned count) const;
+};
+//---------------------------------------------------------------------------
+JoinCopy::JoinCopy(const Table& left,const Table& right)
+   // Constructor
+{
+   Register* regs[]={&leftKey,&leftValue,&rightKey,&rightValue};
+   for (unsigned index=0;index<4;index++) {
+      regs[index]->value=~0u;
+      regs[index]->domain=0;
+   }
+   vector<Register*> leftRegs,rightRegs,leftTail,rightTail;
+   leftRegs.push_back(&leftKey); leftRegs.push_back(&leftValue); leftTail.push_back(&leftValue);
+   rightRegs.push_back(&rightKey); rightRegs.push_back(&rightValue); rightTail.push_back(&rightValue);
+   join=new HashJoin(new TableScan(leftRegs,left),&leftKey,leftTail,new TableScan(rightRegs,right),&rightKey,rightTail,0);
+}
+//---------------------------------------------------------------------------
+void JoinCopy::collect(Results& results,unsigned count) const
+   // Remember the current result
+{
+   vector<unsigned> tuple;
+   tuple.push_back(leftKey.value);
+   tuple.push_back(leftValue.value);
+   tuple.push_back(rightValue.value);
+   results[tuple]+=count;
+}
+//---------------------------------------------------------------------------
+/// Collects the output of a join copy
+class CollectResults : public Scheduler::PipelineSink
+{
+   public:
+   /// The join
+   const JoinCopy& copy;
+   /// The results
+   Results results;
+
+   /// Constructor
+   explicit CollectResults(const JoinCopy& copy) : copy(copy) {}
+
+   /// Consume a morsel of the probe side
+   void consumeMorsel(unsigned /*morsel*/) {
+      for (unsigned count=copy.join->first();count;count=copy.join->next())
+         copy.collect(results,count);
+   }
+   /// Combine the results of all workers
+   void finishPipeline(const vector<Scheduler::PipelineSink*>& workers) {
+      for (unsigned worker=1;worker<workers.size();worker++) {
+         const Results& other=static_cast<CollectResults*>(workers[worker])->results;
+         for (Results::const_iterator iter=other.begin(),limit=other.end();iter!=limit;++iter)
+            results[(*iter).first]+=(*iter).second;
+      }
+   }
+};
+//---------------------------------------------------------------------------
+static Results expectedResults(const Table& left,const Table& right)
+   // Compute the join naively
+{
+   map<pair<unsigned,unsigned>,unsigned> groups;
+   for (Table::const_iterator iter=left.begin(),limit=left.end();iter!=limit;++iter)
+      groups[pair<unsigned,unsigned>((*iter)[0],(*iter)[1])]+=(*iter)[2];
+   Results results;
+   for (Table::const_iterator iter=right.begin(),limit=right.end();iter!=limit;++iter)
+      for (map<pair<unsigned,unsigned>,unsigned>::const_iterator iter2=groups.lower_bound(pair<unsigned,unsigned>((*iter)[0],0));(iter2!=groups.end())&&((*iter2).first.first==(*iter)[0]);++iter2) {
+         vector<unsigned> tuple;
+         tuple.push_back((*iter)[0]);
+         tuple.push_back((*iter2).first.second);
+         tuple.push_back((*iter)[1]);
+         results[tuple]+=(*iter2).second*(*iter)[2];
+      }
+   return results;
+}
+//---------------------------------------------------------------------------
+static vector<unsigned> row(unsigned key,unsigned value,unsigned count)
+   // Build a table row
+{
+   vector<unsigned> result;
+   result.push_back(key);
+   result.push_back(value);
+   result.push_back(count);
+   return result;
+}
+//---------------------------------------------------------------------------
+TEST(HashJoin,AggregatesDuplicates)
+   // Equal build tuples are combined into one entry with the summed count
+{
+   Table left,right;
+   left.push_back(row(1,10,1));
+   left.push_back(row(1,10,2));
+   left.push_back(row(2,20,1));
+   left.push_back(row(1,10,3));
+   left.push_back(row(1,11,1));
+   right.push_back(row(1,100,1));
+   right.push_back(row(2,200,2));
+   right.push_back(row(3,300,1));
+
+   JoinCopy copy(left,right);
+   Results results;
+   unsigned tuples=0;
+   for (unsigned count=copy.join->first();count;count=copy.join->next(),tuples++)
+      copy.collect(results,count);
+
+   EXPECT_EQ(3u,tuples);
+   EXPECT_TRUE(results==expectedResults(left,right));
+   vector<unsigned> tuple;
+   tuple.push_back(1); tuple.push_back(10); tuple.push_back(100);
+   EXPECT_EQ(6u,results[tuple]);
+}
+//---------------------------------------------------------------------------
+TEST(HashJoin,ParallelBuild)
+   // Workers read morsels of the build side, the partitions are built from the entries of all workers
+{
+   // Enough build tuples for several partitions, every key with duplicates
+   Table left,right;
+   for (unsigned index=0;index<20000;index++)
+      left.push_back(row(index%5000,index%3,1+(index%2)));
+   for (unsigned index=0;index<6000;index++)
+      right.push_back(row(index,7*index,1+(index%3)));
+   Results expected=expectedResults(left,right);
+
+   for (unsigned workers=1;workers<=4;workers++) {
+      vector<JoinCopy*> copies;
+      vector<Operator*> roots;
+      vector<Scheduler::PipelineSink*> sinks;
+      for (unsigned worker=0;worker<workers;worker++) {
+         copies.push_back(new JoinCopy(left,right));
+         roots.push_back(copies.back()->join);
+         sinks.push_back(new CollectResults(*copies.back()));
+      }
+
+      Scheduler scheduler;
+      scheduler.execute(roots,sinks);
+      const Results& results=static_cast<CollectResults*>(sinks[0])->results;
+      EXPECT_EQ(expected.size(),results.size());
+      EXPECT_TRUE(results==expected);
+
+      for (unsigned worker=0;worker<workers;worker++) {
+         delete sinks[worker];
+         delete copies[worker];
+      }
+   }
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,261 @@
+#include "rts/operator/Sort.hpp"
+#include "rts/database/Database.hpp"
+#include "rts/database/DatabaseBuilder.hpp"
+#include "rts/runtime/Runtime.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// Helper
+class Sort::TestInterface
+{
+   private:
+   /// The real operator
+   Sort& sort;
+
+   public:
+   /// Constructor
+   TestInterface(Sort& sort) : sort(sort) {}
+
+   /// The number of runs that are currently merged
+   unsigned getRunCount() const { return sort.runs.size(); }
+};
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+static const char tempFileName[]="sorttest.tmp";
+/// The number of strings in the dictionary
+static const unsigned stringCount = 200;
+/// A row, the values of two registers followed by the count
+typedef vector<unsigned> Row;
+//---------------------------------------------------------------------------
+static string stringOf(unsigned id)
+   // The string of an id. The string order differs from the id order
+{
+   char buffer[16];
+   snprintf(buffer,sizeof(buffer),"s%03u",(id*37)%stringCount);
+   return buffer;
+}
+//---------------------------------------------------------------------------
+/// Produces the dictionary strings
+class StringSource : public DatabaseBuilder::StringsReader
+{
+   private:
+   /// The next id
+   unsigned id;
+   /// The current string
+   string current;
+   /// The page and offset of each string
+   vector<pair<unsigned,unsigned> >& positions;
+
+   public:
+   /// Constructor
+   explicit StringSource(vector<pair<unsigned,unsigned> >& positions) : id(0),positions(positions) {}
+
+   /// Get the next string
+   bool next(unsigned& len,const char*& data,Type::ID& type,unsigned& subType) {
+      if (id>=stringCount) return false;
+      current=stringOf(id++);
+      len=current.size(); data=current.data(); type=Type::Literal; subType=0;
+      return true;
+   }
+   /// Remember the string position
+   void rememberInfo(unsigned page,unsigned ofs,unsigned /*hash*/) { positions.push_back(pair<unsigned,unsigned>(page,ofs)); }
+};
+//---------------------------------------------------------------------------
+/// Produces the string positions
+class PositionSource : public DatabaseBuilder::StringInfoReader
+{
+   private:
+   /// The positions
+   const vector<pair<unsigned,unsigned> >& positions;
+   /// The next position
+   unsigned pos;
+
+   public:
+   /// Constructor
+   explicit PositionSource(const vector<pair<unsigned,unsigned> >& positions) : positions(positions),pos(0) {}
+
+   /// Get the next position
+   bool next(unsigned& v1,unsigned& v2) {
+      if (pos>=positions.size()) return false;
+      v1=positions[pos].first; v2=positions[pos].second; pos++;
+      return true;
+   }
+};
+//---------------------------------------------------------------------------
+/// Produces rows
+class RowScan : public Operator
+{
+   private:
+   /// The registers
+   vector<Register*> registers;
+   /// The rows
+   const vector<Row>& rows;
+   /// The current row
+   unsigned pos;
+
+   public:
+   /// Constructor
+   RowScan(const vector<Register*>& registers,const vector<Row>& rows) : Operator(rows.size()),registers(registers),rows(rows),pos(0) {}
+
+   /// Produce the first tuple
+   unsigned first() { pos=0; return next(); }
+   /// Produce the next tuple
+   unsigned next() {
+      if (pos>=rows.size()) return 0;
+      const Row& row=rows[pos++];
+      for (unsigned index=0;index<registers.size();index++)
+         registers[index]->value=row[index];
+      return row.back();
+   }
+   /// Print the operator tree
+   void print(PlanPrinter& /*out*/) {}
+   /// Add a merge join hint
+   void addMergeHint(Register* /*reg1*/,Register* /*reg2*/) {}
+   /// Register parts of the tree that can be executed asynchronous
+   void getAsyncInputCandidates(Scheduler& /*scheduler*/) {}
+};
+//---------------------------------------------------------------------------
+/// A sort key, the column (~0u for the count) and the direction
+typedef pair<unsigned,bool> Key;
+//---------------------------------------------------------------------------
+/// Compares rows like the sort operator
+class RowOrder
+{
+   private:
+   /// The keys
+   const vector<Key>& keys;
+
+   public:
+   /// Constructor
+   explicit RowOrder(const vector<Key>& keys) : keys(keys) {}
+
+   /// Compare
+   bool operator()(const Row& a,const Row& b) const {
+      for (vector<Key>::const_iterator iter=keys.begin(),limit=keys.end();iter!=limit;++iter) {
+         unsigned column=(~(*iter).first)?(*iter).first:2;
+         unsigned va=a[column],vb=b[column];
+         int c;
+         if (column==2) {
+            c=(va<vb)?-1:((va>vb)?1:0);
+         } else {
+            // NULL first, then by string
+            c=((~va)?1:0)-((~vb)?1:0);
+            if ((!c)&&(~va)) c=stringOf(va).compare(stringOf(vb));
+         }
+         if ((*iter).second) c=-c;
+         if (c) return c<0;
+      }
+      return false;
+   }
+};
+//---------------------------------------------------------------------------
+class TestSort : public testing::Test {
+   protected:
+   /// Destructor
+   ~TestSort();
+};
+//---------------------------------------------------------------------------
+TestSort::~TestSort()
+   // Destructor
+{
+   remove(tempFileName);
+}
+//---------------------------------------------------------------------------
+static void buildDatabase()
+   // Create a database containing the strings
+{
+   remove(tempFileName);
+   DatabaseBuilder builder(tempFileName);
+   vector<pair<unsigned,unsigned> > positions;
+   StringSource strings(positions);
+   builder.loadStrings(strings);
+   PositionSource mappings(positions);
+   builder.loadStringMappings(mappings);
+   builder.close();
+}
+//---------------------------------------------------------------------------
+static vector<Row> sortRows(Database& db,const vector<Row>& rows,const vector<Key>& keys,unsigned& runCount)
+   // Sort the rows with the sort operator
+{
+   Register a,b;
+   a.value=b.value=~0u; a.domain=b.domain=0;
+   vector<Register*> registers;
+   registers.push_back(&a); registers.push_back(&b);
+   vector<pair<Register*,bool> > order;
+   for (vector<Key>::const_iterator iter=keys.begin(),limit=keys.end();iter!=limit;++iter)
+      order.push_back(pair<Register*,bool>((~(*iter).first)?registers[(*iter).first]:0,(*iter).second));
+
+   Sort sort(db,new RowScan(registers,rows),registers,order,rows.size());
+   vector<Row> result;
+   unsigned count=sort.first();
+   runCount=Sort::TestInterface(sort).getRunCount();
+   for (;count;count=sort.next()) {
+      Row row;
+      row.push_back(a.value); row.push_back(b.value); row.push_back(count);
+      result.push_back(row);
+   }
+   return result;
+}
+//---------------------------------------------------------------------------
+static void checkSorted(vector<Row> result,vector<Row> rows,const vector<Key>& keys)
+   // Check that the result is ordered and contains the rows
+{
+   RowOrder rowOrder(keys);
+   for (unsigned index=1;index<result.size();index++)
+      EXPECT_FALSE(rowOrder(result[index],result[index-1])) << index;
+   sort(result.begin(),result.end());
+   sort(rows.begin(),rows.end());
+   EXPECT_TRUE(result==rows);
+}
+//---------------------------------------------------------------------------
+TEST_F(TestSort,SpillsRuns)
+   // Inputs exceeding the memory limit are merged from several runs
+{
+   buildDatabase();
+   Database db;
+   ASSERT_TRUE(db.open(tempFileName,true));
+
+   // Rows with duplicate keys and some NULL values
+   vector<Row> rows;
+   for (unsigned index=0;index<3000;index++) {
+      Row row;
+      row.push_back((index%50)?((index*7)%stringCount):~0u);
+      row.push_back((index*13)%stringCount);
+      row.push_back(1+(index%5));
+      rows.push_back(row);
+   }
+
+   vector<vector<Key> > orders(3);
+   orders[0].push_back(Key(0,false)); orders[0].push_back(Key(1,true));
+   orders[1].push_back(Key(~0u,true)); orders[1].push_back(Key(0,false));
+   orders[2].push_back(Key(1,true)); orders[2].push_back(Key(~0u,false)); orders[2].push_back(Key(0,true));
+   for (unsigned index=0;index<orders.size();index++) {
+      // In memory
+      unsigned runCount;
+      checkSorted(sortRows(db,rows,orders[index],runCount),rows,orders[index]);
+      EXPECT_EQ(0u,runCount);
+
+      // Spilled, a few hundred tuples per run
+      db.setSortMemoryLimit(8*1024);
+      checkSorted(sortRows(db,rows,orders[index],runCount),rows,orders[index]);
+      EXPECT_GT(runCount,5u);
+      db.setSortMemoryLimit(64*1024*1024);
+   }
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
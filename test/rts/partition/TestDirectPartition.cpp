@@ -0,0 +1,190 @@
+#include "rts/partition/DirectPartition.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+class DirectPartitionTest : public testing::Test {
+   protected:
+   /// Destructor
+   ~DirectPartitionTest();
+};
+//---------------------------------------------------------------------------
+static const char tempFileName[]="directpartitiontest.tmp";
+//---------------------------------------------------------------------------
+DirectPartitionTest::~DirectPartitionTest()
+   // Destructor
+{
+   remove(tempFileName);
+}
+//---------------------------------------------------------------------------
+TEST_F(DirectPartitionTest,BasicFunctionality)
+   // Test the basic behavior of DirectPartition
+{
+   // Remove the file if it exists
+   remove(tempFileName);
+
+   // Test open/create
+   DirectPartition p(true);
+   EXPECT_FALSE(p.open(tempFileName,false));
+   EXPECT_FALSE(p.open(tempFileName,true));
+   p.close();
+   ASSERT_TRUE(p.create(tempFileName));
+   p.close();
+   EXPECT_TRUE(p.open(tempFileName,false));
+
+   // Grow the partition
+   unsigned start,len;
+   EXPECT_EQ(p.getSize(),0u);
+   ASSERT_TRUE(p.grow(1,start,len));
+   EXPECT_EQ(start,0u);
+   EXPECT_EQ(len,1u);
+   EXPECT_EQ(p.getSize(),1u);
+
+   // Write some data
+   {
+      Partition::PageInfo info;
+      void* writer=p.writePage(0,info);
+      EXPECT_NE(writer,static_cast<void*>(0));
+      static_cast<char*>(writer)[0]=42;
+      EXPECT_TRUE(p.flushWrittenPage(info));
+      p.finishWrittenPage(info);
+   }
+   EXPECT_TRUE(p.flush());
+   p.close();
+
+   // And read it brack
+   ASSERT_TRUE(p.open(tempFileName,true));
+   EXPECT_EQ(p.getSize(),1u);
+   {
+      Partition::PageInfo info;
+      const void* reader=p.readPage(0,info);
+      EXPECT_NE(reader,static_cast<const void*>(0));
+      EXPECT_EQ(static_cast<const char*>(reader)[0],42);
+      p.finishReadPage(info);
+   }
+
+   p.close();
+}
+//---------------------------------------------------------------------------
+TEST_F(DirectPartitionTest,PrivateCopies)
+   // Changes only reach the file when they are flushed
+{
+   remove(tempFileName);
+   DirectPartition p(false);
+   ASSERT_TRUE(p.create(tempFileName));
+   unsigned start,len;
+   ASSERT_TRUE(p.grow(2,start,len));
+
+   // Modify without flushing
+   {
+      Partition::PageInfo info;
+      void* writer=p.writePage(1,info);
+      static_cast<char*>(writer)[0]=42;
+      p.finishWrittenPage(info);
+   }
+   {
+      Partition::PageInfo info;
+      const void* reader=p.readPage(1,info);
+      EXPECT_EQ(static_cast<const char*>(reader)[0],0);
+      p.finishReadPage(info);
+   }
+
+   // Modify an already read page and flush it
+   {
+      Partition::PageInfo info;
+      p.readPage(1,info);
+      void* writer=p.writeReadPage(info);
+      static_cast<char*>(writer)[0]=42;
+      EXPECT_TRUE(p.flushWrittenPage(info));
+      p.finishWrittenPage(info);
+   }
+   {
+      Partition::PageInfo info;
+      const void* reader=p.readPage(1,info);
+      EXPECT_EQ(static_cast<const char*>(reader)[0],42);
+      p.finishReadPage(info);
+   }
+
+   p.close();
+}
+//---------------------------------------------------------------------------
+TEST_F(DirectPartitionTest,RecycledBuffers)
+   // Released pages give their buffer to the next read
+{
+   remove(tempFileName);
+   DirectPartition p(false);
+   ASSERT_TRUE(p.create(tempFileName));
+   unsigned start,len;
+   ASSERT_TRUE(p.grow(2,start,len));
+
+   // Write distinct contents
+   Partition::PageInfo info;
+   for (unsigned index=0;index<2;index++) {
+      void* writer=p.writePage(index,info);
+      ASSERT_NE(writer,static_cast<void*>(0));
+      static_cast<char*>(writer)[0]=42+index;
+      EXPECT_TRUE(p.flushWrittenPage(info));
+      p.finishWrittenPage(info);
+   }
+
+   // The buffer of a released page is reused with the new contents
+   const void* first=p.readPage(0,info);
+   ASSERT_NE(first,static_cast<const void*>(0));
+   EXPECT_EQ(static_cast<const char*>(first)[0],42);
+   p.finishReadPage(info);
+   const void* second=p.readPage(0,info);
+   EXPECT_EQ(second,first);
+   EXPECT_EQ(static_cast<const char*>(second)[0],42);
+
+   // Pages that are in use get different buffers
+   Partition::PageInfo info2;
+   const void* other=p.readPage(0,info2);
+   ASSERT_NE(other,static_cast<const void*>(0));
+   EXPECT_NE(other,second);
+   EXPECT_EQ(static_cast<const char*>(other)[0],42);
+   p.finishReadPage(info2);
+   p.finishReadPage(info);
+
+   // Other pages see their own contents
+   const void* page1=p.readPage(1,info);
+   ASSERT_NE(page1,static_cast<const void*>(0));
+   EXPECT_EQ(static_cast<const char*>(page1)[0],43);
+   p.finishReadPage(info);
+
+   p.close();
+}
+//---------------------------------------------------------------------------
+TEST_F(DirectPartitionTest,ReadErrors)
+   // Pages that cannot be read are reported
+{
+   remove(tempFileName);
+   DirectPartition p(false);
+   ASSERT_TRUE(p.create(tempFileName));
+   unsigned start,len;
+   ASSERT_TRUE(p.grow(2,start,len));
+   EXPECT_TRUE(p.flush());
+
+   // Truncate the file behind the partition
+   FILE* out=fopen(tempFileName,"wb");
+   ASSERT_TRUE(out!=0);
+   fclose(out);
+
+   Partition::PageInfo info;
+   EXPECT_EQ(p.readPage(1,info),static_cast<const void*>(0));
+   EXPECT_EQ(p.writePage(1,info),static_cast<void*>(0));
+
+   p.close();
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
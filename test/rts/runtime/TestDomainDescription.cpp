@@ -0,0 +1,151 @@
+#include "rts/runtime/DomainDescription.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// An observed domain that exposes its filter size
+class ObservedDomain : public ObservedDomainDescription
+{
+   public:
+   /// Constructor
+   explicit ObservedDomain(double expectedValues=0) : ObservedDomainDescription(expectedValues) {}
+
+   /// The number of filter bits
+   unsigned getFilterBits() const { return filter.size()*filterEntryBits; }
+   /// The minimum number of filter bits
+   static unsigned getMinFilterBits() { return filterSize*filterEntryBits; }
+   /// The maximum number of filter bits
+   static unsigned getMaxFilterBits() { return maxFilterSize*filterEntryBits; }
+};
+//---------------------------------------------------------------------------
+static void checkCandidates(const DomainDescription& domain,unsigned limit)
+   // Compare nextCandidate with probing every value, walking down from the limit
+{
+   unsigned next=~0u;
+   for (unsigned value=limit+10;;value--) {
+      bool qualifies=domain.couldQualify(value);
+      // Check samples and the values right behind a candidate
+      if ((!(value%97))||((value<limit)&&domain.couldQualify(value+1))) {
+         EXPECT_EQ(qualifies?value:next,domain.nextCandidate(value)) << value;
+      }
+      if (qualifies)
+         next=value;
+      if (!value) break;
+   }
+}
+//---------------------------------------------------------------------------
+TEST(DomainDescription,FilterSizing)
+   // The filter grows with the expected values, within its bounds
+{
+   unsigned minBits=ObservedDomain::getMinFilterBits(),maxBits=ObservedDomain::getMaxFilterBits();
+   EXPECT_EQ(minBits,ObservedDomain().getFilterBits());
+   EXPECT_EQ(minBits,ObservedDomain(minBits/8).getFilterBits());
+   EXPECT_EQ(2*minBits,ObservedDomain(minBits/8+1).getFilterBits());
+   EXPECT_EQ(16*minBits,ObservedDomain(2*minBits).getFilterBits());
+   EXPECT_EQ(maxBits,ObservedDomain(maxBits).getFilterBits());
+   EXPECT_EQ(maxBits,ObservedDomain(1e12).getFilterBits());
+}
+//---------------------------------------------------------------------------
+TEST(DomainDescription,NextCandidateWrapsAround)
+   // Values beyond the filter size wrap to the start of the filter
+{
+   ObservedDomain domain;
+   unsigned bits=domain.getFilterBits();
+   domain.add(100);
+   domain.add(3*bits+50);
+   domain.add(5*bits+bits/2);
+
+   EXPECT_EQ(100u,domain.nextCandidate(0));
+   EXPECT_EQ(bits/2,domain.nextCandidate(101));
+   EXPECT_EQ(bits+50,domain.nextCandidate(bits/2+1));
+   EXPECT_EQ(~0u,domain.nextCandidate(5*bits+bits/2+1));
+   checkCandidates(domain,5*bits+bits/2);
+}
+//---------------------------------------------------------------------------
+TEST(DomainDescription,NextCandidateSkipsEmptyRegions)
+   // A large, sparse filter finds set bits far away
+{
+   ObservedDomain domain(1e12);
+   unsigned bits=domain.getFilterBits();
+   domain.add(7);
+   domain.add(bits-3);
+   domain.add(bits+1);
+
+   EXPECT_EQ(bits-3,domain.nextCandidate(8));
+   EXPECT_EQ(bits+1,domain.nextCandidate(bits-2));
+   EXPECT_EQ(bits+1,domain.nextCandidate(bits+1));
+   EXPECT_EQ(~0u,domain.nextCandidate(bits+2));
+}
+//---------------------------------------------------------------------------
+TEST(DomainDescription,MixedFilterSizes)
+   // Merging and restricting combine filters of different sizes
+{
+   ObservedDomain small,large(1e5);
+   unsigned smallBits=small.getFilterBits(),largeBits=large.getFilterBits();
+   ASSERT_LT(smallBits,largeBits);
+   vector<unsigned> smallValues,largeValues;
+   for (unsigned index=0;index<20;index++) {
+      smallValues.push_back(index*3*smallBits/7+11);
+      largeValues.push_back(index*largeBits/5+13);
+   }
+   for (vector<unsigned>::const_iterator iter=smallValues.begin(),limit=smallValues.end();iter!=limit;++iter)
+      small.add(*iter);
+   for (vector<unsigned>::const_iterator iter=largeValues.begin(),limit=largeValues.end();iter!=limit;++iter)
+      large.add(*iter);
+   unsigned maxValue=largeValues.back();
+
+   // Merging keeps all values of both sides
+   ObservedDomain merged1(small),merged2(large);
+   merged1.merge(large);
+   merged2.merge(small);
+   EXPECT_EQ(largeBits,merged1.getFilterBits());
+   for (unsigned index=0;index<smallValues.size();index++) {
+      EXPECT_TRUE(merged1.couldQualify(smallValues[index]));
+      EXPECT_TRUE(merged1.couldQualify(largeValues[index]));
+      EXPECT_TRUE(merged2.couldQualify(smallValues[index]));
+      EXPECT_TRUE(merged2.couldQualify(largeValues[index]));
+   }
+   checkCandidates(merged1,maxValue);
+   checkCandidates(merged2,maxValue);
+
+   // Restricting keeps only values that are in the filter of both
+   ObservedDomain both(1e5);
+   both.add(smallValues[3]);
+   both.add(largeValues[7]);
+   small.add(largeValues[7]);
+   large.add(smallValues[3]);
+   PotentialDomainDescription potential;
+   potential.restrictTo(small);
+   potential.restrictTo(large);
+   EXPECT_TRUE(potential.couldQualify(smallValues[3]));
+   EXPECT_TRUE(potential.couldQualify(largeValues[7]));
+   for (unsigned value=0;value<=maxValue;value++)
+      if (potential.couldQualify(value)) {
+         EXPECT_TRUE(small.couldQualify(value)&&large.couldQualify(value)) << value;
+      }
+   checkCandidates(potential,maxValue);
+
+   // Syncing intersects both potential domains
+   PotentialDomainDescription other;
+   other.restrictTo(both);
+   potential.sync(other);
+   EXPECT_TRUE(potential.couldQualify(smallValues[3]));
+   EXPECT_TRUE(other.couldQualify(largeValues[7]));
+   checkCandidates(potential,maxValue);
+   checkCandidates(other,maxValue);
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,72 @@
+#include "rts/segment/DictionaryCache.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+static void insertString(DictionaryCache& cache,unsigned id,const char* value)
+   // Add a literal
+{
+   cache.insert(id,value,value+strlen(value),Type::Literal,0);
+}
+//---------------------------------------------------------------------------
+TEST(DictionaryCache,LookupCopiesValues)
+{
+   DictionaryCache cache(1024*1024);
+   string value; Type::ID type; unsigned subType;
+
+   EXPECT_FALSE(cache.lookup(7,value,type,subType));
+   const char* hello="hello";
+   cache.insert(7,hello,hello+5,Type::CustomLanguage,3);
+   ASSERT_TRUE(cache.lookup(7,value,type,subType));
+   EXPECT_EQ("hello",value);
+   EXPECT_EQ(Type::CustomLanguage,type);
+   EXPECT_EQ(3u,subType);
+
+   // A second insert keeps the first copy
+   insertString(cache,7,"other");
+   ASSERT_TRUE(cache.lookup(7,value,type,subType));
+   EXPECT_EQ("hello",value);
+
+   DictionaryCache::Statistics stats;
+   cache.getStatistics(stats);
+   EXPECT_EQ(2u,stats.hits);
+   EXPECT_EQ(1u,stats.misses);
+   EXPECT_EQ(1u,stats.entries);
+}
+//---------------------------------------------------------------------------
+TEST(DictionaryCache,EvictsLeastRecentlyUsed)
+{
+   // Room for a few entries per shard only
+   DictionaryCache cache(16*1024);
+   string value; Type::ID type; unsigned subType;
+
+   // Ids 0,16,32,... share a shard. Keep id 0 hot while filling it
+   for (unsigned index=0;index<100;index++) {
+      insertString(cache,16*index,"some string value");
+      ASSERT_TRUE(cache.lookup(0,value,type,subType));
+   }
+   EXPECT_EQ("some string value",value);
+   EXPECT_FALSE(cache.lookup(16,value,type,subType));
+   EXPECT_TRUE(cache.lookup(16*99,value,type,subType));
+
+   DictionaryCache::Statistics stats;
+   cache.getStatistics(stats);
+   EXPECT_GT(stats.evictions,0u);
+   EXPECT_LE(stats.size,16u*1024);
+   EXPECT_EQ(100u,stats.entries+stats.evictions);
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
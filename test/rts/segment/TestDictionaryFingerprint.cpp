@@ -0,0 +1,250 @@
+#include "rts/segment/DictionaryFingerprintSegment.hpp"
+#include "rts/segment/DictionarySegment.hpp"
+#include "rts/database/Database.hpp"
+#include "rts/database/DatabaseBuilder.hpp"
+#include "rts/database/DatabasePartition.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// Helper
+class DictionaryFingerprintSegment::TestInterface
+{
+   private:
+   /// The real segment
+   DictionaryFingerprintSegment& seg;
+
+   public:
+   /// Constructor
+   TestInterface(DictionaryFingerprintSegment& seg) : seg(seg) {}
+
+   /// Insert a fingerprint into the loaded table
+   void insert(const string& text,::Type::ID type,unsigned subType,unsigned id) {
+      unsigned ignored;
+      seg.lookup(text,type,subType,ignored);
+      ASSERT_TRUE(seg.table!=0);
+      DictionaryFingerprintSegment::insert(seg.table,seg.groupCount,DictionaryFingerprintSegment::fingerprint(text.data(),text.length(),type,subType),id);
+   }
+};
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+static const char tempFileName[]="fingerprinttest.tmp";
+/// The number of strings in the dictionary
+static const unsigned stringCount = 1000;
+//---------------------------------------------------------------------------
+static string stringOf(unsigned id)
+   // The string of an id
+{
+   char buffer[32];
+   snprintf(buffer,sizeof(buffer),"http://example.org/s%u",id);
+   return buffer;
+}
+//---------------------------------------------------------------------------
+/// The position and hash of a string
+struct StringInfo {
+   /// The page and offset
+   unsigned page,ofs;
+   /// The hash
+   unsigned hash;
+
+   /// Constructor
+   StringInfo(unsigned page,unsigned ofs,unsigned hash) : page(page),ofs(ofs),hash(hash) {}
+};
+//---------------------------------------------------------------------------
+struct SortByHash { bool operator()(const StringInfo& a,const StringInfo& b) const { return a.hash<b.hash; } };
+//---------------------------------------------------------------------------
+/// Produces the dictionary strings
+class StringSource : public DatabaseBuilder::StringsReader
+{
+   private:
+   /// The next id
+   unsigned id;
+   /// The current string
+   string current;
+   /// The string infos
+   vector<StringInfo>& infos;
+
+   public:
+   /// Constructor
+   explicit StringSource(vector<StringInfo>& infos) : id(0),infos(infos) {}
+
+   /// Get the next string
+   bool next(unsigned& len,const char*& data,Type::ID& type,unsigned& subType) {
+      if (id>=stringCount) return false;
+      current=stringOf(id++);
+      len=current.size(); data=current.data(); type=Type::URI; subType=0;
+      return true;
+   }
+   /// Remember the string position
+   void rememberInfo(unsigned page,unsigned ofs,unsigned hash) { infos.push_back(StringInfo(page,ofs,hash)); }
+};
+//---------------------------------------------------------------------------
+/// Produces the string positions or the hashes
+class InfoSource : public DatabaseBuilder::StringInfoReader
+{
+   private:
+   /// The infos
+   const vector<StringInfo>& infos;
+   /// Produce hashes?
+   bool hashes;
+   /// The next info
+   unsigned pos;
+
+   public:
+   /// Constructor
+   InfoSource(const vector<StringInfo>& infos,bool hashes) : infos(infos),hashes(hashes),pos(0) {}
+
+   /// Get the next entry
+   bool next(unsigned& v1,unsigned& v2) {
+      if (pos>=infos.size()) return false;
+      if (hashes) {
+         v1=infos[pos].hash; v2=infos[pos].page;
+      } else {
+         v1=infos[pos].page; v2=infos[pos].ofs;
+      }
+      pos++;
+      return true;
+   }
+};
+//---------------------------------------------------------------------------
+class TestDictionaryFingerprint : public testing::Test {
+   protected:
+   /// The database
+   Database db;
+
+   /// Constructor
+   TestDictionaryFingerprint();
+   /// Destructor
+   ~TestDictionaryFingerprint();
+
+   /// The fingerprint index
+   DictionaryFingerprintSegment& getFingerprints() { return *db.getFirstPartition().lookupSegment<DictionaryFingerprintSegment>(DatabasePartition::Tag_DictionaryFingerprint); }
+   /// Lookup a string in the dictionary
+   bool lookup(const string& text,unsigned& id) { return db.getDictionary().lookup(text,Type::URI,0,id); }
+};
+//---------------------------------------------------------------------------
+TestDictionaryFingerprint::TestDictionaryFingerprint()
+   // Constructor. Builds a dictionary with fingerprint index
+{
+   remove(tempFileName);
+   {
+      DatabaseBuilder builder(tempFileName);
+      vector<StringInfo> infos;
+      StringSource strings(infos);
+      builder.loadStrings(strings);
+      InfoSource mappings(infos,false);
+      builder.loadStringMappings(mappings);
+      sort(infos.begin(),infos.end(),SortByHash());
+      InfoSource hashes(infos,true);
+      builder.loadStringHashes(hashes);
+      builder.computeStringFingerprints();
+      builder.close();
+   }
+   EXPECT_TRUE(db.open(tempFileName,false));
+}
+//---------------------------------------------------------------------------
+TestDictionaryFingerprint::~TestDictionaryFingerprint()
+   // Destructor
+{
+   db.close();
+   remove(tempFileName);
+}
+//---------------------------------------------------------------------------
+TEST_F(TestDictionaryFingerprint,Hits)
+   // Every string is found by its fingerprint
+{
+   ASSERT_TRUE(db.getDictionary().hasFingerprints());
+   DictionaryFingerprintSegment& fingerprints=getFingerprints();
+   EXPECT_EQ(stringCount,fingerprints.getCoveredIds());
+   for (unsigned index=0;index<stringCount;index++) {
+      unsigned id=~0u;
+      EXPECT_EQ(DictionaryFingerprintSegment::Result_Found,fingerprints.lookup(stringOf(index),Type::URI,0,id)) << index;
+      EXPECT_EQ(index,id);
+      id=~0u;
+      EXPECT_TRUE(lookup(stringOf(index),id)) << index;
+      EXPECT_EQ(index,id);
+   }
+}
+//---------------------------------------------------------------------------
+TEST_F(TestDictionaryFingerprint,Misses)
+   // Absent strings are rejected by the table
+{
+   DictionaryFingerprintSegment& fingerprints=getFingerprints();
+   unsigned id;
+   for (unsigned index=stringCount;index<2*stringCount;index++) {
+      EXPECT_EQ(DictionaryFingerprintSegment::Result_Absent,fingerprints.lookup(stringOf(index),Type::URI,0,id)) << index;
+      EXPECT_FALSE(lookup(stringOf(index),id)) << index;
+   }
+   // Same text, different type
+   EXPECT_EQ(DictionaryFingerprintSegment::Result_Absent,fingerprints.lookup(stringOf(0),Type::Literal,0,id));
+   EXPECT_FALSE(db.getDictionary().lookup(stringOf(0),Type::Literal,0,id));
+}
+//---------------------------------------------------------------------------
+TEST_F(TestDictionaryFingerprint,Conflicts)
+   // Shared fingerprints fall back to the b-tree
+{
+   DictionaryFingerprintSegment& fingerprints=getFingerprints();
+   DictionaryFingerprintSegment::TestInterface test(fingerprints);
+
+   // A second string with the same fingerprint marks it as conflict
+   test.insert(stringOf(42),Type::URI,0,7);
+   unsigned id=~0u;
+   EXPECT_EQ(DictionaryFingerprintSegment::Result_Unknown,fingerprints.lookup(stringOf(42),Type::URI,0,id));
+   EXPECT_TRUE(lookup(stringOf(42),id));
+   EXPECT_EQ(42u,id);
+
+   // An absent string colliding with an existing one is rejected after verification
+   string absent=stringOf(stringCount+5);
+   test.insert(absent,Type::URI,0,43);
+   EXPECT_EQ(DictionaryFingerprintSegment::Result_Found,fingerprints.lookup(absent,Type::URI,0,id));
+   EXPECT_EQ(43u,id);
+   EXPECT_FALSE(lookup(absent,id));
+
+   // Other strings are unaffected
+   EXPECT_TRUE(lookup(stringOf(43),id));
+   EXPECT_EQ(43u,id);
+}
+//---------------------------------------------------------------------------
+TEST_F(TestDictionaryFingerprint,AppendedStrings)
+   // Strings added after the table was built are found by the b-tree
+{
+   vector<DictionarySegment::Literal> literals;
+   for (unsigned index=stringCount;index<stringCount+100;index++) {
+      DictionarySegment::Literal literal;
+      literal.str=stringOf(index); literal.type=Type::URI; literal.subType=0;
+      literals.push_back(literal);
+   }
+   db.getDictionary().appendLiterals(literals);
+   ASSERT_EQ(stringCount+100,db.getDictionary().getNextId());
+
+   DictionaryFingerprintSegment& fingerprints=getFingerprints();
+   EXPECT_EQ(stringCount,fingerprints.getCoveredIds());
+   for (unsigned index=stringCount;index<stringCount+100;index++) {
+      unsigned id=~0u;
+      EXPECT_EQ(DictionaryFingerprintSegment::Result_Absent,fingerprints.lookup(stringOf(index),Type::URI,0,id)) << index;
+      EXPECT_TRUE(lookup(stringOf(index),id)) << index;
+      EXPECT_EQ(index,id);
+   }
+   // Old strings and misses still work
+   unsigned id=~0u;
+   EXPECT_TRUE(lookup(stringOf(17),id));
+   EXPECT_EQ(17u,id);
+   EXPECT_FALSE(lookup(stringOf(stringCount+100),id));
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
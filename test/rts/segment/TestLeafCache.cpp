@@ -0,0 +1,108 @@
+#include "rts/segment/LeafCache.hpp"
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Number of triples per test page
+static const unsigned pageTriples = 1000;
+//---------------------------------------------------------------------------
+static const DecodedLeaf* insertPage(LeafCache& cache,unsigned generation,unsigned pageNo)
+   // Decompress a fake page into the cache
+{
+   FactsSegment::Triple* buffer=cache.allocateBuffer();
+   for (unsigned index=0;index<pageTriples;index++) {
+      buffer[index].value1=pageNo;
+      buffer[index].value2=generation;
+      buffer[index].value3=index;
+   }
+   return cache.insert(0,generation,pageNo,0,buffer,buffer+pageTriples);
+}
+//---------------------------------------------------------------------------
+TEST(LeafCache,LookupAndGenerations)
+{
+   LeafCache cache(1024*1024);
+
+   EXPECT_EQ(static_cast<const DecodedLeaf*>(0),cache.lookup(0,0,5,0));
+   const DecodedLeaf* leaf=insertPage(cache,0,5);
+   ASSERT_EQ(pageTriples,static_cast<unsigned>(leaf->end()-leaf->begin()));
+   EXPECT_EQ(5u,leaf->begin()[0].value1);
+   EXPECT_EQ(pageTriples-1,leaf->begin()[pageTriples-1].value3);
+   cache.release(leaf);
+
+   // Found again, but not for another generation or time
+   const DecodedLeaf* again=cache.lookup(0,0,5,0);
+   EXPECT_EQ(leaf,again);
+   cache.release(again);
+   EXPECT_EQ(static_cast<const DecodedLeaf*>(0),cache.lookup(0,1,5,0));
+   EXPECT_EQ(static_cast<const DecodedLeaf*>(0),cache.lookup(0,0,5,1));
+
+   // A concurrent insert of the same page yields the cached copy
+   leaf=insertPage(cache,0,5);
+   EXPECT_EQ(again,leaf);
+   cache.release(leaf);
+
+   LeafCache::Statistics stats;
+   cache.getStatistics(stats);
+   EXPECT_EQ(1u,stats.hits);
+   EXPECT_EQ(3u,stats.misses);
+   EXPECT_EQ(1u,stats.pages);
+}
+//---------------------------------------------------------------------------
+TEST(LeafCache,EvictionKeepsPinnedPages)
+{
+   // Room for about four pages per shard
+   static const unsigned shards = LeafCache::shardCount;
+   LeafCache cache(shards*(4*pageTriples*sizeof(FactsSegment::Triple)+2048));
+
+   // Use pages of the same shard
+   const DecodedLeaf* pinned=insertPage(cache,0,0);
+   for (unsigned pageNo=1;pageNo<20;pageNo++)
+      cache.release(insertPage(cache,0,pageNo*shards));
+
+   LeafCache::Statistics stats;
+   cache.getStatistics(stats);
+   EXPECT_LE(stats.pages,4u);
+   EXPECT_GT(stats.evictions,0u);
+
+   // The pinned page survived and is still intact
+   EXPECT_EQ(0u,pinned->begin()[10].value1);
+   EXPECT_EQ(10u,pinned->begin()[10].value3);
+   const DecodedLeaf* again=cache.lookup(0,0,0,0);
+   EXPECT_EQ(pinned,again);
+   cache.release(again);
+   cache.release(pinned);
+
+   // The most recent pages are still there, the oldest ones are gone
+   const DecodedLeaf* recent=cache.lookup(0,0,19*shards,0);
+   EXPECT_TRUE(recent!=0);
+   if (recent) cache.release(recent);
+   EXPECT_EQ(static_cast<const DecodedLeaf*>(0),cache.lookup(0,0,shards,0));
+}
+//---------------------------------------------------------------------------
+TEST(LeafCache,ShardsEvictIndependently)
+{
+   // Room for about four pages per shard
+   static const unsigned shards = LeafCache::shardCount;
+   LeafCache cache(shards*(4*pageTriples*sizeof(FactsSegment::Triple)+2048));
+
+   // Fill one shard far beyond its budget, the neighbor page stays
+   cache.release(insertPage(cache,0,1));
+   for (unsigned pageNo=0;pageNo<20;pageNo++)
+      cache.release(insertPage(cache,0,pageNo*shards));
+
+   const DecodedLeaf* neighbor=cache.lookup(0,0,1,0);
+   EXPECT_TRUE(neighbor!=0);
+   if (neighbor) cache.release(neighbor);
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
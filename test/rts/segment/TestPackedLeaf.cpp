@@ -0,0 +1,88 @@
+#include "rts/segment/PackedLeaf.hpp"
+#include <gtest/gtest.h>
+#include <vector>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+static void makeTriples(vector<FactsSegment::Triple>& triples,unsigned count,unsigned seed)
+   // Generate sorted triples with mixed value ranges
+{
+   unsigned value1=seed,value2=0,value3=0,state=seed+1;
+   for (unsigned index=0;index<count;index++) {
+      state=state*1103515245+12345;
+      switch ((state>>16)%4) {
+         case 0: value1+=1+((state>>8)%1000); value2=(state>>4)%50; value3=state>>1; break;
+         case 1: value2+=1+((state>>8)%7); value3=(state>>12)%100; break;
+         default: value3+=1+((state>>8)%3); break;
+      }
+      FactsSegment::Triple t;
+      t.value1=value1; t.value2=value2; t.value3=value3;
+      triples.push_back(t);
+   }
+}
+//---------------------------------------------------------------------------
+TEST(PackedLeaf,RoundTrip)
+{
+   vector<FactsSegment::Triple> triples;
+   makeTriples(triples,20000,7);
+   unsigned char page[BufferReference::pageSize];
+
+   // Fill pages until everything is stored
+   vector<FactsSegment::Triple> decoded(BufferReference::pageSize);
+   unsigned done=0,pages=0;
+   while (done<triples.size()) {
+      unsigned stored=PackedLeaf::pack(page+12,page+sizeof(page),&triples[done],triples.size()-done);
+      ASSERT_GT(stored,0u);
+      ASSERT_TRUE(PackedLeaf::isPacked(page+12));
+      ASSERT_EQ(stored,PackedLeaf::getCount(page+12));
+      EXPECT_EQ(triples[done].value1,Segment::readUint32Aligned(PackedLeaf::getFirstTriple(page+12)));
+
+      FactsSegment::Triple* end=PackedLeaf::unpack(page+12,&decoded[0]);
+      ASSERT_EQ(stored,static_cast<unsigned>(end-&decoded[0]));
+      for (unsigned index=0;index<stored;index++) {
+         ASSERT_EQ(triples[done+index].value1,decoded[index].value1);
+         ASSERT_EQ(triples[done+index].value2,decoded[index].value2);
+         ASSERT_EQ(triples[done+index].value3,decoded[index].value3);
+      }
+      done+=stored;
+      pages++;
+   }
+   EXPECT_GT(pages,1u);
+}
+//---------------------------------------------------------------------------
+TEST(PackedLeaf,PartialBlocksAndWideValues)
+{
+   unsigned char page[BufferReference::pageSize];
+   vector<FactsSegment::Triple> decoded(BufferReference::pageSize);
+
+   // Counts that do not fill a block, values using all 32 bits
+   for (unsigned count=1;count<140;count+=9) {
+      vector<FactsSegment::Triple> triples;
+      for (unsigned index=0;index<count;index++) {
+         FactsSegment::Triple t;
+         t.value1=5; t.value2=index*0x01000193u; t.value3=(index&1)?0xFFFFFFFEu:0;
+         triples.push_back(t);
+      }
+      ASSERT_EQ(count,PackedLeaf::pack(page+12,page+sizeof(page),&triples[0],count));
+      ASSERT_EQ(count,static_cast<unsigned>(PackedLeaf::unpack(page+12,&decoded[0])-&decoded[0]));
+      for (unsigned index=0;index<count;index++) {
+         ASSERT_EQ(5u,decoded[index].value1);
+         ASSERT_EQ(triples[index].value2,decoded[index].value2);
+         ASSERT_EQ(triples[index].value3,decoded[index].value3);
+      }
+   }
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
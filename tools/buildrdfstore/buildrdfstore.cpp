@@ -403,6 +403,10 @@ bool buildDatabase(DatabaseBuilder& builder,const char* target,const char* facts
          StringHashesReader reader(sortedByHash);
          builder.loadStringHashes(reader);
       }
+
+      // Build the fingerprint index
+      cout << "Building the string fingerprints..." << endl;
+      builder.computeStringFingerprints();
    }
 
    return true;
@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/segment/AggregatedFactsSegment.hpp"
 #include "rts/segment/DictionarySegment.hpp"
@@ -21,9 +22,10 @@ static void dumpEntry(DictionarySegment& dict,unsigned id)
 {
    cout << id << ' ';
 
+   BufferReference page;
    const char* start,*stop;
    Type::ID type; unsigned subType;
-   if (dict.lookupById(id,start,stop,type,subType)) {
+   if (dict.lookupById(id,page,start,stop,type,subType)) {
       for (;start!=stop;++start)
          cout << *start;
    }
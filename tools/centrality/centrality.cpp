@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
@@ -100,8 +101,9 @@ static void clusterPredicates(set<unsigned>& toURI, set<unsigned>& toLiterals, D
 		if (!decided){
 			assert(predicate==scan.getValue1());
 			unsigned o=scan.getValue3();
+			BufferReference page;
 			const char* start=0,*stop=0; Type::ID type; unsigned subType;
-			db.getDictionary().lookupById(o,start,stop,type,subType);
+			db.getDictionary().lookupById(o,page,start,stop,type,subType);
 			if (type==Type::Literal)
 				toLiterals.insert(scan.getValue1());
 			else
@@ -165,8 +167,9 @@ static unsigned numberOfNeighbors(unsigned node, Database& db, Database::DataOrd
 static string lookupById(Database& db,unsigned id)
    // Lookup a string id
 {
+   BufferReference page;
    const char* start=0,*stop=0; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,stop,type,subType);
+   db.getDictionary().lookupById(id,page,start,stop,type,subType);
    return string(start,stop);
 }
 //---------------------------------------------------------------------------
@@ -178,8 +181,9 @@ static void randomLookups(Database& db){
 		if (i%1000==0)
 			cerr<<"i "<<i<<endl;
 		unsigned id=rand()%dbSize;
+		BufferReference page;
 		const char* start=0,*stop=0; Type::ID type; unsigned subType;
-		db.getDictionary().lookupById(id,start,stop,type,subType);
+		db.getDictionary().lookupById(id,page,start,stop,type,subType);
 	}
 	Timestamp t2;
 	cerr<<"time: "<<t2-t1<<" ms"<<endl;
@@ -553,7 +557,7 @@ static void computeBackwardSelectivity(Database& db, vector<unsigned>& back_sele
 		cerr<<"node: "<<*it<<endl;
 		cerr<<"node name: "<<lookupById(db,*it)<<endl;
 		scan.computeSP(*it);
-		cerr<<"map size: "<<scan.getSPMap().size()<<endl;
+		cerr<<"map size: "<<scan.getReached().size()<<endl;
 
 		scan.countSelectivity(*it);
 	}
@@ -639,8 +643,9 @@ int main(int argc,char* argv[]){
 	unsigned nodenum=numberOfNodes(db);
 	for (unsigned i=0; i < 1000; i++){
 		unsigned startid=rand()%nodenum;
+		BufferReference page;
 		const char* start=0,*stop=0; Type::ID type; unsigned subType;
-		db.getDictionary().lookupById(startid,start,stop,type,subType);
+		db.getDictionary().lookupById(startid,page,start,stop,type,subType);
 		if (type != Type::URI){
 			i--;
 			continue;
@@ -649,7 +654,7 @@ int main(int argc,char* argv[]){
 		approx=(approx==0)?1:approx;
 		FastDijkstraEngine scan1(db, Database::Order_Object_Predicate_Subject,false);
 		scan1.computeSP(startid);
-		int exact=scan1.getSPMap().size();
+		int exact=scan1.getReached().size();
 		if (exact<10){
 			i--;
 			continue;
@@ -48,7 +48,7 @@ int main(int argc,char* argv[]){
 	eng->computeSP(node);
 	Timestamp t2;
 
-	unsigned treeSize=eng->getSPMap().size();
+	unsigned treeSize=eng->getReached().size();
 	cout<<node<<": "<<t2-t1<<" ms, "<<"tree size: "<<treeSize<<endl;
 
 }
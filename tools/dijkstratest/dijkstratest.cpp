@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/segment/PathSelectivitySegment.hpp"
 #include "rts/dijkstra/DijkstraEngine.hpp"
@@ -72,8 +73,9 @@ int main(int argc,char* argv[]){
 			eng=new FastDijkstraEngine(db,order,false);
 		// choose the node and check whether it is URI
 		unsigned startid=rand()%nodenum;
+		BufferReference page;
 		const char* start=0,*stop=0; Type::ID type; unsigned subType;
-		db.getDictionary().lookupById(startid,start,stop,type,subType);
+		db.getDictionary().lookupById(startid,page,start,stop,type,subType);
 		if (type != Type::URI){
 			i--;
 			continue;
@@ -84,7 +86,7 @@ int main(int argc,char* argv[]){
 		eng->computeSP(startid);
 		Timestamp t2;
 		// if result is too small, skip it
-		unsigned treeSize=eng->getSPMap().size();
+		unsigned treeSize=eng->getReached().size();
 		if (treeSize<1000||treeSize<10){
 			i--;
 			continue;
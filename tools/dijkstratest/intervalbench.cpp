@@ -0,0 +1,141 @@
+#include "rts/database/Database.hpp"
+#include "rts/segment/FerrariSegment.hpp"
+#include "rts/ferrari/Index.hpp"
+#include "rts/ferrari/IntervalList.hpp"
+#include "infra/osdep/Timestamp.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// A single containment probe
+struct Probe {
+   /// The interval list
+   const IntervalList* list;
+   /// The probed value
+   unsigned value;
+};
+//---------------------------------------------------------------------------
+static const char* kernelName(IntervalList::kernel k)
+   // Name of a search kernel
+{
+   switch (k) {
+      case IntervalList::BINARY_SEARCH: return "packed binary search";
+      case IntervalList::SCALAR: return "scalar";
+      case IntervalList::SSE4: return "sse4";
+      case IntervalList::AVX2: return "avx2";
+   }
+   return "unknown";
+}
+//---------------------------------------------------------------------------
+static IntervalList::containment referenceContains(const IntervalList& list,unsigned x)
+   // The binary search of IntervalList::contains before the search kernels, the baseline of the benchmark
+{
+   const IntervalList::bounds& lower=list.get_lower(),&upper=list.get_upper();
+   if ((x<lower.front())||(x>upper.back()))
+      return IntervalList::NOT;
+   int min=0,max=lower.size(),mid;
+   while (true) {
+      if (min==max) {
+         if ((lower[min]<=x)&&(x<=upper[min]))
+            return list.is_exact(min)?IntervalList::YES:IntervalList::MAYBE;
+         return IntervalList::NOT;
+      }
+      mid=(max+min)/2;
+      if ((lower[mid]<=x)&&(x<=upper[mid]))
+         return list.is_exact(mid)?IntervalList::YES:IntervalList::MAYBE;
+      else if (x<lower[mid])
+         max=mid; else
+         min=mid+1;
+   }
+}
+//---------------------------------------------------------------------------
+/// Compare the IntervalList search kernels on the interval lists of a database
+int main(int argc,char* argv[])
+{
+   if (argc<3) {
+      cout << "usage: " << argv[0] << " <database> <number of probes> [min intervals]" << endl;
+      return 1;
+   }
+
+   // Open the database
+   Database db;
+   if (!db.open(argv[1],true)) {
+      cout << "unable to open " << argv[1] << endl;
+      return 1;
+   }
+   unsigned probeCount=atoi(argv[2]);
+   unsigned minIntervals=(argc>3)?atoi(argv[3]):1;
+
+   // Collect the interval lists of all indexed predicates
+   vector<const IntervalList*> lists;
+   vector<unsigned> predicates;
+   db.getFerrari()->getPredicates(predicates);
+   for (vector<unsigned>::const_iterator iter=predicates.begin(),limit=predicates.end();iter!=limit;++iter) {
+      Index* index=db.getReachabilityIndex(*iter);
+      if (!index) continue;
+      for (unsigned v=0,n=index->get_graph()->num_nodes();v<n;v++) {
+         const IntervalList* list=index->get_intervals(v);
+         if (list&&(!list->empty())&&(list->size()>=minIntervals))
+            lists.push_back(list);
+      }
+   }
+   if (lists.empty()) {
+      cout << "no interval lists found" << endl;
+      return 1;
+   }
+   unsigned long long intervals=0;
+   for (vector<const IntervalList*>::const_iterator iter=lists.begin(),limit=lists.end();iter!=limit;++iter)
+      intervals+=(*iter)->size();
+   cout << lists.size() << " interval lists, " << (static_cast<double>(intervals)/lists.size()) << " intervals on average" << endl;
+
+   // Generate the probes
+   srand(42);
+   vector<Probe> probes(probeCount);
+   for (unsigned index=0;index<probeCount;index++) {
+      const IntervalList* list=lists[rand()%lists.size()];
+      probes[index].list=list;
+      probes[index].value=list->min()+(rand()%(list->max()-list->min()+2));
+   }
+
+   // The previous search is the reference
+   vector<int> reference(probeCount);
+   {
+      Timestamp start;
+      for (unsigned index=0;index<probeCount;index++)
+         reference[index]=referenceContains(*probes[index].list,probes[index].value);
+      Timestamp stop;
+      cout << "previous binary search: " << (stop-start) << " ms" << endl;
+   }
+
+   // Run all supported kernels
+   IntervalList::kernel initial=IntervalList::get_kernel();
+   static const IntervalList::kernel kernels[]={IntervalList::BINARY_SEARCH,IntervalList::SCALAR,IntervalList::SSE4,IntervalList::AVX2};
+   for (unsigned k=0;k<sizeof(kernels)/sizeof(kernels[0]);k++) {
+      if (!IntervalList::set_kernel(kernels[k])) {
+         cout << kernelName(kernels[k]) << ": not supported" << endl;
+         continue;
+      }
+      vector<int> results(probeCount);
+      Timestamp start;
+      for (unsigned index=0;index<probeCount;index++)
+         results[index]=probes[index].list->contains(probes[index].value);
+      Timestamp stop;
+
+      bool same=(results==reference);
+      cout << kernelName(kernels[k]) << ": " << (stop-start) << " ms" << (same?"":" (MISMATCH)") << endl;
+   }
+   IntervalList::set_kernel(initial);
+   cout << "default kernel: " << kernelName(initial) << endl;
+}
+//---------------------------------------------------------------------------
@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
@@ -39,8 +40,9 @@ static bool contains(const vector<unsigned>& allNodes,unsigned id)
 static string lookupId(Database& db,unsigned id)
    // Lookup a string id
 {
+   BufferReference page;
    const char* start=0,*stop=0; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,stop,type,subType);
+   db.getDictionary().lookupById(id,page,start,stop,type,subType);
    return string(start,stop);
 }
 //---------------------------------------------------------------------------
@@ -258,16 +260,18 @@ static vector<unsigned> buildChain(unsigned from,const vector<unsigned>& fromIds
 static string lookupURL(Database& db,unsigned id)
    // Lookup a URL
 {
+   BufferReference page;
    const char* start=0,*end=start; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,end,type,subType);
+   db.getDictionary().lookupById(id,page,start,end,type,subType);
    return "<"+string(start,end)+">";
 }
 //---------------------------------------------------------------------------
 static string lookupLiteral(Database& db,unsigned id)
    // Lookup a literal value
 {
+   BufferReference page;
    const char* start=0,*end=start; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,end,type,subType);
+   db.getDictionary().lookupById(id,page,start,end,type,subType);
 
    if (type==Type::URI)
       return "<"+string(start,end)+">"; else
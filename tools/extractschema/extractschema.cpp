@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/segment/FactsSegment.hpp"
 #include "rts/segment/AggregatedFactsSegment.hpp"
@@ -163,8 +164,9 @@ int main(int argc,char* argv[])
             out << "  nodeliteral" << (*iter).v1 << "_" << (*iter).v2 << "[shape=none];" << endl;
       }
       for (set<Triple>::const_iterator iter=triples.begin(),limit=triples.end();iter!=limit;++iter) {
+         BufferReference page;
          const char* labelStart=0,*labelStop=0; Type::ID type; unsigned subType;
-         db.getDictionary().lookupById((*iter).v2,labelStart,labelStop,type,subType);
+         db.getDictionary().lookupById((*iter).v2,page,labelStart,labelStop,type,subType);
          string label(labelStart,labelStop);
          if (!~(*iter).v3)
             out << "  node" << (*iter).v1 << " -> nodeliteral" << (*iter).v1 << "_" << (*iter).v2; else
@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
@@ -24,8 +25,9 @@ using namespace std;
 static void lookupById(Database& db,unsigned id)
    // Lookup a string id
 {
+   BufferReference page;
    const char* start=0,*stop=0; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,stop,type,subType);
+   db.getDictionary().lookupById(id,page,start,stop,type,subType);
 
    cout<<string(start,stop)<<endl;
 }
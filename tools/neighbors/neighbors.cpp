@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
@@ -79,8 +80,9 @@ unsigned ConstantOperator::next(){
 static string lookupLiteral(Database& db,unsigned id)
    // Lookup a literal value
 {
+   BufferReference page;
    const char* start=0,*end=start; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,end,type,subType);
+   db.getDictionary().lookupById(id,page,start,end,type,subType);
 
    if (type==Type::URI)
       return "<"+string(start,end)+">"; else
@@ -6,6 +6,7 @@
 #include "cts/semana/SemanticAnalysis.hpp"
 #include "infra/osdep/Timestamp.hpp"
 #include "infra/util/Type.hpp"
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/operator/Operator.hpp"
 #include "rts/operator/PlanPrinter.hpp"
@@ -164,8 +165,9 @@ static void expandConstants(Database& db,const vector<string>& terms,vector<vect
          if (!~v) {
             break;
          } else {
+            BufferReference page;
             const char* start,*stop; Type::ID type; unsigned subType;
-            if (!db.getDictionary().lookupById(v,start,stop,type,subType))
+            if (!db.getDictionary().lookupById(v,page,start,stop,type,subType))
                break;
             switch (type) {
                case Type::URI: values.push_back("<"+escapeURI(start,stop)+">"); break;
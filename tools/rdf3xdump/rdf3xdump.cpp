@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/operator/IndexScan.hpp"
 #include "rts/runtime/Runtime.hpp"
@@ -54,8 +55,9 @@ static void writeLiteral(const char* start,const char* stop)
 static void dumpSubject(DictionarySegment& dic,unsigned id)
    // Write a subject entry
 {
+   BufferReference page;
    const char* start,*stop; Type::ID type; unsigned subType;
-   if (!dic.lookupById(id,start,stop,type,subType)) {
+   if (!dic.lookupById(id,page,start,stop,type,subType)) {
       cerr << "consistency error: encountered unknown id " << id << endl;
       throw;
    }
@@ -67,8 +69,9 @@ static void dumpSubject(DictionarySegment& dic,unsigned id)
 static void dumpPredicate(DictionarySegment& dic,unsigned id)
    // Write a predicate entry
 {
+   BufferReference page;
    const char* start,*stop; Type::ID type; unsigned subType;
-   if (!dic.lookupById(id,start,stop,type,subType)) {
+   if (!dic.lookupById(id,page,start,stop,type,subType)) {
       cerr << "consistency error: encountered unknown id " << id << endl;
       throw;
    }
@@ -80,8 +83,9 @@ static void dumpPredicate(DictionarySegment& dic,unsigned id)
 static void dumpObject(DictionarySegment& dic,unsigned id)
    // Write an object entry
 {
+   BufferReference page;
    const char* start,*stop; Type::ID type; unsigned subType;
-   if (!dic.lookupById(id,start,stop,type,subType)) {
+   if (!dic.lookupById(id,page,start,stop,type,subType)) {
       cerr << "consistency error: encountered unknown id " << id << endl;
       throw;
    }
@@ -89,8 +93,9 @@ static void dumpObject(DictionarySegment& dic,unsigned id)
       case Type::URI: writeURI(start,stop); break;
       case Type::Literal: writeLiteral(start,stop); break;
       case Type::CustomLanguage: {
+         BufferReference page2;
          const char* start2,*stop2; Type::ID type2; unsigned subType2;
-         if (!dic.lookupById(subType,start2,stop2,type2,subType2)) {
+         if (!dic.lookupById(subType,page2,start2,stop2,type2,subType2)) {
             cerr << "consistency error: encountered unknown language " << subType << endl;
             throw;
          }
@@ -100,8 +105,9 @@ static void dumpObject(DictionarySegment& dic,unsigned id)
             cout << (*iter);
          } break;
       case Type::CustomType: {
+         BufferReference page2;
          const char* start2,*stop2; Type::ID type2; unsigned subType2;
-         if (!dic.lookupById(subType,start2,stop2,type2,subType2)) {
+         if (!dic.lookupById(subType,page2,start2,stop2,type2,subType2)) {
             cerr << "consistency error: encountered unknown type " << subType << endl;
             throw;
          }
@@ -160,9 +166,10 @@ int main(int argc,char* argv[])
       }
       // Dump the strings
       {
+         BufferReference page;
          const char* start,*stop; Type::ID type; unsigned subType;
          DictionarySegment& dic=db.getDictionary();
-         for (unsigned id=0;(id<=maxId)&&dic.lookupById(id,start,stop,type,subType);++id) {
+         for (unsigned id=0;(id<=maxId)&&dic.lookupById(id,page,start,stop,type,subType);++id) {
             cerr << id << " " << type << " " << subType << " ";
 	    for (const char* iter=start;iter!=stop;++iter) {
 	       char c=*iter;
@@ -6,6 +6,7 @@
 #include "cts/plangen/PlanGen.hpp"
 #include "cts/semana/SemanticAnalysis.hpp"
 #include "infra/osdep/Timestamp.hpp"
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/operator/Operator.hpp"
 #include "rts/operator/PlanPrinter.hpp"
@@ -321,8 +322,9 @@ string ExplainPrinter::formatValue(unsigned value)
 {
    stringstream result;
    if (~value) {
+      BufferReference page;
       const char* start,*stop; Type::ID type; unsigned subType;
-      if (runtime.getDatabase().getDictionary().lookupById(value,start,stop,type,subType)) {
+      if (runtime.getDatabase().getDictionary().lookupById(value,page,start,stop,type,subType)) {
          result << '\"';
          for (const char* iter=start;iter!=stop;++iter)
            result << *iter;
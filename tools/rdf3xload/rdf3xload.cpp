@@ -619,7 +619,7 @@ bool StringHashesReader::next(unsigned& v1,unsigned& v2)
 //---------------------------------------------------------------------------
 }
 //---------------------------------------------------------------------------
-static void loadStrings(DatabaseBuilder& builder,TempFile& stringTable)
+static void loadStrings(DatabaseBuilder& builder,TempFile& stringTable,bool fingerprints)
    // Load the strings
 {
    cout << "Loading strings..." << endl;
@@ -642,6 +642,10 @@ static void loadStrings(DatabaseBuilder& builder,TempFile& stringTable)
       StringHashesReader infoReader(sortedByHash);
       builder.loadStringHashes(infoReader);
    }
+
+   // Build the fingerprint index
+   if (fingerprints)
+      builder.computeStringFingerprints();
 }
 //---------------------------------------------------------------------------
 static void loadStatistics(DatabaseBuilder& builder,TempFile& facts)
@@ -654,14 +658,14 @@ static void loadStatistics(DatabaseBuilder& builder,TempFile& facts)
    builder.computeExactStatistics(tmp.getFile().c_str());
 }
 //---------------------------------------------------------------------------
-static void loadFerrari(DatabaseBuilder& builder)
+static void loadFerrari(DatabaseBuilder& builder,unsigned threads,uint64_t memoryBudget)
 	// Compute Ferrari reachability index
 {
 	cout<<"Loading reachability index..."<<endl;
-	builder.computeFerrari();
+	builder.computeFerrari(threads,memoryBudget);
 }
 //---------------------------------------------------------------------------
-static void loadDatabase(const char* name,TempFile& facts,TempFile& stringTable)
+static void loadDatabase(const char* name,TempFile& facts,TempFile& stringTable,bool fingerprints,unsigned ferrariThreads,uint64_t ferrariMemory)
    // Load the database
 {
    cout << "Loading database into " << name << "..." << endl;
@@ -671,13 +675,13 @@ static void loadDatabase(const char* name,TempFile& facts,TempFile& stringTable)
    loadFacts(builder,facts);
 
    // Load the strings
-   loadStrings(builder,stringTable);
+   loadStrings(builder,stringTable,fingerprints);
 
    // Compute the statistics
    loadStatistics(builder,facts);
 
    // Compute FERRARI
-   loadFerrari(builder);
+   loadFerrari(builder,ferrariThreads,ferrariMemory);
 }
 //---------------------------------------------------------------------------
 int main(int argc,char* argv[])
@@ -691,21 +695,40 @@ int main(int argc,char* argv[])
         << "(c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x" << endl;
 
    // Check the arguments
-   if (argc<2) {
-      cerr <<  "usage: " << argv[0] << " <database> [input]" << endl
-           << "without input file data is read from stdin" << endl;
+   unsigned ferrariThreads=0;
+   uint64_t ferrariMemory=0;
+   bool fingerprints=true;
+   int first=1;
+   for (;(first<argc)&&(strncmp(argv[first],"--",2)==0);first++) {
+      if (strncmp(argv[first],"--threads=",10)==0) {
+         ferrariThreads=atoi(argv[first]+10);
+      } else if (strncmp(argv[first],"--ferrari-memory=",17)==0) {
+         ferrariMemory=static_cast<uint64_t>(atoi(argv[first]+17))<<20;
+      } else if (strcmp(argv[first],"--no-fingerprints")==0) {
+         fingerprints=false;
+      } else {
+         cerr << "unknown option " << argv[first] << endl;
+         return 1;
+      }
+   }
+   if (argc<first+1) {
+      cerr <<  "usage: " << argv[0] << " [--threads=n] [--ferrari-memory=mb] [--no-fingerprints] <database> [input]" << endl
+           << "without input file data is read from stdin" << endl
+           << "--threads and --ferrari-memory limit the reachability index construction, by default they are guessed" << endl
+           << "--no-fingerprints skips the in-memory string index, lookups then only use the hash b-tree" << endl;
       return 1;
    }
+   const char* dbName=argv[first];
 
    // Parse the input
-   TempFile rawFacts(argv[1]),rawStrings(argv[1]);
+   TempFile rawFacts(dbName),rawStrings(dbName);
    map<unsigned,unsigned> subTypes;
-   if (argc>=3) {
+   if (argc>=first+2) {
       StringLookup lookup;
-      for (int index=2;index<argc;index++) {
+      for (int index=first+1;index<argc;index++) {
          ifstream in(argv[index]);
          if (!in.is_open()) {
-            cerr << "Unable to open " << argv[2] << endl;
+            cerr << "Unable to open " << argv[index] << endl;
             return 1;
          }
          if (!parse(in,argv[index],lookup,rawFacts,rawStrings,subTypes))
@@ -718,16 +741,16 @@ int main(int argc,char* argv[])
    }
 
    // Build the string dictionary
-   TempFile stringTable(argv[1]),stringIds(argv[1]);
+   TempFile stringTable(dbName),stringIds(dbName);
    buildDictionary(rawStrings,stringTable,stringIds,subTypes);
 
    // Resolve the ids
-   TempFile facts(argv[1]);
+   TempFile facts(dbName);
    resolveIds(rawFacts,stringIds,facts);
    stringIds.discard();
 
    // And start the load
-   loadDatabase(argv[1],facts,stringTable);
+   loadDatabase(dbName,facts,stringTable,fingerprints,ferrariThreads,ferrariMemory);
 
    cout << "Done." << endl;
 }
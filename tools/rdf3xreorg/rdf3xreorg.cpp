@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/DatabaseBuilder.hpp"
 #include "rts/operator/IndexScan.hpp"
 #include "rts/runtime/Runtime.hpp"
@@ -7,6 +8,7 @@
 #include "../rdf3xload/Sorter.hpp"
 #include "../rdf3xload/TempFile.hpp"
 #include <iostream>
+#include <cstring>
 #include <map>
 #include <set>
 //---------------------------------------------------------------------------
@@ -74,8 +76,9 @@ static void reorderIds(Database& db,TempFile& idMap,TempFile& dictionary)
    {
       DictionarySegment& dict=db.getDictionary();
       for (unsigned index=0,limit=dict.getNextId();index<limit;++index) {
+         BufferReference page;
          const char* start,*stop; Type::ID type; unsigned subType;
-         if (dict.lookupById(index,start,stop,type,subType)&&Type::hasSubType(type))
+         if (dict.lookupById(index,page,start,stop,type,subType)&&Type::hasSubType(type))
             subTypes[subType];
       }
    }
@@ -152,8 +155,9 @@ static void reorderIds(Database& db,TempFile& idMap,TempFile& dictionary)
             subTypes[id]=newId;
 
          // And produce the new dictionary entry
+         BufferReference page;
          const char* start,*stop; Type::ID type; unsigned subType;
-         if (dict.lookupById(id,start,stop,type,subType)) {
+         if (dict.lookupById(id,page,start,stop,type,subType)) {
             dictionary.writeString(stop-start,start);
             if (Type::hasSubType(type))
                dictionary.writeId(static_cast<uint64_t>(type)|(static_cast<uint64_t>(subTypes[subType])<<8)); else
@@ -281,8 +285,9 @@ static void remapFacts(Database& db,const TempFile& idMap,TempFile& facts)
    TempFile subjectResolved(idMap.getBaseFile());
    {
       FactsSegment::Scan scan;
-      uint64_t from=0,to=0;
-      const char* reader=map.getBegin();
+      // The map starts with id 0, which must be resolved, too
+      uint64_t from,to;
+      const char* reader=TempFile::readId(TempFile::readId(map.getBegin(),from),to);
       if (scan.first(db.getFacts(Database::Order_Subject_Predicate_Object))) do {
          uint64_t subject=scan.getValue1(),predicate=scan.getValue2(),object=scan.getValue3();
          while (from<subject)
@@ -304,8 +309,9 @@ static void remapFacts(Database& db,const TempFile& idMap,TempFile& facts)
       MemoryMappedFile in;
       if (!in.open(sortedByPredicate.getFile().c_str()))
          throw;
-      uint64_t from=0,to=0;
-      const char* reader=map.getBegin();
+      // The map starts with id 0, which must be resolved, too
+      uint64_t from,to;
+      const char* reader=TempFile::readId(TempFile::readId(map.getBegin(),from),to);
       for (const char* iter=in.getBegin(),*limit=in.getEnd();iter!=limit;) {
          uint64_t subject,predicate,object;
          iter=TempFile::readId(iter,predicate);
@@ -331,8 +337,9 @@ static void remapFacts(Database& db,const TempFile& idMap,TempFile& facts)
       MemoryMappedFile in;
       if (!in.open(sortedByObject.getFile().c_str()))
          throw;
-      uint64_t from=0,to=0;
-      const char* reader=map.getBegin();
+      // The map starts with id 0, which must be resolved, too
+      uint64_t from,to;
+      const char* reader=TempFile::readId(TempFile::readId(map.getBegin(),from),to);
       for (const char* iter=in.getBegin(),*limit=in.getEnd();iter!=limit;) {
          uint64_t subject,predicate,object;
          iter=TempFile::readId(iter,object);
@@ -529,7 +536,7 @@ bool StringHashesReader::next(unsigned& v1,unsigned& v2)
 //---------------------------------------------------------------------------
 }
 //---------------------------------------------------------------------------
-static void loadStrings(DatabaseBuilder& builder,TempFile& stringTable)
+static void loadStrings(DatabaseBuilder& builder,TempFile& stringTable,bool fingerprints)
    // Load the strings
 {
    cout << "Loading strings..." << endl;
@@ -552,6 +559,10 @@ static void loadStrings(DatabaseBuilder& builder,TempFile& stringTable)
       StringHashesReader infoReader(sortedByHash);
       builder.loadStringHashes(infoReader);
    }
+
+   // Rebuild the fingerprint index, the ids have changed
+   if (fingerprints)
+      builder.computeStringFingerprints();
 }
 //---------------------------------------------------------------------------
 static void loadStatistics(DatabaseBuilder& builder,TempFile& facts)
@@ -575,38 +586,54 @@ int main(int argc,char* argv[])
         << "(c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x" << endl;
 
    // Check the arguments
-   if (argc!=2) {
-      cerr << "usage: " << argv[0] << " <database>" << endl;
+   FactsSegment::LeafFormat leafFormat=FactsSegment::LeafFormat_Delta;
+   int first=1;
+   for (;(first<argc)&&(strncmp(argv[first],"--",2)==0);first++) {
+      if (strcmp(argv[first],"--packed")==0) {
+         leafFormat=FactsSegment::LeafFormat_Packed;
+      } else {
+         cerr << "unknown option " << argv[first] << endl;
+         return 1;
+      }
+   }
+   if (argc!=first+1) {
+      cerr << "usage: " << argv[0] << " [--packed] <database>" << endl
+           << "--packed stores the facts in bit-packed blocks, which are faster to scan but somewhat larger" << endl;
       return 1;
    }
+   const char* dbName=argv[first];
 
    // Open the database
    Database db;
-   if (!db.open(argv[1],true)) {
-      cerr << "unable to open database " << argv[1] << endl;
+   if (!db.open(dbName,true)) {
+      cerr << "unable to open database " << dbName << endl;
       return 1;
    }
 
+   // Keep the fingerprint index if the database has one
+   bool fingerprints=db.getDictionary().hasFingerprints();
+
    // Reorder the ids
-   TempFile idMap(argv[1]),dictionary(argv[1]);
+   TempFile idMap(dbName),dictionary(dbName);
    reorderIds(db,idMap,dictionary);
 
    // Remapping the facts
-   TempFile facts(argv[1]);
+   TempFile facts(dbName);
    remapFacts(db,idMap,facts);
 
    // Create a new database file
    db.close();
-   TempFile newDB(argv[1]);
+   TempFile newDB(dbName);
    newDB.close();
    DatabaseBuilder builder(newDB.getFile().c_str());
+   builder.setFactsLeafFormat(leafFormat);
 
    // Load the facts
    loadFacts(builder,facts);
    facts.discard();
 
    // Load the strings
-   loadStrings(builder,dictionary);
+   loadStrings(builder,dictionary,fingerprints);
    dictionary.discard();
 
    // Load the statistics
@@ -614,6 +641,6 @@ int main(int argc,char* argv[])
 
    // Move back
    builder.close();
-   rename(newDB.getFile().c_str(),argv[1]);
+   rename(newDB.getFile().c_str(),dbName);
 }
 //---------------------------------------------------------------------------
@@ -1,3 +1,4 @@
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/segment/PathSelectivitySegment.hpp"
 #include "rts/dijkstra/DijkstraEngine.hpp"
@@ -69,8 +70,9 @@ int main(int argc,char* argv[]){
 	unsigned nodenum=numberOfNodes(db);
 	for (unsigned i=0; i < testNum; i++){
 		unsigned startid=rand()%nodenum;
+		BufferReference page;
 		const char* start=0,*stop=0; Type::ID type; unsigned subType;
-		db.getDictionary().lookupById(startid,start,stop,type,subType);
+		db.getDictionary().lookupById(startid,page,start,stop,type,subType);
 		if (type != Type::URI){
 			i--;
 			continue;
@@ -81,7 +83,7 @@ int main(int argc,char* argv[]){
 		approx=(approx==0)?1:approx;
 		DijkstraEngine scan1(db, order);
 		scan1.computeSP(startid);
-		unsigned exact=scan1.getSPMap().size();
+		unsigned exact=scan1.getReached().size();
 		if (exact<10){
 			i--;
 			continue;